@@ -1,3 +1,9 @@
 C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V shader.frag
+C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V depth_reduce.comp -o depth_reduce.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V occlusion_cull.comp -o occlusion_cull.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V particle_sim.comp -o particle_sim.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V particle.vert -o particle_vert.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V particle.frag -o particle_frag.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslangValidator.exe -V --target-env vulkan1.1 post_process.comp -o post_process.spv
 pause
\ No newline at end of file
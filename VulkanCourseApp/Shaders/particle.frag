@@ -0,0 +1,14 @@
+#version 450 		// Use GLSL 4.5
+
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in float fragAge;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	// Round soft particle, fading out over its life (blended additively)
+	const float falloff = 1.0 - clamp(dot(fragCorner, fragCorner), 0.0, 1.0);
+	const vec3 color = mix(vec3(1.0, 0.85, 0.4), vec3(0.9, 0.2, 0.05), fragAge);
+	outColor = vec4(color, falloff * (1.0 - fragAge));
+}
@@ -0,0 +1,46 @@
+#version 450 		// Use GLSL 4.5
+
+// Instanced quad per live particle: instance index is the slot on the alive list the update compacted in to
+struct Particle
+{
+	vec4 positionLife;		// w: seconds left
+	vec4 velocityLifetime;	// w: seconds it was emitted with
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Particles
+{
+	Particle particles[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Alive
+{
+	uint alive[];
+};
+
+layout(push_constant) uniform PushRender
+{
+	mat4 viewProjection;
+	vec2 size;				// Quad half size in clip space units
+} push;
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out float fragAge;
+
+// Two triangles, no vertex buffer
+const vec2 corners[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main()
+{
+	const Particle particle = particles[alive[gl_InstanceIndex]];
+	const vec2 corner = corners[gl_VertexIndex];
+
+	// Offset after projection so the quad always faces the screen and keeps its size
+	gl_Position = push.viewProjection * vec4(particle.positionLife.xyz, 1.0);
+	gl_Position.xy += corner * push.size * gl_Position.w;
+
+	fragCorner = corner;
+	fragAge = 1.0 - particle.positionLife.w / particle.velocityLifetime.w;
+}
@@ -6,7 +6,15 @@ layout(location = 0) in vec3 fragCol;
 
 layout(location = 0) out vec4 outColor; // Final output color (must also have location)
 
+// Debug view of the pipeline variant (see ShaderDebugView in ShaderVariants.h): 0 none, 1 depth
+layout(constant_id = 1) const int DEBUG_VIEW = 0;
+
 void main()
 {
+	if (DEBUG_VIEW == 1)
+	{
+		outColor = vec4(vec3(gl_FragCoord.z), 1.0);
+		return;
+	}
 	outColor = vec4(fragCol, 1.0);
 }
\ No newline at end of file
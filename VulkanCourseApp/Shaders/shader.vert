@@ -21,8 +21,16 @@ layout(location = 1) in vec3 col;
 
 layout(location = 0) out vec3 fragCol;
 
+layout(push_constant) uniform PushModel
+{
+	mat4 model;
+} pushModel;
+
+// Set per pipeline variant (see ShaderVariants.h), the unused path is compiled out
+layout(constant_id = 0) const bool VERTEX_COLOR = true;
+
 void main()
 {
-	gl_Position = vec4(pos, 1.0);
-	fragCol = col;
+	gl_Position = pushModel.model * vec4(pos, 1.0);
+	fragCol = VERTEX_COLOR ? col : vec3(1.0);
 }
\ No newline at end of file
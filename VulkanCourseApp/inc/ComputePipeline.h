@@ -0,0 +1,40 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <stdexcept>
+#include <vector>
+
+// A compute shader plus the pipeline layout it is dispatched with
+class ComputePipeline
+{
+public:
+	ComputePipeline() = default;
+	ComputePipeline(VkDevice newDevice, const std::vector<char>& shaderCode,
+		const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize = 0,
+		const VkSpecializationInfo* specializationInfo = nullptr);
+
+	VkPipeline GetPipeline() const;
+	VkPipelineLayout GetPipelineLayout() const;
+
+	// - Record functions
+	void Bind(VkCommandBuffer commandBuffer) const;
+	void BindDescriptorSets(VkCommandBuffer commandBuffer, const std::vector<VkDescriptorSet>& descriptorSets, uint32_t firstSet = 0) const;
+	void PushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size) const;
+	void Dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1) const;
+	void DispatchItems(VkCommandBuffer commandBuffer, uint32_t itemCount, uint32_t localSizeX) const;
+	void DispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer argumentBuffer, VkDeviceSize offset = 0) const;
+
+	void DestroyPipeline() const;
+
+	// Number of workgroups needed to cover itemCount invocations with workgroups of localSize
+	static uint32_t GroupCount(uint32_t itemCount, uint32_t localSize);
+
+	~ComputePipeline() = default;
+
+private:
+	VkDevice m_device{};
+	VkPipeline m_pipeline{};
+	VkPipelineLayout m_pipelineLayout{};
+	uint32_t m_uiPushConstantSize = 0;
+};
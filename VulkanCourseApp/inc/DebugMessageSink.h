@@ -0,0 +1,143 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Counters of everything that went through the sink
+struct DebugMessageStats
+{
+	uint64_t received = 0;			// Callback invocations
+	uint64_t rateLimited = 0;		// Repeats over the per message limit, only counted
+	uint64_t dropped = 0;			// Ring was full
+	uint64_t printed = 0;
+	uint64_t errors = 0;
+	uint64_t warnings = 0;
+	uint64_t performance = 0;		// VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT messages
+};
+
+// One kind of performance warning (e.g a layer's best practices message), counted instead of printed every time
+struct PerformanceMetric
+{
+	int32_t messageIdNumber = 0;
+	std::string messageIdName;
+	uint64_t count = 0;
+	std::string lastMessage;
+};
+
+// Asynchronous validation/debug message output
+// The debug callback runs on whatever thread made the API call, in the middle of it, so it only copies the message
+// in to a lock free multi producer ring and returns. A background thread drains the ring and does the slow part:
+// messages are deduplicated by message id (first one printed in full, repeats summarized once a second),
+// and performance messages become PerformanceMetric counters instead of console spam
+// Repeats past MESSAGES_PER_SECOND of one id are counted in the callback without being copied at all
+class DebugMessageSink
+{
+public:
+	static constexpr uint32_t RING_CAPACITY = 256;			// Power of two
+	static constexpr uint32_t MESSAGES_PER_SECOND = 8;		// Per message id, the rest is only counted
+	static constexpr size_t MAX_MESSAGE_LENGTH = 1024;		// Longer messages are truncated
+
+	DebugMessageSink() = default;
+
+	// Start before creating the instance, so instance creation messages are caught too
+	void StartDebugMessageSink();
+	// After destroying the instance. Prints what is still queued and a summary
+	void StopDebugMessageSink();
+
+	// Debug callback, any thread. Never blocks or allocates
+	void Push(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
+		const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+
+	// - Stats (thread safe)
+	DebugMessageStats GetStats() const;
+	std::vector<PerformanceMetric> GetPerformanceMetrics() const;
+	void PrintSummary() const;
+
+	~DebugMessageSink();
+
+	DebugMessageSink(DebugMessageSink& other) = delete;
+	DebugMessageSink& operator=(DebugMessageSink& other) = delete;
+
+private:
+	static constexpr uint32_t ID_TABLE_SIZE = 512;			// Power of two
+	static constexpr uint32_t ID_TABLE_PROBES = 16;
+
+	struct DebugMessage
+	{
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+		VkDebugUtilsMessageTypeFlagsEXT type = 0;
+		uint32_t key = 0;
+		int32_t messageIdNumber = 0;
+		char idName[64] = {};
+		char text[MAX_MESSAGE_LENGTH] = {};
+	};
+
+	// Bounded MPSC ring (sequence number per cell, producers claim positions with a CAS)
+	struct RingCell
+	{
+		std::atomic<size_t> sequence{ 0 };
+		DebugMessage message;
+	};
+
+	// Open addressing table of per id counters for the current second, shared by the callback and the drain thread
+	struct IdCounter
+	{
+		std::atomic<uint32_t> key{ 0 };			// 0 = empty
+		std::atomic<uint32_t> windowCount{ 0 };
+		std::atomic<uint32_t> rateLimited{ 0 };	// Not copied since the drain thread last looked
+	};
+
+	// What the drain thread knows about one message id
+	struct MessageRecord
+	{
+		std::string idName;
+		int32_t messageIdNumber = 0;
+		bool performance = false;
+		uint64_t count = 0;
+		uint64_t unreported = 0;		// Repeats since the last summary line
+		std::string lastMessage;
+	};
+
+	std::unique_ptr<RingCell[]> m_ring;
+	std::atomic<size_t> m_enqueuePosition{ 0 };
+	size_t m_dequeuePosition = 0;			// Drain thread only
+	std::unique_ptr<IdCounter[]> m_idCounters;
+
+	std::atomic<uint64_t> m_ullReceived{ 0 };
+	std::atomic<uint64_t> m_ullRateLimited{ 0 };
+	std::atomic<uint64_t> m_ullDropped{ 0 };
+
+	std::atomic<bool> m_bRunning{ false };	// Callbacks outside Start/Stop are ignored
+	std::thread m_drainThread;
+	std::mutex m_stopMutex;
+	std::condition_variable m_stopCondition;
+	bool m_bStopping = false;
+
+	// Written by the drain thread
+	mutable std::mutex m_recordMutex;
+	std::unordered_map<uint32_t, MessageRecord> m_mapRecords;
+	DebugMessageStats m_stats;
+
+	// - Callback side
+	IdCounter* FindIdCounter(uint32_t key);
+	bool TryEnqueue(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
+		uint32_t key, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+
+	// - Drain thread
+	void DrainLoop();
+	void Drain();
+	void ReportRepeats();
+	void Print(const DebugMessage& message, const MessageRecord& record);
+
+	static uint32_t GetMessageKey(const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+	static void CopyString(char* destination, size_t capacity, const char* source);
+	static const char* GetSeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity);
+};
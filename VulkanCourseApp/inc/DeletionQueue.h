@@ -0,0 +1,61 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "FrameTimeline.h"
+
+// GPU resources released while frames may still be using them
+// Every release is tagged with a frame timeline value and only destroyed by Collect once the GPU has passed it,
+// so destroying something at runtime (streaming content out, resizing targets) never needs vkDeviceWaitIdle/vkQueueWaitIdle
+class DeletionQueue
+{
+public:
+	DeletionQueue() = default;
+
+	void InitDeletionQueue(FrameTimeline* frameTimeline);
+
+	// Latest frame value that may reference a resource released from now on
+	// Render thread, at the start of every frame with the value of the frame being started
+	void SetCurrentValue(uint64_t frameValue);
+	uint64_t GetCurrentValue() const;
+
+	// - Release functions (thread safe)
+	// destroy runs once the current frame value has completed
+	void Defer(std::function<void()> destroy);
+	// destroy runs once frameValue has completed and isReady (if given) returns true, e.g an upload on another queue finished
+	void Defer(uint64_t frameValue, std::function<void()> destroy, std::function<bool()> isReady = nullptr);
+
+	// Render thread, once per frame. Destroys everything the GPU is done with
+	void Collect();
+	// Destroys everything left regardless of the GPU, only once the device is idle (shutdown)
+	void Flush();
+
+	size_t GetPendingCount() const;
+	uint64_t GetDestroyedCount() const;
+
+	~DeletionQueue() = default;
+
+	DeletionQueue(DeletionQueue& other) = delete;
+	DeletionQueue& operator=(DeletionQueue& other) = delete;
+
+private:
+	struct PendingDeletion
+	{
+		uint64_t frameValue = 0;
+		std::function<void()> destroy;
+		std::function<bool()> isReady;
+	};
+
+	FrameTimeline* m_pFrameTimeline = nullptr;
+	std::atomic<uint64_t> m_ullCurrentValue{ 0 };
+
+	mutable std::mutex m_mutex;
+	std::deque<PendingDeletion> m_dequePending;
+	std::vector<PendingDeletion> m_vecCollecting;		// Collect only, destroyed outside the lock so destroy can release more
+	std::atomic<uint64_t> m_ullDestroyedCount{ 0 };
+};
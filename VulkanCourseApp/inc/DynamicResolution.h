@@ -0,0 +1,44 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+struct DynamicResolutionSettings
+{
+	double targetFrameMs = 1000.0 / 60.0;	// GPU time budget of a frame
+	float minScale = 0.5f;					// Of the output extent, per axis
+	float maxScale = 1.0f;
+	double increaseHeadroom = 0.85;			// Only scale up while the average is below this fraction of the budget
+	float maxIncreaseStep = 0.05f;			// Per update, scaling up is gradual so it doesn't overshoot back over the budget
+	double smoothing = 0.2;					// Weight of a new measurement in the average that scaling up follows
+};
+
+// Picks the render resolution from measured GPU frame times
+// GPU time is taken to grow with the pixel count (scale squared), so the scale that fits a frame time is
+// scale * sqrt(budget / measured). Going over budget scales down straight away from that single measurement,
+// so a load spike costs resolution rather than missed frames; scaling back up follows the smoothed average
+// with headroom, a little per frame. Not thread safe, updated by the recording thread
+class DynamicResolutionController
+{
+public:
+	DynamicResolutionController() = default;
+
+	void InitDynamicResolution(const DynamicResolutionSettings& settings);
+
+	// gpuFrameMs: GPU time of a completed frame, returns the scale to render the next one at
+	float Update(double gpuFrameMs);
+
+	float GetScale() const;
+	double GetSmoothedFrameMs() const;		// Negative until the first measurement
+	const DynamicResolutionSettings& GetSettings() const;
+
+	// Extent at the current scale, at least 1x1 and never above outputExtent
+	VkExtent2D GetRenderExtent(VkExtent2D outputExtent) const;
+
+	~DynamicResolutionController() = default;
+
+private:
+	DynamicResolutionSettings m_settings;
+	float m_fScale = 1.0f;
+	double m_dSmoothedFrameMs = -1.0;
+};
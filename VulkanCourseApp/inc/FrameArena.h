@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Bump allocator for short lived CPU data (draw lists, barriers, submit infos)
+// Allocation is a pointer bump, deallocation does nothing, Reset frees everything at once
+// If a frame needs more than the block holds, the rest comes from the heap and the block is grown
+// to the peak on the next Reset, so steady state frames don't touch the heap at all
+// Not thread safe: one arena per thread/frame slot
+class LinearArena
+{
+public:
+	LinearArena() = default;
+	explicit LinearArena(size_t capacity);
+
+	void* Allocate(size_t size, size_t alignment);
+	void Reset();
+
+	size_t GetCapacity() const;
+	size_t GetUsed() const;
+	size_t GetPeak() const;				// Most bytes used between two resets so far
+	uint64_t GetOverflowCount() const;	// Allocations that had to go to the heap since creation
+
+	~LinearArena() = default;
+
+	LinearArena(LinearArena& other) = delete;
+	LinearArena& operator=(LinearArena& other) = delete;
+
+	// Restores the arena to where it was on construction, for scratch data inside one function
+	class Scope
+	{
+	public:
+		explicit Scope(LinearArena& arena);
+		~Scope();
+
+		Scope(Scope& other) = delete;
+		Scope& operator=(Scope& other) = delete;
+
+	private:
+		LinearArena& m_arena;
+		size_t m_offset;
+		size_t m_overflowBlocks;
+	};
+
+private:
+	std::unique_ptr<std::byte[]> m_block;
+	size_t m_capacity = 0;
+	size_t m_offset = 0;
+	size_t m_overflowBytes = 0;
+	size_t m_peak = 0;
+	uint64_t m_ullOverflowCount = 0;
+	std::vector<std::unique_ptr<std::byte[]>> m_vecOverflowBlocks;
+};
+
+// std compatible allocator over a LinearArena (e.g std::vector<T, ArenaAllocator<T>>)
+// Default constructed (null arena) it falls back to the heap, so arena backed containers can still be
+// declared as members and given an arena only where it matters
+template <typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	ArenaAllocator() noexcept = default;
+	explicit ArenaAllocator(LinearArena* arena) noexcept
+		: m_pArena(arena)
+	{}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+		: m_pArena(other.GetArena())
+	{}
+
+	T* allocate(size_t count)
+	{
+		if (m_pArena == nullptr)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+		return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, size_t) noexcept
+	{
+		// Arena memory goes away on Reset
+		if (m_pArena == nullptr)
+		{
+			::operator delete(pointer);
+		}
+	}
+
+	LinearArena* GetArena() const noexcept
+	{
+		return m_pArena;
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const noexcept
+	{
+		return m_pArena == other.GetArena();
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const noexcept
+	{
+		return m_pArena != other.GetArena();
+	}
+
+private:
+	LinearArena* m_pArena = nullptr;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,113 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameTimeline.h"
+#include "MemoryBudget.h"
+
+// Pixels of one captured frame, only valid for the duration of the callback
+struct CapturedFrame
+{
+	uint64_t frameValue = 0;		// Frame timeline value of the frame the pixels came from
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;		// Swapchain format, 4 bytes per pixel
+	uint32_t rowPitch = 0;
+	const char* data = nullptr;
+};
+
+using CaptureCallback = std::function<void(const CapturedFrame& frame)>;
+
+// Asynchronous swapchain readback
+// The frame's command buffer copies the presented image in to a free buffer of a ring of persistently mapped,
+// host cached readback buffers. Once the frame timeline shows the frame completed, the buffer is handed to a worker
+// thread which calls the callback (PNG/PPM writer, video stream, golden image compare) and gives the buffer back.
+// Nothing ever waits: when every buffer is still in use the frame simply isn't captured (counted as dropped)
+class FrameCapture
+{
+public:
+	static constexpr uint32_t CONTINUOUS = UINT32_MAX;
+
+	FrameCapture() = default;
+
+	void InitFrameCapture(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, FrameTimeline* frameTimeline,
+		VkExtent2D extent, VkFormat format, uint32_t ringSize);
+	// Device must be idle. Frames already copied are still delivered
+	void ShutdownFrameCapture();
+
+	// - Control (thread safe)
+	// Captures the next frameCount frames (CONTINUOUS until StopCapture), callback runs on the capture worker thread
+	void StartCapture(CaptureCallback callback, uint32_t frameCount = 1);
+	void StopCapture();
+	bool IsCapturing() const;
+
+	// Recording thread, after the frame's last use of the image and before it's ended. Returns false if this frame isn't captured
+	// imageLayout: TRANSFER_SRC_OPTIMAL when the caller has already synced the image for the copy (a frame graph pass reading
+	// it as a transfer source), or PRESENT_SRC, which is transitioned for the copy and back after every earlier command
+	bool RecordCapture(VkCommandBuffer commandBuffer, VkImage swapchainImage, VkImageLayout imageLayout, uint64_t frameValue);
+	// Render thread, once per frame. Hands completed copies to the worker
+	void Poll();
+
+	uint64_t GetCapturedCount() const;
+	uint64_t GetDroppedCount() const;
+
+	// Writes an 8 bit RGB binary PPM, swizzling BGRA formats
+	static bool WritePpm(const CapturedFrame& frame, const std::string& fileName);
+
+	// Only stops the worker if ShutdownFrameCapture wasn't called, Vulkan objects are left to the device
+	~FrameCapture();
+
+	FrameCapture(FrameCapture& other) = delete;
+	FrameCapture& operator=(FrameCapture& other) = delete;
+
+private:
+	enum class SlotState
+	{
+		Free,
+		InFlight,		// Copy recorded, frame not complete on the GPU yet
+		Processing		// With the worker
+	};
+
+	struct ReadbackSlot
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		const char* data = nullptr;
+		SlotState state = SlotState::Free;
+		uint64_t frameValue = 0;
+		CaptureCallback callback;		// Callback at the time the frame was recorded
+	};
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	FrameTimeline* m_pFrameTimeline = nullptr;
+	VkExtent2D m_extent{};
+	VkFormat m_format = VK_FORMAT_UNDEFINED;
+	VkDeviceSize m_frameSize = 0;
+	bool m_bCoherent = false;		// No invalidate needed before reading
+
+	mutable std::mutex m_mutex;
+	std::vector<ReadbackSlot> m_vecSlots;
+	CaptureCallback m_callback;
+	uint32_t m_uiFramesRemaining = 0;
+
+	std::thread m_worker;
+	std::condition_variable m_readyCondition;
+	std::deque<uint32_t> m_dequeReady;		// Slots waiting for the worker
+	bool m_bStopping = false;
+
+	std::atomic<uint64_t> m_ullCapturedCount{ 0 };
+	std::atomic<uint64_t> m_ullDroppedCount{ 0 };
+
+	void WorkerLoop();
+	void StopWorker();
+};
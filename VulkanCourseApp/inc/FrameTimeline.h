@@ -0,0 +1,47 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <stdexcept>
+
+// Single timeline semaphore counting GPU frames (Vulkan 1.2 core / VK_KHR_timeline_semaphore)
+// Every graphics submission signals the next value, so "frame N done" is just "counter >= N"
+// Anything that needs to know when the GPU is finished with something (reclamation, uploads, readback)
+// can remember the value of the frame that used it and compare against GetCompletedValue()
+class FrameTimeline
+{
+public:
+	FrameTimeline() = default;
+
+	void CreateTimeline(VkDevice newDevice);
+	void DestroyTimeline() const;
+
+	VkSemaphore GetSemaphore() const;
+
+	// Value the next submission should signal (advances the CPU side counter)
+	uint64_t AdvanceValue();
+	// Value signalled by the most recent submission
+	uint64_t GetLastSubmittedValue() const;
+
+	// Last value the GPU is known to have reached (queries the semaphore)
+	uint64_t GetCompletedValue();
+	// Cheap check, only queries the semaphore if the cached value isn't already past it
+	bool IsComplete(uint64_t value);
+	// Block until value reached (returns false on timeout)
+	bool Wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+
+	~FrameTimeline() = default;
+
+	FrameTimeline(FrameTimeline& other) = delete;
+	FrameTimeline(FrameTimeline&& other) = delete;
+	FrameTimeline& operator=(FrameTimeline& other) = delete;
+	FrameTimeline& operator=(FrameTimeline&& other) = delete;
+
+private:
+	VkDevice m_device{};
+	VkSemaphore m_semaphore{};
+
+	std::atomic<uint64_t> m_ullSubmittedValue{ 0 };	// Written by the submitting thread
+	std::atomic<uint64_t> m_ullCompletedValue{ 0 };	// Cached GPU progress, may be read from any thread
+};
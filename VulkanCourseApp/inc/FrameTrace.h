@@ -0,0 +1,117 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Utilities.h"
+
+// Frame traces: the scene the renderer was drawing and, per frame, the snapshot it was given and what it decided
+// (render resolution, level of detail, whether the mesh was resident). Replaying one feeds the same frames through
+// the renderer without the app or whatever produced its snapshots, so real workloads can be benchmarked and bisected
+//
+// File layout, little endian and tightly packed:
+//   FrameTraceHeader
+//   Records, each a FrameTraceRecordHeader followed by size bytes of payload
+//     Mesh    uint32 meshId, uint32 vertexCount, uint32 indexCount, Vertex[vertexCount], uint32[indexCount]
+//     Frame   FrameTracePacket
+// Every Mesh record comes before the first Frame. Readers skip record types they don't know, so new records can be
+// added without breaking old readers; any other layout change bumps FRAME_TRACE_VERSION, other versions are refused
+constexpr uint32_t FRAME_TRACE_MAGIC = 0x52544656;		// "VFTR"
+constexpr uint32_t FRAME_TRACE_VERSION = 1;
+
+// Renderer paths taken while recording. A replay that takes other paths (other device or build flags) runs,
+// but its timings aren't comparable with the recording's
+constexpr uint32_t FRAME_TRACE_FEATURE_DYNAMIC_RENDERING = 1u << 0;
+constexpr uint32_t FRAME_TRACE_FEATURE_OCCLUSION_CULLING = 1u << 1;
+constexpr uint32_t FRAME_TRACE_FEATURE_PARTICLES = 1u << 2;
+constexpr uint32_t FRAME_TRACE_FEATURE_DYNAMIC_RESOLUTION = 1u << 3;
+constexpr uint32_t FRAME_TRACE_FEATURE_POST_PROCESSING = 1u << 4;
+
+struct FrameTraceHeader
+{
+	uint32_t magic = FRAME_TRACE_MAGIC;
+	uint32_t version = FRAME_TRACE_VERSION;
+	uint32_t width = 0;				// Swapchain extent
+	uint32_t height = 0;
+	uint32_t msaaSamples = 1;
+	uint32_t shaderFeatures = 0;	// SHADER_FEATURE_* of the scene pipeline
+	uint32_t rendererFeatures = 0;	// FRAME_TRACE_FEATURE_*
+	uint32_t reserved = 0;
+};
+
+enum class FrameTraceRecordType : uint32_t
+{
+	Mesh = 1,
+	Frame = 2
+};
+
+struct FrameTraceRecordHeader
+{
+	FrameTraceRecordType type;
+	uint32_t size;					// Of the payload that follows
+};
+
+// One frame. The snapshot, then the renderer's own decisions, which a replay takes as recorded instead of making again
+struct FrameTracePacket
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	double time = 0.0;
+	uint32_t renderWidth = 0;		// Dynamic resolution's pick (the swapchain extent without it)
+	uint32_t renderHeight = 0;
+	uint32_t meshLod = 0;
+	uint32_t drawMesh = 0;			// Scene mesh was resident and drawn
+};
+
+// Geometry as the app handed it to the renderer, before optimization and simplification
+struct FrameTraceMesh
+{
+	uint32_t meshId = 0;
+	std::vector<Vertex> vecVertices;
+	std::vector<uint32_t> vecIndices;
+};
+
+struct FrameTrace
+{
+	FrameTraceHeader header;
+	std::vector<FrameTraceMesh> vecMeshes;
+	std::vector<FrameTracePacket> vecFrames;
+};
+
+// Whole trace in memory, so a replay never waits for the disk. Throws if the file can't be read, isn't a frame trace,
+// is of another version or is cut short
+FrameTrace LoadFrameTrace(const std::string& fileName);
+
+// Builds a trace in memory and writes it out when stopped, recording a frame never waits for the disk
+// (an hour at 60 fps is around 20 MB). Thread safe, frames can be recorded while another thread starts or stops the trace
+class FrameTraceRecorder
+{
+public:
+	FrameTraceRecorder() = default;
+
+	// meshes: everything the frames can draw, as it is when the trace starts. Restarts a running trace
+	void StartTrace(const std::string& fileName, const FrameTraceHeader& header, const std::vector<FrameTraceMesh>& meshes);
+	// Does nothing unless a trace is running
+	void RecordFrame(const FrameTracePacket& packet);
+	// Writes the file, returns false if nothing was being traced or it couldn't be written
+	bool StopTrace();
+
+	bool IsTracing() const;
+	uint64_t GetFrameCount() const;		// Of the running (or last) trace
+
+	~FrameTraceRecorder() = default;
+
+	FrameTraceRecorder(FrameTraceRecorder& other) = delete;
+	FrameTraceRecorder& operator=(FrameTraceRecorder& other) = delete;
+
+private:
+	mutable std::mutex m_mutex;
+	std::string m_strFileName;
+	std::vector<char> m_vecData;		// Header and records so far
+	bool m_bTracing = false;
+	uint64_t m_ullFrameCount = 0;
+
+	void AppendRecord(FrameTraceRecordType type, const void* payload, uint32_t size);
+	void AppendData(const void* data, size_t size);
+};
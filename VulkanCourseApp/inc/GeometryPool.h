@@ -0,0 +1,112 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "Utilities.h"
+#include "UploadService.h"
+#include "GpuResource.h"
+
+// Where one mesh lives in the pool, in elements (not bytes)
+// Indices are relative to the mesh's own vertices, vkCmdDrawIndexed adds vertexOffset
+struct GeometryRange
+{
+	uint32_t vertexOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+
+	bool IsValid() const { return vertexCount > 0; }
+};
+
+struct GeometryPoolStats
+{
+	uint32_t vertexCapacity = 0;
+	uint32_t vertexFree = 0;
+	uint32_t largestVertexRange = 0;	// Biggest mesh (in vertices) that still fits
+	uint32_t indexCapacity = 0;
+	uint32_t indexFree = 0;
+	uint32_t largestIndexRange = 0;
+	uint32_t meshCount = 0;
+};
+
+// First fit free list over [0, capacity), neighbouring free ranges are merged when freed
+// Not thread safe, GeometryPool locks around it
+class RangeAllocator
+{
+public:
+	RangeAllocator() = default;
+
+	void InitRangeAllocator(uint32_t capacity);
+	bool Allocate(uint32_t count, uint32_t& outOffset);
+	void Free(uint32_t offset, uint32_t count);
+
+	uint32_t GetCapacity() const;
+	uint32_t GetFreeCount() const;
+	uint32_t GetLargestFreeRange() const;
+
+private:
+	uint32_t m_uiCapacity = 0;
+	uint32_t m_uiFreeCount = 0;
+	std::map<uint32_t, uint32_t> m_mapFree;		// Offset -> count, ordered so neighbours are found when freeing
+};
+
+// Allocates range's vertices and indices (counts set, offsets written), both or neither: when the indices don't fit
+// the vertex range is freed again. Not thread safe, GeometryPool locks around it
+bool AllocateGeometryRange(RangeAllocator& vertexRanges, RangeAllocator& indexRanges, GeometryRange& range);
+
+// Static geometry of every mesh packed in to one device local vertex buffer and one index buffer
+// Drawing all of it needs a single Bind, each mesh is just a GeometryRange (firstIndex/vertexOffset of vkCmdDrawIndexed),
+// which is also what multi draw indirect needs. Meshes can be added and removed at any time, a removed range is only
+// reused once the frames that may draw it (and its upload) have completed
+class GeometryPool
+{
+public:
+	GeometryPool() = default;
+
+	// Buffers are shared by the graphics and transfer families of queueFamilyIndices, as the upload service uses them
+	void InitGeometryPool(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, const QueueFamilyIndices& queueFamilyIndices,
+		MemoryBudget* memoryBudget, DeletionQueue* deletionQueue, uint32_t vertexCapacity, uint32_t indexCapacity);
+	// Buffers are released through the deletion queue, so before flushing it
+	void ShutdownGeometryPool();
+
+	// - Mesh functions (thread safe)
+	// Returns false if the pool has no room left (nothing is allocated then)
+	bool Add(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, UploadService& uploadService,
+		GeometryRange& outRange, UploadFuture& outVertexUpload, UploadFuture& outIndexUpload);
+	// Range becomes free once the current frame and both uploads have completed
+	void Remove(const GeometryRange& range, const UploadFuture& vertexUpload, const UploadFuture& indexUpload);
+
+	// Binds the vertex and index buffers, every pooled mesh can then be drawn with its range
+	void Bind(VkCommandBuffer commandBuffer) const;
+
+	VkBuffer GetVertexBuffer() const;
+	VkBuffer GetIndexBuffer() const;
+	GeometryPoolStats GetStats() const;
+
+	~GeometryPool() = default;
+
+	GeometryPool(GeometryPool& other) = delete;
+	GeometryPool& operator=(GeometryPool& other) = delete;
+
+private:
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	DeletionQueue* m_pDeletionQueue = nullptr;
+	uint32_t m_arrQueueFamilies[2] = {};	// Graphics, transfer
+	bool m_bConcurrent = false;				// Families differ, buffers are VK_SHARING_MODE_CONCURRENT
+
+	GpuBuffer m_vertexBuffer;
+	GpuBuffer m_indexBuffer;
+
+	mutable std::mutex m_mutex;
+	RangeAllocator m_vertexRanges;
+	RangeAllocator m_indexRanges;
+	uint32_t m_uiMeshCount = 0;
+
+	void FreeRange(const GeometryRange& range);
+	GpuBuffer CreatePoolBuffer(VkDeviceSize size, VkBufferUsageFlags usage) const;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <functional>
+#include "MemoryBudget.h"
+#include "DeletionQueue.h"
+
+// Owning handles for GPU resources, move-only
+// Destruction releases through the DeletionQueue (if given), so dropping a resource the GPU may still be reading
+// never stalls. Without a deletion queue they're destroyed straight away, which is only safe once the device is idle
+// Memory goes back through the MemoryBudget it was allocated from (if given)
+
+class GpuBuffer
+{
+public:
+	GpuBuffer() = default;
+	GpuBuffer(VkDevice newDevice, VkBuffer buffer, VkDeviceMemory memory, MemoryBudget* memoryBudget, DeletionQueue* deletionQueue);
+
+	GpuBuffer(GpuBuffer&& other) noexcept;
+	GpuBuffer& operator=(GpuBuffer&& other) noexcept;
+
+	VkBuffer GetBuffer() const;
+	VkDeviceMemory GetMemory() const;
+	bool IsValid() const;
+
+	// Hands the handles to the deletion queue, tagged with its current frame value
+	// isReady (if given) holds the deletion back further, e.g until an upload in to the buffer has finished
+	void Release(std::function<bool()> isReady = nullptr);
+	// Destroys straight away, the caller knows the GPU is done with it (e.g memory budget eviction)
+	void DestroyNow();
+
+	~GpuBuffer();
+
+	GpuBuffer(GpuBuffer& other) = delete;
+	GpuBuffer& operator=(GpuBuffer& other) = delete;
+
+private:
+	VkDevice m_device{};
+	VkBuffer m_buffer{};
+	VkDeviceMemory m_memory{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	DeletionQueue* m_pDeletionQueue = nullptr;
+
+	static void Destroy(VkDevice device, VkBuffer buffer, VkDeviceMemory memory, MemoryBudget* memoryBudget);
+	void Reset();
+};
+
+class GpuImage
+{
+public:
+	GpuImage() = default;
+	GpuImage(VkDevice newDevice, VkImage image, VkImageView imageView, VkDeviceMemory memory, MemoryBudget* memoryBudget,
+		DeletionQueue* deletionQueue);
+
+	GpuImage(GpuImage&& other) noexcept;
+	GpuImage& operator=(GpuImage&& other) noexcept;
+
+	VkImage GetImage() const;
+	VkImageView GetImageView() const;
+	VkDeviceMemory GetMemory() const;
+	bool IsValid() const;
+
+	void Release(std::function<bool()> isReady = nullptr);
+	void DestroyNow();
+
+	~GpuImage();
+
+	GpuImage(GpuImage& other) = delete;
+	GpuImage& operator=(GpuImage& other) = delete;
+
+private:
+	VkDevice m_device{};
+	VkImage m_image{};
+	VkImageView m_imageView{};
+	VkDeviceMemory m_memory{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	DeletionQueue* m_pDeletionQueue = nullptr;
+
+	static void Destroy(VkDevice device, VkImage image, VkImageView imageView, VkDeviceMemory memory, MemoryBudget* memoryBudget);
+	void Reset();
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts unfinished jobs. Incremented when a job is scheduled with it, decremented when the job finishes
+// Jobs scheduled with a counter as their dependency are held back until it reaches zero
+// Must outlive every job that references it
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	bool IsDone() const;
+
+	JobCounter(JobCounter& other) = delete;
+	JobCounter& operator=(JobCounter& other) = delete;
+
+private:
+	friend class JobSystem;
+
+	struct PendingJob
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+		bool mainThread;
+	};
+
+	std::atomic<int> m_iValue{ 0 };
+	std::mutex m_mutex;								// Guards m_vecWaiting against the transition to zero
+	std::vector<PendingJob> m_vecWaiting;
+};
+
+// Work stealing job scheduler
+// One deque per thread (the main thread counts as one): the owner pushes and pops at the back (hot in cache),
+// idle threads steal from the front of someone else's. Jobs that must run on the main thread (GLFW window calls)
+// go to a separate queue that only the main thread drains, inside Wait or RunMainThreadJobs
+class JobSystem
+{
+public:
+	JobSystem() = default;
+
+	// workerCount 0 = one worker per hardware thread besides the main thread (can be 0 on a single core machine,
+	// then everything runs on the main thread inside Wait)
+	void InitJobSystem(uint32_t workerCount = 0);
+	void ShutdownJobSystem();
+
+	void Run(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+	void RunOnMainThread(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+	// Splits [0, count) in to jobs of batchSize items, function(begin, end) per job
+	void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& function, JobCounter* counter);
+
+	// Runs other jobs until counter reaches zero (main thread also runs main thread jobs)
+	// Afterwards the counter can be reused or destroyed
+	void Wait(JobCounter& counter);
+	void RunMainThreadJobs();
+
+	uint32_t GetWorkerCount() const;
+	bool IsMainThread() const;
+
+	~JobSystem();
+
+	JobSystem(JobSystem& other) = delete;
+	JobSystem(JobSystem&& other) = delete;
+	JobSystem& operator=(JobSystem& other) = delete;
+	JobSystem& operator=(JobSystem&& other) = delete;
+
+private:
+	using Job = JobCounter::PendingJob;
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	// [0] main thread (and any thread that isn't a worker), [1..] workers
+	std::vector<std::unique_ptr<WorkQueue>> m_vecQueues;
+	WorkQueue m_mainThreadQueue;
+	std::vector<std::thread> m_vecWorkers;
+	std::thread::id m_mainThreadId;
+
+	std::atomic<bool> m_bStopping{ false };
+	std::atomic<uint32_t> m_uiQueuedJobs{ 0 };		// Jobs in m_vecQueues (not main thread ones), lets idle workers sleep
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+
+	void Schedule(Job job, JobCounter* dependency);
+	void Push(Job job);
+	bool TryPop(uint32_t queueIndex, Job& outJob);
+	bool TrySteal(uint32_t queueIndex, Job& outJob);
+	bool TryPopMainThread(Job& outJob);
+	void Execute(Job& job);
+	void WorkerLoop(uint32_t queueIndex);
+	uint32_t GetQueueIndex() const;
+};
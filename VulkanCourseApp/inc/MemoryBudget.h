@@ -0,0 +1,130 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "FrameTimeline.h"
+
+// What an allocation is for, usage is tracked per category as well as per heap
+enum class MemoryCategory
+{
+	Mesh,
+	Texture,
+	Staging,
+	RenderTarget,
+	Readback,
+	Other,
+	Count
+};
+
+struct MemoryHeapStats
+{
+	VkDeviceSize size = 0;				// Heap size reported by the device
+	VkDeviceSize budget = 0;			// How much this process should use (VK_EXT_memory_budget, or a share of the heap)
+	VkDeviceSize usage = 0;				// Estimated current use by this process
+	VkDeviceSize trackedBytes = 0;		// Allocated through MemoryBudget
+};
+
+struct MemoryCategoryStats
+{
+	VkDeviceSize bytes = 0;
+	uint32_t allocationCount = 0;
+};
+
+// Snapshot of the counters, cheap to take every frame
+struct MemoryBudgetStats
+{
+	bool budgetExtension = false;
+	uint32_t heapCount = 0;
+	std::array<MemoryHeapStats, VK_MAX_MEMORY_HEAPS> heaps{};
+	std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::Count)> categories{};
+	uint64_t allocationCount = 0;		// Successful allocations since creation
+	uint64_t refusedAllocations = 0;	// Streamable allocations refused because the heap was over budget
+	uint64_t failedAllocations = 0;		// Allocations the driver failed
+	uint64_t evictionCount = 0;
+	VkDeviceSize evictedBytes = 0;
+};
+
+// Device memory accounting with least recently used eviction
+// All vkAllocateMemory/vkFreeMemory calls go through here so usage is known per heap and per category
+// Budget comes from VK_EXT_memory_budget when the device has it (refreshed once per frame, plus allocations made since),
+// otherwise a fixed share of each heap
+//
+// Mesh and texture allocations are streamable: instead of letting the driver fail, an allocation that would go over
+// budget is refused and the next UpdateBudget evicts least recently used evictable allocations the GPU is done with.
+// Callers treat a refused allocation as "not resident yet" and try again later
+class MemoryBudget
+{
+public:
+	MemoryBudget() = default;
+
+	void InitMemoryBudget(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, bool budgetExtensionEnabled, FrameTimeline* frameTimeline);
+
+	// Once per frame, from the thread that owns the evictable resources (render thread, between frames)
+	void UpdateBudget();
+
+	// - Allocation functions (thread safe)
+	VkResult Allocate(const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category, VkDeviceMemory* outMemory);
+	void Free(VkDeviceMemory memory);
+
+	// - Eviction
+	// evict must release the allocation (through Free). Called from UpdateBudget only
+	void SetEvictable(VkDeviceMemory memory, std::function<void()> evict);
+	// Before releasing an evictable allocation some other way (e.g through a DeletionQueue)
+	void ClearEvictable(VkDeviceMemory memory);
+	// Allocation is used by the frame that signals frameValue, it won't be evicted before that frame completes
+	void Touch(VkDeviceMemory memory, uint64_t frameValue);
+
+	MemoryBudgetStats GetStats() const;
+	void PrintStats() const;
+
+	~MemoryBudget() = default;
+
+	MemoryBudget(MemoryBudget& other) = delete;
+	MemoryBudget& operator=(MemoryBudget& other) = delete;
+
+private:
+	struct Allocation
+	{
+		VkDeviceSize size = 0;
+		uint32_t heapIndex = 0;
+		MemoryCategory category = MemoryCategory::Other;
+		bool evictable = false;
+		std::list<VkDeviceMemory>::iterator lruPosition;	// Valid if evictable
+		uint64_t lastUse = 0;
+		std::function<void()> evict;
+	};
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	FrameTimeline* m_pFrameTimeline = nullptr;
+	bool m_bBudgetExtension = false;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+
+	// Evict callbacks call Free, so the lock must be re-entrant
+	mutable std::recursive_mutex m_mutex;
+	std::unordered_map<VkDeviceMemory, Allocation> m_mapAllocations;
+	std::list<VkDeviceMemory> m_listLru;				// Evictable allocations, least recently used first
+
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_arrBudget{};
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_arrDriverUsage{};		// Usage reported at the last UpdateBudget
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_arrTrackedAtUpdate{};	// Tracked bytes at the last UpdateBudget
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_arrTracked{};
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_arrRequested{};		// Refused bytes waiting for eviction
+	std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::Count)> m_arrCategories{};
+
+	uint64_t m_ullAllocationCount = 0;
+	uint64_t m_ullRefusedAllocations = 0;
+	uint64_t m_ullFailedAllocations = 0;
+	uint64_t m_ullEvictionCount = 0;
+	VkDeviceSize m_evictedBytes = 0;
+
+	VkDeviceSize GetHeapUsage(uint32_t heapIndex) const;
+	static bool IsStreamable(MemoryCategory category);
+	static const char* GetCategoryName(MemoryCategory category);
+};
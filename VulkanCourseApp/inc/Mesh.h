@@ -4,30 +4,105 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include "Utilities.h"
+#include "UploadService.h"
+#include "GpuResource.h"
+#include "MeshLod.h"
+#include "MeshOptimizer.h"
+#include "GeometryPool.h"
 
+// Move-only, the vertex buffer is owned through a GpuBuffer
+// With a deletion queue, destroying (or replacing) a mesh defers freeing its buffer until the GPU is done with it
 class Mesh
 {
 public:
 	Mesh() = default;
-	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices);
+	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, DeletionQueue* deletionQueue = nullptr);
+	// Device local vertex buffer filled in the background by uploadService, check IsUploaded before drawing
+	// With a memoryBudget the mesh is streamable: a CPU copy of the vertices is kept, the buffer may be evicted
+	// when memory runs low and is only created again (EnsureResident) once the budget has room
+	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, UploadService& uploadService,
+		MemoryBudget* memoryBudget = nullptr, DeletionQueue* deletionQueue = nullptr);
+	// Indexed, with up to lodCount levels of detail simplified at load (see MeshLod.h) sharing the vertex and index buffers
+	// Vertices and indices are copied and reordered (OPTIMIZE_MESHES), the caller's vectors are left as they are
+	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+		UploadService& uploadService, MemoryBudget* memoryBudget = nullptr, DeletionQueue* deletionQueue = nullptr, uint32_t lodCount = 1);
+	// Indexed and prepared the same way, but stored in geometryPool's shared buffers instead of buffers of its own
+	// Falls back to its own buffers when the pool is full. Pooled meshes are never evicted
+	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+		GeometryPool& geometryPool, UploadService& uploadService, DeletionQueue* deletionQueue = nullptr, uint32_t lodCount = 1);
+
+	Mesh(Mesh&& other) noexcept;
+	Mesh& operator=(Mesh&& other) noexcept;
 
 	unsigned long long GetVertexCount() const;
 	VkBuffer GetVertexBuffer() const;
+	VkBuffer GetIndexBuffer() const;
+	bool HasIndices() const;
+	// Index ranges of every level, empty if the mesh isn't indexed
+	const std::vector<MeshLod>& GetLods() const;
+	// Axis aligned bounds of the vertices, in model space
+	const glm::vec3& GetBoundsMin() const;
+	const glm::vec3& GetBoundsMax() const;
+	// Vertex cache efficiency of the full detail level before and after OPTIMIZE_MESHES reordered it (zero if it didn't)
+	const MeshOptimizationStats& GetOptimizationStats() const;
+	bool IsUploaded() const;
+
+	// - Geometry pool
+	bool IsPooled() const;
+	// Where the mesh starts in the bound vertex/index buffers (0 when it has buffers of its own)
+	// Draw a level with firstIndex = GetFirstIndex() + lod.firstIndex and vertexOffset = GetVertexOffset()
+	uint32_t GetVertexOffset() const;
+	uint32_t GetFirstIndex() const;
+
+	// - Streaming (only meaningful with a memory budget)
+	bool IsResident() const;
+	// Recreates and re-uploads an evicted (or refused) buffer, does nothing if the budget still has no room
+	void EnsureResident();
+	// Mesh is drawn by the frame signalling frameValue, so the buffer isn't evicted before that frame completes
+	void Touch(uint64_t frameValue);
 
-	void DestroyVertexBuffer() const;
+	// Releases the vertex and index buffers (deferred when the mesh has a deletion queue), also done on destruction
+	void DestroyVertexBuffer();
 
-	~Mesh() = default;
+	~Mesh();
+
+	Mesh(Mesh& other) = delete;
+	Mesh& operator=(Mesh& other) = delete;
 
 protected:
-	unsigned long long m_ullVertexCount;
-	VkBuffer m_VertexBuffer{};
-	VkDeviceMemory m_VertexBufferMemory{};
+	unsigned long long m_ullVertexCount = 0;
+	GpuBuffer m_vertexBuffer;
+	GpuBuffer m_indexBuffer;
+	std::vector<MeshLod> m_vecLods;
+	glm::vec3 m_boundsMin = glm::vec3(0.0f);
+	glm::vec3 m_boundsMax = glm::vec3(0.0f);
+	MeshOptimizationStats m_optimizationStats;
+
+	VkPhysicalDevice m_PhysicalDevice{};
+	VkDevice m_Device{};
+	std::vector<Vertex>* vertices_ = nullptr;
+	UploadFuture m_uploadFuture;			// Not valid for host visible buffers, they are ready straight away
+	UploadFuture m_indexUploadFuture;
+
+	UploadService* m_pUploadService = nullptr;
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	DeletionQueue* m_pDeletionQueue = nullptr;
+	std::vector<Vertex> m_vecStreamingVertices;	// Kept to restore evicted buffers
+	std::vector<uint32_t> m_vecStreamingIndices;
+	bool m_bEvictable = false;				// Eviction callback registered for the current buffer
+	GeometryPool* m_pGeometryPool = nullptr;
+	GeometryRange m_geometryRange;			// Valid while the mesh lives in the pool
 
-	VkPhysicalDevice m_PhysicalDevice;
-	VkDevice m_Device;
-	std::vector<Vertex>* vertices_;
+	void ComputeBounds(const std::vector<Vertex>& vertices);
+	void PrepareIndexedGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t lodCount,
+		std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices);
 
 	void CreateVertexBuffer(const std::vector<Vertex>* vertices);
+	void CreateDeviceLocalBuffers(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, UploadService& uploadService);
+	bool CreateDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkAccessFlags dstAccess,
+		UploadService& uploadService, GpuBuffer& outBuffer, UploadFuture& outUploadFuture);
+	void Evict();
+	static void ReleaseBuffer(GpuBuffer& buffer, UploadFuture& uploadFuture);
 	VkResult FindMemoryTypeIndex(uint32_t allowedTypes, VkMemoryPropertyFlags properties, uint32_t& outTypeIndex) const;
 };
 
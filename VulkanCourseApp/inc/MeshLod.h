@@ -0,0 +1,42 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+#include "Utilities.h"
+
+// One level of detail, a range of the mesh's shared index buffer
+struct MeshLod
+{
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f;			// Object space distance the level may be off from the full detail mesh
+};
+
+// Level 0 is the full detail mesh, every level after it has about lodReduction as many triangles as the one before
+// All levels index the same vertices, so they share one vertex buffer and one index buffer
+struct MeshLodChain
+{
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+};
+
+// Quadric error metric simplification (Garland & Heckbert) by collapsing edges on to one of their vertices
+// Vertices are never moved or created, only referenced less. Border and attribute seam vertices are kept in place,
+// so silhouettes of open meshes and color seams survive. outError is the object space error of the result
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float& outError);
+
+// Stops early when a level can't get meaningfully smaller than the one before it
+MeshLodChain BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	uint32_t maxLodCount = 4, float lodReduction = 0.5f);
+
+// Pixels one object space unit covers on screen
+// Perspective: viewport height / (2 * tan(fovY / 2) * distance to the camera), scaled by the instance's scale
+float GetPixelsPerUnit(float viewportHeight, float fovY, float distance, float scale);
+
+// Coarsest level whose error projects to at most maxPixelError pixels
+// Going coarser than currentLod needs the error below maxPixelError * (1 - hysteresis), going back finer happens
+// as soon as the current level is over maxPixelError, so an instance sitting on a threshold doesn't pop every frame
+uint32_t SelectLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError, uint32_t currentLod, float hysteresis);
@@ -0,0 +1,35 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+#include "Utilities.h"
+
+// Post-transform vertex cache efficiency of an index buffer, from a FIFO cache simulation
+struct VertexCacheStats
+{
+	float acmr = 0.0f;		// Average cache miss ratio: vertex shader invocations per triangle (0.5 ideal, 3 worst)
+	float atvr = 0.0f;		// Average transformed vertex ratio: invocations per vertex used (1 ideal)
+};
+
+struct MeshOptimizationStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+// - Mesh build passes, in the order they're meant to run
+// Reorders triangles so recently transformed vertices get reused (Forsyth's linear-speed vertex cache optimisation)
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+// Reorders clusters of the cache optimised triangles so outward facing ones come first (Sander et al. / Tipsify),
+// drawing what's likely in front before what it hides. threshold is how much worse than the input the cluster ACMR may get
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+// Reorders vertices in to the order the indices first use them so vertex fetch reads memory linearly, rewrites indices to match
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// All three passes, returns the vertex cache numbers before and after
+MeshOptimizationStats OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
@@ -0,0 +1,132 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <vector>
+#include "Utilities.h"
+#include "MemoryBudget.h"
+#include "ComputePipeline.h"
+
+// One object to cull, laid out as the cull shader reads it (std430)
+// Bounds are in the space the view projection given to the cull functions takes to clip space
+struct OcclusionCullObject
+{
+	glm::vec4 boundsMin;		// w unused
+	glm::vec4 boundsMax;
+	uint32_t firstIndex = 0;	// Draw arguments, already offset to where the mesh lives in the bound buffers
+	uint32_t indexCount = 0;	// 0 = nothing to draw
+	int32_t vertexOffset = 0;
+	uint32_t padding = 0;
+};
+
+// Two phase hierarchical Z occlusion culling on the GPU
+// A depth pyramid (every level holds the farthest depth of the 2x2 texels above it) is built in compute from the depth
+// buffer after the early draws, and kept for the next frame. Each frame:
+//   1. RecordEarlyCull   frustum test, then bounds against the previous frame's pyramid
+//   2. RecordEarlyDraws  what passed, in a render pass that keeps its depth
+//   3. RecordDepthPyramid from that depth
+//   4. RecordLateCull    what the early test rejected for occlusion, against the new pyramid
+//   5. RecordLateDraws   what turned out visible after all (false negatives of the stale pyramid)
+// Draws come from compacted indirect command buffers with a GPU written count, firstInstance is the object index
+// All buffers and the pyramid are shared by every frame, frames are ordered on one queue and synced by barriers
+class OcclusionCuller
+{
+public:
+	OcclusionCuller() = default;
+
+	// depthView: single sample depth the pyramid is built from, in DEPTH_STENCIL_READ_ONLY_OPTIMAL when RecordDepthPyramid runs
+	void InitOcclusionCuller(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, uint32_t maxObjects,
+		VkImageView depthView, VkExtent2D depthExtent, const std::vector<char>& reduceShaderCode, const std::vector<char>& cullShaderCode);
+	// Device must be idle
+	void ShutdownOcclusionCuller();
+
+	// Recording thread, before the cull functions of the frame. Objects past GetMaxObjects are ignored
+	void SetObjects(uint32_t frameSlot, const OcclusionCullObject* objects, uint32_t objectCount);
+
+	// - Record functions (outside rendering, except the draws)
+	void RecordEarlyCull(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection);
+	// renderExtent: region of the depth view (from its origin) the frame rendered to, the pyramid always covers all of it
+	void RecordDepthPyramid(VkCommandBuffer commandBuffer, VkExtent2D renderExtent);
+	void RecordLateCull(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection);
+	// Graphics pipeline and the vertex/index buffers the objects' draw arguments point in to must be bound
+	void RecordEarlyDraws(VkCommandBuffer commandBuffer) const;
+	void RecordLateDraws(VkCommandBuffer commandBuffer) const;
+
+	uint32_t GetMaxObjects() const;
+	VkExtent2D GetPyramidExtent() const;
+	uint32_t GetPyramidLevels() const;
+
+	~OcclusionCuller() = default;
+
+	OcclusionCuller(OcclusionCuller& other) = delete;
+	OcclusionCuller& operator=(OcclusionCuller& other) = delete;
+
+private:
+	struct ReducePushConstants
+	{
+		int32_t srcSize[2];
+		int32_t dstSize[2];
+	};
+
+	struct CullPushConstants
+	{
+		glm::mat4 viewProjection;
+		float pyramidSize[2];
+		uint32_t objectCount;
+		uint32_t latePhase;
+		uint32_t occlusionEnabled;
+		uint32_t pyramidLevels;
+	};
+
+	// Buffer with its own memory, mapped is only set for host visible ones
+	struct CullBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+	};
+
+	static constexpr uint32_t CULL_GROUP_SIZE = 64;		// local_size_x of occlusion_cull.comp
+	static constexpr uint32_t REDUCE_GROUP_SIZE = 8;	// local_size_x/y of depth_reduce.comp
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	uint32_t m_uiMaxObjects = 0;
+	std::array<uint32_t, MAX_FRAME_DRAWS> m_arrObjectCounts{};
+
+	// - Buffers
+	std::array<CullBuffer, MAX_FRAME_DRAWS> m_arrObjectBuffers;		// Written by the CPU, one per frame slot
+	CullBuffer m_stateBuffer;			// Per object result of the early phase, read by the late phase
+	CullBuffer m_earlyDrawBuffer;
+	CullBuffer m_lateDrawBuffer;
+	CullBuffer m_drawCountBuffer;		// Early count, late count
+
+	// - Depth pyramid
+	VkExtent2D m_depthExtent = {};			// Largest the rendered region can be, the pyramid is sized for it
+	VkExtent2D m_pyramidExtent = {};
+	uint32_t m_uiPyramidLevels = 0;
+	VkImage m_pyramidImage = VK_NULL_HANDLE;
+	VkDeviceMemory m_pyramidMemory = VK_NULL_HANDLE;
+	VkImageView m_pyramidView = VK_NULL_HANDLE;				// Every level, sampled by the cull shader
+	std::vector<VkImageView> m_vecPyramidLevelViews;		// One level each, written by the reduction
+	VkSampler m_sampler = VK_NULL_HANDLE;
+	bool m_bPyramidValid = false;		// Holds a depth buffer, false until the first pyramid is recorded
+
+	// - Pipelines
+	VkDescriptorSetLayout m_reduceSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_vecReduceSets;			// One per pyramid level
+	std::array<VkDescriptorSet, MAX_FRAME_DRAWS> m_arrCullSets{};
+	ComputePipeline m_reducePipeline;
+	ComputePipeline m_cullPipeline;
+
+	void CreateBuffers();
+	void CreatePyramid();
+	void CreateDescriptors(VkImageView depthView);
+	CullBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category) const;
+	void DestroyBuffer(CullBuffer& buffer) const;
+	void RecordCull(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection, bool latePhase) const;
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <vector>
+#include "Utilities.h"
+#include "MemoryBudget.h"
+#include "ComputePipeline.h"
+#include "QueueSync.h"
+
+// What the particles are drawn in to, the pipeline is created against it
+struct ParticleRenderTarget
+{
+	VkRenderPass renderPass = VK_NULL_HANDLE;		// Subpass 0, or VK_NULL_HANDLE for dynamic rendering with the formats below
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	VkExtent2D extent = {};
+	bool dynamicViewport = false;					// Viewport and scissor are set by the caller when rendering, extent is the full output
+};
+
+// Shape of the emitter, changed at any time from the recording thread
+struct ParticleEmitterSettings
+{
+	glm::vec3 position = glm::vec3(0.0f, 0.5f, 0.5f);	// Clip space while there is no camera
+	float emitRate = 0.0f;								// Particles per second
+	float speed = 1.0f;									// Clip space units per second
+	float maxLifetime = 2.0f;							// Seconds, each particle lives a random 25-100% of it
+	glm::vec3 gravity = glm::vec3(0.0f, 1.0f, 0.0f);
+	float size = 4.0f;									// Quad size in pixels
+};
+
+// GPU particle system: emit, update and compaction all run in compute on GPU buffers, drawn with one indirect
+// instanced draw whose instance count the update builds with an atomic counter. Per frame the CPU only records
+// four dispatches and a draw with a handful of push constants, however many particles are alive
+//
+//   Prepare  (1 invocation)          clamps this frame's emit count to the free particles, writes the indirect arguments
+//   Emit     (indirect, per emitted) takes indices off the dead list, appends them to the current alive list
+//   Update   (indirect, per alive)   integrates, returns dead particles to the dead list, compacts survivors in to the
+//                                    other alive list, which the draw reads and the next frame updates
+//
+// All buffers are shared by every frame. The simulation may run on another queue than the draw (async compute):
+// the caller orders the two with semaphores, previous draw -> simulation -> draw, and when the queue families differ
+// the buffers the draw reads are handed over with RecordDrawAcquire/RecordDrawRelease around the frame's draws
+class ParticleSystem
+{
+public:
+	ParticleSystem() = default;
+
+	// simulationShaderCode: particle_sim.comp, one pipeline per stage is specialized from it
+	// simulationFamily/drawFamily: queue families RecordSimulation and RecordDraw are submitted to
+	void InitParticleSystem(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, uint32_t capacity,
+		uint32_t simulationFamily, uint32_t drawFamily, const ParticleRenderTarget& renderTarget, const std::vector<char>& simulationShaderCode,
+		const std::vector<char>& vertexShaderCode, const std::vector<char>& fragmentShaderCode);
+	// Device must be idle
+	void ShutdownParticleSystem();
+
+	void SetEmitter(const ParticleEmitterSettings& settings);
+	const ParticleEmitterSettings& GetEmitter() const;
+
+	// - Record functions
+	// Simulation family, once per frame before the draws. deltaTime of 0 (e.g the same snapshot drawn again) emits and moves nothing
+	void RecordSimulation(VkCommandBuffer commandBuffer, float deltaTime);
+	// Draw family, outside rendering: before the frame's first RecordDraw and after its last one
+	// Every frame that simulated records both. Nothing to record when the families are the same
+	void RecordDrawAcquire(VkCommandBuffer commandBuffer) const;
+	void RecordDrawRelease(VkCommandBuffer commandBuffer);
+	// Inside rendering, draws what the last RecordSimulation left alive
+	void RecordDraw(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection) const;
+
+	uint32_t GetCapacity() const;
+
+	~ParticleSystem() = default;
+
+	ParticleSystem(ParticleSystem& other) = delete;
+	ParticleSystem& operator=(ParticleSystem& other) = delete;
+
+private:
+	// Layout of the State buffer in particle_sim.comp, the indirect arguments are read straight out of it
+	struct ParticleState
+	{
+		uint32_t deadCount;
+		uint32_t emitCount;
+		uint32_t aliveCount;
+		uint32_t padding0;
+		VkDispatchIndirectCommand emitDispatch;
+		uint32_t padding1;
+		VkDispatchIndirectCommand updateDispatch;
+		uint32_t padding2;
+		VkDrawIndirectCommand draw;
+	};
+
+	struct SimulationPushConstants
+	{
+		glm::vec4 emitter;			// xyz: position, w: speed
+		glm::vec4 gravity;			// w: delta time
+		uint32_t requestedEmitCount;
+		uint32_t capacity;
+		uint32_t seed;
+		float maxLifetime;
+	};
+
+	struct RenderPushConstants
+	{
+		glm::mat4 viewProjection;
+		glm::vec2 size;
+	};
+
+	// Values of STAGE in particle_sim.comp
+	enum class SimulationStage : uint32_t
+	{
+		Init,
+		Prepare,
+		Emit,
+		Update,
+		Count
+	};
+
+	// Buffer with its own memory
+	struct ParticleBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+	};
+
+	static constexpr uint32_t SIMULATION_GROUP_SIZE = 64;		// local_size_x of particle_sim.comp
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	uint32_t m_uiCapacity = 0;
+	uint32_t m_uiSimulationFamily = 0;
+	uint32_t m_uiDrawFamily = 0;
+	bool m_bOwnershipTransfer = false;		// Families differ, the buffers the draw reads change owner twice a frame
+	bool m_bDrawReleased = false;			// Draw family handed the buffers back, the next simulation acquires them
+	ParticleRenderTarget m_renderTarget;
+	ParticleEmitterSettings m_emitter;
+	double m_dEmitRemainder = 0.0;		// Fraction of a particle carried to the next frame so low rates still emit
+	uint32_t m_uiSeed = 0;
+
+	// - Buffers
+	ParticleBuffer m_particleBuffer;
+	std::array<ParticleBuffer, 2> m_arrAliveBuffers;
+	ParticleBuffer m_deadBuffer;
+	ParticleBuffer m_stateBuffer;
+	uint32_t m_uiCurrentAlive = 0;		// Alive list the next simulation updates, the other one is compacted in to
+	bool m_bInitialized = false;		// Init stage recorded
+
+	// - Pipelines
+	VkDescriptorSetLayout m_simulationSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_renderSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	std::array<VkDescriptorSet, 2> m_arrSimulationSets{};		// Per current alive list
+	std::array<VkDescriptorSet, 2> m_arrRenderSets{};			// Per list drawn
+	std::array<ComputePipeline, static_cast<size_t>(SimulationStage::Count)> m_arrSimulationPipelines;
+	VkPipelineLayout m_renderPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_renderPipeline = VK_NULL_HANDLE;
+
+	void CreateBuffers();
+	void CreateDescriptors();
+	void CreateRenderPipeline(const std::vector<char>& vertexShaderCode, const std::vector<char>& fragmentShaderCode);
+	ParticleBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage) const;
+	void DestroyBuffer(ParticleBuffer& buffer) const;
+	// Particles, both alive lists and the state (draw arguments). The dead list never leaves the simulation
+	std::array<VkBuffer, 4> GetSharedBuffers() const;
+	VkShaderModule CreateShaderModule(const std::vector<char>& code) const;
+	void RecordStage(VkCommandBuffer commandBuffer, SimulationStage stage, const SimulationPushConstants& pushConstants) const;
+};
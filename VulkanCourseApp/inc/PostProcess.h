@@ -0,0 +1,137 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <vector>
+#include "Utilities.h"
+#include "MemoryBudget.h"
+#include "ComputePipeline.h"
+
+// Look of the chain, changed at any time from the recording thread
+struct PostProcessSettings
+{
+	float exposureCompensation = 0.0f;		// EV on top of the eye adaptation
+	float adaptationRate = 1.5f;			// Per second, how fast exposure follows the scene's average luminance
+	float bloomThreshold = 1.0f;			// Exposed brightness bloom starts at
+	float bloomKnee = 0.5f;					// Width of the fade in below the threshold
+	float bloomIntensity = 0.08f;
+	glm::vec3 colorGain = glm::vec3(1.0f);	// Grading, after the tonemap
+	float saturation = 1.0f;
+	float contrast = 1.0f;
+};
+
+// Images the chain reads and works in, owned by the caller (e.g frame graph transients, aliased with the scene's targets)
+// Nothing is kept in them between frames. Views of single sample, single mip 2D images
+struct PostProcessImages
+{
+	VkImageView sceneColor = VK_NULL_HANDLE;		// SCENE_COLOR_FORMAT, sampled in SHADER_READ_ONLY_OPTIMAL
+	std::array<VkImageView, 2> bloom = {};			// Ping pong of the blur: BLOOM_FORMAT, GetBloomExtent(maxExtent), storage and sampled in GENERAL
+	VkImageView output = VK_NULL_HANDLE;			// OUTPUT_FORMAT, maxExtent, storage in GENERAL
+};
+
+// Post processing in compute, from the HDR scene color to a display ready image the caller copies to the swapchain
+// Every kernel is one stage of post_process.comp:
+//
+//   Downsample (per half res texel)  2x2 scene texels, bloom threshold and luminance reduction fused in to one read of the scene
+//   Adapt      (1 invocation)        eye adaptation from the reduced luminance, exposure of the frame
+//   Blur       (per half res texel)  separable gaussian, horizontal then vertical, each workgroup's line of texels
+//                                    loaded once in to shared memory
+//   Composite  (per output pixel)    bloom, exposure, tonemap, colour grade and sRGB encoding fused in to one pass
+//
+// The full resolution scene is read twice and the output written once, everything else is at half resolution
+// The device must support subgroup arithmetic in compute. The caller transitions the images (see PostProcessImages),
+// the exposure buffer is shared by every frame, frames are ordered on one queue and synced by barriers
+class PostProcessChain
+{
+public:
+	PostProcessChain() = default;
+
+	// maxExtent: largest extent ever processed, the images are sized for it
+	void InitPostProcessChain(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, VkExtent2D maxExtent,
+		const PostProcessImages& images, const std::vector<char>& shaderCode);
+	// Device must be idle
+	void ShutdownPostProcessChain();
+
+	void SetSettings(const PostProcessSettings& settings);
+	const PostProcessSettings& GetSettings() const;
+
+	// Outside rendering, with the images in the layouts of PostProcessImages. Processes the top left extent of the scene
+	// color in to the same area of the output image. deltaTime drives the eye adaptation
+	void RecordPostProcess(VkCommandBuffer commandBuffer, VkExtent2D extent, float deltaTime);
+
+	// Formats the scene has to be rendered in, the bloom is blurred in and the output is written in
+	static constexpr VkFormat SCENE_COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	static constexpr VkFormat BLOOM_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	static constexpr VkFormat OUTPUT_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	// Of the bloom images, half of maxExtent rounded up
+	static VkExtent2D GetBloomExtent(VkExtent2D maxExtent);
+
+	~PostProcessChain() = default;
+
+	PostProcessChain(PostProcessChain& other) = delete;
+	PostProcessChain& operator=(PostProcessChain& other) = delete;
+
+private:
+	// Layout of the Exposure buffer in post_process.comp
+	struct ExposureState
+	{
+		int32_t logLuminanceSum;
+		uint32_t luminanceCount;
+		float adaptedLuminance;
+		float exposure;
+	};
+
+	struct PostProcessPushConstants
+	{
+		int32_t inputSize[2];
+		int32_t bloomSize[2];
+		float bloomImageSize[2];
+		float deltaTime;
+		float adaptationRate;
+		float bloomThreshold;
+		float bloomKnee;
+		float bloomIntensity;
+		float exposureCompensation;
+		glm::vec4 colorGain;
+		float saturation;
+		float contrast;
+	};
+
+	// Values of STAGE in post_process.comp
+	enum class PostProcessStage : uint32_t
+	{
+		Downsample,
+		Adapt,
+		BlurHorizontal,
+		BlurVertical,
+		Composite,
+		Count
+	};
+
+	static constexpr uint32_t POST_GROUP_SIZE = 64;		// local_size_x of post_process.comp
+	static constexpr uint32_t POST_TILE_SIZE = 8;		// Side of the 2D stages' workgroups (8x8 = POST_GROUP_SIZE)
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	VkExtent2D m_maxExtent = {};
+	VkExtent2D m_bloomExtent = {};		// Of the bloom images
+	PostProcessSettings m_settings;
+	bool m_bInitialized = false;		// Exposure cleared
+
+	// - Resources
+	VkBuffer m_exposureBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_exposureMemory = VK_NULL_HANDLE;
+	VkSampler m_sampler = VK_NULL_HANDLE;			// Bilinear, clamped
+
+	// - Pipelines
+	VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+	std::array<ComputePipeline, static_cast<size_t>(PostProcessStage::Count)> m_arrPipelines;
+
+	void CreateResources();
+	void CreateDescriptors(const PostProcessImages& images);
+	void RecordStage(VkCommandBuffer commandBuffer, PostProcessStage stage, const PostProcessPushConstants& pushConstants) const;
+};
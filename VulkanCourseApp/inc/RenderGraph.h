@@ -0,0 +1,195 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <stdexcept>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Utilities.h"
+#include "FrameArena.h"
+
+// How a pass touches an image. Decides the layout, pipeline stages and access flags the graph syncs to
+enum class RenderGraphUsage
+{
+	ColorAttachment,
+	DepthAttachment,
+	Sampled,			// Read through a sampler/texture in the pass's shader stage
+	Storage,			// Read and/or written as a storage image in the pass's shader stage
+	TransferSrc,
+	TransferDst,
+	Present				// Only valid as the final usage of an imported image
+};
+
+enum class RenderGraphPassType
+{
+	Graphics,
+	Compute,
+	Transfer
+};
+
+using RenderGraphResource = uint32_t;
+
+// Description of an image the graph owns (created, aliased and destroyed by the graph)
+// Usage flags are derived from how passes use it, so only the basics are needed
+struct RenderGraphImageDesc
+{
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent = {};
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	VkImageUsageFlags extraUsage = 0;					// Usage that no pass in the graph declares (e.g sampled by code outside the graph)
+};
+
+// Frame description: passes declare what they read and write, the graph works out the rest
+// 1. AddPass/CreateImage/ImportImage to describe the frame
+// 2. Compile once: culls passes nothing depends on, orders the rest, aliases transient images with
+//    non-overlapping lifetimes in to shared memory and precomputes the barriers between passes
+// 3. Execute per command buffer: emits the barriers and calls each pass's record function
+class RenderGraph
+{
+public:
+	class PassBuilder
+	{
+	public:
+		void Read(RenderGraphResource resource, RenderGraphUsage usage);
+		void Write(RenderGraphResource resource, RenderGraphUsage usage);
+		// Pass must run even if nothing in the graph reads what it writes (e.g writes a buffer read on the CPU)
+		void SetSideEffect();
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t passIndex);
+
+		RenderGraph& m_graph;
+		uint32_t m_uiPassIndex;
+	};
+
+	using SetupFunction = std::function<void(PassBuilder&)>;
+	using RecordFunction = std::function<void(VkCommandBuffer)>;
+
+	RenderGraph() = default;
+	RenderGraph(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice);
+
+	// - Describe functions
+	RenderGraphResource CreateImage(const std::string& name, const RenderGraphImageDesc& desc);
+	// External image (e.g swapchain). Contents in initialLayout on entry, left in the layout of finalUsage on exit
+	RenderGraphResource ImportImage(const std::string& name, VkImage image, VkImageView imageView, VkImageAspectFlags aspect,
+		VkImageLayout initialLayout, RenderGraphUsage finalUsage);
+	void AddPass(const std::string& name, RenderGraphPassType type, const SetupFunction& setup, const RecordFunction& record);
+
+	// - Build functions
+	void Compile();
+	// Per execution temporaries come from scratchArena if given (otherwise the heap)
+	void Execute(VkCommandBuffer commandBuffer, LinearArena* scratchArena = nullptr) const;
+
+	// Swap imported image between executions (e.g per swapchain image), declared usage stays the same
+	void SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+
+	// - Get functions
+	VkImage GetImage(RenderGraphResource resource) const;
+	VkImageView GetImageView(RenderGraphResource resource) const;
+	bool IsPassCulled(const std::string& name) const;
+	// Stages of the first pass that uses the image, after Compile. A semaphore guarding an imported image
+	// (e.g swapchain acquire) must be waited on at these stages. 0 if nothing uses it
+	VkPipelineStageFlags GetFirstUseStages(RenderGraphResource resource) const;
+	uint32_t GetBarrierCount() const;				// Image barriers emitted per Execute
+	VkDeviceSize GetTransientMemorySize() const;	// Memory actually allocated for transient images
+	VkDeviceSize GetUnaliasedMemorySize() const;	// Memory the transient images would need without aliasing
+
+	void DestroyGraph();
+
+	~RenderGraph() = default;
+
+private:
+	struct ResourceAccess
+	{
+		RenderGraphResource resource;
+		RenderGraphUsage usage;
+		bool write;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		RenderGraphPassType type;
+		RecordFunction record;
+		std::vector<ResourceAccess> accesses;
+		bool sideEffect = false;
+		bool culled = false;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		bool imported = false;
+		RenderGraphImageDesc desc;
+		VkImageUsageFlags usage = 0;
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		RenderGraphUsage finalUsage = RenderGraphUsage::Present;
+		bool hasFinalUsage = false;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkMemoryRequirements memoryRequirements = {};
+
+		// Lifetime in execution order (indices in to m_vecExecutionOrder)
+		int firstUse = -1;
+		int lastUse = -1;
+		int memoryBlock = -1;
+		VkPipelineStageFlags firstUseStages = 0;
+	};
+
+	// Memory shared by transient images whose lifetimes don't overlap
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t memoryTypeBits = 0xFFFFFFFF;
+		std::vector<RenderGraphResource> occupants;
+	};
+
+	// Layout, stages and access a resource is in (or must be in) around a pass
+	struct ResourceState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags stages = 0;
+		VkAccessFlags access = 0;
+		bool write = false;
+	};
+
+	// Barriers recorded before a pass (or after the last one, for final usages)
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		std::vector<RenderGraphResource> resources;		// Which resource each image barrier is for (image patched at Execute)
+	};
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+
+	std::vector<Pass> m_vecPasses;
+	std::vector<Resource> m_vecResources;
+	std::vector<MemoryBlock> m_vecMemoryBlocks;
+
+	std::vector<uint32_t> m_vecExecutionOrder;			// Indices in to m_vecPasses
+	std::vector<BarrierBatch> m_vecPassBarriers;		// One batch per entry in m_vecExecutionOrder
+	BarrierBatch m_finalBarriers;
+	bool m_bCompiled = false;
+
+	// - Compile steps
+	void CullPasses();
+	void OrderPasses();
+	void ComputeLifetimes();
+	void CreateTransientImages();
+	void AliasTransientImages();
+	void BuildBarriers();
+
+	static ResourceState GetUsageState(RenderGraphUsage usage, RenderGraphPassType type, bool write, VkImageAspectFlags aspect);
+	static ResourceState GetFinalState(const Resource& resource);
+	static VkImageUsageFlags GetUsageFlags(RenderGraphUsage usage);
+	static void RecordBatch(VkCommandBuffer commandBuffer, const BarrierBatch& batch, const std::vector<Resource>& resources,
+		LinearArena* scratchArena);
+};
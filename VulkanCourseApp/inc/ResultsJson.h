@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Helpers of the JSON results the benchmark suite and frame trace replay write (mainBenchmark.cpp, mainReplay.cpp)
+
+// sorted must not be empty, percentile in [0, 1]
+inline double GetPercentile(const std::vector<double>& sorted, double percentile)
+{
+	const size_t index = static_cast<size_t>(percentile * static_cast<double>(sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+// Contents of a JSON string literal (without the quotes)
+inline std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+	for (const char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+			escaped += code;
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+	return escaped;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Features of the scene shaders, combined in to a bitmask
+// Specialized features are specialization constants of one SPIR-V module: the driver compiles the paths a variant
+// doesn't use out when the pipeline is created, nothing is branched on at run time
+constexpr uint32_t SHADER_FEATURE_VERTEX_COLOR = 1u << 0;		// Vertex color, otherwise flat white
+constexpr uint32_t SHADER_FEATURE_DEBUG_DEPTH = 1u << 1;		// Output depth as grey instead of color
+// Permutation features change the shader interface (vertex inputs), so every combination is its own SPIR-V
+constexpr uint32_t SHADER_FEATURE_INSTANCING = 1u << 2;			// Per instance model matrix
+constexpr uint32_t SHADER_FEATURE_QUANTIZED_INPUT = 1u << 3;	// Normalized integer vertex attributes
+
+constexpr uint32_t SHADER_FEATURES_SPECIALIZED = SHADER_FEATURE_VERTEX_COLOR | SHADER_FEATURE_DEBUG_DEPTH;
+constexpr uint32_t SHADER_FEATURES_PERMUTATION = SHADER_FEATURE_INSTANCING | SHADER_FEATURE_QUANTIZED_INPUT;
+
+// Values of DEBUG_VIEW (constant_id 1 of shader.frag)
+enum class ShaderDebugView : int32_t
+{
+	None = 0,
+	Depth = 1
+};
+
+// Everything needed to create the shader stages of one variant
+// Code and specialization info point in to the registry and stay valid until it is cleared
+struct ShaderVariant
+{
+	uint32_t features = 0;
+	const std::vector<char>* pVertexCode = nullptr;
+	const std::vector<char>* pFragmentCode = nullptr;
+	VkSpecializationInfo specializationInfo = {};		// Shared by both stages, each only reads the constants it declares
+};
+
+// Maps feature bitmasks to SPIR-V and specialization constants
+// SPIR-V is registered per permutation (the permutation bits of the mask), every specialized combination of it is
+// derived on first request and kept, so pipelines can be created from any thread while others are looked up
+class ShaderVariantRegistry
+{
+public:
+	ShaderVariantRegistry() = default;
+
+	// Specialized bits of permutation are ignored, registering one again replaces its code
+	// Must not be called while variants of that permutation are in use
+	void RegisterPermutation(uint32_t permutation, std::vector<char> vertexCode, std::vector<char> fragmentCode);
+	bool HasPermutation(uint32_t features) const;
+
+	// Throws if no SPIR-V was registered for the permutation bits of features
+	const ShaderVariant& GetVariant(uint32_t features);
+
+	size_t GetVariantCount() const;
+	void Clear();
+
+	~ShaderVariantRegistry() = default;
+
+	ShaderVariantRegistry(ShaderVariantRegistry& other) = delete;
+	ShaderVariantRegistry& operator=(ShaderVariantRegistry& other) = delete;
+
+private:
+	// Layout of the specialization data, constant_id is the index of the map entry
+	struct SpecializationData
+	{
+		VkBool32 vertexColor = VK_FALSE;		// constant_id 0: VERTEX_COLOR (shader.vert)
+		int32_t debugView = 0;					// constant_id 1: DEBUG_VIEW (shader.frag)
+	};
+
+	struct Permutation
+	{
+		std::vector<char> vertexCode;
+		std::vector<char> fragmentCode;
+	};
+
+	// Map nodes never move, so the variant can point at its own data
+	struct VariantEntry
+	{
+		ShaderVariant variant;
+		SpecializationData data;
+		std::array<VkSpecializationMapEntry, 2> mapEntries{};
+	};
+
+	mutable std::mutex m_mutex;
+	std::map<uint32_t, Permutation> m_mapPermutations;
+	std::map<uint32_t, VariantEntry> m_mapVariants;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Shared by the self checks (mainTest*.cpp): failed checks are printed and counted, the check's entry point returns
+// FinishChecks. One check runs per process, counting is thread safe for checks made from worker threads
+
+inline std::atomic<uint32_t>& GetCheckFailures()
+{
+	static std::atomic<uint32_t> failures{ 0 };
+	return failures;
+}
+
+inline void Check(const bool condition, const char* description)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "FAILED: %s\n", description);
+		++GetCheckFailures();
+	}
+}
+
+// Prints the outcome, returns the process exit code
+inline int FinishChecks(const char* checkName)
+{
+	const uint32_t failures = GetCheckFailures().load();
+	if (failures > 0)
+	{
+		fprintf(stderr, "FAILED: %u %s checks\n", failures, checkName);
+		return EXIT_FAILURE;
+	}
+	printf("Passed: %s\n", checkName);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer hand over of whole values (e.g frame snapshots)
+// Three slots: the writer fills its back slot and swaps it with the middle one, the reader swaps the middle one
+// in to its front slot when something new was published. Neither side ever waits on the other, the reader
+// always gets the most recently published value and a value is never modified while the reader holds it
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	// Writer side: slot to fill in, then Publish
+	T& GetWriteBuffer()
+	{
+		return m_arrSlots[m_uiBack];
+	}
+
+	void Publish()
+	{
+		// Release: slot contents are visible to the reader before the index is
+		const uint32_t previous = m_uiMiddle.exchange(m_uiBack | NEW_DATA_BIT, std::memory_order_acq_rel);
+		m_uiBack = previous & INDEX_MASK;
+	}
+
+	void Publish(const T& value)
+	{
+		GetWriteBuffer() = value;
+		Publish();
+	}
+
+	// Reader side: latest published value (the same one as last time if nothing new was published)
+	const T& Read()
+	{
+		if (m_uiMiddle.load(std::memory_order_relaxed) & NEW_DATA_BIT)
+		{
+			const uint32_t previous = m_uiMiddle.exchange(m_uiFront, std::memory_order_acq_rel);
+			m_uiFront = previous & INDEX_MASK;
+		}
+		return m_arrSlots[m_uiFront];
+	}
+
+	bool HasNewData() const
+	{
+		return (m_uiMiddle.load(std::memory_order_relaxed) & NEW_DATA_BIT) != 0;
+	}
+
+	TripleBuffer(TripleBuffer& other) = delete;
+	TripleBuffer& operator=(TripleBuffer& other) = delete;
+
+private:
+	static constexpr uint32_t INDEX_MASK = 0x3;
+	static constexpr uint32_t NEW_DATA_BIT = 0x4;
+
+	std::array<T, 3> m_arrSlots{};
+	uint32_t m_uiBack = 0;								// Writer only
+	alignas(64) std::atomic<uint32_t> m_uiMiddle{ 1 };	// Index of the middle slot + NEW_DATA_BIT
+	alignas(64) uint32_t m_uiFront = 2;					// Reader only
+};
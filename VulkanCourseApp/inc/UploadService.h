@@ -0,0 +1,146 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Utilities.h"
+#include "FrameTimeline.h"
+#include "MemoryBudget.h"
+
+using UploadFuture = std::shared_future<void>;
+
+// Background GPU upload service
+// Any thread can enqueue buffer/image uploads and gets a future that becomes ready once the data is on the GPU
+// and owned by the graphics queue family. A worker thread copies the data in to a reused staging ring,
+// records the copies in batches and submits them to the transfer queue. When the transfer family differs
+// from the graphics family, each batch releases ownership and a matching acquire is submitted on the graphics queue
+//
+// Queues are externally synchronized, so the worker only submits itself when the transfer queue is dedicated
+// (nobody else uses it). Everything that has to go to a shared queue is handed to the render thread,
+// which submits it without waiting in SubmitPending
+class UploadService
+{
+public:
+	UploadService() = default;
+
+	// Staging memory is accounted to memoryBudget when given
+	void InitUploadService(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, const QueueFamilyIndices& queueFamilyIndices,
+		VkQueue newTransferQueue, MemoryBudget* memoryBudget = nullptr, VkDeviceSize stagingSize = 16 * 1024 * 1024);
+	void ShutdownUploadService();
+
+	// - Enqueue functions (thread safe, never block on the GPU)
+	// dstStage/dstAccess describe the first use on the graphics queue (e.g vertex input / vertex attribute read)
+	// concurrent: dstBuffer is VK_SHARING_MODE_CONCURRENT over the graphics and transfer families, so it has no owner to
+	// hand over. Required for buffers uploaded to in ranges while the graphics queue reads the rest (e.g GeometryPool)
+	UploadFuture EnqueueBufferUpload(VkBuffer dstBuffer, VkDeviceSize dstOffset, std::vector<char> data,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool concurrent = false);
+	// Image is transitioned from UNDEFINED (previous contents discarded) to finalLayout
+	UploadFuture EnqueueImageUpload(VkImage dstImage, VkExtent3D extent, VkImageAspectFlags aspect, std::vector<char> data,
+		VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	// Render thread, once per frame before its graphics submission
+	// Uploads submitted here are visible to everything submitted to graphicsQueue afterwards
+	void SubmitPending(VkQueue graphicsQueue);
+
+	// Only stops the worker if ShutdownUploadService wasn't called (e.g Init failed), Vulkan objects are left to the device
+	~UploadService();
+
+	UploadService(UploadService& other) = delete;
+	UploadService(UploadService&& other) = delete;
+	UploadService& operator=(UploadService& other) = delete;
+	UploadService& operator=(UploadService&& other) = delete;
+
+private:
+	struct UploadRequest
+	{
+		VkBuffer dstBuffer = VK_NULL_HANDLE;
+		VkDeviceSize dstOffset = 0;
+		VkImage dstImage = VK_NULL_HANDLE;
+		VkExtent3D extent = {};
+		VkImageAspectFlags aspect = 0;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags dstStage = 0;
+		VkAccessFlags dstAccess = 0;
+		bool concurrent = false;
+		std::vector<char> data;
+		std::promise<void> promise;
+	};
+
+	// One transfer submission (plus its acquire submission when families differ)
+	struct UploadBatch
+	{
+		uint64_t value = 0;									// Timeline value signalled by the batch's last submission
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+		VkDeviceSize stagingConsumed = 0;					// Bytes of the ring (including wrap padding) freed on completion
+		VkBuffer oversizeStagingBuffer = VK_NULL_HANDLE;	// One-off staging for uploads bigger than the ring
+		VkDeviceMemory oversizeStagingMemory = VK_NULL_HANDLE;
+		std::vector<std::promise<void>> promises;
+	};
+
+	VkPhysicalDevice m_physicalDevice{};
+	VkDevice m_device{};
+	VkQueue m_transferQueue{};
+	MemoryBudget* m_pMemoryBudget = nullptr;
+	uint32_t m_uiTransferFamily = 0;
+	uint32_t m_uiGraphicsFamily = 0;
+	bool m_bOwnershipTransfer = false;		// Transfer and graphics families differ
+	bool m_bWorkerSubmits = false;			// Transfer queue is dedicated, so the worker may submit to it
+
+	VkCommandPool m_transferCommandPool{};
+	VkCommandPool m_acquireCommandPool{};	// Graphics family, only used when m_bOwnershipTransfer
+
+	// Transfer submissions signal m_transferTimeline, acquire submissions signal m_acquireTimeline, both with the batch value
+	// (every batch advances both when there is an ownership transfer, so the values stay in step)
+	FrameTimeline m_transferTimeline;
+	FrameTimeline m_acquireTimeline;
+
+	// Staging ring, persistently mapped, freed in FIFO order as batches complete
+	VkBuffer m_stagingBuffer{};
+	VkDeviceMemory m_stagingMemory{};
+	char* m_pStagingData = nullptr;
+	VkDeviceSize m_stagingSize = 0;
+	VkDeviceSize m_stagingHead = 0;
+	VkDeviceSize m_stagingUsed = 0;
+
+	// Worker thread state
+	std::thread m_worker;
+	std::mutex m_requestMutex;
+	std::condition_variable m_requestCondition;
+	std::deque<UploadRequest> m_dequeRequests;
+	bool m_bStopping = false;
+	std::deque<UploadBatch> m_dequeInFlight;		// Worker thread only
+
+	// Submissions handed to the render thread
+	struct PendingSubmit
+	{
+		uint64_t value;
+		VkCommandBuffer transferCommandBuffer;		// Null if the worker already submitted it
+		VkCommandBuffer acquireCommandBuffer;		// Null if no ownership transfer
+	};
+	std::mutex m_submitMutex;
+	std::vector<PendingSubmit> m_vecPendingSubmits;
+	std::vector<PendingSubmit> m_vecSubmitting;		// Render thread only, swapped with m_vecPendingSubmits to keep its capacity
+
+	// - Worker functions
+	void StopWorker();
+	void WorkerLoop();
+	void RecordBatch(std::deque<UploadRequest>& requests);
+	void RetireCompletedBatches();
+	bool AllocateStaging(VkDeviceSize size, VkDeviceSize& outOffset, VkDeviceSize& inOutConsumed);
+
+	void RecordRequest(const UploadRequest& request, VkCommandBuffer transferCommandBuffer, VkCommandBuffer acquireCommandBuffer,
+		VkBuffer stagingBuffer, VkDeviceSize stagingOffset) const;
+	void CreateHostBuffer(VkDeviceSize size, VkBuffer& outBuffer, VkDeviceMemory& outMemory) const;
+	void FreeHostBuffer(VkBuffer buffer, VkDeviceMemory memory) const;
+	VkCommandBuffer BeginOneTimeCommands(VkCommandPool commandPool) const;
+	static void SubmitCommands(VkQueue queue, VkCommandBuffer commandBuffer, VkSemaphore waitSemaphore, uint64_t waitValue,
+		VkSemaphore signalSemaphore, uint64_t signalValue);
+	bool IsBatchComplete(uint64_t value);
+};
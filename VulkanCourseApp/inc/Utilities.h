@@ -5,6 +5,66 @@
 
 constexpr int MAX_FRAME_DRAWS = 2;
 
+// Requested MSAA sample count, clamped to what the device supports for color and depth framebuffers
+constexpr VkSampleCountFlagBits MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+
+// Record with vkCmdBeginRendering (Vulkan 1.3 / VK_KHR_dynamic_rendering) instead of VkRenderPass + VkFramebuffer
+// Falls back to the render pass path if the device doesn't support it
+constexpr bool USE_DYNAMIC_RENDERING = true;
+
+// Submit and present on a dedicated render thread while the main thread only pumps window events and runs
+// the simulation at a fixed step. Otherwise frames are pipelined across cores on the job system
+constexpr bool USE_RENDER_THREAD = true;
+constexpr double SIMULATION_TIMESTEP = 1.0 / 60.0;		// Seconds per simulation step in render thread mode
+
+// Run independent Init steps (shader reads, mesh preparation, pipeline compilation) on startup worker threads
+// while the device and swapchain are created, otherwise every step runs in order on the calling thread
+constexpr bool PARALLEL_STARTUP = true;
+
+// Draw the scene with the depth debug view variant of its shaders (a specialization constant, see ShaderVariants.h)
+constexpr bool DEBUG_VIEW_DEPTH = false;
+
+// Reorder indexed meshes at load for vertex cache hits, less overdraw and linear vertex fetch
+constexpr bool OPTIMIZE_MESHES = true;
+
+// Levels of detail built for indexed meshes at load, and the projected error (pixels) a level may have to be drawn
+// Hysteresis is the fraction the error has to drop below that before switching to a coarser level
+constexpr uint32_t MESH_LOD_COUNT = 4;
+constexpr float LOD_MAX_PIXEL_ERROR = 1.0f;
+constexpr float LOD_HYSTERESIS = 0.25f;
+
+// Capacity (in elements) of the shared vertex and index buffers static meshes are packed in to
+// Meshes that don't fit any more get buffers of their own
+constexpr uint32_t GEOMETRY_POOL_VERTEX_CAPACITY = 1024 * 1024;
+constexpr uint32_t GEOMETRY_POOL_INDEX_CAPACITY = 4 * 1024 * 1024;
+
+// Two phase GPU occlusion culling against a depth pyramid, drawn with indirect draws (dynamic rendering only)
+// Needs Shaders/depth_reduce.spv and Shaders/occlusion_cull.spv (built by CompileShaders.bat, not checked in), falls
+// back to plain draws on devices without drawIndirectCount/multiDrawIndirect
+constexpr bool OCCLUSION_CULLING = false;
+constexpr uint32_t OCCLUSION_CULL_MAX_OBJECTS = 4096;
+
+// GPU particle system (emit/update/compaction in compute, instanced quads drawn indirectly)
+// Needs Shaders/particle_sim.spv, particle_vert.spv and particle_frag.spv (built by CompileShaders.bat, not checked in)
+constexpr bool GPU_PARTICLES = false;
+constexpr uint32_t PARTICLE_CAPACITY = 1024 * 1024;
+constexpr float PARTICLE_EMIT_RATE = 200000.0f;		// Particles per second
+
+// Scene renders to an offscreen target scaled to hold a GPU frame time budget (measured with timestamps), then is
+// upscaled to the swapchain with a bilinear blit. Dynamic rendering only
+constexpr bool DYNAMIC_RESOLUTION = true;
+constexpr double DYNAMIC_RESOLUTION_TARGET_MS = 1000.0 / 60.0;
+constexpr float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;		// Per axis, of the swapchain extent
+
+// Scene renders to an HDR target, then bloom, eye adaptation, tonemap and colour grading run as compute kernels before
+// the result is blitted to the swapchain. Dynamic rendering only, needs Shaders/post_process.spv (built by
+// CompileShaders.bat, not checked in), and is off on devices without compute subgroup arithmetic
+constexpr bool POST_PROCESSING = false;
+
+// Readback buffers for frame capture. Copies are read a few frames after they are recorded, a frame is only
+// dropped from a capture when every buffer is still in flight or waiting on the capture callback
+constexpr uint32_t FRAME_CAPTURE_RING_SIZE = MAX_FRAME_DRAWS + 2;
+
 const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
@@ -16,6 +76,13 @@ struct Vertex
 	glm::vec3 col; // Vertex Color (r, g, b)
 };
 
+// Everything the renderer needs from the simulation to draw one frame, copied by value so the simulation
+// can move on to the next frame while this one is recorded
+struct FrameSnapshot
+{
+	glm::mat4 model = glm::mat4(1.0f);	// Transform of the scene mesh
+	double time = 0.0;					// Simulation time (seconds) the snapshot is for
+};
 
 //Indices (locations) of Queue Families (if they exist at all)
 
@@ -23,12 +90,25 @@ struct QueueFamilyIndices
 {
 	int graphicsFamily = -1;			// Location of Graphics Queue family
 	int presentationFamily = -1;			// Location of Presentation Queue family
+	int computeFamily = -1;				// Location of Compute Queue family (dedicated async compute family if the device has one)
+	int transferFamily = -1;			// Location of Transfer Queue family (dedicated DMA family if the device has one)
 
 	// check if queue families are valid
 	bool IsValid() const
 	{
 		return graphicsFamily >= 0 && presentationFamily >= 0;
 	}
+
+	// Compute work can overlap graphics work only if it is submitted to a different family
+	bool HasDedicatedCompute() const
+	{
+		return computeFamily >= 0 && computeFamily != graphicsFamily;
+	}
+
+	bool HasDedicatedTransfer() const
+	{
+		return transferFamily >= 0 && transferFamily != graphicsFamily && transferFamily != computeFamily;
+	}
 };
 
 struct SwapChainDetails
@@ -44,7 +124,26 @@ struct SwapChainImage
 	VkImageView imageView;
 };
 
-static std::vector<char> ReadFile(const std::string& fileName)
+// Index of first memory type allowed by allowedTypes (bit i = type i) that has all the requested properties
+// Returns UINT32_MAX if there is none so callers can try a fallback set of properties
+inline uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((allowedTypes & (1u << i))
+			&& (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+inline std::vector<char> ReadFile(const std::string& fileName)
 {
 	// Open stream from given file
 	// std::ios::binary tells stream to read file as binary
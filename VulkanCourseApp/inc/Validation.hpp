@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <iostream>
+#include "DebugMessageSink.h"
 
 constexpr uint32_t G_WIDTH = 800;
 constexpr uint32_t G_HEIGHT = 600;
@@ -50,7 +51,15 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 	void* pUserData)
 {
-	std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+	// Runs inside the API call that triggered it, so only hand the message over, the sink's thread prints it
+	if (pUserData != nullptr)
+	{
+		static_cast<DebugMessageSink*>(pUserData)->Push(messageSeverity, messageType, pCallbackData);
+	}
+	else
+	{
+		std::cerr << "validation layer: " << pCallbackData->pMessage << '\n';
+	}
 
 	return VK_FALSE;
 }
\ No newline at end of file
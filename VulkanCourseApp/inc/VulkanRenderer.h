@@ -6,19 +6,131 @@
 #include <set>
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
 #include "Utilities.h"
 #include "Mesh.h"
+#include "ComputePipeline.h"
+#include "QueueSync.h"
+#include "FrameTimeline.h"
+#include "RenderGraph.h"
+#include "UploadService.h"
+#include "FrameArena.h"
+#include "MemoryBudget.h"
+#include "DeletionQueue.h"
+#include "GpuResource.h"
+#include "GeometryPool.h"
+#include "OcclusionCuller.h"
+#include "FrameCapture.h"
+#include "DebugMessageSink.h"
+#include "ShaderVariants.h"
+#include "ParticleSystem.h"
+#include "DynamicResolution.h"
+#include "PostProcess.h"
+#include "FrameTrace.h"
 
 
 
 class VulkanRenderer final
 {
 public:
+	// Identifies one frame between BeginFrame, RecordFrame and SubmitFrame
+	struct FrameContext
+	{
+		uint32_t imageIndex = 0;		// Swapchain image being drawn to
+		uint32_t frameSlot = 0;			// Which of the MAX_FRAME_DRAWS semaphore sets the frame uses
+		uint64_t timelineValue = 0;		// Frame timeline value the frame signals once it completes on the GPU
+	};
+
+	// One step of Init, times relative to the start of Init (phases on startup workers overlap the others)
+	struct StartupPhase
+	{
+		std::string name;
+		double startMs = 0.0;
+		double durationMs = 0.0;
+	};
+
 	VulkanRenderer();
 
+	// Must be called before Init, clamped to what the device supports (VK_SAMPLE_COUNT_1_BIT disables MSAA)
+	void SetRequestedMsaaSamples(VkSampleCountFlagBits samples);
+	// Must be called before Init. Forces a physical device by (case insensitive) name substring or UUID hex string
+	// Falls back to the VULKAN_DEVICE environment variable, then to the best scoring device
+	void SetDeviceOverride(const std::string& nameOrUuid);
+	// Must be called before Init. Geometry of the scene mesh instead of the built in quad (e.g a replayed trace's)
+	void SetSceneGeometry(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+	// Must be called before Init. Init then takes a null window and presents to a VK_EXT_headless_surface of this
+	// extent, with an uncapped present mode where there is one (nothing is shown, so frames don't wait for a display)
+	void SetHeadless(VkExtent2D extent);
+	// Instance can be created with VK_EXT_headless_surface
+	static bool IsHeadlessSupported();
+
 	int Init(GLFWwindow* newWindow);
-	void Draw();
-	void Cleanup() const;
+	// Per phase timings of the last Init
+	const std::vector<StartupPhase>& GetStartupPhases() const;
+	// BeginFrame + RecordFrame + SubmitFrame
+	void Draw(const FrameSnapshot& snapshot = FrameSnapshot());
+
+	// - Frame stages, for pipelining frames across threads
+	// Stages of one frame run in order. RecordFrame of frame N may run on another thread at the same time as
+	// SubmitFrame of frame N-1, but BeginFrame (acquire) must not overlap SubmitFrame (present)
+	FrameContext BeginFrame();
+	void RecordFrame(const FrameContext& frame, const FrameSnapshot& snapshot);
+	void SubmitFrame(const FrameContext& frame);
+	void Cleanup();
+
+	// - Async compute
+	// Compute work of a frame, between its BeginFrame and SubmitFrame (e.g in RecordFrame): record in to the returned
+	// command buffer, then end it with EndComputeCommands. SubmitFrame submits it to the compute queue once the previous
+	// frame's graphics work has finished, and the frame's graphics submission waits on it at graphicsWaitStage
+	// Resources shared with graphics need RecordBufferRelease/RecordBufferAcquire if the families differ
+	VkCommandBuffer BeginComputeCommands(const FrameContext& frame);
+	void EndComputeCommands(const FrameContext& frame, VkPipelineStageFlags graphicsWaitStage);
+
+	// - Frame timeline
+	// Value signalled when the most recently submitted frame finishes on the GPU
+	// Compare against GetFrameTimeline().IsComplete/Wait to know when resources used by that frame are free
+	uint64_t GetLastSubmittedFrameValue() const;
+	FrameTimeline& GetFrameTimeline();
+
+	// - Uploads
+	// Background transfer queue uploads, resources are usable by frames drawn after their future is ready
+	UploadService& GetUploadService();
+
+	// - Memory
+	// Per heap/category usage, budget and eviction counters (GetStats is thread safe, e.g for a stats overlay)
+	const MemoryBudget& GetMemoryBudget() const;
+	// Release GPU resources here (or through GpuBuffer/GpuImage) instead of destroying them, never wait for the device
+	DeletionQueue& GetDeletionQueue();
+	// Shared vertex/index buffers, create static meshes in it so a whole scene draws with one buffer bind
+	GeometryPool& GetGeometryPool();
+
+	// - Debug
+	// Validation message counters and performance warnings seen so far (thread safe)
+	const DebugMessageSink& GetDebugMessageSink() const;
+
+	// - Capture
+	// Asynchronous readback of presented frames, null if the surface can't be copied from
+	FrameCapture* GetFrameCapture();
+
+	// - Frame trace (see FrameTrace.h)
+	// Records every frame from the next one on, along with the scene, in to fileName once stopped (thread safe)
+	void StartFrameTrace(const std::string& fileName);
+	// Returns false if no trace was running or it couldn't be written
+	bool StopFrameTrace();
+	bool IsFrameTracing() const;
+	// Header a trace recorded now would have, compare a replayed trace's against it
+	FrameTraceHeader GetFrameTraceHeader() const;
+	// Draw with a recorded frame's snapshot and decisions: render resolution (clamped to the swapchain), level of detail
+	// and whether the scene mesh is drawn
+	void DrawTraceFrame(const FrameTracePacket& packet);
+	// Scene mesh has been uploaded and can be drawn. Replays wait for it, so recorded draws aren't dropped
+	bool IsSceneResident() const;
+
+	VkDevice GetLogicalDevice() const;
+	const QueueFamilyIndices& GetQueueFamilyIndices() const;
 
 	~VulkanRenderer();
 
@@ -29,16 +141,34 @@ public:
 	VulkanRenderer operator=(VulkanRenderer&& other) = delete;
 private:
 	GLFWwindow* m_pWindow;
+	std::string m_strDeviceOverride;
+	bool m_bHeadless = false;
+	VkExtent2D m_headlessExtent = {};
 	unsigned int m_uiCurrentFrame = 0;
+	uint64_t m_ullFramesBegun = 0;
+
+	// Startup instrumentation
+	std::chrono::steady_clock::time_point m_startupBegin;
+	std::mutex m_startupMutex;						// Phases are recorded from startup workers too
+	std::vector<StartupPhase> m_vecStartupPhases;
 
 	// Scene Objectts
 	Mesh m_firstMesh{};
+	std::vector<Vertex> m_vecSceneVertices;		// Source geometry of m_firstMesh, kept for frame traces
+	std::vector<uint32_t> m_vecSceneIndices;
+	uint32_t m_uiSceneShaderFeatures = 0;		// SHADER_FEATURE_* of the scene pipeline
+	FrameSnapshot m_recordSnapshot;		// Snapshot of the frame being recorded
+	uint64_t m_ullRecordFrameValue = 0;	// Timeline value of the frame being recorded
+	uint32_t m_uiRecordFrameSlot = 0;		// Frame slot of the frame being recorded
+	bool m_bDrawFirstMesh = false;		// Decided once per frame, so only what was touched gets drawn
+	uint32_t m_uiFirstMeshLod = 0;		// Level of detail drawn, kept between frames for hysteresis
 
 	//Vulkan components
 	// - Main
 	VkInstance m_instance;
 
 	VkDebugUtilsMessengerEXT m_debugMessenger;
+	DebugMessageSink m_debugMessageSink;		// Validation output, deduplicated and printed off the calling thread
 
 	struct DeviceReferences{
 		VkPhysicalDevice physicalDevice;
@@ -53,6 +183,16 @@ private:
 
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentationQueue;
+	VkQueue m_computeQueue;
+	VkQueue m_transferQueue;
+	QueueFamilyIndices m_queueFamilyIndices;
+	bool m_bMemoryBudgetExtension = false;	// VK_EXT_memory_budget enabled on the device
+	MemoryBudget m_memoryBudget;
+	DeletionQueue m_deletionQueue;
+	UploadService m_uploadService;
+	GeometryPool m_geometryPool;
+	bool m_bFrameCaptureSupported = false;	// Swapchain images can be a transfer source
+	FrameCapture m_frameCapture;
 	VkSurfaceKHR m_surface;
 	VkSwapchainKHR m_swapchain;
 	
@@ -63,19 +203,100 @@ private:
 	// - Pipeline
 	VkPipeline m_graphicsPipeline;
 	VkPipelineLayout m_pipelineLayout;
+	ShaderVariantRegistry m_shaderVariants;		// SPIR-V and specialization constants of the scene shader variants
 	VkRenderPass m_renderPass;
 
+	// - Dynamic rendering
+	// No render pass or framebuffers: the frame graph records the barriers the render pass would have done implicitly
+	bool m_bDynamicRendering = false;
+	RenderGraph m_frameGraph;
+	RenderGraphResource m_swapChainResource = 0;
+	RenderGraphResource m_sceneColorResource = 0;		// What the scene resolves in to: the swap chain, or the offscreen scene color
+	RenderGraphResource m_msaaColorResource = 0;		// Offscreen targets below are transients, only valid when used
+	RenderGraphResource m_depthResource = 0;
+	RenderGraphResource m_depthResolveResource = 0;		// Occlusion culling with MSAA
+	RenderGraphResource m_postOutputResource = 0;
+	std::array<RenderGraphResource, 2> m_arrBloomResources{};
+	VkPipelineStageFlags m_swapChainWaitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;	// Where the acquire semaphore is waited on
+
+	// - Occlusion culling
+	// Scene is drawn in two passes around the cull (see OcclusionCuller.h), only with dynamic rendering
+	enum class ScenePass
+	{
+		All,		// No culling, one pass
+		Early,		// Visible against the previous frame's depth, clears and keeps the attachments
+		Late		// Found visible against this frame's depth, loads the attachments and resolves
+	};
+	bool m_bOcclusionCulling = false;
+	OcclusionCuller m_occlusionCuller;
+	VkResolveModeFlagBits m_depthResolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+
+	// - Particles
+	bool m_bParticles = GPU_PARTICLES;
+	ParticleSystem m_particleSystem;
+
+	// - Frame time
+	double m_dLastFrameTime = -1.0;			// Snapshot time of the last recorded frame, negative before the first
+	float m_fFrameDeltaTime = 0.0f;			// Step of the frame being recorded (particles, eye adaptation)
+
+	// - Offscreen scene color
+	// With dynamic resolution or post processing the scene renders to a swapchain sized image instead of the swapchain,
+	// the Output pass blits it (or the post processed image) to the swapchain. A frame graph transient (m_sceneColorResource)
+	VkFormat m_sceneColorFormat = VK_FORMAT_UNDEFINED;		// Of the scene's color attachments, HDR with post processing
+
+	// - Dynamic resolution
+	// Scene renders to the top left m_renderExtent of the scene color image, the output blit scales it to the swapchain
+	bool m_bDynamicResolution = false;
+	DynamicResolutionController m_resolutionController;
+	VkExtent2D m_renderExtent = {};					// Of the frame being recorded
+	VkQueryPool m_timestampQueryPool = VK_NULL_HANDLE;	// Start and end of each frame slot's command buffer
+	float m_fTimestampPeriod = 0.0f;				// Nanoseconds per timestamp tick
+	std::array<bool, MAX_FRAME_DRAWS> m_arrTimestampsWritten{};
+
+	// - Post processing
+	bool m_bPostProcessing = false;
+	PostProcessChain m_postProcessChain;
+
+	// - Frame trace
+	FrameTraceRecorder m_frameTraceRecorder;
+	const FrameTracePacket* m_pReplayPacket = nullptr;		// Decisions of the frame being recorded, when replaying a trace
+
 	// - Pools
 	VkCommandPool m_graphicsCommandPool;
+	VkCommandPool m_computeCommandPool;
+
+	// - Async compute
+	// Per frame slot, a slot's compute work is submitted with its graphics work
+	std::vector<VkCommandBuffer> m_vecComputeCommandBuffers;
+	std::vector<VkSemaphore> m_vecComputeFinished;
+	std::array<VkPipelineStageFlags, MAX_FRAME_DRAWS> m_arrComputeWaitStages{};		// 0 if the slot's frame has no compute work
 
 	// - Utility
 	VkFormat m_swapChainImageFormat;
 	VkExtent2D m_swapChainExtent;
+	VkFormat m_depthFormat;
+
+	// - MSAA / Depth
+	// Multisampled targets only live inside the render pass (resolved/discarded at the end),
+	// so they are transient attachments backed by lazily allocated memory where the device has it
+	// Only the render pass path creates these, with dynamic rendering they're frame graph transients
+	VkSampleCountFlagBits m_requestedMsaaSamples = MSAA_SAMPLES;
+	VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	GpuImage m_colorBuffer;
+	GpuImage m_depthBuffer;
 
 	// - Synchronization
 	std::vector<VkSemaphore> m_vecImageAvailable;
 	std::vector<VkSemaphore> m_vecRenderFinished;
-	std::vector<VkFence> m_vecDrawFences;
+	FrameTimeline m_frameTimeline;
+	std::array<uint64_t, MAX_FRAME_DRAWS> m_arrFrameTimelineValues{};	// Timeline value each frame slot last signalled
+	std::vector<uint64_t> m_vecImageTimelineValues;						// Timeline value of the last frame that used each swapchain image
+
+	// - Transient CPU memory
+	// Per frame slot, reset once the slot's last frame has finished. Arenas size themselves after the first frames
+	// (overflow goes to the heap and grows the arena), after that recording a frame doesn't touch the heap
+	std::array<LinearArena, MAX_FRAME_DRAWS> m_arrFrameArenas;
+	mutable LinearArena m_scratchArena;									// Temporaries of device/queue queries
 
 	//Vulkan functions
 	// - Create functions
@@ -83,15 +304,25 @@ private:
 	void CreateLogicalDevice();
 	void CreateSurface();
 	void CreateSwapChain();
+	void CreateColorBufferImage();
+	void CreateDepthBufferImage();
+	void CreateResolutionController();
+	void CreateTimestampQueries();
 	void CreateRenderPass();
-	void CreateGraphicsPipeline();
+	void CreateGraphicsPipeline(const ShaderVariant& shaderVariant);
 	void CreateFramebuffers();
 	void CreateCommandPool();
 	void CreateCommandBuffers();
 	void CreateSynchronization();
+	void CreateFrameGraph();
+	void CreateOcclusionCullingPasses(RenderGraphResource colorResource, RenderGraphResource depthResource);
 
 	// - Record Functions
-	void RecordCommands() const;
+	void RecordCommands(uint32_t imageIndex, LinearArena& frameArena);
+	void RecordSceneDraws(VkCommandBuffer commandBuffer, ScenePass pass = ScenePass::All) const;
+	void RecordDynamicRendering(VkCommandBuffer commandBuffer, ScenePass pass = ScenePass::All) const;
+	void RecordParticleDraws(VkCommandBuffer commandBuffer, ScenePass pass = ScenePass::All) const;
+	void RecordOutputBlit(VkCommandBuffer commandBuffer) const;
 
 	// - Get functions
 	void GetPhysicalDevice();
@@ -99,8 +330,14 @@ private:
 	// - Support functions
 	// -- Checker functions
 	static bool CheckInstanceExtensionSupport(const std::vector<const char*>* checkExtentions);
-	static bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+	bool CheckDeviceExtensionSupport(VkPhysicalDevice device) const;
+	bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) const;
 	bool CheckDeviceSuitable(VkPhysicalDevice device) const;
+	static bool CheckDeviceMatchesOverride(VkPhysicalDevice device, const std::string& nameOrUuid);
+
+	// -- Scoring functions
+	uint64_t RateDevice(VkPhysicalDevice device) const;
+	static std::string GetDeviceUuidString(VkPhysicalDevice device);
 
 	// -- Getter functions
 	QueueFamilyIndices GetQueueFamilies(VkPhysicalDevice device) const;
@@ -108,17 +345,26 @@ private:
 
 	// -- Choose functions
 	static VkSurfaceFormatKHR ChooseBestSurfaceFormat(const std::vector < VkSurfaceFormatKHR>& formats);
-	static VkPresentModeKHR ChooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes);
+	static VkPresentModeKHR ChooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes, bool uncapped);
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities) const;
+	VkFormat ChooseSupportedFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags) const;
+	VkSampleCountFlagBits ChooseMsaaSamples(VkSampleCountFlagBits requested) const;
 
 	// -- Create functions
 	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlagBits aspectFlags) const;
+	VkImage CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+		VkSampleCountFlagBits samples, VkMemoryPropertyFlags preferredProperties, VkMemoryPropertyFlags fallbackProperties,
+		VkDeviceMemory* outImageMemory);
 	VkShaderModule CreateShaderModule(const std::vector<char>& code) const;
 	
 
+	// - Startup functions
+	void TimeStartupPhase(const char* name, const std::function<void()>& phase);
+	void PrintStartupPhases() const;
+
 	// - Debug functions
 	void SetupDebugMessenger();
-	static void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
+	static void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo, DebugMessageSink* debugMessageSink);
 
 	
 };
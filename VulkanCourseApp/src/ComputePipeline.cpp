@@ -0,0 +1,130 @@
+#include "ComputePipeline.h"
+
+
+ComputePipeline::ComputePipeline(VkDevice newDevice, const std::vector<char>& shaderCode,
+	const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize,
+	const VkSpecializationInfo* specializationInfo)
+	: m_device(newDevice)
+	, m_uiPushConstantSize(pushConstantSize)
+{
+	// Create Shader Module
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = shaderCode.size();
+	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+	VkResult result = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a compute shader module");
+	}
+
+	// -- PIPELINE LAYOUT --
+	// Push constants are visible to the compute stage only and always start at offset 0
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	result = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		vkDestroyShaderModule(m_device, shaderModule, nullptr);
+		throw std::runtime_error("Failed to create a Compute Pipeline Layout!");
+	}
+
+	// -- COMPUTE PIPELINE CREATION --
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;			// Compute pipelines have exactly one stage
+	pipelineCreateInfo.stage.module = shaderModule;
+	pipelineCreateInfo.stage.pName = "main";								// Entry point in to shader
+	pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;		// Constants baked in at pipeline creation (e.g workgroup size)
+	pipelineCreateInfo.layout = m_pipelineLayout;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_pipeline);
+
+	// Shader module no longer needed after Pipeline created (or failed to create)
+	vkDestroyShaderModule(m_device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+		throw std::runtime_error("Failed to create a Compute Pipeline");
+	}
+}
+
+VkPipeline ComputePipeline::GetPipeline() const
+{
+	return m_pipeline;
+}
+
+VkPipelineLayout ComputePipeline::GetPipelineLayout() const
+{
+	return m_pipelineLayout;
+}
+
+void ComputePipeline::Bind(VkCommandBuffer commandBuffer) const
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+}
+
+void ComputePipeline::BindDescriptorSets(VkCommandBuffer commandBuffer, const std::vector<VkDescriptorSet>& descriptorSets, uint32_t firstSet) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+		firstSet, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+}
+
+void ComputePipeline::PushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size) const
+{
+	if (size > m_uiPushConstantSize)
+	{
+		throw std::runtime_error("Push constant data is larger than the Compute Pipeline's push constant range");
+	}
+
+	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data);
+}
+
+void ComputePipeline::Dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) const
+{
+	vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+void ComputePipeline::DispatchItems(VkCommandBuffer commandBuffer, uint32_t itemCount, uint32_t localSizeX) const
+{
+	// Nothing to do, and a zero sized dispatch is wasted work on some drivers
+	if (itemCount == 0)
+	{
+		return;
+	}
+
+	vkCmdDispatch(commandBuffer, GroupCount(itemCount, localSizeX), 1, 1);
+}
+
+void ComputePipeline::DispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer argumentBuffer, VkDeviceSize offset) const
+{
+	// Group counts are read from a VkDispatchIndirectCommand the GPU wrote earlier
+	vkCmdDispatchIndirect(commandBuffer, argumentBuffer, offset);
+}
+
+void ComputePipeline::DestroyPipeline() const
+{
+	vkDestroyPipeline(m_device, m_pipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+}
+
+uint32_t ComputePipeline::GroupCount(uint32_t itemCount, uint32_t localSize)
+{
+	return (itemCount + localSize - 1) / localSize;
+}
@@ -0,0 +1,370 @@
+#include "DebugMessageSink.h"
+#include <chrono>
+#include <cstdio>
+
+
+void DebugMessageSink::StartDebugMessageSink()
+{
+	m_ring.reset(new RingCell[RING_CAPACITY]);
+	for (size_t i = 0; i < RING_CAPACITY; ++i)
+	{
+		m_ring[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	m_enqueuePosition = 0;
+	m_dequeuePosition = 0;
+	m_idCounters.reset(new IdCounter[ID_TABLE_SIZE]);
+
+	m_bStopping = false;
+	m_drainThread = std::thread(&DebugMessageSink::DrainLoop, this);
+	m_bRunning = true;
+}
+
+void DebugMessageSink::StopDebugMessageSink()
+{
+	if (!m_drainThread.joinable())
+	{
+		return;
+	}
+
+	m_bRunning = false;
+	{
+		std::lock_guard<std::mutex> lock(m_stopMutex);
+		m_bStopping = true;
+	}
+	m_stopCondition.notify_one();
+	m_drainThread.join();
+
+	PrintSummary();
+}
+
+void DebugMessageSink::Push(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
+	const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData)
+{
+	// Sink not started (or already stopped), nothing to hand the message to
+	if (!m_bRunning.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	m_ullReceived.fetch_add(1, std::memory_order_relaxed);
+
+	// Repeats over the limit are only counted, which is what keeps a noisy layer cheap
+	const uint32_t key = GetMessageKey(pCallbackData);
+	IdCounter* counter = FindIdCounter(key);
+	if (counter != nullptr && counter->windowCount.fetch_add(1, std::memory_order_relaxed) >= MESSAGES_PER_SECOND)
+	{
+		counter->rateLimited.fetch_add(1, std::memory_order_relaxed);
+		m_ullRateLimited.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (!TryEnqueue(messageSeverity, messageType, key, pCallbackData))
+	{
+		m_ullDropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+DebugMessageStats DebugMessageSink::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_recordMutex);
+
+	DebugMessageStats stats = m_stats;
+	stats.received = m_ullReceived.load(std::memory_order_relaxed);
+	stats.rateLimited = m_ullRateLimited.load(std::memory_order_relaxed);
+	stats.dropped = m_ullDropped.load(std::memory_order_relaxed);
+	return stats;
+}
+
+std::vector<PerformanceMetric> DebugMessageSink::GetPerformanceMetrics() const
+{
+	std::lock_guard<std::mutex> lock(m_recordMutex);
+
+	std::vector<PerformanceMetric> metrics;
+	for (const auto& entry : m_mapRecords)
+	{
+		const MessageRecord& record = entry.second;
+		if (!record.performance)
+		{
+			continue;
+		}
+
+		PerformanceMetric metric;
+		metric.messageIdNumber = record.messageIdNumber;
+		metric.messageIdName = record.idName;
+		metric.count = record.count;
+		metric.lastMessage = record.lastMessage;
+		metrics.push_back(std::move(metric));
+	}
+	return metrics;
+}
+
+void DebugMessageSink::PrintSummary() const
+{
+	const DebugMessageStats stats = GetStats();
+	if (stats.received == 0)
+	{
+		return;
+	}
+
+	fprintf(stderr, "Debug messages: %llu received, %llu errors, %llu warnings, %llu performance, %llu rate limited, %llu dropped\n",
+		static_cast<unsigned long long>(stats.received), static_cast<unsigned long long>(stats.errors),
+		static_cast<unsigned long long>(stats.warnings), static_cast<unsigned long long>(stats.performance),
+		static_cast<unsigned long long>(stats.rateLimited), static_cast<unsigned long long>(stats.dropped));
+
+	for (const PerformanceMetric& metric : GetPerformanceMetrics())
+	{
+		fprintf(stderr, "  performance %s (0x%08x): %llu\n", metric.messageIdName.c_str(), static_cast<uint32_t>(metric.messageIdNumber),
+			static_cast<unsigned long long>(metric.count));
+	}
+}
+
+DebugMessageSink::~DebugMessageSink()
+{
+	StopDebugMessageSink();
+}
+
+DebugMessageSink::IdCounter* DebugMessageSink::FindIdCounter(uint32_t key)
+{
+	// Slots are claimed once and never freed, a full neighbourhood just means no rate limiting for that id
+	for (uint32_t probe = 0; probe < ID_TABLE_PROBES; ++probe)
+	{
+		IdCounter& counter = m_idCounters[(key + probe) & (ID_TABLE_SIZE - 1)];
+		uint32_t current = counter.key.load(std::memory_order_acquire);
+		if (current == 0 && counter.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+		{
+			return &counter;
+		}
+		if (current == key)
+		{
+			return &counter;
+		}
+	}
+	return nullptr;
+}
+
+bool DebugMessageSink::TryEnqueue(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
+	uint32_t key, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData)
+{
+	// Claim a cell: its sequence equals the position when free for that lap of the ring
+	RingCell* cell;
+	size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &m_ring[position & (RING_CAPACITY - 1)];
+		const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+		if (difference == 0)
+		{
+			if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// Drain thread hasn't read this cell from the last lap yet
+			return false;
+		}
+		else
+		{
+			position = m_enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	DebugMessage& message = cell->message;
+	message.severity = messageSeverity;
+	message.type = messageType;
+	message.key = key;
+	message.messageIdNumber = pCallbackData->messageIdNumber;
+	CopyString(message.idName, sizeof(message.idName), pCallbackData->pMessageIdName);
+	CopyString(message.text, sizeof(message.text), pCallbackData->pMessage);
+
+	// Publish to the drain thread
+	cell->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+void DebugMessageSink::DrainLoop()
+{
+	auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (true)
+	{
+		bool stopping;
+		{
+			// Polls instead of being woken by the callback, so pushing never touches a lock or the scheduler
+			std::unique_lock<std::mutex> lock(m_stopMutex);
+			m_stopCondition.wait_for(lock, std::chrono::milliseconds(20), [this] { return m_bStopping; });
+			stopping = m_bStopping;
+		}
+
+		Drain();
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= nextReport || stopping)
+		{
+			ReportRepeats();
+			nextReport = now + std::chrono::seconds(1);
+		}
+
+		if (stopping)
+		{
+			return;
+		}
+	}
+}
+
+void DebugMessageSink::Drain()
+{
+	while (true)
+	{
+		RingCell& cell = m_ring[m_dequeuePosition & (RING_CAPACITY - 1)];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		if (sequence != m_dequeuePosition + 1)
+		{
+			// Empty, or the producer that claimed the cell is still copying
+			return;
+		}
+
+		const DebugMessage& message = cell.message;
+		bool print;
+		MessageRecord* record;
+		{
+			std::lock_guard<std::mutex> lock(m_recordMutex);
+
+			const bool performance = (message.type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) != 0;
+			if (message.severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+			{
+				++m_stats.errors;
+			}
+			else if (message.severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+			{
+				++m_stats.warnings;
+			}
+			if (performance)
+			{
+				++m_stats.performance;
+			}
+
+			record = &m_mapRecords[message.key];
+			print = record->count == 0;
+			if (print)
+			{
+				record->idName = message.idName;
+				record->messageIdNumber = message.messageIdNumber;
+				record->performance = performance;
+				++m_stats.printed;
+			}
+			else
+			{
+				++record->unreported;
+			}
+			++record->count;
+			record->lastMessage = message.text;
+		}
+
+		// First of its kind is printed in full, repeats go in to the once a second summary
+		if (print)
+		{
+			Print(message, *record);
+		}
+
+		// Hand the cell back for the next lap
+		cell.sequence.store(m_dequeuePosition + RING_CAPACITY, std::memory_order_release);
+		++m_dequeuePosition;
+	}
+}
+
+void DebugMessageSink::ReportRepeats()
+{
+	// Open the next rate limit window and collect what was only counted in this one
+	std::unordered_map<uint32_t, uint32_t> rateLimited;
+	for (uint32_t i = 0; i < ID_TABLE_SIZE; ++i)
+	{
+		IdCounter& counter = m_idCounters[i];
+		const uint32_t key = counter.key.load(std::memory_order_acquire);
+		if (key == 0)
+		{
+			continue;
+		}
+
+		counter.windowCount.store(0, std::memory_order_relaxed);
+		const uint32_t count = counter.rateLimited.exchange(0, std::memory_order_relaxed);
+		if (count > 0)
+		{
+			rateLimited[key] = count;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_recordMutex);
+	for (auto& entry : m_mapRecords)
+	{
+		MessageRecord& record = entry.second;
+		const auto found = rateLimited.find(entry.first);
+		const uint64_t limited = found != rateLimited.end() ? found->second : 0;
+		record.count += limited;
+
+		const uint64_t repeats = record.unreported + limited;
+		record.unreported = 0;
+		if (repeats == 0 || record.performance)
+		{
+			continue;
+		}
+
+		fprintf(stderr, "validation layer: %s repeated %llu more times\n", record.idName.c_str(), static_cast<unsigned long long>(repeats));
+	}
+}
+
+void DebugMessageSink::Print(const DebugMessage& message, const MessageRecord& record)
+{
+	const char* kind = record.performance ? "performance" : "validation layer";
+	fprintf(stderr, "%s [%s] %s: %s\n", kind, GetSeverityName(message.severity), message.idName, message.text);
+}
+
+uint32_t DebugMessageSink::GetMessageKey(const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData)
+{
+	if (pCallbackData->messageIdNumber != 0)
+	{
+		return static_cast<uint32_t>(pCallbackData->messageIdNumber) | 1u;
+	}
+
+	// Loader and general messages have no id, tell them apart by name or text (FNV-1a)
+	const char* source = pCallbackData->pMessageIdName != nullptr ? pCallbackData->pMessageIdName : pCallbackData->pMessage;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; source != nullptr && source[i] != '\0' && i < MAX_MESSAGE_LENGTH; ++i)
+	{
+		hash = (hash ^ static_cast<uint8_t>(source[i])) * 16777619u;
+	}
+	// 0 marks an empty id counter
+	return hash | 1u;
+}
+
+void DebugMessageSink::CopyString(char* destination, size_t capacity, const char* source)
+{
+	size_t length = 0;
+	if (source != nullptr)
+	{
+		while (length + 1 < capacity && source[length] != '\0')
+		{
+			destination[length] = source[length];
+			++length;
+		}
+	}
+	destination[length] = '\0';
+}
+
+const char* DebugMessageSink::GetSeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+{
+	if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+	{
+		return "ERROR";
+	}
+	if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+	{
+		return "WARNING";
+	}
+	if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+	{
+		return "INFO";
+	}
+	return "VERBOSE";
+}
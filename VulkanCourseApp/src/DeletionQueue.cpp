@@ -0,0 +1,104 @@
+#include "DeletionQueue.h"
+
+
+void DeletionQueue::InitDeletionQueue(FrameTimeline* frameTimeline)
+{
+	m_pFrameTimeline = frameTimeline;
+}
+
+void DeletionQueue::SetCurrentValue(uint64_t frameValue)
+{
+	m_ullCurrentValue = frameValue;
+}
+
+uint64_t DeletionQueue::GetCurrentValue() const
+{
+	return m_ullCurrentValue;
+}
+
+void DeletionQueue::Defer(std::function<void()> destroy)
+{
+	Defer(m_ullCurrentValue, std::move(destroy));
+}
+
+void DeletionQueue::Defer(uint64_t frameValue, std::function<void()> destroy, std::function<bool()> isReady)
+{
+	PendingDeletion deletion;
+	deletion.frameValue = frameValue;
+	deletion.destroy = std::move(destroy);
+	deletion.isReady = std::move(isReady);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_dequePending.push_back(std::move(deletion));
+}
+
+void DeletionQueue::Collect()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Releases from different threads (or waiting on isReady) aren't strictly in value order, so check all of them
+		// Compacts in place, keeping what isn't done yet in release order
+		size_t kept = 0;
+		for (size_t i = 0; i < m_dequePending.size(); ++i)
+		{
+			PendingDeletion& deletion = m_dequePending[i];
+			const bool complete = m_pFrameTimeline == nullptr || m_pFrameTimeline->IsComplete(deletion.frameValue);
+			if (complete && (!deletion.isReady || deletion.isReady()))
+			{
+				m_vecCollecting.push_back(std::move(deletion));
+			}
+			else
+			{
+				if (kept != i)
+				{
+					m_dequePending[kept] = std::move(deletion);
+				}
+				++kept;
+			}
+		}
+		m_dequePending.resize(kept);
+	}
+
+	for (auto& deletion : m_vecCollecting)
+	{
+		deletion.destroy();
+	}
+	m_ullDestroyedCount += m_vecCollecting.size();
+	m_vecCollecting.clear();
+}
+
+void DeletionQueue::Flush()
+{
+	// Destroying may release more (e.g a mesh owning buffers), so keep going until nothing is left
+	std::deque<PendingDeletion> flushing;
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			flushing.swap(m_dequePending);
+		}
+		if (flushing.empty())
+		{
+			break;
+		}
+
+		for (auto& deletion : flushing)
+		{
+			deletion.destroy();
+		}
+		m_ullDestroyedCount += flushing.size();
+		flushing.clear();
+	}
+}
+
+size_t DeletionQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_dequePending.size();
+}
+
+uint64_t DeletionQueue::GetDestroyedCount() const
+{
+	return m_ullDestroyedCount;
+}
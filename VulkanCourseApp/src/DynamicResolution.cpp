@@ -0,0 +1,65 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+
+void DynamicResolutionController::InitDynamicResolution(const DynamicResolutionSettings& settings)
+{
+	m_settings = settings;
+	m_fScale = settings.maxScale;
+	m_dSmoothedFrameMs = -1.0;
+}
+
+float DynamicResolutionController::Update(double gpuFrameMs)
+{
+	if (!(gpuFrameMs > 0.0))
+	{
+		return m_fScale;
+	}
+
+	m_dSmoothedFrameMs = m_dSmoothedFrameMs < 0.0 ? gpuFrameMs
+		: m_dSmoothedFrameMs + (gpuFrameMs - m_dSmoothedFrameMs) * m_settings.smoothing;
+
+	float scale = m_fScale;
+	if (gpuFrameMs > m_settings.targetFrameMs)
+	{
+		// Over budget: drop to what this frame would have needed, don't wait for the average to notice
+		scale = m_fScale * static_cast<float>(std::sqrt(m_settings.targetFrameMs / gpuFrameMs));
+
+		// The spike counts fully, so the next frames don't climb straight back in to it
+		m_dSmoothedFrameMs = std::max(m_dSmoothedFrameMs, gpuFrameMs);
+	}
+	else if (m_dSmoothedFrameMs < m_settings.targetFrameMs * m_settings.increaseHeadroom)
+	{
+		const float fit = m_fScale * static_cast<float>(std::sqrt(m_settings.targetFrameMs * m_settings.increaseHeadroom / m_dSmoothedFrameMs));
+		scale = std::min(fit, m_fScale + m_settings.maxIncreaseStep);
+	}
+
+	m_fScale = std::min(std::max(scale, m_settings.minScale), m_settings.maxScale);
+	return m_fScale;
+}
+
+float DynamicResolutionController::GetScale() const
+{
+	return m_fScale;
+}
+
+double DynamicResolutionController::GetSmoothedFrameMs() const
+{
+	return m_dSmoothedFrameMs;
+}
+
+const DynamicResolutionSettings& DynamicResolutionController::GetSettings() const
+{
+	return m_settings;
+}
+
+VkExtent2D DynamicResolutionController::GetRenderExtent(VkExtent2D outputExtent) const
+{
+	auto scaleAxis = [this](uint32_t size)
+	{
+		const uint32_t scaled = static_cast<uint32_t>(std::lround(static_cast<double>(size) * m_fScale));
+		return std::min(std::max(scaled, 1u), size);
+	};
+	return { scaleAxis(outputExtent.width), scaleAxis(outputExtent.height) };
+}
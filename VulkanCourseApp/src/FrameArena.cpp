@@ -0,0 +1,88 @@
+#include "FrameArena.h"
+#include <algorithm>
+
+
+LinearArena::LinearArena(size_t capacity)
+	: m_block(std::make_unique<std::byte[]>(capacity))
+	, m_capacity(capacity)
+{
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	// Block is allocated with new[], so its start is aligned for any fundamental type and only the offset needs aligning
+	const size_t alignedOffset = (m_offset + alignment - 1) & ~(alignment - 1);
+	if (m_block && alignedOffset + size <= m_capacity)
+	{
+		m_offset = alignedOffset + size;
+		m_peak = std::max(m_peak, m_offset + m_overflowBytes);
+		return m_block.get() + alignedOffset;
+	}
+
+	// Out of space, take this one from the heap (kept until Reset) and remember to grow
+	m_vecOverflowBlocks.push_back(std::make_unique<std::byte[]>(size + alignment));
+	void* pointer = m_vecOverflowBlocks.back().get();
+	size_t space = size + alignment;
+	std::align(alignment, size, pointer, space);
+
+	m_overflowBytes += size + alignment;
+	m_peak = std::max(m_peak, m_offset + m_overflowBytes);
+	++m_ullOverflowCount;
+	return pointer;
+}
+
+void LinearArena::Reset()
+{
+	m_offset = 0;
+	if (m_vecOverflowBlocks.empty())
+	{
+		return;
+	}
+
+	// Last frame didn't fit, grow to what it needed (with some head room) so the next one does
+	m_vecOverflowBlocks.clear();
+	m_overflowBytes = 0;
+	m_capacity = m_peak + m_peak / 2;
+	m_block = std::make_unique<std::byte[]>(m_capacity);
+}
+
+size_t LinearArena::GetCapacity() const
+{
+	return m_capacity;
+}
+
+size_t LinearArena::GetUsed() const
+{
+	return m_offset + m_overflowBytes;
+}
+
+size_t LinearArena::GetPeak() const
+{
+	return m_peak;
+}
+
+uint64_t LinearArena::GetOverflowCount() const
+{
+	return m_ullOverflowCount;
+}
+
+LinearArena::Scope::Scope(LinearArena& arena)
+	: m_arena(arena)
+	, m_offset(arena.m_offset)
+	, m_overflowBlocks(arena.m_vecOverflowBlocks.size())
+{
+}
+
+LinearArena::Scope::~Scope()
+{
+	// Outermost scope on an empty arena can reset it completely (growing it if the scope overflowed)
+	if (m_offset == 0 && m_overflowBlocks == 0)
+	{
+		m_arena.Reset();
+	}
+	// Otherwise overflow blocks made inside the scope are kept until the next Reset
+	else if (m_arena.m_vecOverflowBlocks.size() == m_overflowBlocks)
+	{
+		m_arena.m_offset = m_offset;
+	}
+}
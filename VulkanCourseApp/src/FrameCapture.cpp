@@ -0,0 +1,345 @@
+#include "FrameCapture.h"
+#include <fstream>
+#include "Utilities.h"
+
+
+void FrameCapture::InitFrameCapture(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, FrameTimeline* frameTimeline,
+	VkExtent2D extent, VkFormat format, uint32_t ringSize)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_pMemoryBudget = memoryBudget;
+	m_pFrameTimeline = frameTimeline;
+	m_extent = extent;
+	m_format = format;
+	m_frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+	m_vecSlots.resize(ringSize);
+	for (auto& slot : m_vecSlots)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = m_frameSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &slot.buffer);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Readback Buffer");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(m_device, slot.buffer, &memRequirements);
+
+		// CPU reads this memory, cached makes that fast (uncached reads are painfully slow), coherent is only a fallback
+		uint32_t memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		if (memoryTypeIndex == UINT32_MAX)
+		{
+			memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		}
+		if (memoryTypeIndex == UINT32_MAX)
+		{
+			throw std::runtime_error("Failed to find memory type for a Readback Buffer");
+		}
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
+		m_bCoherent = (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = memRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::Readback, &slot.memory)
+			: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &slot.memory);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Readback Buffer Memory");
+		}
+		vkBindBufferMemory(m_device, slot.buffer, slot.memory, 0);
+
+		// Mapped for the lifetime of the ring
+		void* data;
+		result = vkMapMemory(m_device, slot.memory, 0, VK_WHOLE_SIZE, 0, &data);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to map a Readback Buffer");
+		}
+		slot.data = static_cast<const char*>(data);
+	}
+
+	m_bStopping = false;
+	m_worker = std::thread(&FrameCapture::WorkerLoop, this);
+}
+
+void FrameCapture::ShutdownFrameCapture()
+{
+	// Device is idle, so every copy in flight is complete, deliver them before stopping
+	Poll();
+	StopWorker();
+
+	for (auto& slot : m_vecSlots)
+	{
+		vkUnmapMemory(m_device, slot.memory);
+		vkDestroyBuffer(m_device, slot.buffer, nullptr);
+		if (m_pMemoryBudget != nullptr)
+		{
+			m_pMemoryBudget->Free(slot.memory);
+		}
+		else
+		{
+			vkFreeMemory(m_device, slot.memory, nullptr);
+		}
+	}
+	m_vecSlots.clear();
+}
+
+void FrameCapture::StartCapture(CaptureCallback callback, uint32_t frameCount)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_callback = std::move(callback);
+	m_uiFramesRemaining = frameCount;
+}
+
+void FrameCapture::StopCapture()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_uiFramesRemaining = 0;
+}
+
+bool FrameCapture::IsCapturing() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_uiFramesRemaining > 0;
+}
+
+bool FrameCapture::RecordCapture(VkCommandBuffer commandBuffer, VkImage swapchainImage, VkImageLayout imageLayout, uint64_t frameValue)
+{
+	ReadbackSlot* slot = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_uiFramesRemaining == 0 || !m_callback)
+		{
+			return false;
+		}
+
+		for (auto& candidate : m_vecSlots)
+		{
+			if (candidate.state == SlotState::Free)
+			{
+				slot = &candidate;
+				break;
+			}
+		}
+
+		// GPU or worker is behind, skipping a frame beats stalling one
+		if (slot == nullptr)
+		{
+			++m_ullDroppedCount;
+			return false;
+		}
+
+		slot->state = SlotState::InFlight;
+		slot->frameValue = frameValue;
+		slot->callback = m_callback;
+		if (m_uiFramesRemaining != CONTINUOUS)
+		{
+			--m_uiFramesRemaining;
+		}
+	}
+
+	// Image is waiting to be presented. Its last writer may be a render pass or a blit, and the transition to present
+	// layout may have been in a barrier to BOTTOM_OF_PIPE: waiting on every earlier command chains with all of them
+	const bool transitionImage = imageLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	VkImageMemoryBarrier imageBarrier = {};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = swapchainImage;
+	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarrier.subresourceRange.baseMipLevel = 0;
+	imageBarrier.subresourceRange.levelCount = 1;
+	imageBarrier.subresourceRange.baseArrayLayer = 0;
+	imageBarrier.subresourceRange.layerCount = 1;
+
+	if (transitionImage)
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageBarrier);
+	}
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = 0;
+	copyRegion.bufferRowLength = 0;				// Tightly packed
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = { m_extent.width, m_extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &copyRegion);
+
+	// Back to present layout unless the caller transitions it (present waits on the frame's semaphore, so no access
+	// mask needed) and make the copy visible to host reads once the frame's timeline value is reached
+	imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	imageBarrier.dstAccessMask = 0;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkBufferMemoryBarrier bufferBarrier = {};
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = slot->buffer;
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+
+	if (transitionImage)
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageBarrier);
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+	return true;
+}
+
+void FrameCapture::Poll()
+{
+	bool handedOver = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (uint32_t i = 0; i < m_vecSlots.size(); ++i)
+		{
+			ReadbackSlot& slot = m_vecSlots[i];
+			if (slot.state == SlotState::InFlight && m_pFrameTimeline->IsComplete(slot.frameValue))
+			{
+				slot.state = SlotState::Processing;
+				m_dequeReady.push_back(i);
+				handedOver = true;
+			}
+		}
+	}
+
+	if (handedOver)
+	{
+		m_readyCondition.notify_one();
+	}
+}
+
+uint64_t FrameCapture::GetCapturedCount() const
+{
+	return m_ullCapturedCount;
+}
+
+uint64_t FrameCapture::GetDroppedCount() const
+{
+	return m_ullDroppedCount;
+}
+
+bool FrameCapture::WritePpm(const CapturedFrame& frame, const std::string& fileName)
+{
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	const bool bgra = frame.format == VK_FORMAT_B8G8R8A8_UNORM || frame.format == VK_FORMAT_B8G8R8A8_SRGB;
+	file << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+
+	std::vector<char> row(static_cast<size_t>(frame.width) * 3);
+	for (uint32_t y = 0; y < frame.height; ++y)
+	{
+		const char* source = frame.data + static_cast<size_t>(y) * frame.rowPitch;
+		for (uint32_t x = 0; x < frame.width; ++x)
+		{
+			row[x * 3 + 0] = source[x * 4 + (bgra ? 2 : 0)];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + (bgra ? 0 : 2)];
+		}
+		file.write(row.data(), static_cast<std::streamsize>(row.size()));
+	}
+	return file.good();
+}
+
+FrameCapture::~FrameCapture()
+{
+	StopWorker();
+}
+
+void FrameCapture::WorkerLoop()
+{
+	while (true)
+	{
+		uint32_t slotIndex;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_readyCondition.wait(lock, [this] { return m_bStopping || !m_dequeReady.empty(); });
+
+			// Deliver everything handed over before stopping
+			if (m_dequeReady.empty())
+			{
+				return;
+			}
+			slotIndex = m_dequeReady.front();
+			m_dequeReady.pop_front();
+		}
+
+		// Slot belongs to the worker while Processing, no lock needed to read it
+		ReadbackSlot& slot = m_vecSlots[slotIndex];
+		if (!m_bCoherent)
+		{
+			VkMappedMemoryRange range = {};
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = slot.memory;
+			range.offset = 0;
+			range.size = VK_WHOLE_SIZE;
+			vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+		}
+
+		CapturedFrame frame;
+		frame.frameValue = slot.frameValue;
+		frame.width = m_extent.width;
+		frame.height = m_extent.height;
+		frame.format = m_format;
+		frame.rowPitch = m_extent.width * 4;
+		frame.data = slot.data;
+		slot.callback(frame);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			slot.callback = nullptr;
+			slot.state = SlotState::Free;
+		}
+		++m_ullCapturedCount;
+	}
+}
+
+void FrameCapture::StopWorker()
+{
+	if (!m_worker.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_readyCondition.notify_one();
+	m_worker.join();
+}
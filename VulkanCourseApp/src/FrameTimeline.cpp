@@ -0,0 +1,99 @@
+#include "FrameTimeline.h"
+
+
+void FrameTimeline::CreateTimeline(VkDevice newDevice)
+{
+	m_device = newDevice;
+
+	// Semaphore type information (timeline semaphores hold a 64-bit counter instead of a signaled/unsignaled state)
+	VkSemaphoreTypeCreateInfo typeCreateInfo = {};
+	typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeCreateInfo.initialValue = 0;						// Nothing submitted yet, so every "frame 0" wait is already satisfied
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+	const VkResult result = vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_semaphore);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Timeline Semaphore");
+	}
+
+	m_ullSubmittedValue = 0;
+	m_ullCompletedValue = 0;
+}
+
+void FrameTimeline::DestroyTimeline() const
+{
+	vkDestroySemaphore(m_device, m_semaphore, nullptr);
+}
+
+VkSemaphore FrameTimeline::GetSemaphore() const
+{
+	return m_semaphore;
+}
+
+uint64_t FrameTimeline::AdvanceValue()
+{
+	return ++m_ullSubmittedValue;
+}
+
+uint64_t FrameTimeline::GetLastSubmittedValue() const
+{
+	return m_ullSubmittedValue;
+}
+
+uint64_t FrameTimeline::GetCompletedValue()
+{
+	uint64_t value = 0;
+	if (vkGetSemaphoreCounterValue(m_device, m_semaphore, &value) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to query Timeline Semaphore value (device lost?)");
+	}
+
+	// Counter only ever increases, but another thread may have cached a newer value in the meantime
+	uint64_t cached = m_ullCompletedValue.load();
+	while (cached < value && !m_ullCompletedValue.compare_exchange_weak(cached, value))
+	{
+	}
+
+	return value;
+}
+
+bool FrameTimeline::IsComplete(uint64_t value)
+{
+	return value <= m_ullCompletedValue.load() || value <= GetCompletedValue();
+}
+
+bool FrameTimeline::Wait(uint64_t value, uint64_t timeout)
+{
+	if (value <= m_ullCompletedValue.load())
+	{
+		return true;
+	}
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_semaphore;
+	waitInfo.pValues = &value;
+
+	const VkResult result = vkWaitSemaphores(m_device, &waitInfo, timeout);
+	if (result == VK_TIMEOUT)
+	{
+		return false;
+	}
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to wait on Timeline Semaphore");
+	}
+
+	uint64_t cached = m_ullCompletedValue.load();
+	while (cached < value && !m_ullCompletedValue.compare_exchange_weak(cached, value))
+	{
+	}
+
+	return true;
+}
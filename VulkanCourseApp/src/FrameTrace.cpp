@@ -0,0 +1,213 @@
+#include "FrameTrace.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Records are copied to and from the file as they are in memory
+static_assert(sizeof(FrameTraceHeader) == 32, "FrameTraceHeader must match the trace layout");
+static_assert(sizeof(FrameTraceRecordHeader) == 8, "FrameTraceRecordHeader must match the trace layout");
+static_assert(sizeof(FrameTracePacket) == 88, "FrameTracePacket must match the trace layout");
+static_assert(sizeof(Vertex) == 24, "Vertex must match the trace layout");
+
+namespace
+{
+	// Reads from the loaded file, throws when a read would run past its end
+	class TraceReader
+	{
+	public:
+		TraceReader(const std::vector<char>& data, const std::string& fileName)
+			: m_data(data)
+			, m_fileName(fileName)
+		{}
+
+		void Read(void* destination, size_t size)
+		{
+			if (size > m_data.size() - m_offset)
+			{
+				throw std::runtime_error("Frame trace is cut short: " + m_fileName);
+			}
+			if (size == 0)
+			{
+				return;		// Empty vectors' data() may be null
+			}
+			memcpy(destination, m_data.data() + m_offset, size);
+			m_offset += size;
+		}
+
+		bool AtEnd() const
+		{
+			return m_offset == m_data.size();
+		}
+
+		size_t GetOffset() const
+		{
+			return m_offset;
+		}
+
+		void Seek(size_t offset)
+		{
+			if (offset > m_data.size())
+			{
+				throw std::runtime_error("Frame trace is cut short: " + m_fileName);
+			}
+			m_offset = offset;
+		}
+
+	private:
+		const std::vector<char>& m_data;
+		const std::string& m_fileName;
+		size_t m_offset = 0;
+	};
+}
+
+FrameTrace LoadFrameTrace(const std::string& fileName)
+{
+	const std::vector<char> data = ReadFile(fileName);
+	TraceReader reader(data, fileName);
+
+	FrameTrace trace;
+	reader.Read(&trace.header, sizeof(trace.header));
+	if (trace.header.magic != FRAME_TRACE_MAGIC)
+	{
+		throw std::runtime_error("Not a frame trace: " + fileName);
+	}
+	if (trace.header.version != FRAME_TRACE_VERSION)
+	{
+		throw std::runtime_error("Frame trace " + fileName + " is version " + std::to_string(trace.header.version)
+			+ ", only version " + std::to_string(FRAME_TRACE_VERSION) + " can be replayed");
+	}
+
+	while (!reader.AtEnd())
+	{
+		FrameTraceRecordHeader recordHeader;
+		reader.Read(&recordHeader, sizeof(recordHeader));
+		const size_t recordEnd = reader.GetOffset() + recordHeader.size;
+
+		if (recordHeader.type == FrameTraceRecordType::Mesh)
+		{
+			FrameTraceMesh mesh;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+			reader.Read(&mesh.meshId, sizeof(mesh.meshId));
+			reader.Read(&vertexCount, sizeof(vertexCount));
+			reader.Read(&indexCount, sizeof(indexCount));
+
+			// Counts are checked against the record before anything is allocated for them
+			const uint64_t payloadSize = 3 * sizeof(uint32_t) + static_cast<uint64_t>(vertexCount) * sizeof(Vertex)
+				+ static_cast<uint64_t>(indexCount) * sizeof(uint32_t);
+			if (payloadSize > recordHeader.size)
+			{
+				throw std::runtime_error("Frame trace has a malformed mesh record: " + fileName);
+			}
+
+			mesh.vecVertices.resize(vertexCount);
+			mesh.vecIndices.resize(indexCount);
+			reader.Read(mesh.vecVertices.data(), mesh.vecVertices.size() * sizeof(Vertex));
+			reader.Read(mesh.vecIndices.data(), mesh.vecIndices.size() * sizeof(uint32_t));
+			trace.vecMeshes.push_back(std::move(mesh));
+		}
+		else if (recordHeader.type == FrameTraceRecordType::Frame)
+		{
+			if (recordHeader.size < sizeof(FrameTracePacket))
+			{
+				throw std::runtime_error("Frame trace has a malformed frame record: " + fileName);
+			}
+			FrameTracePacket packet;
+			reader.Read(&packet, sizeof(packet));
+			trace.vecFrames.push_back(packet);
+		}
+
+		// Unknown records are skipped whole, known ones may have grown at the end
+		reader.Seek(recordEnd);
+	}
+
+	return trace;
+}
+
+void FrameTraceRecorder::StartTrace(const std::string& fileName, const FrameTraceHeader& header, const std::vector<FrameTraceMesh>& meshes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_strFileName = fileName;
+	m_vecData.clear();
+	m_ullFrameCount = 0;
+
+	AppendData(&header, sizeof(header));
+	for (const FrameTraceMesh& mesh : meshes)
+	{
+		const uint32_t vertexCount = static_cast<uint32_t>(mesh.vecVertices.size());
+		const uint32_t indexCount = static_cast<uint32_t>(mesh.vecIndices.size());
+		const size_t payloadSize = 3 * sizeof(uint32_t) + mesh.vecVertices.size() * sizeof(Vertex) + mesh.vecIndices.size() * sizeof(uint32_t);
+
+		const FrameTraceRecordHeader recordHeader = { FrameTraceRecordType::Mesh, static_cast<uint32_t>(payloadSize) };
+		AppendData(&recordHeader, sizeof(recordHeader));
+		AppendData(&mesh.meshId, sizeof(mesh.meshId));
+		AppendData(&vertexCount, sizeof(vertexCount));
+		AppendData(&indexCount, sizeof(indexCount));
+		AppendData(mesh.vecVertices.data(), mesh.vecVertices.size() * sizeof(Vertex));
+		AppendData(mesh.vecIndices.data(), mesh.vecIndices.size() * sizeof(uint32_t));
+	}
+
+	m_bTracing = true;
+}
+
+void FrameTraceRecorder::RecordFrame(const FrameTracePacket& packet)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_bTracing)
+	{
+		return;
+	}
+
+	AppendRecord(FrameTraceRecordType::Frame, &packet, sizeof(packet));
+	++m_ullFrameCount;
+}
+
+bool FrameTraceRecorder::StopTrace()
+{
+	// Taken out under the lock, written without it so frames recorded meanwhile don't wait for the disk
+	std::string fileName;
+	std::vector<char> data;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_bTracing)
+		{
+			return false;
+		}
+		m_bTracing = false;
+		fileName = std::move(m_strFileName);
+		data.swap(m_vecData);
+	}
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.write(data.data(), static_cast<std::streamsize>(data.size()));
+	return file.good();
+}
+
+bool FrameTraceRecorder::IsTracing() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bTracing;
+}
+
+uint64_t FrameTraceRecorder::GetFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ullFrameCount;
+}
+
+void FrameTraceRecorder::AppendRecord(FrameTraceRecordType type, const void* payload, uint32_t size)
+{
+	const FrameTraceRecordHeader recordHeader = { type, size };
+	AppendData(&recordHeader, sizeof(recordHeader));
+	AppendData(payload, size);
+}
+
+void FrameTraceRecorder::AppendData(const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	m_vecData.insert(m_vecData.end(), bytes, bytes + size);
+}
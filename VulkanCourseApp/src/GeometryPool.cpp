@@ -0,0 +1,297 @@
+#include "GeometryPool.h"
+#include <algorithm>
+#include <chrono>
+
+
+// -- RangeAllocator --
+void RangeAllocator::InitRangeAllocator(uint32_t capacity)
+{
+	m_uiCapacity = capacity;
+	m_uiFreeCount = capacity;
+	m_mapFree.clear();
+	if (capacity > 0)
+	{
+		m_mapFree[0] = capacity;
+	}
+}
+
+bool RangeAllocator::Allocate(uint32_t count, uint32_t& outOffset)
+{
+	if (count == 0)
+	{
+		outOffset = 0;
+		return true;
+	}
+
+	for (auto it = m_mapFree.begin(); it != m_mapFree.end(); ++it)
+	{
+		if (it->second < count)
+		{
+			continue;
+		}
+
+		// Take the front of the range, the rest stays free
+		outOffset = it->first;
+		const uint32_t remaining = it->second - count;
+		m_mapFree.erase(it);
+		if (remaining > 0)
+		{
+			m_mapFree[outOffset + count] = remaining;
+		}
+		m_uiFreeCount -= count;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	m_uiFreeCount += count;
+	auto next = m_mapFree.lower_bound(offset);
+
+	// Merge with the free range right before it
+	if (next != m_mapFree.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			count += previous->second;
+			m_mapFree.erase(previous);
+		}
+	}
+
+	// And with the one right after it
+	if (next != m_mapFree.end() && offset + count == next->first)
+	{
+		count += next->second;
+		m_mapFree.erase(next);
+	}
+
+	m_mapFree[offset] = count;
+}
+
+uint32_t RangeAllocator::GetCapacity() const
+{
+	return m_uiCapacity;
+}
+
+uint32_t RangeAllocator::GetFreeCount() const
+{
+	return m_uiFreeCount;
+}
+
+uint32_t RangeAllocator::GetLargestFreeRange() const
+{
+	uint32_t largest = 0;
+	for (const auto& range : m_mapFree)
+	{
+		largest = std::max(largest, range.second);
+	}
+	return largest;
+}
+
+bool AllocateGeometryRange(RangeAllocator& vertexRanges, RangeAllocator& indexRanges, GeometryRange& range)
+{
+	if (!vertexRanges.Allocate(range.vertexCount, range.vertexOffset))
+	{
+		return false;
+	}
+	if (!indexRanges.Allocate(range.indexCount, range.firstIndex))
+	{
+		vertexRanges.Free(range.vertexOffset, range.vertexCount);
+		return false;
+	}
+	return true;
+}
+
+// -- GeometryPool --
+void GeometryPool::InitGeometryPool(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, const QueueFamilyIndices& queueFamilyIndices,
+	MemoryBudget* memoryBudget, DeletionQueue* deletionQueue, uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_pMemoryBudget = memoryBudget;
+	m_pDeletionQueue = deletionQueue;
+
+	// Same families as UploadService picks
+	m_arrQueueFamilies[0] = static_cast<uint32_t>(queueFamilyIndices.graphicsFamily);
+	m_arrQueueFamilies[1] = static_cast<uint32_t>(queueFamilyIndices.transferFamily >= 0 ? queueFamilyIndices.transferFamily : queueFamilyIndices.graphicsFamily);
+	m_bConcurrent = m_arrQueueFamilies[0] != m_arrQueueFamilies[1];
+
+	m_vertexBuffer = CreatePoolBuffer(sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCapacity), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	m_indexBuffer = CreatePoolBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCapacity), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_vertexRanges.InitRangeAllocator(vertexCapacity);
+	m_indexRanges.InitRangeAllocator(indexCapacity);
+	m_uiMeshCount = 0;
+}
+
+void GeometryPool::ShutdownGeometryPool()
+{
+	m_vertexBuffer.Release();
+	m_indexBuffer.Release();
+}
+
+bool GeometryPool::Add(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, UploadService& uploadService,
+	GeometryRange& outRange, UploadFuture& outVertexUpload, UploadFuture& outIndexUpload)
+{
+	GeometryRange range;
+	range.vertexCount = static_cast<uint32_t>(vertices.size());
+	range.indexCount = static_cast<uint32_t>(indices.size());
+	if (range.vertexCount == 0)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!AllocateGeometryRange(m_vertexRanges, m_indexRanges, range))
+		{
+			return false;
+		}
+		++m_uiMeshCount;
+	}
+
+	// Only the mesh's part of each buffer is written. Buffers are concurrent, the graphics queue keeps drawing the rest meanwhile
+	const char* vertexBytes = reinterpret_cast<const char*>(vertices.data());
+	outVertexUpload = uploadService.EnqueueBufferUpload(m_vertexBuffer.GetBuffer(), sizeof(Vertex) * static_cast<VkDeviceSize>(range.vertexOffset),
+		std::vector<char>(vertexBytes, vertexBytes + sizeof(Vertex) * vertices.size()), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		m_bConcurrent);
+
+	outIndexUpload = UploadFuture();
+	if (range.indexCount > 0)
+	{
+		const char* indexBytes = reinterpret_cast<const char*>(indices.data());
+		outIndexUpload = uploadService.EnqueueBufferUpload(m_indexBuffer.GetBuffer(), sizeof(uint32_t) * static_cast<VkDeviceSize>(range.firstIndex),
+			std::vector<char>(indexBytes, indexBytes + sizeof(uint32_t) * indices.size()), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+			m_bConcurrent);
+	}
+
+	outRange = range;
+	return true;
+}
+
+void GeometryPool::Remove(const GeometryRange& range, const UploadFuture& vertexUpload, const UploadFuture& indexUpload)
+{
+	if (!range.IsValid())
+	{
+		return;
+	}
+
+	if (m_pDeletionQueue == nullptr)
+	{
+		FreeRange(range);
+		return;
+	}
+
+	// Frames recorded so far may still draw the range, and an upload may still be writing in to it
+	m_pDeletionQueue->Defer(m_pDeletionQueue->GetCurrentValue(), [this, range]() { FreeRange(range); },
+		[vertexUpload, indexUpload]()
+		{
+			const auto isReady = [](const UploadFuture& future)
+			{
+				return !future.valid() || future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			};
+			return isReady(vertexUpload) && isReady(indexUpload);
+		});
+}
+
+void GeometryPool::Bind(VkCommandBuffer commandBuffer) const
+{
+	const VkBuffer vertexBuffers[] = { m_vertexBuffer.GetBuffer() };
+	constexpr VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+VkBuffer GeometryPool::GetVertexBuffer() const
+{
+	return m_vertexBuffer.GetBuffer();
+}
+
+VkBuffer GeometryPool::GetIndexBuffer() const
+{
+	return m_indexBuffer.GetBuffer();
+}
+
+GeometryPoolStats GeometryPool::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	GeometryPoolStats stats;
+	stats.vertexCapacity = m_vertexRanges.GetCapacity();
+	stats.vertexFree = m_vertexRanges.GetFreeCount();
+	stats.largestVertexRange = m_vertexRanges.GetLargestFreeRange();
+	stats.indexCapacity = m_indexRanges.GetCapacity();
+	stats.indexFree = m_indexRanges.GetFreeCount();
+	stats.largestIndexRange = m_indexRanges.GetLargestFreeRange();
+	stats.meshCount = m_uiMeshCount;
+	return stats;
+}
+
+void GeometryPool::FreeRange(const GeometryRange& range)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_vertexRanges.Free(range.vertexOffset, range.vertexCount);
+	m_indexRanges.Free(range.firstIndex, range.indexCount);
+	--m_uiMeshCount;
+}
+
+GpuBuffer GeometryPool::CreatePoolBuffer(VkDeviceSize size, VkBufferUsageFlags usage) const
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	// Ranges are uploaded on the transfer queue while the graphics queue draws the others. Ownership is per buffer,
+	// not per range, so the buffers are shared by both families instead of handed back and forth
+	if (m_bConcurrent)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = m_arrQueueFamilies;
+	}
+	else
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	VkBuffer buffer;
+	VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Geometry Pool Buffer");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type for a Geometry Pool Buffer");
+	}
+
+	// Pool is static geometry, it's never evicted, so a refused allocation is as fatal as a failed one
+	VkDeviceMemory memory;
+	result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::Mesh, &memory)
+		: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &memory);
+	if (result != VK_SUCCESS)
+	{
+		vkDestroyBuffer(m_device, buffer, nullptr);
+		throw std::runtime_error("Failed to allocate Geometry Pool Buffer Memory");
+	}
+
+	vkBindBufferMemory(m_device, buffer, memory, 0);
+	return GpuBuffer(m_device, buffer, memory, m_pMemoryBudget, m_pDeletionQueue);
+}
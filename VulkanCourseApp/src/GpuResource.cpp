@@ -0,0 +1,229 @@
+#include "GpuResource.h"
+#include <utility>
+
+
+// -- GpuBuffer --
+GpuBuffer::GpuBuffer(VkDevice newDevice, VkBuffer buffer, VkDeviceMemory memory, MemoryBudget* memoryBudget, DeletionQueue* deletionQueue)
+	: m_device(newDevice)
+	, m_buffer(buffer)
+	, m_memory(memory)
+	, m_pMemoryBudget(memoryBudget)
+	, m_pDeletionQueue(deletionQueue)
+{
+}
+
+GpuBuffer::GpuBuffer(GpuBuffer&& other) noexcept
+	: m_device(other.m_device)
+	, m_buffer(other.m_buffer)
+	, m_memory(other.m_memory)
+	, m_pMemoryBudget(other.m_pMemoryBudget)
+	, m_pDeletionQueue(other.m_pDeletionQueue)
+{
+	other.Reset();
+}
+
+GpuBuffer& GpuBuffer::operator=(GpuBuffer&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		m_device = other.m_device;
+		m_buffer = other.m_buffer;
+		m_memory = other.m_memory;
+		m_pMemoryBudget = other.m_pMemoryBudget;
+		m_pDeletionQueue = other.m_pDeletionQueue;
+		other.Reset();
+	}
+	return *this;
+}
+
+VkBuffer GpuBuffer::GetBuffer() const
+{
+	return m_buffer;
+}
+
+VkDeviceMemory GpuBuffer::GetMemory() const
+{
+	return m_memory;
+}
+
+bool GpuBuffer::IsValid() const
+{
+	return m_buffer != VK_NULL_HANDLE;
+}
+
+void GpuBuffer::Release(std::function<bool()> isReady)
+{
+	if (!IsValid())
+	{
+		return;
+	}
+
+	if (m_pDeletionQueue != nullptr)
+	{
+		// Copies of the handles, this object may be long gone when the deletion runs
+		m_pDeletionQueue->Defer(m_pDeletionQueue->GetCurrentValue(),
+			[device = m_device, buffer = m_buffer, memory = m_memory, memoryBudget = m_pMemoryBudget]()
+			{
+				Destroy(device, buffer, memory, memoryBudget);
+			},
+			std::move(isReady));
+	}
+	else
+	{
+		Destroy(m_device, m_buffer, m_memory, m_pMemoryBudget);
+	}
+	Reset();
+}
+
+void GpuBuffer::DestroyNow()
+{
+	if (!IsValid())
+	{
+		return;
+	}
+	Destroy(m_device, m_buffer, m_memory, m_pMemoryBudget);
+	Reset();
+}
+
+GpuBuffer::~GpuBuffer()
+{
+	Release();
+}
+
+void GpuBuffer::Destroy(VkDevice device, VkBuffer buffer, VkDeviceMemory memory, MemoryBudget* memoryBudget)
+{
+	vkDestroyBuffer(device, buffer, nullptr);
+	if (memoryBudget != nullptr)
+	{
+		memoryBudget->Free(memory);
+	}
+	else
+	{
+		vkFreeMemory(device, memory, nullptr);
+	}
+}
+
+void GpuBuffer::Reset()
+{
+	m_buffer = VK_NULL_HANDLE;
+	m_memory = VK_NULL_HANDLE;
+}
+
+// -- GpuImage --
+GpuImage::GpuImage(VkDevice newDevice, VkImage image, VkImageView imageView, VkDeviceMemory memory, MemoryBudget* memoryBudget,
+	DeletionQueue* deletionQueue)
+	: m_device(newDevice)
+	, m_image(image)
+	, m_imageView(imageView)
+	, m_memory(memory)
+	, m_pMemoryBudget(memoryBudget)
+	, m_pDeletionQueue(deletionQueue)
+{
+}
+
+GpuImage::GpuImage(GpuImage&& other) noexcept
+	: m_device(other.m_device)
+	, m_image(other.m_image)
+	, m_imageView(other.m_imageView)
+	, m_memory(other.m_memory)
+	, m_pMemoryBudget(other.m_pMemoryBudget)
+	, m_pDeletionQueue(other.m_pDeletionQueue)
+{
+	other.Reset();
+}
+
+GpuImage& GpuImage::operator=(GpuImage&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		m_device = other.m_device;
+		m_image = other.m_image;
+		m_imageView = other.m_imageView;
+		m_memory = other.m_memory;
+		m_pMemoryBudget = other.m_pMemoryBudget;
+		m_pDeletionQueue = other.m_pDeletionQueue;
+		other.Reset();
+	}
+	return *this;
+}
+
+VkImage GpuImage::GetImage() const
+{
+	return m_image;
+}
+
+VkImageView GpuImage::GetImageView() const
+{
+	return m_imageView;
+}
+
+VkDeviceMemory GpuImage::GetMemory() const
+{
+	return m_memory;
+}
+
+bool GpuImage::IsValid() const
+{
+	return m_image != VK_NULL_HANDLE;
+}
+
+void GpuImage::Release(std::function<bool()> isReady)
+{
+	if (!IsValid())
+	{
+		return;
+	}
+
+	if (m_pDeletionQueue != nullptr)
+	{
+		m_pDeletionQueue->Defer(m_pDeletionQueue->GetCurrentValue(),
+			[device = m_device, image = m_image, imageView = m_imageView, memory = m_memory, memoryBudget = m_pMemoryBudget]()
+			{
+				Destroy(device, image, imageView, memory, memoryBudget);
+			},
+			std::move(isReady));
+	}
+	else
+	{
+		Destroy(m_device, m_image, m_imageView, m_memory, m_pMemoryBudget);
+	}
+	Reset();
+}
+
+void GpuImage::DestroyNow()
+{
+	if (!IsValid())
+	{
+		return;
+	}
+	Destroy(m_device, m_image, m_imageView, m_memory, m_pMemoryBudget);
+	Reset();
+}
+
+GpuImage::~GpuImage()
+{
+	Release();
+}
+
+void GpuImage::Destroy(VkDevice device, VkImage image, VkImageView imageView, VkDeviceMemory memory, MemoryBudget* memoryBudget)
+{
+	vkDestroyImageView(device, imageView, nullptr);
+	vkDestroyImage(device, image, nullptr);
+	if (memoryBudget != nullptr)
+	{
+		memoryBudget->Free(memory);
+	}
+	else
+	{
+		vkFreeMemory(device, memory, nullptr);
+	}
+}
+
+void GpuImage::Reset()
+{
+	m_image = VK_NULL_HANDLE;
+	m_imageView = VK_NULL_HANDLE;
+	m_memory = VK_NULL_HANDLE;
+}
@@ -0,0 +1,273 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+
+namespace
+{
+	// Which JobSystem queue the calling thread owns (set by worker threads, main thread and others use 0)
+	thread_local const JobSystem* t_pOwner = nullptr;
+	thread_local uint32_t t_uiQueueIndex = 0;
+}
+
+bool JobCounter::IsDone() const
+{
+	return m_iValue.load(std::memory_order_acquire) == 0;
+}
+
+void JobSystem::InitJobSystem(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	m_mainThreadId = std::this_thread::get_id();
+	m_bStopping = false;
+
+	m_vecQueues.clear();
+	for (uint32_t i = 0; i <= workerCount; ++i)
+	{
+		m_vecQueues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	for (uint32_t i = 1; i <= workerCount; ++i)
+	{
+		m_vecWorkers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::ShutdownJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStopping = true;
+	}
+	m_sleepCondition.notify_all();
+
+	for (auto& worker : m_vecWorkers)
+	{
+		worker.join();
+	}
+	m_vecWorkers.clear();
+}
+
+JobSystem::~JobSystem()
+{
+	if (!m_vecWorkers.empty())
+	{
+		ShutdownJobSystem();
+	}
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+{
+	Schedule({ std::move(function), counter, false }, dependency);
+}
+
+void JobSystem::RunOnMainThread(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+{
+	Schedule({ std::move(function), counter, true }, dependency);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& function, JobCounter* counter)
+{
+	batchSize = std::max(batchSize, 1u);
+	for (uint32_t begin = 0; begin < count; begin += batchSize)
+	{
+		const uint32_t end = std::min(begin + batchSize, count);
+		Run([function, begin, end] { function(begin, end); }, counter);
+	}
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	const bool mainThread = IsMainThread();
+	const uint32_t queueIndex = GetQueueIndex();
+
+	while (!counter.IsDone())
+	{
+		Job job;
+		if ((mainThread && TryPopMainThread(job)) || TryPop(queueIndex, job) || TrySteal(queueIndex, job))
+		{
+			Execute(job);
+		}
+		else
+		{
+			// Remaining jobs are running on other threads
+			std::this_thread::yield();
+		}
+	}
+
+	// Last job may still be inside Execute, holding the counter's lock
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+	Job job;
+	while (TryPopMainThread(job))
+	{
+		Execute(job);
+	}
+}
+
+uint32_t JobSystem::GetWorkerCount() const
+{
+	return static_cast<uint32_t>(m_vecWorkers.size());
+}
+
+bool JobSystem::IsMainThread() const
+{
+	return std::this_thread::get_id() == m_mainThreadId;
+}
+
+void JobSystem::Schedule(Job job, JobCounter* dependency)
+{
+	// Count the job straight away so waiting on its counter also covers the time it is held back
+	if (job.counter != nullptr)
+	{
+		job.counter->m_iValue.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (dependency != nullptr)
+	{
+		// Checked under the dependency's lock, so it either sees zero or is released by the job that gets it there
+		std::lock_guard<std::mutex> lock(dependency->m_mutex);
+		if (!dependency->IsDone())
+		{
+			dependency->m_vecWaiting.push_back(std::move(job));
+			return;
+		}
+	}
+
+	Push(std::move(job));
+}
+
+void JobSystem::Push(Job job)
+{
+	if (job.mainThread)
+	{
+		std::lock_guard<std::mutex> lock(m_mainThreadQueue.mutex);
+		m_mainThreadQueue.jobs.push_back(std::move(job));
+		return;
+	}
+
+	// Counted before it becomes visible, so a thief can never take the count below zero
+	m_uiQueuedJobs.fetch_add(1);
+	WorkQueue& queue = *m_vecQueues[GetQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+
+	{
+		// Empty critical section orders the increment with a worker checking it before going to sleep
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_sleepCondition.notify_one();
+}
+
+bool JobSystem::TryPop(uint32_t queueIndex, Job& outJob)
+{
+	WorkQueue& queue = *m_vecQueues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty())
+	{
+		return false;
+	}
+
+	// Newest first, its data is most likely still in this core's cache
+	outJob = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	m_uiQueuedJobs.fetch_sub(1);
+	return true;
+}
+
+bool JobSystem::TrySteal(uint32_t queueIndex, Job& outJob)
+{
+	const uint32_t queueCount = static_cast<uint32_t>(m_vecQueues.size());
+	for (uint32_t i = 1; i < queueCount; ++i)
+	{
+		WorkQueue& victim = *m_vecQueues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			// Oldest first, tends to be the biggest piece of remaining work
+			outJob = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			m_uiQueuedJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::TryPopMainThread(Job& outJob)
+{
+	std::lock_guard<std::mutex> lock(m_mainThreadQueue.mutex);
+	if (m_mainThreadQueue.jobs.empty())
+	{
+		return false;
+	}
+
+	outJob = std::move(m_mainThreadQueue.jobs.front());
+	m_mainThreadQueue.jobs.pop_front();
+	return true;
+}
+
+void JobSystem::Execute(Job& job)
+{
+	job.function();
+
+	JobCounter* counter = job.counter;
+	if (counter == nullptr)
+	{
+		return;
+	}
+
+	// Decrement under the lock: Wait takes the same lock before returning, so the counter can't be destroyed
+	// while this thread is still using it
+	std::vector<Job> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (counter->m_iValue.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			// Last job on this counter, release everything that was waiting for it
+			released.swap(counter->m_vecWaiting);
+		}
+	}
+	for (auto& waiting : released)
+	{
+		Push(std::move(waiting));
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t queueIndex)
+{
+	t_pOwner = this;
+	t_uiQueueIndex = queueIndex;
+
+	while (true)
+	{
+		Job job;
+		if (TryPop(queueIndex, job) || TrySteal(queueIndex, job))
+		{
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepCondition.wait(lock, [this] { return m_bStopping || m_uiQueuedJobs.load() > 0; });
+		if (m_bStopping)
+		{
+			break;
+		}
+	}
+}
+
+uint32_t JobSystem::GetQueueIndex() const
+{
+	return t_pOwner == this ? t_uiQueueIndex : 0;
+}
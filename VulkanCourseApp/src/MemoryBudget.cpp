@@ -0,0 +1,272 @@
+#include "MemoryBudget.h"
+#include <algorithm>
+#include <cstdio>
+
+
+void MemoryBudget::InitMemoryBudget(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, bool budgetExtensionEnabled, FrameTimeline* frameTimeline)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_bBudgetExtension = budgetExtensionEnabled;
+	m_pFrameTimeline = frameTimeline;
+
+	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+	UpdateBudget();
+}
+
+void MemoryBudget::UpdateBudget()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	if (m_bBudgetExtension)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2 memoryProperties2 = {};
+		memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProperties2.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &memoryProperties2);
+
+		for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+		{
+			m_arrBudget[i] = budgetProperties.heapBudget[i];
+			m_arrDriverUsage[i] = budgetProperties.heapUsage[i];
+			m_arrTrackedAtUpdate[i] = m_arrTracked[i];
+		}
+	}
+	else
+	{
+		// No driver numbers: leave a fifth of each heap for other processes and driver internals
+		for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+		{
+			m_arrBudget[i] = m_memoryProperties.memoryHeaps[i].size / 5 * 4;
+		}
+	}
+
+	// Evict least recently used allocations the GPU is done with until each heap fits its budget again,
+	// including whatever streamable allocations were refused since last time
+	auto it = m_listLru.begin();
+	while (it != m_listLru.end())
+	{
+		Allocation& allocation = m_mapAllocations[*it];
+		const uint32_t heapIndex = allocation.heapIndex;
+		const bool overBudget = GetHeapUsage(heapIndex) + m_arrRequested[heapIndex] > m_arrBudget[heapIndex];
+		if (!overBudget)
+		{
+			++it;
+			continue;
+		}
+
+		// List is in order of use, so once one allocation is still in flight the rest are too
+		if (m_pFrameTimeline != nullptr && !m_pFrameTimeline->IsComplete(allocation.lastUse))
+		{
+			break;
+		}
+
+		const VkDeviceSize size = allocation.size;
+		const std::function<void()> evict = std::move(allocation.evict);
+		++it;
+
+		// Frees the allocation, which also removes it from the list
+		evict();
+		++m_ullEvictionCount;
+		m_evictedBytes += size;
+		m_arrRequested[heapIndex] = m_arrRequested[heapIndex] > size ? m_arrRequested[heapIndex] - size : 0;
+	}
+
+	// Requests that couldn't be satisfied are retried by their callers, no need to keep evicting for them
+	m_arrRequested.fill(0);
+}
+
+VkResult MemoryBudget::Allocate(const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category, VkDeviceMemory* outMemory)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	const uint32_t heapIndex = m_memoryProperties.memoryTypes[allocateInfo.memoryTypeIndex].heapIndex;
+
+	// Streamable data can wait a frame, so don't push the heap over budget for it
+	if (IsStreamable(category) && GetHeapUsage(heapIndex) + allocateInfo.allocationSize > m_arrBudget[heapIndex])
+	{
+		m_arrRequested[heapIndex] += allocateInfo.allocationSize;
+		++m_ullRefusedAllocations;
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	const VkResult result = vkAllocateMemory(m_device, &allocateInfo, nullptr, outMemory);
+	if (result != VK_SUCCESS)
+	{
+		m_arrRequested[heapIndex] += allocateInfo.allocationSize;
+		++m_ullFailedAllocations;
+		return result;
+	}
+
+	Allocation allocation;
+	allocation.size = allocateInfo.allocationSize;
+	allocation.heapIndex = heapIndex;
+	allocation.category = category;
+	m_mapAllocations[*outMemory] = std::move(allocation);
+
+	m_arrTracked[heapIndex] += allocateInfo.allocationSize;
+	m_arrCategories[static_cast<size_t>(category)].bytes += allocateInfo.allocationSize;
+	m_arrCategories[static_cast<size_t>(category)].allocationCount++;
+	++m_ullAllocationCount;
+
+	return VK_SUCCESS;
+}
+
+void MemoryBudget::Free(VkDeviceMemory memory)
+{
+	if (memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	const auto found = m_mapAllocations.find(memory);
+	if (found == m_mapAllocations.end())
+	{
+		throw std::runtime_error("Freeing memory that wasn't allocated through the Memory Budget");
+	}
+
+	const Allocation& allocation = found->second;
+	m_arrTracked[allocation.heapIndex] -= allocation.size;
+	m_arrCategories[static_cast<size_t>(allocation.category)].bytes -= allocation.size;
+	m_arrCategories[static_cast<size_t>(allocation.category)].allocationCount--;
+	if (allocation.evictable)
+	{
+		m_listLru.erase(allocation.lruPosition);
+	}
+	m_mapAllocations.erase(found);
+
+	vkFreeMemory(m_device, memory, nullptr);
+}
+
+void MemoryBudget::SetEvictable(VkDeviceMemory memory, std::function<void()> evict)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	Allocation& allocation = m_mapAllocations.at(memory);
+	if (!allocation.evictable)
+	{
+		allocation.lruPosition = m_listLru.insert(m_listLru.end(), memory);
+		allocation.evictable = true;
+	}
+	allocation.evict = std::move(evict);
+}
+
+void MemoryBudget::ClearEvictable(VkDeviceMemory memory)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	const auto found = m_mapAllocations.find(memory);
+	if (found == m_mapAllocations.end() || !found->second.evictable)
+	{
+		return;
+	}
+
+	m_listLru.erase(found->second.lruPosition);
+	found->second.evictable = false;
+	found->second.evict = nullptr;
+}
+
+void MemoryBudget::Touch(VkDeviceMemory memory, uint64_t frameValue)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	const auto found = m_mapAllocations.find(memory);
+	if (found == m_mapAllocations.end())
+	{
+		return;
+	}
+
+	Allocation& allocation = found->second;
+	allocation.lastUse = std::max(allocation.lastUse, frameValue);
+	if (allocation.evictable)
+	{
+		// Most recently used goes to the back
+		m_listLru.splice(m_listLru.end(), m_listLru, allocation.lruPosition);
+	}
+}
+
+MemoryBudgetStats MemoryBudget::GetStats() const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	MemoryBudgetStats stats;
+	stats.budgetExtension = m_bBudgetExtension;
+	stats.heapCount = m_memoryProperties.memoryHeapCount;
+	for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+	{
+		stats.heaps[i].size = m_memoryProperties.memoryHeaps[i].size;
+		stats.heaps[i].budget = m_arrBudget[i];
+		stats.heaps[i].usage = GetHeapUsage(i);
+		stats.heaps[i].trackedBytes = m_arrTracked[i];
+	}
+	stats.categories = m_arrCategories;
+	stats.allocationCount = m_ullAllocationCount;
+	stats.refusedAllocations = m_ullRefusedAllocations;
+	stats.failedAllocations = m_ullFailedAllocations;
+	stats.evictionCount = m_ullEvictionCount;
+	stats.evictedBytes = m_evictedBytes;
+
+	return stats;
+}
+
+void MemoryBudget::PrintStats() const
+{
+	const MemoryBudgetStats stats = GetStats();
+
+	printf("Memory budget (%s):\n", stats.budgetExtension ? "VK_EXT_memory_budget" : "heap size estimate");
+	for (uint32_t i = 0; i < stats.heapCount; ++i)
+	{
+		printf("  Heap %u: %llu / %llu MB used (%llu MB tracked, heap %llu MB)\n", i,
+			static_cast<unsigned long long>(stats.heaps[i].usage >> 20), static_cast<unsigned long long>(stats.heaps[i].budget >> 20),
+			static_cast<unsigned long long>(stats.heaps[i].trackedBytes >> 20), static_cast<unsigned long long>(stats.heaps[i].size >> 20));
+	}
+	for (size_t i = 0; i < stats.categories.size(); ++i)
+	{
+		printf("  %s: %llu KB in %u allocations\n", GetCategoryName(static_cast<MemoryCategory>(i)),
+			static_cast<unsigned long long>(stats.categories[i].bytes >> 10), stats.categories[i].allocationCount);
+	}
+	printf("  %llu allocations, %llu refused, %llu failed, %llu evictions (%llu KB)\n",
+		static_cast<unsigned long long>(stats.allocationCount), static_cast<unsigned long long>(stats.refusedAllocations),
+		static_cast<unsigned long long>(stats.failedAllocations), static_cast<unsigned long long>(stats.evictionCount),
+		static_cast<unsigned long long>(stats.evictedBytes >> 10));
+}
+
+VkDeviceSize MemoryBudget::GetHeapUsage(uint32_t heapIndex) const
+{
+	if (!m_bBudgetExtension)
+	{
+		return m_arrTracked[heapIndex];
+	}
+
+	// Driver number from the last update, adjusted by what was allocated/freed through here since
+	const VkDeviceSize usage = m_arrDriverUsage[heapIndex] + m_arrTracked[heapIndex];
+	return usage > m_arrTrackedAtUpdate[heapIndex] ? usage - m_arrTrackedAtUpdate[heapIndex] : 0;
+}
+
+bool MemoryBudget::IsStreamable(MemoryCategory category)
+{
+	return category == MemoryCategory::Mesh || category == MemoryCategory::Texture;
+}
+
+const char* MemoryBudget::GetCategoryName(MemoryCategory category)
+{
+	switch (category)
+	{
+	case MemoryCategory::Mesh:
+		return "Meshes";
+	case MemoryCategory::Texture:
+		return "Textures";
+	case MemoryCategory::Staging:
+		return "Staging";
+	case MemoryCategory::RenderTarget:
+		return "Render targets";
+	case MemoryCategory::Readback:
+		return "Readback";
+	default:
+		return "Other";
+	}
+}
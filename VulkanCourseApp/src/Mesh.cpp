@@ -1,15 +1,134 @@
 #include "Mesh.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 
-Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices)
+namespace
+{
+	bool IsFutureReady(const UploadFuture& future)
+	{
+		return !future.valid() || future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+}
+
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, DeletionQueue* deletionQueue)
 	: m_ullVertexCount(vertices->size())
 	, m_PhysicalDevice(newPhysicalDevice)
 	, m_Device(newDevice)
 	, vertices_(vertices)
+	, m_pDeletionQueue(deletionQueue)
 {
+	ComputeBounds(*vertices);
 	CreateVertexBuffer(vertices);
 }
 
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, UploadService& uploadService,
+	MemoryBudget* memoryBudget, DeletionQueue* deletionQueue)
+	: m_ullVertexCount(vertices->size())
+	, m_PhysicalDevice(newPhysicalDevice)
+	, m_Device(newDevice)
+	, vertices_(vertices)
+	, m_pUploadService(&uploadService)
+	, m_pMemoryBudget(memoryBudget)
+	, m_pDeletionQueue(deletionQueue)
+{
+	ComputeBounds(*vertices);
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_vecStreamingVertices = *vertices;
+	}
+	CreateDeviceLocalBuffers(*vertices, m_vecStreamingIndices, uploadService);
+}
+
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+	UploadService& uploadService, MemoryBudget* memoryBudget, DeletionQueue* deletionQueue, uint32_t lodCount)
+	: m_PhysicalDevice(newPhysicalDevice)
+	, m_Device(newDevice)
+	, vertices_(vertices)
+	, m_pUploadService(&uploadService)
+	, m_pMemoryBudget(memoryBudget)
+	, m_pDeletionQueue(deletionQueue)
+{
+	std::vector<Vertex> meshVertices;
+	std::vector<uint32_t> meshIndices;
+	PrepareIndexedGeometry(*vertices, *indices, lodCount, meshVertices, meshIndices);
+
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_vecStreamingVertices = meshVertices;
+		m_vecStreamingIndices = meshIndices;
+	}
+	CreateDeviceLocalBuffers(meshVertices, meshIndices, uploadService);
+}
+
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+	GeometryPool& geometryPool, UploadService& uploadService, DeletionQueue* deletionQueue, uint32_t lodCount)
+	: m_PhysicalDevice(newPhysicalDevice)
+	, m_Device(newDevice)
+	, vertices_(vertices)
+	, m_pUploadService(&uploadService)
+	, m_pDeletionQueue(deletionQueue)
+{
+	std::vector<Vertex> meshVertices;
+	std::vector<uint32_t> meshIndices;
+	PrepareIndexedGeometry(*vertices, *indices, lodCount, meshVertices, meshIndices);
+
+	if (geometryPool.Add(meshVertices, meshIndices, uploadService, m_geometryRange, m_uploadFuture, m_indexUploadFuture))
+	{
+		m_pGeometryPool = &geometryPool;
+		return;
+	}
+
+	printf("Geometry pool full, mesh of %zu vertices gets buffers of its own\n", meshVertices.size());
+	CreateDeviceLocalBuffers(meshVertices, meshIndices, uploadService);
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+
+	DestroyVertexBuffer();
+
+	m_ullVertexCount = other.m_ullVertexCount;
+	m_vertexBuffer = std::move(other.m_vertexBuffer);
+	m_indexBuffer = std::move(other.m_indexBuffer);
+	m_vecLods = std::move(other.m_vecLods);
+	m_boundsMin = other.m_boundsMin;
+	m_boundsMax = other.m_boundsMax;
+	m_optimizationStats = other.m_optimizationStats;
+	m_PhysicalDevice = other.m_PhysicalDevice;
+	m_Device = other.m_Device;
+	vertices_ = other.vertices_;
+	m_uploadFuture = std::move(other.m_uploadFuture);
+	m_indexUploadFuture = std::move(other.m_indexUploadFuture);
+	m_pUploadService = other.m_pUploadService;
+	m_pMemoryBudget = other.m_pMemoryBudget;
+	m_pDeletionQueue = other.m_pDeletionQueue;
+	m_vecStreamingVertices = std::move(other.m_vecStreamingVertices);
+	m_vecStreamingIndices = std::move(other.m_vecStreamingIndices);
+	m_bEvictable = other.m_bEvictable;
+	other.m_bEvictable = false;
+	m_pGeometryPool = other.m_pGeometryPool;
+	m_geometryRange = other.m_geometryRange;
+	other.m_geometryRange = GeometryRange();
+
+	// Eviction callback points at the mesh, so point it at the new one
+	if (m_bEvictable)
+	{
+		m_pMemoryBudget->SetEvictable(m_vertexBuffer.GetMemory(), [this]() { Evict(); });
+	}
+	return *this;
+}
+
 unsigned long long Mesh::GetVertexCount() const
 {
 	return m_ullVertexCount;
@@ -17,13 +136,190 @@ unsigned long long Mesh::GetVertexCount() const
 
 VkBuffer Mesh::GetVertexBuffer() const
 {
-	return m_VertexBuffer;
+	return IsPooled() ? m_pGeometryPool->GetVertexBuffer() : m_vertexBuffer.GetBuffer();
+}
+
+VkBuffer Mesh::GetIndexBuffer() const
+{
+	return IsPooled() ? m_pGeometryPool->GetIndexBuffer() : m_indexBuffer.GetBuffer();
+}
+
+bool Mesh::HasIndices() const
+{
+	return !m_vecLods.empty();
+}
+
+const std::vector<MeshLod>& Mesh::GetLods() const
+{
+	return m_vecLods;
+}
+
+const glm::vec3& Mesh::GetBoundsMin() const
+{
+	return m_boundsMin;
+}
+
+const glm::vec3& Mesh::GetBoundsMax() const
+{
+	return m_boundsMax;
+}
+
+const MeshOptimizationStats& Mesh::GetOptimizationStats() const
+{
+	return m_optimizationStats;
+}
+
+bool Mesh::IsUploaded() const
+{
+	return IsResident() && IsFutureReady(m_uploadFuture) && IsFutureReady(m_indexUploadFuture);
+}
+
+bool Mesh::IsPooled() const
+{
+	return m_geometryRange.IsValid();
 }
 
-void Mesh::DestroyVertexBuffer() const
+uint32_t Mesh::GetVertexOffset() const
 {
-	vkDestroyBuffer(m_Device, m_VertexBuffer, nullptr);
-	vkFreeMemory(m_Device, m_VertexBufferMemory, nullptr);
+	return m_geometryRange.vertexOffset;
+}
+
+uint32_t Mesh::GetFirstIndex() const
+{
+	return m_geometryRange.firstIndex;
+}
+
+bool Mesh::IsResident() const
+{
+	return IsPooled() || m_vertexBuffer.IsValid() && (!HasIndices() || m_indexBuffer.IsValid());
+}
+
+void Mesh::EnsureResident()
+{
+	if (IsResident() || m_pMemoryBudget == nullptr)
+	{
+		return;
+	}
+	CreateDeviceLocalBuffers(m_vecStreamingVertices, m_vecStreamingIndices, *m_pUploadService);
+}
+
+void Mesh::Touch(uint64_t frameValue)
+{
+	if (m_pMemoryBudget == nullptr || !IsResident())
+	{
+		return;
+	}
+
+	// Registered on first use rather than on creation, by then its upload is done, so eviction never races the transfer queue
+	// Only the vertex buffer is in the LRU list, evicting it takes the index buffer with it
+	if (!m_bEvictable)
+	{
+		m_pMemoryBudget->SetEvictable(m_vertexBuffer.GetMemory(), [this]() { Evict(); });
+		m_bEvictable = true;
+	}
+	m_pMemoryBudget->Touch(m_vertexBuffer.GetMemory(), frameValue);
+}
+
+void Mesh::DestroyVertexBuffer()
+{
+	// Budget must not evict memory the deletion queue now owns
+	if (m_bEvictable)
+	{
+		m_pMemoryBudget->ClearEvictable(m_vertexBuffer.GetMemory());
+		m_bEvictable = false;
+	}
+
+	// Range goes back to the pool once the frames that may draw it have completed
+	if (IsPooled())
+	{
+		m_pGeometryPool->Remove(m_geometryRange, m_uploadFuture, m_indexUploadFuture);
+		m_geometryRange = GeometryRange();
+		m_uploadFuture = UploadFuture();
+		m_indexUploadFuture = UploadFuture();
+		return;
+	}
+
+	ReleaseBuffer(m_vertexBuffer, m_uploadFuture);
+	ReleaseBuffer(m_indexBuffer, m_indexUploadFuture);
+}
+
+Mesh::~Mesh()
+{
+	DestroyVertexBuffer();
+}
+
+void Mesh::Evict()
+{
+	// Budget only evicts once the last frame that touched the buffers has completed (and touching waits for the uploads),
+	// so there's nothing to defer. The budget already dropped its callback
+	m_bEvictable = false;
+	m_uploadFuture = UploadFuture();
+	m_indexUploadFuture = UploadFuture();
+	m_vertexBuffer.DestroyNow();
+	m_indexBuffer.DestroyNow();
+}
+
+void Mesh::ReleaseBuffer(GpuBuffer& buffer, UploadFuture& uploadFuture)
+{
+	// An upload may still be writing in to the buffer on the transfer queue, which the frame timeline knows nothing about
+	if (uploadFuture.valid())
+	{
+		buffer.Release([uploadFuture]() { return IsFutureReady(uploadFuture); });
+	}
+	else
+	{
+		buffer.Release();
+	}
+	uploadFuture = UploadFuture();
+}
+
+void Mesh::ComputeBounds(const std::vector<Vertex>& vertices)
+{
+	if (vertices.empty())
+	{
+		m_boundsMin = glm::vec3(0.0f);
+		m_boundsMax = glm::vec3(0.0f);
+		return;
+	}
+
+	m_boundsMin = vertices[0].pos;
+	m_boundsMax = vertices[0].pos;
+	for (const Vertex& vertex : vertices)
+	{
+		m_boundsMin = glm::min(m_boundsMin, vertex.pos);
+		m_boundsMax = glm::max(m_boundsMax, vertex.pos);
+	}
+}
+
+void Mesh::PrepareIndexedGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t lodCount,
+	std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices)
+{
+	// Reorder for the post-transform cache, overdraw and fetch locality before anything is built on top of the order
+	outVertices = vertices;
+	std::vector<uint32_t> meshIndices = indices;
+	if (OPTIMIZE_MESHES)
+	{
+		m_optimizationStats = OptimizeMesh(outVertices, meshIndices);
+	}
+	m_ullVertexCount = outVertices.size();
+	ComputeBounds(outVertices);
+
+	// Every level goes in to the one index buffer, drawing a level is just a different index range
+	MeshLodChain lodChain = BuildLodChain(outVertices, meshIndices, lodCount);
+	if (OPTIMIZE_MESHES)
+	{
+		// Simplified levels keep the triangle order of the full detail mesh minus the collapsed ones, reorder each on its own
+		for (size_t i = 1; i < lodChain.lods.size(); ++i)
+		{
+			const MeshLod& lod = lodChain.lods[i];
+			const auto begin = lodChain.indices.begin() + lod.firstIndex;
+			std::vector<uint32_t> lodIndices(begin, begin + lod.indexCount);
+			OptimizeVertexCache(lodIndices, outVertices.size());
+			std::copy(lodIndices.begin(), lodIndices.end(), begin);
+		}
+	}
+	m_vecLods = std::move(lodChain.lods);
+	outIndices = std::move(lodChain.indices);
 }
 
 void Mesh::CreateVertexBuffer(const std::vector<Vertex>* vertices)
@@ -36,7 +332,8 @@ void Mesh::CreateVertexBuffer(const std::vector<Vertex>* vertices)
 	bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;			// Multiple types of buffer possible, we want vertex buffer
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;				// Similar to Swap Chain images, can share vertex buffers
 
-	VkResult result = vkCreateBuffer(m_Device, &bufferInfo, nullptr, &m_VertexBuffer);
+	VkBuffer vertexBuffer;
+	VkResult result = vkCreateBuffer(m_Device, &bufferInfo, nullptr, &vertexBuffer);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create a Vertex Buffer");
@@ -44,7 +341,7 @@ void Mesh::CreateVertexBuffer(const std::vector<Vertex>* vertices)
 
 	// GET BUFFER MEMORY REQUIREMENTS
 	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(m_Device, m_VertexBuffer, &memRequirements);
+	vkGetBufferMemoryRequirements(m_Device, vertexBuffer, &memRequirements);
 
 	// ALLOCATE MEMORY TO BUFFER
 	VkMemoryAllocateInfo memoryAllocateInfo = {};
@@ -64,22 +361,102 @@ void Mesh::CreateVertexBuffer(const std::vector<Vertex>* vertices)
 	memoryAllocateInfo.memoryTypeIndex = memTypeIndex;
 
 	// Allocate memory to VkDeviceMemory
-	result = vkAllocateMemory(m_Device, &memoryAllocateInfo, nullptr, &m_VertexBufferMemory);
+	VkDeviceMemory vertexBufferMemory;
+	result = vkAllocateMemory(m_Device, &memoryAllocateInfo, nullptr, &vertexBufferMemory);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to allocate Vertex Buffer Memory");
 	}
 
 	// Allocate memory to given vertex buffer
-	vkBindBufferMemory(m_Device, m_VertexBuffer, m_VertexBufferMemory, 0);
+	vkBindBufferMemory(m_Device, vertexBuffer, vertexBufferMemory, 0);
+	m_vertexBuffer = GpuBuffer(m_Device, vertexBuffer, vertexBufferMemory, nullptr, m_pDeletionQueue);
 
 	// MAP MEMORY TO VERTEX BUFFER
 	void* data;																									// 1. Create pointer to a point in normal memory
-	vkMapMemory(m_Device, m_VertexBufferMemory, 0, bufferInfo.size, 0, &data);		// 2. "Map" the vertex buffer memory to that point
+	vkMapMemory(m_Device, vertexBufferMemory, 0, bufferInfo.size, 0, &data);		// 2. "Map" the vertex buffer memory to that point
 	memcpy(data, vertices->data(), bufferInfo.size);											// 3. Copy memory from vertices vector to the point
-	vkUnmapMemory(m_Device, m_VertexBufferMemory);																// 4. Unmap the vertex buffer memory
+	vkUnmapMemory(m_Device, vertexBufferMemory);																// 4. Unmap the vertex buffer memory
 
-}																										
+}
+
+void Mesh::CreateDeviceLocalBuffers(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, UploadService& uploadService)
+{
+	if (!CreateDeviceLocalBuffer(vertices.data(), sizeof(Vertex) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, uploadService, m_vertexBuffer, m_uploadFuture))
+	{
+		return;
+	}
+
+	// Resident means all buffers or none, so a refused index buffer gives back the vertex buffer too
+	if (!indices.empty() && !CreateDeviceLocalBuffer(indices.data(), sizeof(uint32_t) * indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_ACCESS_INDEX_READ_BIT, uploadService, m_indexBuffer, m_indexUploadFuture))
+	{
+		ReleaseBuffer(m_vertexBuffer, m_uploadFuture);
+	}
+}
+
+bool Mesh::CreateDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkAccessFlags dstAccess,
+	UploadService& uploadService, GpuBuffer& outBuffer, UploadFuture& outUploadFuture)
+{
+	// Buffer only the GPU can see, filled by a copy on the transfer queue instead of a CPU write
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;				// Ownership is handed to the graphics family by the upload
+
+	VkBuffer buffer;
+	VkResult result = vkCreateBuffer(m_Device, &bufferInfo, nullptr, &buffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Mesh Buffer");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	uint32_t memTypeIndex = 0xFFFFFFFF;
+	result = FindMemoryTypeIndex(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memTypeIndex);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to find memory type index");
+	}
+
+	memoryAllocateInfo.memoryTypeIndex = memTypeIndex;
+
+	VkDeviceMemory bufferMemory;
+	if (m_pMemoryBudget != nullptr)
+	{
+		// Over budget (or out of memory): stay non-resident and try again once something was evicted
+		result = m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::Mesh, &bufferMemory);
+		if (result != VK_SUCCESS)
+		{
+			vkDestroyBuffer(m_Device, buffer, nullptr);
+			return false;
+		}
+	}
+	else
+	{
+		result = vkAllocateMemory(m_Device, &memoryAllocateInfo, nullptr, &bufferMemory);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Mesh Buffer Memory");
+		}
+	}
+
+	vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
+	outBuffer = GpuBuffer(m_Device, buffer, bufferMemory, m_pMemoryBudget, m_pDeletionQueue);
+
+	// Data is copied in to the request, so the caller's data can go away before the upload runs
+	const char* bytes = static_cast<const char*>(data);
+	outUploadFuture = uploadService.EnqueueBufferUpload(buffer, 0, std::vector<char>(bytes, bytes + size),
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, dstAccess);
+	return true;
+}
 
 VkResult Mesh::FindMemoryTypeIndex(uint32_t allowedTypes, VkMemoryPropertyFlags properties, uint32_t& outTypeIndex) const
 {
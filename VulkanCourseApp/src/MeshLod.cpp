@@ -0,0 +1,338 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+
+namespace
+{
+	// Symmetric 4x4 error quadric, v^T Q v is the sum of squared distances from v to the planes accumulated in to it
+	struct Quadric
+	{
+		double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+		double b2 = 0.0, bc = 0.0, bd = 0.0;
+		double c2 = 0.0, cd = 0.0;
+		double d2 = 0.0;
+
+		// Plane ax + by + cz + d = 0 with a unit normal
+		void AddPlane(double a, double b, double c, double d)
+		{
+			a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+			b2 += b * b; bc += b * c; bd += b * d;
+			c2 += c * c; cd += c * d;
+			d2 += d * d;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+		}
+
+		double Evaluate(const glm::dvec3& p) const
+		{
+			const double error = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z
+				+ 2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z)
+				+ 2.0 * (ad * p.x + bd * p.y + cd * p.z)
+				+ d2;
+			return std::max(error, 0.0);		// Rounding can take it slightly negative
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& position) const
+		{
+			const std::hash<float> hasher;
+			size_t hash = hasher(position.x);
+			hash ^= hasher(position.y) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			hash ^= hasher(position.z) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+	};
+
+	glm::dvec3 GetPosition(const std::vector<Vertex>& vertices, uint32_t index)
+	{
+		return glm::dvec3(vertices[index].pos);
+	}
+
+	glm::dvec3 GetTriangleNormal(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2)
+	{
+		return glm::cross(p1 - p0, p2 - p0);
+	}
+}
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float& outError)
+{
+	outError = 0.0f;
+	std::vector<uint32_t> result = indices;
+	const size_t vertexCount = vertices.size();
+	if (result.size() <= targetIndexCount || vertexCount == 0)
+	{
+		return result;
+	}
+
+	// Vertices sharing a position (attribute seams) are one vertex as far as the topology goes,
+	// they're locked so the seam never tears. Only unlocked vertices collapse (or are collapsed on to)
+	std::vector<uint32_t> vecPositionIndex(vertexCount);
+	std::vector<char> vecLocked(vertexCount, 0);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> mapFirstAtPosition;
+		mapFirstAtPosition.reserve(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			// + 0.0f turns -0.0f in to 0.0f, they compare equal so they must hash equal
+			const auto inserted = mapFirstAtPosition.emplace(vertices[i].pos + glm::vec3(0.0f), i);
+			vecPositionIndex[i] = inserted.first->second;
+			if (!inserted.second)
+			{
+				vecLocked[i] = 1;
+				vecLocked[inserted.first->second] = 1;
+			}
+		}
+	}
+
+	// Border (one triangle) and non-manifold (more than two) edges are locked too, so open meshes keep their outline
+	{
+		std::unordered_map<uint64_t, uint32_t> mapEdgeUses;
+		mapEdgeUses.reserve(result.size());
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			const uint32_t a = vecPositionIndex[result[i]];
+			const uint32_t b = vecPositionIndex[result[i - i % 3 + (i + 1) % 3]];
+			const uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+			++mapEdgeUses[key];
+		}
+		for (const auto& edge : mapEdgeUses)
+		{
+			if (edge.second != 2)
+			{
+				vecLocked[static_cast<uint32_t>(edge.first >> 32)] = 1;
+				vecLocked[static_cast<uint32_t>(edge.first & 0xFFFFFFFF)] = 1;
+			}
+		}
+	}
+
+	// Quadrics of the original faces, collapsing adds the removed vertex's quadric to the one it collapsed on to
+	// so the error always measures against the full detail surface
+	std::vector<Quadric> vecQuadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const glm::dvec3 p0 = GetPosition(vertices, result[i]);
+		const glm::dvec3 normal = GetTriangleNormal(p0, GetPosition(vertices, result[i + 1]), GetPosition(vertices, result[i + 2]));
+		const double length = glm::length(normal);
+		if (length <= 0.0)
+		{
+			continue;
+		}
+
+		const glm::dvec3 unitNormal = normal / length;
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			vecQuadrics[vecPositionIndex[result[i + corner]]].AddPlane(unitNormal.x, unitNormal.y, unitNormal.z, -glm::dot(unitNormal, p0));
+		}
+	}
+
+	std::vector<uint32_t> vecTriangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vecVertexTriangles;
+	std::vector<uint32_t> vecCollapseTarget(vertexCount);
+	std::vector<char> vecTouched(vertexCount);
+	std::vector<Collapse> vecCollapses;
+	double maxCost = 0.0;
+
+	// Passes of independent collapses (no two in a pass share a neighbourhood), cheapest first
+	while (result.size() > targetIndexCount)
+	{
+		// Triangles around each vertex
+		std::fill(vecTriangleOffsets.begin(), vecTriangleOffsets.end(), 0);
+		for (const uint32_t index : result)
+		{
+			++vecTriangleOffsets[index + 1];
+		}
+		std::partial_sum(vecTriangleOffsets.begin(), vecTriangleOffsets.end(), vecTriangleOffsets.begin());
+		vecVertexTriangles.resize(result.size());
+		{
+			std::vector<uint32_t> vecFill(vecTriangleOffsets.begin(), vecTriangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i)
+			{
+				vecVertexTriangles[vecFill[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// Cheapest direction of every collapsible edge (each interior edge is seen once per triangle, keep the a < b one)
+		vecCollapses.clear();
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			const uint32_t a = result[i];
+			const uint32_t b = result[i - i % 3 + (i + 1) % 3];
+			if (a >= b || vecLocked[a] || vecLocked[b])
+			{
+				continue;
+			}
+
+			Quadric combined = vecQuadrics[a];
+			combined.Add(vecQuadrics[b]);
+			const double costToB = combined.Evaluate(GetPosition(vertices, b));
+			const double costToA = combined.Evaluate(GetPosition(vertices, a));
+			vecCollapses.push_back(costToB <= costToA ? Collapse{ a, b, costToB } : Collapse{ b, a, costToA });
+		}
+		if (vecCollapses.empty())
+		{
+			break;
+		}
+		std::sort(vecCollapses.begin(), vecCollapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+		// Each collapse removes about two triangles, don't overshoot the target by much
+		const size_t collapseLimit = std::max<size_t>(1, (result.size() - targetIndexCount) / 6);
+		size_t collapseCount = 0;
+		std::iota(vecCollapseTarget.begin(), vecCollapseTarget.end(), 0);
+		std::fill(vecTouched.begin(), vecTouched.end(), 0);
+
+		for (const Collapse& collapse : vecCollapses)
+		{
+			if (collapseCount >= collapseLimit)
+			{
+				break;
+			}
+			if (vecTouched[collapse.from] || vecTouched[collapse.to])
+			{
+				continue;
+			}
+
+			// Triangles that stay after the collapse must not flip over
+			const glm::dvec3 target = GetPosition(vertices, collapse.to);
+			bool flips = false;
+			for (uint32_t t = vecTriangleOffsets[collapse.from]; t < vecTriangleOffsets[collapse.from + 1] && !flips; ++t)
+			{
+				const uint32_t* triangle = &result[vecVertexTriangles[t] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					continue;
+				}
+
+				glm::dvec3 before[3];
+				glm::dvec3 after[3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					before[corner] = GetPosition(vertices, triangle[corner]);
+					after[corner] = triangle[corner] == collapse.from ? target : before[corner];
+				}
+				flips = glm::dot(GetTriangleNormal(before[0], before[1], before[2]), GetTriangleNormal(after[0], after[1], after[2])) <= 0.0;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			vecCollapseTarget[collapse.from] = collapse.to;
+			vecQuadrics[collapse.to].Add(vecQuadrics[collapse.from]);
+			maxCost = std::max(maxCost, collapse.cost);
+			++collapseCount;
+
+			// Neighbourhood is fixed for the rest of the pass, the flip checks above assumed it doesn't move
+			for (uint32_t t = vecTriangleOffsets[collapse.from]; t < vecTriangleOffsets[collapse.from + 1]; ++t)
+			{
+				const uint32_t* triangle = &result[vecVertexTriangles[t] * 3];
+				vecTouched[triangle[0]] = vecTouched[triangle[1]] = vecTouched[triangle[2]] = 1;
+			}
+			vecTouched[collapse.to] = 1;
+		}
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		// Apply the collapses and drop triangles that became degenerate
+		size_t written = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const uint32_t a = vecCollapseTarget[result[i]];
+			const uint32_t b = vecCollapseTarget[result[i + 1]];
+			const uint32_t c = vecCollapseTarget[result[i + 2]];
+			if (vecPositionIndex[a] == vecPositionIndex[b] || vecPositionIndex[b] == vecPositionIndex[c] || vecPositionIndex[a] == vecPositionIndex[c])
+			{
+				continue;
+			}
+			result[written++] = a;
+			result[written++] = b;
+			result[written++] = c;
+		}
+		result.resize(written);
+	}
+
+	outError = static_cast<float>(std::sqrt(maxCost));
+	return result;
+}
+
+MeshLodChain BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t maxLodCount, float lodReduction)
+{
+	MeshLodChain chain;
+	chain.indices = indices;
+
+	MeshLod fullDetail;
+	fullDetail.indexCount = static_cast<uint32_t>(indices.size());
+	chain.lods.push_back(fullDetail);
+
+	// Every level is simplified from the full detail mesh, so errors don't compound through the chain
+	for (uint32_t level = 1; level < maxLodCount; ++level)
+	{
+		const MeshLod& previous = chain.lods.back();
+		const size_t targetIndexCount = static_cast<size_t>(static_cast<double>(indices.size()) * std::pow(lodReduction, level)) / 3 * 3;
+
+		float error = 0.0f;
+		std::vector<uint32_t> lodIndices = SimplifyMesh(vertices, indices, targetIndexCount, error);
+
+		// Not worth a level of its own (what's left is locked or would flip)
+		if (lodIndices.empty() || lodIndices.size() * 10 > static_cast<size_t>(previous.indexCount) * 9)
+		{
+			break;
+		}
+
+		MeshLod lod;
+		lod.firstIndex = static_cast<uint32_t>(chain.indices.size());
+		lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.error = std::max(error, previous.error);			// Selection relies on the error growing along the chain
+		chain.indices.insert(chain.indices.end(), lodIndices.begin(), lodIndices.end());
+		chain.lods.push_back(lod);
+	}
+
+	return chain;
+}
+
+float GetPixelsPerUnit(float viewportHeight, float fovY, float distance, float scale)
+{
+	// Inside (or on) the near plane everything needs full detail
+	if (distance <= std::numeric_limits<float>::epsilon())
+	{
+		return std::numeric_limits<float>::max();
+	}
+	return viewportHeight / (2.0f * std::tan(fovY * 0.5f) * distance) * scale;
+}
+
+uint32_t SelectLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError, uint32_t currentLod, float hysteresis)
+{
+	uint32_t selected = 0;
+	for (uint32_t i = 1; i < lods.size(); ++i)
+	{
+		const float threshold = i > currentLod ? maxPixelError * (1.0f - hysteresis) : maxPixelError;
+		if (lods[i].error * pixelsPerUnit > threshold)
+		{
+			break;
+		}
+		selected = i;
+	}
+	return selected;
+}
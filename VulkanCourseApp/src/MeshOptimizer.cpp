@@ -0,0 +1,359 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+namespace
+{
+	// Forsyth's scoring, tuned for a 32 entry LRU cache model
+	constexpr uint32_t SCORE_CACHE_SIZE = 32;
+	constexpr float CACHE_DECAY_POWER = 1.5f;
+	constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+	float GetVertexScore(int cachePosition, uint32_t liveTriangles)
+	{
+		// Nothing left to draw with it, never worth picking
+		if (liveTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// Vertices of the last triangle get a fixed score so the next triangle doesn't just reuse the same edge
+			if (cachePosition < 3)
+			{
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				const float scaled = 1.0f - static_cast<float>(cachePosition - 3) / static_cast<float>(SCORE_CACHE_SIZE - 3);
+				score = std::pow(scaled, CACHE_DECAY_POWER);
+			}
+		}
+
+		// Vertices with few triangles left get a boost, finishing them off avoids coming back to them later
+		score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(liveTriangles), -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	// FIFO cache model shared by the analysis and the overdraw clustering
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint32_t cacheSize)
+			: m_vecTimestamps(vertexCount, 0)
+			, m_uiCacheSize(cacheSize)
+		{}
+
+		// Returns true on a miss
+		bool Access(uint32_t index)
+		{
+			// Entry is in the cache if it was inserted within the last cacheSize misses
+			if (m_vecTimestamps[index] != 0 && m_uiTime - m_vecTimestamps[index] < m_uiCacheSize)
+			{
+				return false;
+			}
+			m_vecTimestamps[index] = ++m_uiTime;
+			return true;
+		}
+
+		void Clear()
+		{
+			// Pushing the clock past the cache size invalidates every entry without touching them
+			m_uiTime += m_uiCacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32_t> m_vecTimestamps;
+		uint32_t m_uiTime = 0;
+		uint32_t m_uiCacheSize;
+	};
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> vecUsed(vertexCount, 0);
+	size_t misses = 0;
+	size_t usedVertices = 0;
+	for (const uint32_t index : indices)
+	{
+		misses += cache.Access(index) ? 1 : 0;
+		if (!vecUsed[index])
+		{
+			vecUsed[index] = 1;
+			++usedVertices;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(usedVertices);
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles around each vertex, the first liveTriangles of each range are the ones not emitted yet
+	std::vector<uint32_t> vecLiveTriangles(vertexCount, 0);
+	for (const uint32_t index : indices)
+	{
+		++vecLiveTriangles[index];
+	}
+	std::vector<uint32_t> vecOffsets(vertexCount + 1, 0);
+	std::partial_sum(vecLiveTriangles.begin(), vecLiveTriangles.end(), vecOffsets.begin() + 1);
+	std::vector<uint32_t> vecVertexTriangles(indices.size());
+	{
+		std::vector<uint32_t> vecFill(vecOffsets.begin(), vecOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			vecVertexTriangles[vecFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<float> vecVertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vecVertexScore[v] = GetVertexScore(-1, vecLiveTriangles[v]);
+	}
+
+	std::vector<float> vecTriangleScore(triangleCount);
+	std::vector<char> vecEmitted(triangleCount, 0);
+	uint32_t bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		vecTriangleScore[t] = vecVertexScore[indices[t * 3]] + vecVertexScore[indices[t * 3 + 1]] + vecVertexScore[indices[t * 3 + 2]];
+		if (vecTriangleScore[t] > vecTriangleScore[bestTriangle])
+		{
+			bestTriangle = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> vecCache;
+	std::vector<uint32_t> vecNewCache;
+	vecCache.reserve(SCORE_CACHE_SIZE + 3);
+	vecNewCache.reserve(SCORE_CACHE_SIZE + 3);
+	size_t deadEndCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// Nothing in the cache has triangles left, continue from the next triangle in input order
+		if (bestTriangle == UINT32_MAX)
+		{
+			while (vecEmitted[deadEndCursor])
+			{
+				++deadEndCursor;
+			}
+			bestTriangle = static_cast<uint32_t>(deadEndCursor);
+		}
+
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		result.insert(result.end(), triangle, triangle + 3);
+		vecEmitted[bestTriangle] = 1;
+
+		// Triangle is no longer live for its vertices
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t vertex = triangle[corner];
+			uint32_t* begin = &vecVertexTriangles[vecOffsets[vertex]];
+			uint32_t* end = begin + vecLiveTriangles[vertex];
+			uint32_t* found = std::find(begin, end, bestTriangle);
+			if (found != end)
+			{
+				std::swap(*found, *(end - 1));
+				--vecLiveTriangles[vertex];
+			}
+		}
+
+		// Triangle's vertices move to the front of the cache, everything else shifts back
+		vecNewCache.assign(triangle, triangle + 3);
+		for (const uint32_t vertex : vecCache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				vecNewCache.push_back(vertex);
+			}
+		}
+
+		// Rescore everything in (or just pushed out of) the cache, and the live triangles around it
+		bestTriangle = UINT32_MAX;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < vecNewCache.size(); ++i)
+		{
+			const uint32_t vertex = vecNewCache[i];
+			const int position = i < SCORE_CACHE_SIZE ? static_cast<int>(i) : -1;
+			vecVertexScore[vertex] = GetVertexScore(position, vecLiveTriangles[vertex]);
+		}
+		for (const uint32_t vertex : vecNewCache)
+		{
+			for (uint32_t i = 0; i < vecLiveTriangles[vertex]; ++i)
+			{
+				const uint32_t t = vecVertexTriangles[vecOffsets[vertex] + i];
+				vecTriangleScore[t] = vecVertexScore[indices[t * 3]] + vecVertexScore[indices[t * 3 + 1]] + vecVertexScore[indices[t * 3 + 2]];
+				if (vecTriangleScore[t] > bestScore)
+				{
+					bestScore = vecTriangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (vecNewCache.size() > SCORE_CACHE_SIZE)
+		{
+			vecNewCache.resize(SCORE_CACHE_SIZE);
+		}
+		vecCache.swap(vecNewCache);
+	}
+
+	indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	constexpr uint32_t CLUSTER_CACHE_SIZE = 16;
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	const float targetAcmr = AnalyzeVertexCache(indices, vertices.size(), CLUSTER_CACHE_SIZE).acmr * threshold;
+
+	// Cluster boundaries: hard ones where the cache optimised order started over anyway (all three vertices missed),
+	// soft ones as soon as a cluster on its own would keep the ACMR within threshold of the input
+	std::vector<uint32_t> vecClusterStarts;
+	FifoCache cache(vertices.size(), CLUSTER_CACHE_SIZE);
+	size_t clusterMisses = 0;
+	size_t clusterStart = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const size_t misses = (cache.Access(indices[t * 3]) ? 1 : 0) + (cache.Access(indices[t * 3 + 1]) ? 1 : 0)
+			+ (cache.Access(indices[t * 3 + 2]) ? 1 : 0);
+
+		if (t == 0 || misses == 3)
+		{
+			vecClusterStarts.push_back(static_cast<uint32_t>(t));
+			clusterStart = t;
+			clusterMisses = 0;
+		}
+		clusterMisses += misses;
+
+		const size_t clusterTriangles = t - clusterStart + 1;
+		if (t + 1 < triangleCount && static_cast<float>(clusterMisses) <= targetAcmr * static_cast<float>(clusterTriangles))
+		{
+			// Next triangle starts a soft cluster, the cache is reset so its misses are counted on their own
+			vecClusterStarts.push_back(static_cast<uint32_t>(t + 1));
+			clusterStart = t + 1;
+			clusterMisses = 0;
+			cache.Clear();
+		}
+	}
+	// Soft boundary right before a hard one leaves the same start twice
+	vecClusterStarts.erase(std::unique(vecClusterStarts.begin(), vecClusterStarts.end()), vecClusterStarts.end());
+	vecClusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+	// Centroid of the whole mesh, area weighted
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+		const float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+		meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+		meshArea += area;
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+	// Clusters facing away from the centre are more likely to be in front of the rest, draw them first
+	const size_t clusterCount = vecClusterStarts.size() - 1;
+	std::vector<float> vecSortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = vecClusterStarts[c]; t < vecClusterStarts[c + 1]; ++t)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+			const glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);		// Length is twice the area
+			const float faceArea = glm::length(faceNormal);
+			centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		const float normalLength = glm::length(normal);
+		if (area <= 0.0f || normalLength <= 0.0f)
+		{
+			vecSortKeys[c] = 0.0f;
+			continue;
+		}
+		vecSortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+
+	std::vector<uint32_t> vecClusterOrder(clusterCount);
+	std::iota(vecClusterOrder.begin(), vecClusterOrder.end(), 0);
+	std::stable_sort(vecClusterOrder.begin(), vecClusterOrder.end(),
+		[&vecSortKeys](uint32_t lhs, uint32_t rhs) { return vecSortKeys[lhs] > vecSortKeys[rhs]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const uint32_t c : vecClusterOrder)
+	{
+		result.insert(result.end(), indices.begin() + vecClusterStarts[c] * 3, indices.begin() + vecClusterStarts[c + 1] * 3);
+	}
+	indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// New index of every vertex, in order of first use. Unused vertices are dropped
+	std::vector<uint32_t> vecRemap(vertices.size(), UINT32_MAX);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+	for (uint32_t& index : indices)
+	{
+		if (vecRemap[index] == UINT32_MAX)
+		{
+			vecRemap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(vertices[index]);
+		}
+		index = vecRemap[index];
+	}
+	vertices.swap(result);
+}
+
+MeshOptimizationStats OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	MeshOptimizationStats stats;
+	stats.before = AnalyzeVertexCache(indices, vertices.size());
+
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+
+	stats.after = AnalyzeVertexCache(indices, vertices.size());
+	return stats;
+}
@@ -0,0 +1,532 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cstring>
+
+
+static_assert(sizeof(OcclusionCullObject) == 48, "OcclusionCullObject must match CullObject in occlusion_cull.comp");
+
+void OcclusionCuller::InitOcclusionCuller(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, uint32_t maxObjects,
+	VkImageView depthView, VkExtent2D depthExtent, const std::vector<char>& reduceShaderCode, const std::vector<char>& cullShaderCode)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_pMemoryBudget = memoryBudget;
+	m_uiMaxObjects = maxObjects;
+	m_arrObjectCounts.fill(0);
+	m_depthExtent = depthExtent;
+	m_bPyramidValid = false;
+
+	CreateBuffers();
+	CreatePyramid();
+	CreateDescriptors(depthView);
+
+	m_reducePipeline = ComputePipeline(m_device, reduceShaderCode, { m_reduceSetLayout }, sizeof(ReducePushConstants));
+	m_cullPipeline = ComputePipeline(m_device, cullShaderCode, { m_cullSetLayout }, sizeof(CullPushConstants));
+}
+
+void OcclusionCuller::ShutdownOcclusionCuller()
+{
+	m_cullPipeline.DestroyPipeline();
+	m_reducePipeline.DestroyPipeline();
+
+	// Sets go with the pool
+	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_cullSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_reduceSetLayout, nullptr);
+	m_vecReduceSets.clear();
+
+	vkDestroySampler(m_device, m_sampler, nullptr);
+	for (VkImageView levelView : m_vecPyramidLevelViews)
+	{
+		vkDestroyImageView(m_device, levelView, nullptr);
+	}
+	m_vecPyramidLevelViews.clear();
+	vkDestroyImageView(m_device, m_pyramidView, nullptr);
+	vkDestroyImage(m_device, m_pyramidImage, nullptr);
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_pMemoryBudget->Free(m_pyramidMemory);
+	}
+	else
+	{
+		vkFreeMemory(m_device, m_pyramidMemory, nullptr);
+	}
+
+	for (auto& objectBuffer : m_arrObjectBuffers)
+	{
+		DestroyBuffer(objectBuffer);
+	}
+	DestroyBuffer(m_stateBuffer);
+	DestroyBuffer(m_earlyDrawBuffer);
+	DestroyBuffer(m_lateDrawBuffer);
+	DestroyBuffer(m_drawCountBuffer);
+}
+
+void OcclusionCuller::SetObjects(uint32_t frameSlot, const OcclusionCullObject* objects, uint32_t objectCount)
+{
+	// Slot's last frame has completed (BeginFrame waited for it), so its buffer is free to overwrite
+	objectCount = std::min(objectCount, m_uiMaxObjects);
+	memcpy(m_arrObjectBuffers[frameSlot].mapped, objects, sizeof(OcclusionCullObject) * objectCount);
+	m_arrObjectCounts[frameSlot] = objectCount;
+}
+
+void OcclusionCuller::RecordEarlyCull(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection)
+{
+	// Nothing was rendered in to the pyramid yet, put it in the layout the descriptors expect (the cull skips the occlusion test)
+	if (!m_bPyramidValid)
+	{
+		VkImageMemoryBarrier pyramidBarrier = {};
+		pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		pyramidBarrier.srcAccessMask = 0;
+		pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.image = m_pyramidImage;
+		pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &pyramidBarrier);
+	}
+
+	// Previous frame's indirect draws must have read the commands and counts, and its late cull written the states
+	VkMemoryBarrier previousFrameBarrier = {};
+	previousFrameBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	previousFrameBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	previousFrameBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &previousFrameBarrier, 0, nullptr, 0, nullptr);
+
+	// Both counts start at 0, the cull appends with atomics
+	vkCmdFillBuffer(commandBuffer, m_drawCountBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	VkMemoryBarrier clearBarrier = {};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	RecordCull(commandBuffer, frameSlot, viewProjection, false);
+}
+
+void OcclusionCuller::RecordDepthPyramid(VkCommandBuffer commandBuffer, VkExtent2D renderExtent)
+{
+	// Early cull has read the previous pyramid, it's overwritten from here on
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	m_reducePipeline.Bind(commandBuffer);
+
+	// Level 0 reduces only the rendered region, so the pyramid's uv space is the viewport's whatever its size
+	VkExtent2D srcExtent = { std::min(std::max(renderExtent.width, 1u), m_depthExtent.width),
+		std::min(std::max(renderExtent.height, 1u), m_depthExtent.height) };
+	for (uint32_t level = 0; level < m_uiPyramidLevels; ++level)
+	{
+		const VkExtent2D dstExtent = { std::max(m_pyramidExtent.width >> level, 1u), std::max(m_pyramidExtent.height >> level, 1u) };
+
+		ReducePushConstants pushConstants = {};
+		pushConstants.srcSize[0] = static_cast<int32_t>(srcExtent.width);
+		pushConstants.srcSize[1] = static_cast<int32_t>(srcExtent.height);
+		pushConstants.dstSize[0] = static_cast<int32_t>(dstExtent.width);
+		pushConstants.dstSize[1] = static_cast<int32_t>(dstExtent.height);
+
+		m_reducePipeline.BindDescriptorSets(commandBuffer, { m_vecReduceSets[level] });
+		m_reducePipeline.PushConstants(commandBuffer, &pushConstants, sizeof(pushConstants));
+		m_reducePipeline.Dispatch(commandBuffer, ComputePipeline::GroupCount(dstExtent.width, REDUCE_GROUP_SIZE),
+			ComputePipeline::GroupCount(dstExtent.height, REDUCE_GROUP_SIZE));
+
+		// Next level reads this one (and after the last level, the late cull reads all of them)
+		VkMemoryBarrier levelBarrier = {};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+
+		srcExtent = dstExtent;
+	}
+
+	m_bPyramidValid = true;
+}
+
+void OcclusionCuller::RecordLateCull(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection)
+{
+	// States written by the early cull are covered by the barriers of RecordDepthPyramid
+	RecordCull(commandBuffer, frameSlot, viewProjection, true);
+}
+
+void OcclusionCuller::RecordEarlyDraws(VkCommandBuffer commandBuffer) const
+{
+	vkCmdDrawIndexedIndirectCount(commandBuffer, m_earlyDrawBuffer.buffer, 0, m_drawCountBuffer.buffer, 0,
+		m_uiMaxObjects, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void OcclusionCuller::RecordLateDraws(VkCommandBuffer commandBuffer) const
+{
+	vkCmdDrawIndexedIndirectCount(commandBuffer, m_lateDrawBuffer.buffer, 0, m_drawCountBuffer.buffer, sizeof(uint32_t),
+		m_uiMaxObjects, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+uint32_t OcclusionCuller::GetMaxObjects() const
+{
+	return m_uiMaxObjects;
+}
+
+VkExtent2D OcclusionCuller::GetPyramidExtent() const
+{
+	return m_pyramidExtent;
+}
+
+uint32_t OcclusionCuller::GetPyramidLevels() const
+{
+	return m_uiPyramidLevels;
+}
+
+void OcclusionCuller::CreateBuffers()
+{
+	for (auto& objectBuffer : m_arrObjectBuffers)
+	{
+		objectBuffer = CreateBuffer(sizeof(OcclusionCullObject) * static_cast<VkDeviceSize>(m_uiMaxObjects), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Other);
+	}
+
+	constexpr VkBufferUsageFlags drawUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+	m_stateBuffer = CreateBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(m_uiMaxObjects), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Other);
+	m_earlyDrawBuffer = CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(m_uiMaxObjects), drawUsage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Other);
+	m_lateDrawBuffer = CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(m_uiMaxObjects), drawUsage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Other);
+	m_drawCountBuffer = CreateBuffer(sizeof(uint32_t) * 2, drawUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Other);
+}
+
+void OcclusionCuller::CreatePyramid()
+{
+	// Largest power of two not above the depth buffer, so every level is exactly half the one before
+	auto previousPowerOfTwo = [](uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result * 2 <= value)
+		{
+			result *= 2;
+		}
+		return result;
+	};
+	m_pyramidExtent = { previousPowerOfTwo(m_depthExtent.width), previousPowerOfTwo(m_depthExtent.height) };
+
+	m_uiPyramidLevels = 1;
+	while ((std::max(m_pyramidExtent.width, m_pyramidExtent.height) >> m_uiPyramidLevels) > 0)
+	{
+		++m_uiPyramidLevels;
+	}
+
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageCreateInfo.extent = { m_pyramidExtent.width, m_pyramidExtent.height, 1 };
+	imageCreateInfo.mipLevels = m_uiPyramidLevels;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkResult result = vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_pyramidImage);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Depth Pyramid Image");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_device, m_pyramidImage, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type for the Depth Pyramid Image");
+	}
+
+	result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::RenderTarget, &m_pyramidMemory)
+		: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &m_pyramidMemory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Depth Pyramid Image Memory");
+	}
+	vkBindImageMemory(m_device, m_pyramidImage, m_pyramidMemory, 0);
+
+	// View of the whole chain for the cull, and one per level for the reduction to write
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = m_pyramidImage;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_uiPyramidLevels, 0, 1 };
+
+	result = vkCreateImageView(m_device, &viewCreateInfo, nullptr, &m_pyramidView);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Depth Pyramid Image View");
+	}
+
+	m_vecPyramidLevelViews.resize(m_uiPyramidLevels);
+	for (uint32_t level = 0; level < m_uiPyramidLevels; ++level)
+	{
+		viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		result = vkCreateImageView(m_device, &viewCreateInfo, nullptr, &m_vecPyramidLevelViews[level]);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Depth Pyramid Level View");
+		}
+	}
+
+	// Shaders only use texelFetch, nearest and clamped keeps the sampler from mattering
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	result = vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &m_sampler);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Depth Pyramid Sampler");
+	}
+}
+
+void OcclusionCuller::CreateDescriptors(VkImageView depthView)
+{
+	// -- LAYOUTS --
+	// Reduction: level above (or the depth buffer) in, one level out
+	std::array<VkDescriptorSetLayoutBinding, 2> reduceBindings = {};
+	reduceBindings[0] = { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	reduceBindings[1] = { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+	// Cull: objects, states, early draws, late draws, counts, pyramid
+	std::array<VkDescriptorSetLayoutBinding, 6> cullBindings = {};
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		cullBindings[i] = { i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	}
+	cullBindings[5] = { 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(reduceBindings.size());
+	layoutCreateInfo.pBindings = reduceBindings.data();
+	VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_reduceSetLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Depth Reduce Descriptor Set Layout");
+	}
+
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+	layoutCreateInfo.pBindings = cullBindings.data();
+	result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_cullSetLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Occlusion Cull Descriptor Set Layout");
+	}
+
+	// -- POOL --
+	const std::array<VkDescriptorPoolSize, 3> poolSizes = { {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_uiPyramidLevels + MAX_FRAME_DRAWS },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_uiPyramidLevels },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * MAX_FRAME_DRAWS }
+	} };
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = m_uiPyramidLevels + MAX_FRAME_DRAWS;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+	result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Occlusion Cull Descriptor Pool");
+	}
+
+	// -- SETS --
+	std::vector<VkDescriptorSetLayout> setLayouts(m_uiPyramidLevels, m_reduceSetLayout);
+	setLayouts.insert(setLayouts.end(), MAX_FRAME_DRAWS, m_cullSetLayout);
+	std::vector<VkDescriptorSet> sets(setLayouts.size());
+
+	VkDescriptorSetAllocateInfo setAllocateInfo = {};
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.descriptorPool = m_descriptorPool;
+	setAllocateInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+	setAllocateInfo.pSetLayouts = setLayouts.data();
+	result = vkAllocateDescriptorSets(m_device, &setAllocateInfo, sets.data());
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Occlusion Cull Descriptor Sets");
+	}
+	m_vecReduceSets.assign(sets.begin(), sets.begin() + m_uiPyramidLevels);
+	std::copy(sets.begin() + m_uiPyramidLevels, sets.end(), m_arrCullSets.begin());
+
+	// -- WRITES --
+	// Infos are reserved up front, the writes point in to them
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkDescriptorBufferInfo> bufferInfos;
+	imageInfos.reserve(m_uiPyramidLevels * 2 + MAX_FRAME_DRAWS);
+	bufferInfos.reserve(5 * MAX_FRAME_DRAWS);
+	std::vector<VkWriteDescriptorSet> writes;
+
+	auto addImageWrite = [&](VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout)
+	{
+		imageInfos.push_back({ m_sampler, view, layout });
+
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.descriptorCount = 1;
+		write.descriptorType = type;
+		write.pImageInfo = &imageInfos.back();
+		writes.push_back(write);
+	};
+	auto addBufferWrite = [&](VkDescriptorSet set, uint32_t binding, VkBuffer buffer)
+	{
+		bufferInfos.push_back({ buffer, 0, VK_WHOLE_SIZE });
+
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfos.back();
+		writes.push_back(write);
+	};
+
+	for (uint32_t level = 0; level < m_uiPyramidLevels; ++level)
+	{
+		// Level 0 reduces the depth buffer itself
+		if (level == 0)
+		{
+			addImageWrite(m_vecReduceSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+		}
+		else
+		{
+			addImageWrite(m_vecReduceSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_vecPyramidLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL);
+		}
+		addImageWrite(m_vecReduceSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_vecPyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL);
+	}
+
+	for (uint32_t slot = 0; slot < MAX_FRAME_DRAWS; ++slot)
+	{
+		addBufferWrite(m_arrCullSets[slot], 0, m_arrObjectBuffers[slot].buffer);
+		addBufferWrite(m_arrCullSets[slot], 1, m_stateBuffer.buffer);
+		addBufferWrite(m_arrCullSets[slot], 2, m_earlyDrawBuffer.buffer);
+		addBufferWrite(m_arrCullSets[slot], 3, m_lateDrawBuffer.buffer);
+		addBufferWrite(m_arrCullSets[slot], 4, m_drawCountBuffer.buffer);
+		addImageWrite(m_arrCullSets[slot], 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_pyramidView, VK_IMAGE_LAYOUT_GENERAL);
+	}
+
+	vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+OcclusionCuller::CullBuffer OcclusionCuller::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+	MemoryCategory category) const
+{
+	CullBuffer cullBuffer;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &cullBuffer.buffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create an Occlusion Cull Buffer");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_device, cullBuffer.buffer, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits, properties);
+	if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type for an Occlusion Cull Buffer");
+	}
+
+	result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, category, &cullBuffer.memory)
+		: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &cullBuffer.memory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Occlusion Cull Buffer Memory");
+	}
+	vkBindBufferMemory(m_device, cullBuffer.buffer, cullBuffer.memory, 0);
+
+	// Host visible buffers stay mapped for their lifetime
+	if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		result = vkMapMemory(m_device, cullBuffer.memory, 0, VK_WHOLE_SIZE, 0, &cullBuffer.mapped);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to map an Occlusion Cull Buffer");
+		}
+	}
+	return cullBuffer;
+}
+
+void OcclusionCuller::DestroyBuffer(CullBuffer& buffer) const
+{
+	if (buffer.mapped != nullptr)
+	{
+		vkUnmapMemory(m_device, buffer.memory);
+	}
+	vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_pMemoryBudget->Free(buffer.memory);
+	}
+	else
+	{
+		vkFreeMemory(m_device, buffer.memory, nullptr);
+	}
+	buffer = CullBuffer();
+}
+
+void OcclusionCuller::RecordCull(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection, bool latePhase) const
+{
+	CullPushConstants pushConstants = {};
+	pushConstants.viewProjection = viewProjection;
+	pushConstants.pyramidSize[0] = static_cast<float>(m_pyramidExtent.width);
+	pushConstants.pyramidSize[1] = static_cast<float>(m_pyramidExtent.height);
+	pushConstants.objectCount = m_arrObjectCounts[frameSlot];
+	pushConstants.latePhase = latePhase ? 1 : 0;
+	pushConstants.occlusionEnabled = m_bPyramidValid ? 1 : 0;
+	pushConstants.pyramidLevels = m_uiPyramidLevels;
+
+	m_cullPipeline.Bind(commandBuffer);
+	m_cullPipeline.BindDescriptorSets(commandBuffer, { m_arrCullSets[frameSlot] });
+	m_cullPipeline.PushConstants(commandBuffer, &pushConstants, sizeof(pushConstants));
+	m_cullPipeline.DispatchItems(commandBuffer, pushConstants.objectCount, CULL_GROUP_SIZE);
+
+	// Commands and counts are read by the draws that follow
+	VkMemoryBarrier drawBarrier = {};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
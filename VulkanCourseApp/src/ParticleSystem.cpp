@@ -0,0 +1,559 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+
+void ParticleSystem::InitParticleSystem(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, uint32_t capacity,
+	uint32_t simulationFamily, uint32_t drawFamily, const ParticleRenderTarget& renderTarget, const std::vector<char>& simulationShaderCode,
+	const std::vector<char>& vertexShaderCode, const std::vector<char>& fragmentShaderCode)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_pMemoryBudget = memoryBudget;
+	m_uiCapacity = capacity;
+	m_uiSimulationFamily = simulationFamily;
+	m_uiDrawFamily = drawFamily;
+	m_bOwnershipTransfer = simulationFamily != drawFamily;
+	m_bDrawReleased = false;
+	m_renderTarget = renderTarget;
+	m_dEmitRemainder = 0.0;
+	m_uiCurrentAlive = 0;
+	m_bInitialized = false;
+
+	CreateBuffers();
+	CreateDescriptors();
+
+	// Same SPIR-V for every stage, the branches of the other stages are compiled out
+	for (uint32_t stage = 0; stage < static_cast<uint32_t>(SimulationStage::Count); ++stage)
+	{
+		const VkSpecializationMapEntry mapEntry = { 0, 0, sizeof(uint32_t) };
+		VkSpecializationInfo specializationInfo = {};
+		specializationInfo.mapEntryCount = 1;
+		specializationInfo.pMapEntries = &mapEntry;
+		specializationInfo.dataSize = sizeof(uint32_t);
+		specializationInfo.pData = &stage;
+
+		m_arrSimulationPipelines[stage] = ComputePipeline(m_device, simulationShaderCode, { m_simulationSetLayout },
+			sizeof(SimulationPushConstants), &specializationInfo);
+	}
+
+	CreateRenderPipeline(vertexShaderCode, fragmentShaderCode);
+}
+
+void ParticleSystem::ShutdownParticleSystem()
+{
+	vkDestroyPipeline(m_device, m_renderPipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_renderPipelineLayout, nullptr);
+	for (const ComputePipeline& pipeline : m_arrSimulationPipelines)
+	{
+		pipeline.DestroyPipeline();
+	}
+
+	// Sets go with the pool
+	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_renderSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_simulationSetLayout, nullptr);
+
+	DestroyBuffer(m_particleBuffer);
+	for (auto& aliveBuffer : m_arrAliveBuffers)
+	{
+		DestroyBuffer(aliveBuffer);
+	}
+	DestroyBuffer(m_deadBuffer);
+	DestroyBuffer(m_stateBuffer);
+}
+
+void ParticleSystem::SetEmitter(const ParticleEmitterSettings& settings)
+{
+	m_emitter = settings;
+}
+
+const ParticleEmitterSettings& ParticleSystem::GetEmitter() const
+{
+	return m_emitter;
+}
+
+void ParticleSystem::RecordSimulation(VkCommandBuffer commandBuffer, float deltaTime)
+{
+	deltaTime = std::max(deltaTime, 0.0f);
+
+	// Only the number of particles to emit is worked out on the CPU, the GPU clamps it to what's free
+	const double emit = m_emitter.emitRate * static_cast<double>(deltaTime) + m_dEmitRemainder;
+	const double emitWhole = std::floor(emit);
+	m_dEmitRemainder = emit - emitWhole;
+
+	SimulationPushConstants pushConstants = {};
+	pushConstants.emitter = glm::vec4(m_emitter.position, m_emitter.speed);
+	pushConstants.gravity = glm::vec4(m_emitter.gravity, deltaTime);
+	pushConstants.requestedEmitCount = static_cast<uint32_t>(std::min(emitWhole, static_cast<double>(m_uiCapacity)));
+	pushConstants.capacity = m_uiCapacity;
+	pushConstants.seed = m_uiSeed++;
+	pushConstants.maxLifetime = m_emitter.maxLifetime;
+
+	// Previous frame's draw must have read the particles, the alive list and its arguments before they change
+	// (the semaphore wait orders it, on another family the buffers also come back from the draw family first)
+	constexpr VkAccessFlags simulationAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	if (m_bOwnershipTransfer)
+	{
+		if (m_bDrawReleased)
+		{
+			for (const VkBuffer buffer : GetSharedBuffers())
+			{
+				RecordBufferAcquire(commandBuffer, buffer, m_uiDrawFamily, m_uiSimulationFamily,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, simulationAccess);
+			}
+			m_bDrawReleased = false;
+		}
+	}
+	else
+	{
+		VkMemoryBarrier previousFrameBarrier = {};
+		previousFrameBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		previousFrameBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		previousFrameBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &previousFrameBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Every particle starts on the dead list
+	if (!m_bInitialized)
+	{
+		RecordStage(commandBuffer, SimulationStage::Init, pushConstants);
+		m_arrSimulationPipelines[static_cast<size_t>(SimulationStage::Init)].DispatchItems(commandBuffer, m_uiCapacity, SIMULATION_GROUP_SIZE);
+		m_bInitialized = true;
+	}
+
+	// Writes of each stage are read by the next, directly and as indirect arguments
+	VkMemoryBarrier stageBarrier = {};
+	stageBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	stageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	stageBarrier.dstAccessMask = simulationAccess;
+	constexpr VkPipelineStageFlags nextStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+
+	const ComputePipeline& preparePipeline = m_arrSimulationPipelines[static_cast<size_t>(SimulationStage::Prepare)];
+	const ComputePipeline& emitPipeline = m_arrSimulationPipelines[static_cast<size_t>(SimulationStage::Emit)];
+	const ComputePipeline& updatePipeline = m_arrSimulationPipelines[static_cast<size_t>(SimulationStage::Update)];
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, nextStages, 0, 1, &stageBarrier, 0, nullptr, 0, nullptr);
+	RecordStage(commandBuffer, SimulationStage::Prepare, pushConstants);
+	preparePipeline.Dispatch(commandBuffer, 1);
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, nextStages, 0, 1, &stageBarrier, 0, nullptr, 0, nullptr);
+	RecordStage(commandBuffer, SimulationStage::Emit, pushConstants);
+	emitPipeline.DispatchIndirect(commandBuffer, m_stateBuffer.buffer, offsetof(ParticleState, emitDispatch));
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, nextStages, 0, 1, &stageBarrier, 0, nullptr, 0, nullptr);
+	RecordStage(commandBuffer, SimulationStage::Update, pushConstants);
+	updatePipeline.DispatchIndirect(commandBuffer, m_stateBuffer.buffer, offsetof(ParticleState, updateDispatch));
+
+	// Draw reads the compacted list and its instance count
+	if (m_bOwnershipTransfer)
+	{
+		for (const VkBuffer buffer : GetSharedBuffers())
+		{
+			RecordBufferRelease(commandBuffer, buffer, m_uiSimulationFamily, m_uiDrawFamily, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+		}
+	}
+	else
+	{
+		VkMemoryBarrier drawBarrier = {};
+		drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Survivors are the list to draw now, and to update next frame
+	m_uiCurrentAlive = 1 - m_uiCurrentAlive;
+}
+
+void ParticleSystem::RecordDrawAcquire(VkCommandBuffer commandBuffer) const
+{
+	if (!m_bOwnershipTransfer)
+	{
+		return;
+	}
+
+	for (const VkBuffer buffer : GetSharedBuffers())
+	{
+		RecordBufferAcquire(commandBuffer, buffer, m_uiSimulationFamily, m_uiDrawFamily,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+	}
+}
+
+void ParticleSystem::RecordDrawRelease(VkCommandBuffer commandBuffer)
+{
+	if (!m_bOwnershipTransfer)
+	{
+		return;
+	}
+
+	// Draw only reads, nothing to make available
+	for (const VkBuffer buffer : GetSharedBuffers())
+	{
+		RecordBufferRelease(commandBuffer, buffer, m_uiDrawFamily, m_uiSimulationFamily,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0);
+	}
+	m_bDrawReleased = true;
+}
+
+void ParticleSystem::RecordDraw(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection) const
+{
+	// Draw arguments are only written once the first simulation ran
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	RenderPushConstants pushConstants = {};
+	pushConstants.viewProjection = viewProjection;
+	pushConstants.size = glm::vec2(m_emitter.size / static_cast<float>(m_renderTarget.extent.width),
+		m_emitter.size / static_cast<float>(m_renderTarget.extent.height));
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_renderPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_renderPipelineLayout, 0, 1, &m_arrRenderSets[m_uiCurrentAlive], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_renderPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+	vkCmdDrawIndirect(commandBuffer, m_stateBuffer.buffer, offsetof(ParticleState, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+uint32_t ParticleSystem::GetCapacity() const
+{
+	return m_uiCapacity;
+}
+
+void ParticleSystem::CreateBuffers()
+{
+	static_assert(offsetof(ParticleState, emitDispatch) == 16 && offsetof(ParticleState, updateDispatch) == 32 && offsetof(ParticleState, draw) == 48,
+		"ParticleState must match State in particle_sim.comp");
+
+	constexpr VkDeviceSize particleSize = sizeof(glm::vec4) * 2;		// Particle in particle_sim.comp
+	m_particleBuffer = CreateBuffer(particleSize * m_uiCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	for (auto& aliveBuffer : m_arrAliveBuffers)
+	{
+		aliveBuffer = CreateBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(m_uiCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	}
+	m_deadBuffer = CreateBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(m_uiCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_stateBuffer = CreateBuffer(sizeof(ParticleState), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+}
+
+void ParticleSystem::CreateDescriptors()
+{
+	// -- LAYOUTS --
+	// Simulation: particles, current alive list, next alive list, dead list, state
+	std::array<VkDescriptorSetLayoutBinding, 5> simulationBindings = {};
+	for (uint32_t i = 0; i < simulationBindings.size(); ++i)
+	{
+		simulationBindings[i] = { i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	}
+
+	// Render: particles, alive list drawn
+	std::array<VkDescriptorSetLayoutBinding, 2> renderBindings = {};
+	renderBindings[0] = { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+	renderBindings[1] = { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(simulationBindings.size());
+	layoutCreateInfo.pBindings = simulationBindings.data();
+	VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_simulationSetLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Particle Simulation Descriptor Set Layout");
+	}
+
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(renderBindings.size());
+	layoutCreateInfo.pBindings = renderBindings.data();
+	result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_renderSetLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Particle Render Descriptor Set Layout");
+	}
+
+	// -- POOL --
+	const VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		static_cast<uint32_t>(m_arrSimulationSets.size() * simulationBindings.size() + m_arrRenderSets.size() * renderBindings.size()) };
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = static_cast<uint32_t>(m_arrSimulationSets.size() + m_arrRenderSets.size());
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+	result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Particle Descriptor Pool");
+	}
+
+	// -- SETS --
+	const std::array<VkDescriptorSetLayout, 4> setLayouts = { m_simulationSetLayout, m_simulationSetLayout, m_renderSetLayout, m_renderSetLayout };
+	std::array<VkDescriptorSet, 4> sets = {};
+
+	VkDescriptorSetAllocateInfo setAllocateInfo = {};
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.descriptorPool = m_descriptorPool;
+	setAllocateInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+	setAllocateInfo.pSetLayouts = setLayouts.data();
+	result = vkAllocateDescriptorSets(m_device, &setAllocateInfo, sets.data());
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Particle Descriptor Sets");
+	}
+	m_arrSimulationSets = { sets[0], sets[1] };
+	m_arrRenderSets = { sets[2], sets[3] };
+
+	// -- WRITES --
+	// Infos are reserved up front, the writes point in to them
+	std::vector<VkDescriptorBufferInfo> bufferInfos;
+	bufferInfos.reserve(poolSize.descriptorCount);
+	std::vector<VkWriteDescriptorSet> writes;
+
+	auto addBufferWrite = [&](VkDescriptorSet set, uint32_t binding, VkBuffer buffer)
+	{
+		bufferInfos.push_back({ buffer, 0, VK_WHOLE_SIZE });
+
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfos.back();
+		writes.push_back(write);
+	};
+
+	for (uint32_t current = 0; current < 2; ++current)
+	{
+		addBufferWrite(m_arrSimulationSets[current], 0, m_particleBuffer.buffer);
+		addBufferWrite(m_arrSimulationSets[current], 1, m_arrAliveBuffers[current].buffer);
+		addBufferWrite(m_arrSimulationSets[current], 2, m_arrAliveBuffers[1 - current].buffer);
+		addBufferWrite(m_arrSimulationSets[current], 3, m_deadBuffer.buffer);
+		addBufferWrite(m_arrSimulationSets[current], 4, m_stateBuffer.buffer);
+
+		addBufferWrite(m_arrRenderSets[current], 0, m_particleBuffer.buffer);
+		addBufferWrite(m_arrRenderSets[current], 1, m_arrAliveBuffers[current].buffer);
+	}
+
+	vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void ParticleSystem::CreateRenderPipeline(const std::vector<char>& vertexShaderCode, const std::vector<char>& fragmentShaderCode)
+{
+	VkShaderModule vertexShaderModule = CreateShaderModule(vertexShaderCode);
+	VkShaderModule fragmentShaderModule = CreateShaderModule(fragmentShaderCode);
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertexShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragmentShaderModule;
+	shaderStages[1].pName = "main";
+
+	// No vertex buffers, the quad corners come from gl_VertexIndex and the particle from gl_InstanceIndex
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkViewport viewport = {};
+	viewport.width = static_cast<float>(m_renderTarget.extent.width);
+	viewport.height = static_cast<float>(m_renderTarget.extent.height);
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.extent = m_renderTarget.extent;
+
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportStateCreateInfo.viewportCount = 1;
+	viewportStateCreateInfo.pViewports = &viewport;
+	viewportStateCreateInfo.scissorCount = 1;
+	viewportStateCreateInfo.pScissors = &scissor;
+
+	// Rendered at a varying resolution, the caller sets them inside rendering
+	const std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+	// Quads face the screen, so nothing to cull
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizerCreateInfo.lineWidth = 1.0f;
+	rasterizerCreateInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.rasterizationSamples = m_renderTarget.samples;
+
+	// Additive, so particles don't need sorting
+	VkPipelineColorBlendAttachmentState colorState = {};
+	colorState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorState.blendEnable = VK_TRUE;
+	colorState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorState.colorBlendOp = VK_BLEND_OP_ADD;
+	colorState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
+	colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendingCreateInfo.attachmentCount = 1;
+	colorBlendingCreateInfo.pAttachments = &colorState;
+
+	// Tested against the scene, but never written: particles don't hide each other
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(RenderPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &m_renderSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	VkResult result = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_renderPipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Particle Pipeline Layout");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineCreateInfo.pStages = shaderStages.data();
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+	pipelineCreateInfo.pDynamicState = m_renderTarget.dynamicViewport ? &dynamicStateCreateInfo : nullptr;
+	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.layout = m_renderPipelineLayout;
+	pipelineCreateInfo.renderPass = m_renderTarget.renderPass;
+	pipelineCreateInfo.subpass = 0;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	// Dynamic rendering: no render pass, the attachment formats are given directly instead
+	VkPipelineRenderingCreateInfo renderingCreateInfo = {};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingCreateInfo.colorAttachmentCount = 1;
+	renderingCreateInfo.pColorAttachmentFormats = &m_renderTarget.colorFormat;
+	renderingCreateInfo.depthAttachmentFormat = m_renderTarget.depthFormat;
+	if (m_renderTarget.renderPass == VK_NULL_HANDLE)
+	{
+		pipelineCreateInfo.pNext = &renderingCreateInfo;
+	}
+
+	result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_renderPipeline);
+
+	// Modules are only needed to create the pipeline
+	vkDestroyShaderModule(m_device, fragmentShaderModule, nullptr);
+	vkDestroyShaderModule(m_device, vertexShaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Particle Pipeline");
+	}
+}
+
+ParticleSystem::ParticleBuffer ParticleSystem::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage) const
+{
+	ParticleBuffer particleBuffer;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &particleBuffer.buffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Particle Buffer");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_device, particleBuffer.buffer, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type for a Particle Buffer");
+	}
+
+	// Only ever touched by the GPU, never evicted
+	result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::Other, &particleBuffer.memory)
+		: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &particleBuffer.memory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Particle Buffer Memory");
+	}
+	vkBindBufferMemory(m_device, particleBuffer.buffer, particleBuffer.memory, 0);
+	return particleBuffer;
+}
+
+void ParticleSystem::DestroyBuffer(ParticleBuffer& buffer) const
+{
+	vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_pMemoryBudget->Free(buffer.memory);
+	}
+	else
+	{
+		vkFreeMemory(m_device, buffer.memory, nullptr);
+	}
+	buffer = ParticleBuffer();
+}
+
+std::array<VkBuffer, 4> ParticleSystem::GetSharedBuffers() const
+{
+	return { m_particleBuffer.buffer, m_arrAliveBuffers[0].buffer, m_arrAliveBuffers[1].buffer, m_stateBuffer.buffer };
+}
+
+VkShaderModule ParticleSystem::CreateShaderModule(const std::vector<char>& code) const
+{
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = code.size();
+	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	const VkResult result = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Particle Shader Module");
+	}
+	return shaderModule;
+}
+
+void ParticleSystem::RecordStage(VkCommandBuffer commandBuffer, SimulationStage stage, const SimulationPushConstants& pushConstants) const
+{
+	const ComputePipeline& pipeline = m_arrSimulationPipelines[static_cast<size_t>(stage)];
+	pipeline.Bind(commandBuffer);
+	pipeline.BindDescriptorSets(commandBuffer, { m_arrSimulationSets[m_uiCurrentAlive] });
+	pipeline.PushConstants(commandBuffer, &pushConstants, sizeof(pushConstants));
+}
@@ -0,0 +1,292 @@
+#include "PostProcess.h"
+#include <algorithm>
+
+
+void PostProcessChain::InitPostProcessChain(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, MemoryBudget* memoryBudget, VkExtent2D maxExtent,
+	const PostProcessImages& images, const std::vector<char>& shaderCode)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_pMemoryBudget = memoryBudget;
+	m_maxExtent = maxExtent;
+	m_bloomExtent = GetBloomExtent(maxExtent);
+	m_bInitialized = false;
+
+	CreateResources();
+	CreateDescriptors(images);
+
+	// Same SPIR-V for every stage, the branches of the other stages are compiled out
+	for (uint32_t stage = 0; stage < static_cast<uint32_t>(PostProcessStage::Count); ++stage)
+	{
+		const VkSpecializationMapEntry mapEntry = { 0, 0, sizeof(uint32_t) };
+		VkSpecializationInfo specializationInfo = {};
+		specializationInfo.mapEntryCount = 1;
+		specializationInfo.pMapEntries = &mapEntry;
+		specializationInfo.dataSize = sizeof(uint32_t);
+		specializationInfo.pData = &stage;
+
+		m_arrPipelines[stage] = ComputePipeline(m_device, shaderCode, { m_setLayout }, sizeof(PostProcessPushConstants), &specializationInfo);
+	}
+}
+
+void PostProcessChain::ShutdownPostProcessChain()
+{
+	for (const ComputePipeline& pipeline : m_arrPipelines)
+	{
+		pipeline.DestroyPipeline();
+	}
+
+	// Set goes with the pool
+	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+	vkDestroySampler(m_device, m_sampler, nullptr);
+
+	vkDestroyBuffer(m_device, m_exposureBuffer, nullptr);
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_pMemoryBudget->Free(m_exposureMemory);
+	}
+	else
+	{
+		vkFreeMemory(m_device, m_exposureMemory, nullptr);
+	}
+}
+
+void PostProcessChain::SetSettings(const PostProcessSettings& settings)
+{
+	m_settings = settings;
+}
+
+const PostProcessSettings& PostProcessChain::GetSettings() const
+{
+	return m_settings;
+}
+
+void PostProcessChain::RecordPostProcess(VkCommandBuffer commandBuffer, VkExtent2D extent, float deltaTime)
+{
+	extent = { std::min(extent.width, m_maxExtent.width), std::min(extent.height, m_maxExtent.height) };
+	const VkExtent2D bloomExtent = { (extent.width + 1) / 2, (extent.height + 1) / 2 };
+
+	PostProcessPushConstants pushConstants = {};
+	pushConstants.inputSize[0] = static_cast<int32_t>(extent.width);
+	pushConstants.inputSize[1] = static_cast<int32_t>(extent.height);
+	pushConstants.bloomSize[0] = static_cast<int32_t>(bloomExtent.width);
+	pushConstants.bloomSize[1] = static_cast<int32_t>(bloomExtent.height);
+	pushConstants.bloomImageSize[0] = static_cast<float>(m_bloomExtent.width);
+	pushConstants.bloomImageSize[1] = static_cast<float>(m_bloomExtent.height);
+	pushConstants.deltaTime = std::max(deltaTime, 0.0f);
+	pushConstants.adaptationRate = m_settings.adaptationRate;
+	pushConstants.bloomThreshold = m_settings.bloomThreshold;
+	pushConstants.bloomKnee = m_settings.bloomKnee;
+	pushConstants.bloomIntensity = m_settings.bloomIntensity;
+	pushConstants.exposureCompensation = m_settings.exposureCompensation;
+	pushConstants.colorGain = glm::vec4(m_settings.colorGain, 1.0f);
+	pushConstants.saturation = m_settings.saturation;
+	pushConstants.contrast = m_settings.contrast;
+
+	if (!m_bInitialized)
+	{
+		// Exposure state starts out unmeasured (all zero)
+		vkCmdFillBuffer(commandBuffer, m_exposureBuffer, 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier clearBarrier = {};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+		m_bInitialized = true;
+	}
+
+	// Each stage reads what the one before wrote. The first also waits for the previous frame's composite to have
+	// read the exposure before it's overwritten
+	VkMemoryBarrier stageBarrier = {};
+	stageBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	stageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	stageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	auto recordStageBarrier = [&]()
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &stageBarrier, 0, nullptr, 0, nullptr);
+	};
+
+	recordStageBarrier();
+	RecordStage(commandBuffer, PostProcessStage::Downsample, pushConstants);
+	m_arrPipelines[static_cast<size_t>(PostProcessStage::Downsample)].Dispatch(commandBuffer,
+		ComputePipeline::GroupCount(bloomExtent.width, POST_TILE_SIZE), ComputePipeline::GroupCount(bloomExtent.height, POST_TILE_SIZE));
+
+	recordStageBarrier();
+	RecordStage(commandBuffer, PostProcessStage::Adapt, pushConstants);
+	m_arrPipelines[static_cast<size_t>(PostProcessStage::Adapt)].Dispatch(commandBuffer, 1);
+
+	// Adaptation only touches the exposure, the barrier before it already made the downsampled bloom visible
+	// Blur workgroups take a line segment each: x is the segment along the line, y the line
+	RecordStage(commandBuffer, PostProcessStage::BlurHorizontal, pushConstants);
+	m_arrPipelines[static_cast<size_t>(PostProcessStage::BlurHorizontal)].Dispatch(commandBuffer,
+		ComputePipeline::GroupCount(bloomExtent.width, POST_GROUP_SIZE), bloomExtent.height);
+
+	recordStageBarrier();
+	RecordStage(commandBuffer, PostProcessStage::BlurVertical, pushConstants);
+	m_arrPipelines[static_cast<size_t>(PostProcessStage::BlurVertical)].Dispatch(commandBuffer,
+		ComputePipeline::GroupCount(bloomExtent.height, POST_GROUP_SIZE), bloomExtent.width);
+
+	recordStageBarrier();
+	RecordStage(commandBuffer, PostProcessStage::Composite, pushConstants);
+	m_arrPipelines[static_cast<size_t>(PostProcessStage::Composite)].Dispatch(commandBuffer,
+		ComputePipeline::GroupCount(extent.width, POST_TILE_SIZE), ComputePipeline::GroupCount(extent.height, POST_TILE_SIZE));
+}
+
+VkExtent2D PostProcessChain::GetBloomExtent(VkExtent2D maxExtent)
+{
+	return { (maxExtent.width + 1) / 2, (maxExtent.height + 1) / 2 };
+}
+
+void PostProcessChain::CreateResources()
+{
+	static_assert(sizeof(ExposureState) == 16, "ExposureState must match Exposure in post_process.comp");
+
+	// -- EXPOSURE --
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = sizeof(ExposureState);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_exposureBuffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Exposure Buffer");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_device, m_exposureBuffer, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type for the Exposure Buffer");
+	}
+
+	result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::Other, &m_exposureMemory)
+		: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &m_exposureMemory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Exposure Buffer Memory");
+	}
+	vkBindBufferMemory(m_device, m_exposureBuffer, m_exposureMemory, 0);
+
+	// -- SAMPLER --
+	// Bloom upsample is the only filtered read, the scene is read with texelFetch
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	result = vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &m_sampler);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Post Process Sampler");
+	}
+}
+
+void PostProcessChain::CreateDescriptors(const PostProcessImages& images)
+{
+	// -- LAYOUT --
+	// Scene color, bloom A, bloom B, bloom A filtered, output, exposure
+	const std::array<VkDescriptorSetLayoutBinding, 6> bindings = { {
+		{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+	} };
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+	VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_setLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Post Process Descriptor Set Layout");
+	}
+
+	// -- POOL --
+	const std::array<VkDescriptorPoolSize, 3> poolSizes = { {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 }
+	} };
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+	result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Post Process Descriptor Pool");
+	}
+
+	// -- SET --
+	VkDescriptorSetAllocateInfo setAllocateInfo = {};
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.descriptorPool = m_descriptorPool;
+	setAllocateInfo.descriptorSetCount = 1;
+	setAllocateInfo.pSetLayouts = &m_setLayout;
+	result = vkAllocateDescriptorSets(m_device, &setAllocateInfo, &m_descriptorSet);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate the Post Process Descriptor Set");
+	}
+
+	// -- WRITES --
+	// Storage images are in GENERAL, the bloom is sampled in it too
+	const std::array<VkDescriptorImageInfo, 5> imageInfos = { {
+		{ m_sampler, images.sceneColor, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+		{ VK_NULL_HANDLE, images.bloom[0], VK_IMAGE_LAYOUT_GENERAL },
+		{ VK_NULL_HANDLE, images.bloom[1], VK_IMAGE_LAYOUT_GENERAL },
+		{ m_sampler, images.bloom[0], VK_IMAGE_LAYOUT_GENERAL },
+		{ VK_NULL_HANDLE, images.output, VK_IMAGE_LAYOUT_GENERAL }
+	} };
+	const VkDescriptorBufferInfo exposureInfo = { m_exposureBuffer, 0, VK_WHOLE_SIZE };
+
+	std::array<VkWriteDescriptorSet, 6> writes = {};
+	for (uint32_t binding = 0; binding < writes.size(); ++binding)
+	{
+		writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[binding].dstSet = m_descriptorSet;
+		writes[binding].dstBinding = binding;
+		writes[binding].descriptorCount = 1;
+		writes[binding].descriptorType = bindings[binding].descriptorType;
+		if (binding < imageInfos.size())
+		{
+			writes[binding].pImageInfo = &imageInfos[binding];
+		}
+		else
+		{
+			writes[binding].pBufferInfo = &exposureInfo;
+		}
+	}
+
+	vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void PostProcessChain::RecordStage(VkCommandBuffer commandBuffer, PostProcessStage stage, const PostProcessPushConstants& pushConstants) const
+{
+	const ComputePipeline& pipeline = m_arrPipelines[static_cast<size_t>(stage)];
+	pipeline.Bind(commandBuffer);
+	pipeline.BindDescriptorSets(commandBuffer, { m_descriptorSet });
+	pipeline.PushConstants(commandBuffer, &pushConstants, sizeof(pushConstants));
+}
@@ -0,0 +1,763 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <queue>
+
+
+// -- PASS BUILDER --
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, uint32_t passIndex)
+	: m_graph(graph)
+	, m_uiPassIndex(passIndex)
+{
+}
+
+void RenderGraph::PassBuilder::Read(RenderGraphResource resource, RenderGraphUsage usage)
+{
+	if (resource >= m_graph.m_vecResources.size() || usage == RenderGraphUsage::Present)
+	{
+		throw std::runtime_error("Render Graph pass reads an invalid resource or usage");
+	}
+	m_graph.m_vecPasses[m_uiPassIndex].accesses.push_back({ resource, usage, false });
+}
+
+void RenderGraph::PassBuilder::Write(RenderGraphResource resource, RenderGraphUsage usage)
+{
+	if (resource >= m_graph.m_vecResources.size() || usage == RenderGraphUsage::Present || usage == RenderGraphUsage::Sampled)
+	{
+		throw std::runtime_error("Render Graph pass writes an invalid resource or usage");
+	}
+	m_graph.m_vecPasses[m_uiPassIndex].accesses.push_back({ resource, usage, true });
+}
+
+void RenderGraph::PassBuilder::SetSideEffect()
+{
+	m_graph.m_vecPasses[m_uiPassIndex].sideEffect = true;
+}
+
+
+// -- RENDER GRAPH --
+
+RenderGraph::RenderGraph(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice)
+	: m_physicalDevice(newPhysicalDevice)
+	, m_device(newDevice)
+{
+}
+
+RenderGraphResource RenderGraph::CreateImage(const std::string& name, const RenderGraphImageDesc& desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	m_vecResources.push_back(resource);
+	m_bCompiled = false;
+
+	return static_cast<RenderGraphResource>(m_vecResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportImage(const std::string& name, VkImage image, VkImageView imageView, VkImageAspectFlags aspect,
+	VkImageLayout initialLayout, RenderGraphUsage finalUsage)
+{
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.desc.aspect = aspect;
+	resource.image = image;
+	resource.imageView = imageView;
+	resource.initialLayout = initialLayout;
+	resource.finalUsage = finalUsage;
+	resource.hasFinalUsage = true;			// Imported images are the graph's outputs, anything that doesn't lead to them is culled
+	m_vecResources.push_back(resource);
+	m_bCompiled = false;
+
+	return static_cast<RenderGraphResource>(m_vecResources.size() - 1);
+}
+
+void RenderGraph::AddPass(const std::string& name, RenderGraphPassType type, const SetupFunction& setup, const RecordFunction& record)
+{
+	Pass pass;
+	pass.name = name;
+	pass.type = type;
+	pass.record = record;
+	m_vecPasses.push_back(pass);
+
+	PassBuilder builder(*this, static_cast<uint32_t>(m_vecPasses.size() - 1));
+	setup(builder);
+	m_bCompiled = false;
+}
+
+void RenderGraph::Compile()
+{
+	if (m_bCompiled)
+	{
+		return;
+	}
+
+	CullPasses();
+	OrderPasses();
+	ComputeLifetimes();
+	CreateTransientImages();
+	AliasTransientImages();
+	BuildBarriers();
+
+	m_bCompiled = true;
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer, LinearArena* scratchArena) const
+{
+	if (!m_bCompiled)
+	{
+		throw std::runtime_error("Render Graph must be compiled before it is executed");
+	}
+
+	for (size_t i = 0; i < m_vecExecutionOrder.size(); ++i)
+	{
+		RecordBatch(commandBuffer, m_vecPassBarriers[i], m_vecResources, scratchArena);
+		m_vecPasses[m_vecExecutionOrder[i]].record(commandBuffer);
+	}
+
+	RecordBatch(commandBuffer, m_finalBarriers, m_vecResources, scratchArena);
+}
+
+void RenderGraph::SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView)
+{
+	if (!m_vecResources[resource].imported)
+	{
+		throw std::runtime_error("Only imported Render Graph images can be replaced");
+	}
+
+	m_vecResources[resource].image = image;
+	m_vecResources[resource].imageView = imageView;
+}
+
+VkImage RenderGraph::GetImage(RenderGraphResource resource) const
+{
+	return m_vecResources[resource].image;
+}
+
+VkImageView RenderGraph::GetImageView(RenderGraphResource resource) const
+{
+	return m_vecResources[resource].imageView;
+}
+
+bool RenderGraph::IsPassCulled(const std::string& name) const
+{
+	for (const auto& pass : m_vecPasses)
+	{
+		if (pass.name == name)
+		{
+			return pass.culled;
+		}
+	}
+	return true;
+}
+
+VkPipelineStageFlags RenderGraph::GetFirstUseStages(RenderGraphResource resource) const
+{
+	return m_vecResources[resource].firstUseStages;
+}
+
+uint32_t RenderGraph::GetBarrierCount() const
+{
+	size_t count = m_finalBarriers.imageBarriers.size();
+	for (const auto& batch : m_vecPassBarriers)
+	{
+		count += batch.imageBarriers.size();
+	}
+	return static_cast<uint32_t>(count);
+}
+
+VkDeviceSize RenderGraph::GetTransientMemorySize() const
+{
+	VkDeviceSize size = 0;
+	for (const auto& block : m_vecMemoryBlocks)
+	{
+		size += block.size;
+	}
+	return size;
+}
+
+VkDeviceSize RenderGraph::GetUnaliasedMemorySize() const
+{
+	VkDeviceSize size = 0;
+	for (const auto& resource : m_vecResources)
+	{
+		if (!resource.imported && resource.image != VK_NULL_HANDLE)
+		{
+			size += resource.memoryRequirements.size;
+		}
+	}
+	return size;
+}
+
+void RenderGraph::DestroyGraph()
+{
+	for (auto& resource : m_vecResources)
+	{
+		if (resource.imported)
+		{
+			continue;
+		}
+
+		vkDestroyImageView(m_device, resource.imageView, nullptr);
+		vkDestroyImage(m_device, resource.image, nullptr);
+		resource.imageView = VK_NULL_HANDLE;
+		resource.image = VK_NULL_HANDLE;
+	}
+
+	for (auto& block : m_vecMemoryBlocks)
+	{
+		vkFreeMemory(m_device, block.memory, nullptr);
+	}
+	m_vecMemoryBlocks.clear();
+	m_bCompiled = false;
+}
+
+// Walk passes backwards from the outputs: a pass survives only if it writes something a surviving pass
+// (or an output) reads. Declaration order means a pass can only depend on passes declared before it
+void RenderGraph::CullPasses()
+{
+	std::vector<bool> needed(m_vecResources.size(), false);
+	for (size_t i = 0; i < m_vecResources.size(); ++i)
+	{
+		needed[i] = m_vecResources[i].hasFinalUsage;
+	}
+
+	for (size_t p = m_vecPasses.size(); p-- > 0;)
+	{
+		Pass& pass = m_vecPasses[p];
+
+		bool writesNeeded = false;
+		for (const auto& access : pass.accesses)
+		{
+			if (access.write && needed[access.resource])
+			{
+				writesNeeded = true;
+				break;
+			}
+		}
+
+		pass.culled = !(pass.sideEffect || writesNeeded);
+		if (pass.culled)
+		{
+			continue;
+		}
+
+		// Contents this pass reads must be produced by earlier passes
+		// A plain write replaces the contents, so earlier writers aren't needed unless the pass also reads
+		for (const auto& access : pass.accesses)
+		{
+			if (!access.write)
+			{
+				needed[access.resource] = true;
+			}
+		}
+	}
+}
+
+// Build dependency edges between surviving passes (read-after-write, write-after-read, write-after-write)
+// and topologically sort them, preferring declaration order when several passes are ready
+void RenderGraph::OrderPasses()
+{
+	const size_t passCount = m_vecPasses.size();
+	std::vector<std::vector<uint32_t>> edges(passCount);
+	std::vector<uint32_t> inDegree(passCount, 0);
+
+	std::vector<int> lastWriter(m_vecResources.size(), -1);
+	std::vector<std::vector<uint32_t>> readersSinceWrite(m_vecResources.size());
+
+	auto addEdge = [&](int from, uint32_t to)
+	{
+		if (from < 0 || static_cast<uint32_t>(from) == to)
+		{
+			return;
+		}
+		auto& list = edges[from];
+		if (std::find(list.begin(), list.end(), to) == list.end())
+		{
+			list.push_back(to);
+			inDegree[to]++;
+		}
+	};
+
+	for (uint32_t p = 0; p < passCount; ++p)
+	{
+		if (m_vecPasses[p].culled)
+		{
+			continue;
+		}
+
+		for (const auto& access : m_vecPasses[p].accesses)
+		{
+			addEdge(lastWriter[access.resource], p);
+			if (access.write)
+			{
+				for (const uint32_t reader : readersSinceWrite[access.resource])
+				{
+					addEdge(static_cast<int>(reader), p);
+				}
+			}
+		}
+
+		// Update after all accesses, so a pass that reads and writes the same resource doesn't depend on itself
+		for (const auto& access : m_vecPasses[p].accesses)
+		{
+			if (access.write)
+			{
+				lastWriter[access.resource] = static_cast<int>(p);
+				readersSinceWrite[access.resource].clear();
+			}
+			else
+			{
+				readersSinceWrite[access.resource].push_back(p);
+			}
+		}
+	}
+
+	// Kahn's algorithm, min-heap on declaration index keeps the order stable and predictable
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+	for (uint32_t p = 0; p < passCount; ++p)
+	{
+		if (!m_vecPasses[p].culled && inDegree[p] == 0)
+		{
+			ready.push(p);
+		}
+	}
+
+	m_vecExecutionOrder.clear();
+	while (!ready.empty())
+	{
+		const uint32_t p = ready.top();
+		ready.pop();
+		m_vecExecutionOrder.push_back(p);
+
+		for (const uint32_t next : edges[p])
+		{
+			if (--inDegree[next] == 0)
+			{
+				ready.push(next);
+			}
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (auto& resource : m_vecResources)
+	{
+		resource.firstUse = -1;
+		resource.lastUse = -1;
+		resource.usage = resource.desc.extraUsage;
+	}
+
+	for (size_t order = 0; order < m_vecExecutionOrder.size(); ++order)
+	{
+		for (const auto& access : m_vecPasses[m_vecExecutionOrder[order]].accesses)
+		{
+			Resource& resource = m_vecResources[access.resource];
+			if (resource.firstUse < 0)
+			{
+				resource.firstUse = static_cast<int>(order);
+			}
+			resource.lastUse = static_cast<int>(order);
+			resource.usage |= GetUsageFlags(access.usage);
+		}
+	}
+}
+
+void RenderGraph::CreateTransientImages()
+{
+	for (auto& resource : m_vecResources)
+	{
+		// Imported images belong to someone else, unused images are never created
+		if (resource.imported || resource.firstUse < 0)
+		{
+			continue;
+		}
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = resource.desc.format;
+		imageCreateInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = resource.desc.samples;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = resource.usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		const VkResult result = vkCreateImage(m_device, &imageCreateInfo, nullptr, &resource.image);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Render Graph image: " + resource.name);
+		}
+
+		vkGetImageMemoryRequirements(m_device, resource.image, &resource.memoryRequirements);
+	}
+}
+
+// Greedy interval packing: biggest images first, each goes in to the first block whose occupants
+// are all dead before it starts (or born after it ends). Every occupant sits at offset 0 of its block
+void RenderGraph::AliasTransientImages()
+{
+	std::vector<RenderGraphResource> transients;
+	for (RenderGraphResource i = 0; i < m_vecResources.size(); ++i)
+	{
+		if (!m_vecResources[i].imported && m_vecResources[i].image != VK_NULL_HANDLE)
+		{
+			transients.push_back(i);
+		}
+	}
+
+	std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+	{
+		return m_vecResources[a].memoryRequirements.size > m_vecResources[b].memoryRequirements.size;
+	});
+
+	for (const RenderGraphResource index : transients)
+	{
+		Resource& resource = m_vecResources[index];
+
+		int chosenBlock = -1;
+		for (size_t b = 0; b < m_vecMemoryBlocks.size() && chosenBlock < 0; ++b)
+		{
+			const MemoryBlock& block = m_vecMemoryBlocks[b];
+
+			// Must still have a common device local memory type once this image joins
+			const uint32_t commonTypes = block.memoryTypeBits & resource.memoryRequirements.memoryTypeBits;
+			if (FindMemoryTypeIndex(m_physicalDevice, commonTypes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == UINT32_MAX)
+			{
+				continue;
+			}
+
+			bool overlaps = false;
+			for (const RenderGraphResource occupant : block.occupants)
+			{
+				const Resource& other = m_vecResources[occupant];
+				if (!(other.lastUse < resource.firstUse || resource.lastUse < other.firstUse))
+				{
+					overlaps = true;
+					break;
+				}
+			}
+
+			if (!overlaps)
+			{
+				chosenBlock = static_cast<int>(b);
+			}
+		}
+
+		if (chosenBlock < 0)
+		{
+			m_vecMemoryBlocks.emplace_back();
+			chosenBlock = static_cast<int>(m_vecMemoryBlocks.size() - 1);
+		}
+
+		MemoryBlock& block = m_vecMemoryBlocks[chosenBlock];
+		block.memoryTypeBits &= resource.memoryRequirements.memoryTypeBits;
+		block.size = std::max(block.size, resource.memoryRequirements.size);
+		block.occupants.push_back(index);
+		resource.memoryBlock = chosenBlock;
+	}
+
+	// Allocate blocks and bind every occupant at offset 0
+	for (auto& block : m_vecMemoryBlocks)
+	{
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = block.size;
+		memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+		{
+			throw std::runtime_error("Failed to find memory type for Render Graph images");
+		}
+
+		VkResult result = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &block.memory);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Render Graph image memory");
+		}
+
+		for (const RenderGraphResource occupant : block.occupants)
+		{
+			Resource& resource = m_vecResources[occupant];
+			vkBindImageMemory(m_device, resource.image, block.memory, 0);
+
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.image = resource.image;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = resource.desc.format;
+			viewCreateInfo.subresourceRange = { resource.desc.aspect, 0, 1, 0, 1 };
+
+			result = vkCreateImageView(m_device, &viewCreateInfo, nullptr, &resource.imageView);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create Render Graph image view: " + resource.name);
+			}
+		}
+	}
+}
+
+// Simulate the frame once, tracking each image's layout/stage/access, and keep only the barriers that are
+// actually needed: layout changes and hazards involving a write. Read-after-read in the same layout needs nothing,
+// write-after-read in the same layout only needs an execution dependency (no image barrier)
+void RenderGraph::BuildBarriers()
+{
+	std::vector<ResourceState> states(m_vecResources.size());
+	std::vector<bool> touched(m_vecResources.size(), false);
+	for (size_t i = 0; i < m_vecResources.size(); ++i)
+	{
+		states[i].layout = m_vecResources[i].imported ? m_vecResources[i].initialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+	// State each image is left in by its last use, needed before the simulation reaches it (see aliasing below)
+	std::vector<ResourceState> lastUseStates(m_vecResources.size());
+	for (const uint32_t passIndex : m_vecExecutionOrder)
+	{
+		const Pass& pass = m_vecPasses[passIndex];
+		for (const auto& access : pass.accesses)
+		{
+			lastUseStates[access.resource] = GetUsageState(access.usage, pass.type, access.write, m_vecResources[access.resource].desc.aspect);
+		}
+	}
+
+	// Each block's occupant that executes last; the first occupant in the next frame must wait for it
+	std::vector<RenderGraphResource> blockLastOccupant(m_vecMemoryBlocks.size());
+	for (size_t b = 0; b < m_vecMemoryBlocks.size(); ++b)
+	{
+		blockLastOccupant[b] = *std::max_element(m_vecMemoryBlocks[b].occupants.begin(), m_vecMemoryBlocks[b].occupants.end(),
+			[this](RenderGraphResource a, RenderGraphResource c) { return m_vecResources[a].lastUse < m_vecResources[c].lastUse; });
+	}
+	std::vector<int> blockPreviousOccupant(m_vecMemoryBlocks.size(), -1);
+
+	auto addBarrier = [](BarrierBatch& batch, RenderGraphResource resource, VkImageAspectFlags aspect,
+		const ResourceState& from, const ResourceState& to)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = from.write ? from.access : 0;			// Only writes need to be made available
+		barrier.dstAccessMask = to.access;
+		barrier.oldLayout = from.layout;
+		barrier.newLayout = to.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange = { aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+		batch.imageBarriers.push_back(barrier);
+		batch.resources.push_back(resource);
+		batch.srcStages |= from.stages;
+		batch.dstStages |= to.stages;
+	};
+
+	m_vecPassBarriers.assign(m_vecExecutionOrder.size(), BarrierBatch());
+	for (size_t order = 0; order < m_vecExecutionOrder.size(); ++order)
+	{
+		const Pass& pass = m_vecPasses[m_vecExecutionOrder[order]];
+		BarrierBatch& batch = m_vecPassBarriers[order];
+
+		// Merge multiple accesses to the same resource within the pass (e.g depth read + write)
+		std::vector<ResourceAccess> merged;
+		for (const auto& access : pass.accesses)
+		{
+			auto existing = std::find_if(merged.begin(), merged.end(), [&](const ResourceAccess& a) { return a.resource == access.resource; });
+			if (existing == merged.end())
+			{
+				merged.push_back(access);
+			}
+			else if (existing->usage != access.usage)
+			{
+				throw std::runtime_error("Render Graph pass '" + pass.name + "' uses an image with two different usages");
+			}
+			else
+			{
+				existing->write = existing->write || access.write;
+			}
+		}
+
+		for (const auto& access : merged)
+		{
+			const Resource& resource = m_vecResources[access.resource];
+			const ResourceState required = GetUsageState(access.usage, pass.type, access.write, resource.desc.aspect);
+			ResourceState& current = states[access.resource];
+
+			if (!touched[access.resource])
+			{
+				touched[access.resource] = true;
+				m_vecResources[access.resource].firstUseStages = required.stages;
+				ResourceState from = current;
+
+				if (resource.imported)
+				{
+					// Start at the stage of first use so a semaphore waited on at that stage (e.g swapchain acquire) is chained
+					// Images kept in a writable usage between executions (e.g a depth buffer shared by frames in flight)
+					// must also wait for the previous execution's writes
+					const ResourceState finalState = GetFinalState(resource);
+					from.stages = required.stages;
+					if (resource.finalUsage != RenderGraphUsage::Present)
+					{
+						from.stages |= finalState.stages;
+						from.access = finalState.access;
+						from.write = finalState.write;
+					}
+				}
+				else
+				{
+					// Contents of a transient image are never kept between frames (UNDEFINED discards them), but its memory
+					// was last used by another image: the previous occupant this frame, or the block's last occupant
+					// in the previous frame, which may still be in flight on the same queue
+					const int block = resource.memoryBlock;
+					from = blockPreviousOccupant[block] >= 0
+						? states[blockPreviousOccupant[block]]
+						: lastUseStates[blockLastOccupant[block]];
+					from.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+					blockPreviousOccupant[block] = static_cast<int>(access.resource);
+				}
+
+				addBarrier(batch, access.resource, resource.desc.aspect, from, required);
+				current = required;
+				continue;
+			}
+
+			const bool layoutChange = current.layout != required.layout;
+			if (!layoutChange && !current.write && !required.write)
+			{
+				// Read after read: no barrier, but remember the readers for a later write
+				current.stages |= required.stages;
+				current.access |= required.access;
+				continue;
+			}
+
+			if (!layoutChange && !current.write)
+			{
+				// Write after read: execution dependency only
+				batch.srcStages |= current.stages;
+				batch.dstStages |= required.stages;
+			}
+			else
+			{
+				addBarrier(batch, access.resource, resource.desc.aspect, current, required);
+			}
+			current = required;
+		}
+	}
+
+	// Transition imported images to their final usage (e.g present)
+	m_finalBarriers = BarrierBatch();
+	for (RenderGraphResource i = 0; i < m_vecResources.size(); ++i)
+	{
+		const Resource& resource = m_vecResources[i];
+		if (!resource.hasFinalUsage || !touched[i])
+		{
+			continue;
+		}
+
+		const ResourceState required = GetFinalState(resource);
+		if (states[i].layout != required.layout || (states[i].write && !required.write))
+		{
+			addBarrier(m_finalBarriers, i, resource.desc.aspect, states[i], required);
+		}
+	}
+}
+
+RenderGraph::ResourceState RenderGraph::GetUsageState(RenderGraphUsage usage, RenderGraphPassType type, bool write, VkImageAspectFlags aspect)
+{
+	const VkPipelineStageFlags shaderStage = type == RenderGraphPassType::Compute
+		? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		: VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	ResourceState state;
+	state.write = write;
+
+	switch (usage)
+	{
+	case RenderGraphUsage::ColorAttachment:
+		state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		state.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		state.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0);
+		break;
+	case RenderGraphUsage::DepthAttachment:
+		state.layout = write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		state.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		state.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+		break;
+	case RenderGraphUsage::Sampled:
+		state.layout = (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		state.stages = shaderStage;
+		state.access = VK_ACCESS_SHADER_READ_BIT;
+		break;
+	case RenderGraphUsage::Storage:
+		state.layout = VK_IMAGE_LAYOUT_GENERAL;
+		state.stages = shaderStage;
+		state.access = VK_ACCESS_SHADER_READ_BIT | (write ? VK_ACCESS_SHADER_WRITE_BIT : 0);
+		break;
+	case RenderGraphUsage::TransferSrc:
+		state.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		state.access = VK_ACCESS_TRANSFER_READ_BIT;
+		break;
+	case RenderGraphUsage::TransferDst:
+		state.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		state.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		state.write = true;
+		break;
+	case RenderGraphUsage::Present:
+		state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		state.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;		// Presentation engine syncs through the render finished semaphore
+		state.access = 0;
+		break;
+	}
+
+	return state;
+}
+
+RenderGraph::ResourceState RenderGraph::GetFinalState(const Resource& resource)
+{
+	// Attachments and storage images left in their usage between executions stay in the writable layout
+	const bool write = resource.finalUsage == RenderGraphUsage::ColorAttachment
+		|| resource.finalUsage == RenderGraphUsage::DepthAttachment
+		|| resource.finalUsage == RenderGraphUsage::Storage;
+
+	return GetUsageState(resource.finalUsage, RenderGraphPassType::Graphics, write, resource.desc.aspect);
+}
+
+VkImageUsageFlags RenderGraph::GetUsageFlags(RenderGraphUsage usage)
+{
+	switch (usage)
+	{
+	case RenderGraphUsage::ColorAttachment:	return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case RenderGraphUsage::DepthAttachment:	return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case RenderGraphUsage::Sampled:			return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case RenderGraphUsage::Storage:			return VK_IMAGE_USAGE_STORAGE_BIT;
+	case RenderGraphUsage::TransferSrc:		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case RenderGraphUsage::TransferDst:		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	case RenderGraphUsage::Present:			return 0;
+	}
+	return 0;
+}
+
+void RenderGraph::RecordBatch(VkCommandBuffer commandBuffer, const BarrierBatch& batch, const std::vector<Resource>& resources,
+	LinearArena* scratchArena)
+{
+	if (batch.imageBarriers.empty() && batch.srcStages == 0)
+	{
+		return;
+	}
+
+	// Images are patched in here so imported images can change between executions
+	ArenaVector<VkImageMemoryBarrier> imageBarriers(batch.imageBarriers.begin(), batch.imageBarriers.end(),
+		ArenaAllocator<VkImageMemoryBarrier>(scratchArena));
+	for (size_t i = 0; i < imageBarriers.size(); ++i)
+	{
+		imageBarriers[i].image = resources[batch.resources[i]].image;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer,
+		batch.srcStages ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		batch.dstStages ? batch.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
@@ -0,0 +1,70 @@
+#include "ShaderVariants.h"
+#include <cstddef>
+
+
+void ShaderVariantRegistry::RegisterPermutation(uint32_t permutation, std::vector<char> vertexCode, std::vector<char> fragmentCode)
+{
+	permutation &= SHADER_FEATURES_PERMUTATION;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Permutation& entry = m_mapPermutations[permutation];
+	entry.vertexCode = std::move(vertexCode);
+	entry.fragmentCode = std::move(fragmentCode);
+}
+
+bool ShaderVariantRegistry::HasPermutation(uint32_t features) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_mapPermutations.count(features & SHADER_FEATURES_PERMUTATION) > 0;
+}
+
+const ShaderVariant& ShaderVariantRegistry::GetVariant(uint32_t features)
+{
+	features &= SHADER_FEATURES_SPECIALIZED | SHADER_FEATURES_PERMUTATION;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto existing = m_mapVariants.find(features);
+	if (existing != m_mapVariants.end())
+	{
+		return existing->second.variant;
+	}
+
+	const auto permutation = m_mapPermutations.find(features & SHADER_FEATURES_PERMUTATION);
+	if (permutation == m_mapPermutations.end())
+	{
+		throw std::runtime_error("No SPIR-V registered for the requested shader permutation");
+	}
+
+	VariantEntry& entry = m_mapVariants[features];
+	entry.data.vertexColor = (features & SHADER_FEATURE_VERTEX_COLOR) ? VK_TRUE : VK_FALSE;
+	entry.data.debugView = static_cast<int32_t>((features & SHADER_FEATURE_DEBUG_DEPTH) ? ShaderDebugView::Depth : ShaderDebugView::None);
+
+	entry.mapEntries[0].constantID = 0;
+	entry.mapEntries[0].offset = offsetof(SpecializationData, vertexColor);
+	entry.mapEntries[0].size = sizeof(VkBool32);
+	entry.mapEntries[1].constantID = 1;
+	entry.mapEntries[1].offset = offsetof(SpecializationData, debugView);
+	entry.mapEntries[1].size = sizeof(int32_t);
+
+	entry.variant.features = features;
+	entry.variant.pVertexCode = &permutation->second.vertexCode;
+	entry.variant.pFragmentCode = &permutation->second.fragmentCode;
+	entry.variant.specializationInfo.mapEntryCount = static_cast<uint32_t>(entry.mapEntries.size());
+	entry.variant.specializationInfo.pMapEntries = entry.mapEntries.data();
+	entry.variant.specializationInfo.dataSize = sizeof(SpecializationData);
+	entry.variant.specializationInfo.pData = &entry.data;
+	return entry.variant;
+}
+
+size_t ShaderVariantRegistry::GetVariantCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_mapVariants.size();
+}
+
+void ShaderVariantRegistry::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mapVariants.clear();
+	m_mapPermutations.clear();
+}
@@ -0,0 +1,568 @@
+#include "UploadService.h"
+#include <chrono>
+#include <cstring>
+#include "QueueSync.h"
+
+
+void UploadService::InitUploadService(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, const QueueFamilyIndices& queueFamilyIndices,
+	VkQueue newTransferQueue, MemoryBudget* memoryBudget, VkDeviceSize stagingSize)
+{
+	m_physicalDevice = newPhysicalDevice;
+	m_device = newDevice;
+	m_transferQueue = newTransferQueue;
+	m_pMemoryBudget = memoryBudget;
+	m_uiGraphicsFamily = static_cast<uint32_t>(queueFamilyIndices.graphicsFamily);
+	m_uiTransferFamily = static_cast<uint32_t>(queueFamilyIndices.transferFamily >= 0 ? queueFamilyIndices.transferFamily : queueFamilyIndices.graphicsFamily);
+	m_bOwnershipTransfer = m_uiTransferFamily != m_uiGraphicsFamily;
+	m_bWorkerSubmits = queueFamilyIndices.HasDedicatedTransfer();
+
+	// Command buffers are recorded once and freed when their batch completes
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = m_uiTransferFamily;
+
+	VkResult result = vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_transferCommandPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create an Upload Command Pool");
+	}
+
+	if (m_bOwnershipTransfer)
+	{
+		poolInfo.queueFamilyIndex = m_uiGraphicsFamily;
+		result = vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_acquireCommandPool);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create an Upload Acquire Command Pool");
+		}
+	}
+
+	m_transferTimeline.CreateTimeline(m_device);
+	m_acquireTimeline.CreateTimeline(m_device);
+
+	// Staging ring stays mapped for the lifetime of the service
+	m_stagingSize = stagingSize;
+	m_stagingHead = 0;
+	m_stagingUsed = 0;
+	CreateHostBuffer(m_stagingSize, m_stagingBuffer, m_stagingMemory);
+
+	void* data;
+	result = vkMapMemory(m_device, m_stagingMemory, 0, m_stagingSize, 0, &data);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to map Upload Staging Buffer");
+	}
+	m_pStagingData = static_cast<char*>(data);
+
+	m_bStopping = false;
+	m_worker = std::thread(&UploadService::WorkerLoop, this);
+}
+
+void UploadService::ShutdownUploadService()
+{
+	StopWorker();
+
+	// Worker may have submitted right up to the join. Render thread only, so waiting on every queue is safe
+	vkDeviceWaitIdle(m_device);
+
+	// Anything still queued or never handed to the GPU is dropped, its future reports a broken promise
+	m_dequeRequests.clear();
+	m_dequeInFlight.clear();
+	m_vecPendingSubmits.clear();
+
+	vkUnmapMemory(m_device, m_stagingMemory);
+	FreeHostBuffer(m_stagingBuffer, m_stagingMemory);
+	m_acquireTimeline.DestroyTimeline();
+	m_transferTimeline.DestroyTimeline();
+	if (m_bOwnershipTransfer)
+	{
+		vkDestroyCommandPool(m_device, m_acquireCommandPool, nullptr);
+	}
+	vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
+}
+
+UploadFuture UploadService::EnqueueBufferUpload(VkBuffer dstBuffer, VkDeviceSize dstOffset, std::vector<char> data,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, bool concurrent)
+{
+	if (data.empty())
+	{
+		throw std::runtime_error("Upload request has no data");
+	}
+
+	UploadRequest request;
+	request.dstBuffer = dstBuffer;
+	request.dstOffset = dstOffset;
+	request.dstStage = dstStage;
+	request.dstAccess = dstAccess;
+	request.concurrent = concurrent;
+	request.data = std::move(data);
+	UploadFuture future = request.promise.get_future().share();
+
+	{
+		std::lock_guard<std::mutex> lock(m_requestMutex);
+		m_dequeRequests.push_back(std::move(request));
+	}
+	m_requestCondition.notify_one();
+
+	return future;
+}
+
+UploadFuture UploadService::EnqueueImageUpload(VkImage dstImage, VkExtent3D extent, VkImageAspectFlags aspect, std::vector<char> data,
+	VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	if (data.empty())
+	{
+		throw std::runtime_error("Upload request has no data");
+	}
+
+	UploadRequest request;
+	request.dstImage = dstImage;
+	request.extent = extent;
+	request.aspect = aspect;
+	request.finalLayout = finalLayout;
+	request.dstStage = dstStage;
+	request.dstAccess = dstAccess;
+	request.data = std::move(data);
+	UploadFuture future = request.promise.get_future().share();
+
+	{
+		std::lock_guard<std::mutex> lock(m_requestMutex);
+		m_dequeRequests.push_back(std::move(request));
+	}
+	m_requestCondition.notify_one();
+
+	return future;
+}
+
+void UploadService::SubmitPending(VkQueue graphicsQueue)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_submitMutex);
+		m_vecSubmitting.swap(m_vecPendingSubmits);
+	}
+
+	// Batches are handed over in value order, so the timelines are signalled in order too
+	for (const auto& pending : m_vecSubmitting)
+	{
+		if (pending.transferCommandBuffer != VK_NULL_HANDLE)
+		{
+			SubmitCommands(m_transferQueue, pending.transferCommandBuffer, VK_NULL_HANDLE, 0,
+				m_transferTimeline.GetSemaphore(), pending.value);
+		}
+		if (pending.acquireCommandBuffer != VK_NULL_HANDLE)
+		{
+			SubmitCommands(graphicsQueue, pending.acquireCommandBuffer, m_transferTimeline.GetSemaphore(), pending.value,
+				m_acquireTimeline.GetSemaphore(), pending.value);
+		}
+	}
+	m_vecSubmitting.clear();
+}
+
+UploadService::~UploadService()
+{
+	StopWorker();
+}
+
+void UploadService::StopWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_requestMutex);
+		m_bStopping = true;
+	}
+	m_requestCondition.notify_one();
+	if (m_worker.joinable())
+	{
+		m_worker.join();
+	}
+}
+
+void UploadService::WorkerLoop()
+{
+	std::deque<UploadRequest> requests;
+	bool stalled = false;
+
+	std::unique_lock<std::mutex> lock(m_requestMutex);
+	while (!m_bStopping)
+	{
+		// Sleep until there is work. While batches are in flight wake up regularly to retire them,
+		// and if the staging ring was full don't spin on the requests that didn't fit
+		const auto hasWork = [this, stalled] { return m_bStopping || (!stalled && !m_dequeRequests.empty()); };
+		if (m_dequeInFlight.empty())
+		{
+			m_requestCondition.wait(lock, hasWork);
+		}
+		else
+		{
+			m_requestCondition.wait_for(lock, std::chrono::milliseconds(1), hasWork);
+		}
+		if (m_bStopping)
+		{
+			break;
+		}
+
+		requests.swap(m_dequeRequests);
+		lock.unlock();
+
+		RetireCompletedBatches();
+		if (!requests.empty())
+		{
+			RecordBatch(requests);
+		}
+		stalled = !requests.empty();
+
+		lock.lock();
+		// Whatever didn't fit goes back to the front so uploads stay in order
+		while (!requests.empty())
+		{
+			m_dequeRequests.push_front(std::move(requests.back()));
+			requests.pop_back();
+		}
+	}
+}
+
+void UploadService::RecordBatch(std::deque<UploadRequest>& requests)
+{
+	UploadBatch batch;
+	batch.transferCommandBuffer = BeginOneTimeCommands(m_transferCommandPool);
+	if (m_bOwnershipTransfer)
+	{
+		batch.acquireCommandBuffer = BeginOneTimeCommands(m_acquireCommandPool);
+	}
+
+	while (!requests.empty())
+	{
+		UploadRequest& request = requests.front();
+		const VkDeviceSize size = request.data.size();
+
+		VkBuffer stagingBuffer = m_stagingBuffer;
+		VkDeviceSize stagingOffset = 0;
+		if (size > m_stagingSize)
+		{
+			// Would never fit in the ring, give it a staging buffer of its own (at most one per batch)
+			if (batch.oversizeStagingBuffer != VK_NULL_HANDLE)
+			{
+				break;
+			}
+			CreateHostBuffer(size, batch.oversizeStagingBuffer, batch.oversizeStagingMemory);
+
+			void* data;
+			const VkResult result = vkMapMemory(m_device, batch.oversizeStagingMemory, 0, size, 0, &data);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to map Upload Staging Buffer");
+			}
+			memcpy(data, request.data.data(), size);
+			vkUnmapMemory(m_device, batch.oversizeStagingMemory);
+			stagingBuffer = batch.oversizeStagingBuffer;
+		}
+		else if (AllocateStaging(size, stagingOffset, batch.stagingConsumed))
+		{
+			memcpy(m_pStagingData + stagingOffset, request.data.data(), size);
+		}
+		else
+		{
+			// Ring is full until older batches retire
+			break;
+		}
+
+		RecordRequest(request, batch.transferCommandBuffer, batch.acquireCommandBuffer, stagingBuffer, stagingOffset);
+		batch.promises.push_back(std::move(request.promise));
+		requests.pop_front();
+	}
+
+	if (batch.promises.empty())
+	{
+		vkFreeCommandBuffers(m_device, m_transferCommandPool, 1, &batch.transferCommandBuffer);
+		if (m_bOwnershipTransfer)
+		{
+			vkFreeCommandBuffers(m_device, m_acquireCommandPool, 1, &batch.acquireCommandBuffer);
+		}
+		return;
+	}
+
+	VkResult result = vkEndCommandBuffer(batch.transferCommandBuffer);
+	if (result == VK_SUCCESS && m_bOwnershipTransfer)
+	{
+		result = vkEndCommandBuffer(batch.acquireCommandBuffer);
+	}
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to stop recording an Upload Command Buffer");
+	}
+
+	batch.value = m_transferTimeline.AdvanceValue();
+	if (m_bOwnershipTransfer)
+	{
+		m_acquireTimeline.AdvanceValue();
+	}
+
+	if (m_bWorkerSubmits)
+	{
+		SubmitCommands(m_transferQueue, batch.transferCommandBuffer, VK_NULL_HANDLE, 0, m_transferTimeline.GetSemaphore(), batch.value);
+	}
+	if (!m_bWorkerSubmits || m_bOwnershipTransfer)
+	{
+		std::lock_guard<std::mutex> lock(m_submitMutex);
+		m_vecPendingSubmits.push_back({ batch.value, m_bWorkerSubmits ? VK_NULL_HANDLE : batch.transferCommandBuffer, batch.acquireCommandBuffer });
+	}
+
+	m_dequeInFlight.push_back(std::move(batch));
+}
+
+void UploadService::RetireCompletedBatches()
+{
+	// Batches complete in value order, so the staging ring is freed in the order it was allocated
+	while (!m_dequeInFlight.empty() && IsBatchComplete(m_dequeInFlight.front().value))
+	{
+		UploadBatch& batch = m_dequeInFlight.front();
+
+		vkFreeCommandBuffers(m_device, m_transferCommandPool, 1, &batch.transferCommandBuffer);
+		if (m_bOwnershipTransfer)
+		{
+			vkFreeCommandBuffers(m_device, m_acquireCommandPool, 1, &batch.acquireCommandBuffer);
+		}
+		if (batch.oversizeStagingBuffer != VK_NULL_HANDLE)
+		{
+			FreeHostBuffer(batch.oversizeStagingBuffer, batch.oversizeStagingMemory);
+		}
+		m_stagingUsed -= batch.stagingConsumed;
+
+		for (auto& promise : batch.promises)
+		{
+			promise.set_value();
+		}
+
+		m_dequeInFlight.pop_front();
+	}
+}
+
+bool UploadService::AllocateStaging(VkDeviceSize size, VkDeviceSize& outOffset, VkDeviceSize& inOutConsumed)
+{
+	// Keeps buffer offsets valid for vkCmdCopyBufferToImage with the common (power of two sized) formats
+	constexpr VkDeviceSize alignment = 16;
+
+	if (m_stagingUsed == 0)
+	{
+		m_stagingHead = 0;
+	}
+
+	VkDeviceSize offset = (m_stagingHead + alignment - 1) & ~(alignment - 1);
+	VkDeviceSize consumed = offset - m_stagingHead + size;
+	if (offset + size > m_stagingSize)
+	{
+		// Wrap around, the unused tail of the ring is freed together with this allocation
+		offset = 0;
+		consumed = m_stagingSize - m_stagingHead + size;
+	}
+
+	if (m_stagingUsed + consumed > m_stagingSize)
+	{
+		return false;
+	}
+
+	m_stagingHead = offset + size;
+	m_stagingUsed += consumed;
+	inOutConsumed += consumed;
+	outOffset = offset;
+	return true;
+}
+
+void UploadService::RecordRequest(const UploadRequest& request, VkCommandBuffer transferCommandBuffer, VkCommandBuffer acquireCommandBuffer,
+	VkBuffer stagingBuffer, VkDeviceSize stagingOffset) const
+{
+	if (request.dstBuffer != VK_NULL_HANDLE)
+	{
+		VkBufferCopy copyRegion = {};
+		copyRegion.srcOffset = stagingOffset;
+		copyRegion.dstOffset = request.dstOffset;
+		copyRegion.size = request.data.size();
+		vkCmdCopyBuffer(transferCommandBuffer, stagingBuffer, request.dstBuffer, 1, &copyRegion);
+
+		// A concurrent buffer has no owner to hand over. The acquire submission still waits for the copy at every stage,
+		// which makes it visible to everything the graphics queue runs afterwards
+		if (m_bOwnershipTransfer)
+		{
+			if (request.concurrent)
+			{
+				return;
+			}
+
+			RecordBufferRelease(transferCommandBuffer, request.dstBuffer, m_uiTransferFamily, m_uiGraphicsFamily,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+			RecordBufferAcquire(acquireCommandBuffer, request.dstBuffer, m_uiTransferFamily, m_uiGraphicsFamily,
+				request.dstStage, request.dstAccess);
+		}
+		else
+		{
+			// Same queue as the graphics work, a normal barrier covers everything submitted afterwards
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = request.dstAccess;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = request.dstBuffer;
+			barrier.offset = request.dstOffset;
+			barrier.size = request.data.size();
+
+			vkCmdPipelineBarrier(transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, request.dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		}
+		return;
+	}
+
+	// Image: discard old contents, copy, then move to the layout the graphics queue expects
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = request.dstImage;
+	barrier.subresourceRange = { request.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+	vkCmdPipelineBarrier(transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = stagingOffset;
+	copyRegion.bufferRowLength = 0;									// Tightly packed
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource = { request.aspect, 0, 0, 1 };		// Mip 0, layer 0
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = request.extent;
+	vkCmdCopyBufferToImage(transferCommandBuffer, stagingBuffer, request.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	if (m_bOwnershipTransfer)
+	{
+		RecordImageRelease(transferCommandBuffer, request.dstImage, request.aspect, m_uiTransferFamily, m_uiGraphicsFamily,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, request.finalLayout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		RecordImageAcquire(acquireCommandBuffer, request.dstImage, request.aspect, m_uiTransferFamily, m_uiGraphicsFamily,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, request.finalLayout, request.dstStage, request.dstAccess);
+	}
+	else
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = request.dstAccess;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = request.finalLayout;
+
+		vkCmdPipelineBarrier(transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, request.dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+void UploadService::CreateHostBuffer(VkDeviceSize size, VkBuffer& outBuffer, VkDeviceMemory& outMemory) const
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &outBuffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create an Upload Staging Buffer");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_device, outBuffer, &memRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type index");
+	}
+
+	result = m_pMemoryBudget != nullptr ? m_pMemoryBudget->Allocate(memoryAllocateInfo, MemoryCategory::Staging, &outMemory)
+		: vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &outMemory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Upload Staging Buffer Memory");
+	}
+
+	vkBindBufferMemory(m_device, outBuffer, outMemory, 0);
+}
+
+void UploadService::FreeHostBuffer(VkBuffer buffer, VkDeviceMemory memory) const
+{
+	vkDestroyBuffer(m_device, buffer, nullptr);
+	if (m_pMemoryBudget != nullptr)
+	{
+		m_pMemoryBudget->Free(memory);
+	}
+	else
+	{
+		vkFreeMemory(m_device, memory, nullptr);
+	}
+}
+
+VkCommandBuffer UploadService::BeginOneTimeCommands(VkCommandPool commandPool) const
+{
+	VkCommandBufferAllocateInfo cbAllocInfo = {};
+	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cbAllocInfo.commandPool = commandPool;
+	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cbAllocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	VkResult result = vkAllocateCommandBuffers(m_device, &cbAllocInfo, &commandBuffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate an Upload Command Buffer");
+	}
+
+	VkCommandBufferBeginInfo bufferBeginInfo = {};
+	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to start recording an Upload Command Buffer");
+	}
+
+	return commandBuffer;
+}
+
+void UploadService::SubmitCommands(VkQueue queue, VkCommandBuffer commandBuffer, VkSemaphore waitSemaphore, uint64_t waitValue,
+	VkSemaphore signalSemaphore, uint64_t signalValue)
+{
+	// Ownership acquire barriers carry their own stage masks, so the wait can cover every stage
+	constexpr VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.waitSemaphoreValueCount = waitSemaphore != VK_NULL_HANDLE ? 1 : 0;
+	timelineSubmitInfo.pWaitSemaphoreValues = &waitValue;
+	timelineSubmitInfo.signalSemaphoreValueCount = 1;
+	timelineSubmitInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineSubmitInfo;
+	submitInfo.waitSemaphoreCount = timelineSubmitInfo.waitSemaphoreValueCount;
+	submitInfo.pWaitSemaphores = &waitSemaphore;
+	submitInfo.pWaitDstStageMask = &waitStage;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &signalSemaphore;
+
+	const VkResult result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to submit Upload Command Buffer");
+	}
+}
+
+bool UploadService::IsBatchComplete(uint64_t value)
+{
+	// With an ownership transfer the batch is only usable once the graphics queue has acquired it
+	return m_bOwnershipTransfer ? m_acquireTimeline.IsComplete(value) : m_transferTimeline.IsComplete(value);
+}
@@ -1,5 +1,10 @@
 #include "VulkanRenderer.h"
 #include <Validation.hpp>
+#include <cctype>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include "JobSystem.h"
 
 
 VkResult g_CreateDebugUtilsMessengerExt(	
@@ -38,104 +43,571 @@ VulkanRenderer::VulkanRenderer()
 	  , m_debugMessenger()
 	  , m_graphicsQueue(nullptr)
 	  , m_presentationQueue()
+	  , m_computeQueue()
+	  , m_transferQueue()
 	  , m_surface()
 	  , m_swapchain(nullptr)
 	  , m_graphicsPipeline(nullptr)
 	  , m_pipelineLayout(nullptr)
 	  , m_renderPass(nullptr)
 	  , m_graphicsCommandPool()
+	  , m_computeCommandPool()
 	  , m_swapChainImageFormat(VK_FORMAT_UNDEFINED)
 	  , m_swapChainExtent()
+	  , m_depthFormat(VK_FORMAT_UNDEFINED)
 {
 }
 
+void VulkanRenderer::SetRequestedMsaaSamples(VkSampleCountFlagBits samples)
+{
+	m_requestedMsaaSamples = samples;
+}
+
+void VulkanRenderer::SetDeviceOverride(const std::string& nameOrUuid)
+{
+	m_strDeviceOverride = nameOrUuid;
+}
+
+void VulkanRenderer::SetSceneGeometry(std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+{
+	m_vecSceneVertices = std::move(vertices);
+	m_vecSceneIndices = std::move(indices);
+}
+
+void VulkanRenderer::SetHeadless(VkExtent2D extent)
+{
+	m_bHeadless = true;
+	m_headlessExtent = extent;
+}
+
+bool VulkanRenderer::IsHeadlessSupported()
+{
+	const std::vector<const char*> headlessExtensions = { VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME };
+	return CheckInstanceExtensionSupport(&headlessExtensions);
+}
+
 int VulkanRenderer::Init(GLFWwindow* newWindow)
 {
 	m_pWindow = newWindow;
+	m_startupBegin = std::chrono::steady_clock::now();
+	m_vecStartupPhases.clear();
+
+	// Startup task graph: the device chain (instance -> surface -> physical device -> device) and the swapchain chain
+	// run on this thread, everything that doesn't need them runs on startup workers at the same time:
+	//   shader reads       no dependencies, start straight away
+	//   mesh + upload      after the device (CPU optimization/simplification overlaps swapchain creation)
+	//   command pool       after the device
+	//   pipeline           after the shader reads and the render pass (or attachment formats)
+	//   occlusion culler   after the shader reads and the depth buffer
+	// Without PARALLEL_STARTUP the same tasks run inline in this order
+	JobSystem startupJobs;
+	if (PARALLEL_STARTUP)
+	{
+		startupJobs.InitJobSystem();
+	}
+	JobCounter shaderReadCounter;
+	JobCounter commandPoolCounter;
+	JobCounter startupCounter;		// Every other startup task
+
+	std::vector<char> depthReduceShaderCode;
+	std::vector<char> occlusionCullShaderCode;
+	std::vector<char> particleSimulationShaderCode;
+	std::vector<char> particleVertexShaderCode;
+	std::vector<char> particleFragmentShaderCode;
+	std::vector<char> postProcessShaderCode;
+
+	std::exception_ptr startupError;
+	std::mutex errorMutex;
+	auto runTask = [this, &startupJobs, &startupError, &errorMutex](const char* name, std::function<void()> task, JobCounter* counter, JobCounter* dependency)
+	{
+		// Errors are kept for the main thread, a throwing job would otherwise take the whole process down
+		auto guardedTask = [this, name, task = std::move(task), &startupError, &errorMutex]
+		{
+			try
+			{
+				TimeStartupPhase(name, task);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!startupError)
+				{
+					startupError = std::current_exception();
+				}
+			}
+		};
+
+		if (PARALLEL_STARTUP)
+		{
+			startupJobs.Run(std::move(guardedTask), counter, dependency);
+		}
+		else
+		{
+			guardedTask();
+		}
+	};
+
 	try
 	{
-		CreateInstance();
-		SetupDebugMessenger();
-		CreateSurface();
-		GetPhysicalDevice();
-		CreateLogicalDevice();
+		runTask("Read shaders", [this, &depthReduceShaderCode, &occlusionCullShaderCode, &particleSimulationShaderCode,
+			&particleVertexShaderCode, &particleFragmentShaderCode, &postProcessShaderCode]
+		{
+			// Base permutation, every specialized scene variant is derived from it
+			m_shaderVariants.RegisterPermutation(0, ReadFile("Shaders/vert.spv"), ReadFile("Shaders/frag.spv"));
+			if (OCCLUSION_CULLING)
+			{
+				depthReduceShaderCode = ReadFile("Shaders/depth_reduce.spv");
+				occlusionCullShaderCode = ReadFile("Shaders/occlusion_cull.spv");
+			}
+			if (GPU_PARTICLES)
+			{
+				particleSimulationShaderCode = ReadFile("Shaders/particle_sim.spv");
+				particleVertexShaderCode = ReadFile("Shaders/particle_vert.spv");
+				particleFragmentShaderCode = ReadFile("Shaders/particle_frag.spv");
+			}
+			if (POST_PROCESSING)
+			{
+				postProcessShaderCode = ReadFile("Shaders/post_process.spv");
+			}
+		}, &shaderReadCounter, nullptr);
 
-		// Create a mesh
-		std::vector<Vertex> meshVertices = {
-			{{0.4, -0.4, 0.0}, {1.0, 0.0, 0.0}},
-			{{0.4, 0.4, 0.0}, {0.0, 1.0, 0.0}},
-			{{-0.4, 0.4, 0.0}, {0.0, 0.0, 1.0}},
+		TimeStartupPhase("Instance", [this]
+		{
+			if (enableValidationLayers)
+			{
+				m_debugMessageSink.StartDebugMessageSink();
+			}
+			CreateInstance();
+			SetupDebugMessenger();
+			CreateSurface();
+		});
+		TimeStartupPhase("Device", [this]
+		{
+			GetPhysicalDevice();
+			CreateLogicalDevice();
+			m_memoryBudget.InitMemoryBudget(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, m_bMemoryBudgetExtension, &m_frameTimeline);
+			m_deletionQueue.InitDeletionQueue(&m_frameTimeline);
+			m_uploadService.InitUploadService(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, m_queueFamilyIndices, m_transferQueue, &m_memoryBudget);
+			m_geometryPool.InitGeometryPool(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, m_queueFamilyIndices, &m_memoryBudget,
+				&m_deletionQueue, GEOMETRY_POOL_VERTEX_CAPACITY, GEOMETRY_POOL_INDEX_CAPACITY);
+		});
+
+		// Create a mesh (uploaded in the background in to the geometry pool, drawn once it has arrived)
+		runTask("Mesh", [this]
+		{
+			if (m_vecSceneVertices.empty())
+			{
+				m_vecSceneVertices = {
+					{{0.4, -0.4, 0.0}, {1.0, 0.0, 0.0}},
+					{{0.4, 0.4, 0.0}, {0.0, 1.0, 0.0}},
+					{{-0.4, 0.4, 0.0}, {0.0, 0.0, 1.0}},
+					{{-0.4, -0.4, 0.0}, {1.0, 1.0, 0.0}},
+				};
+				m_vecSceneIndices = {
+					0, 1, 2,
+					2, 3, 0
+				};
+			}
 
-			{{-0.4, 0.4, 0.0}, {0.0, 0.0, 1.0}},
-			{{-0.4, -0.4, 0.0}, {1.0, 1.0, 0.0}},
-			{{0.4, -0.4, 0.0}, {1.0, 0.0, 0.0}},
+			m_firstMesh = Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &m_vecSceneVertices, &m_vecSceneIndices, m_geometryPool,
+				m_uploadService, &m_deletionQueue, MESH_LOD_COUNT);
+		}, &startupCounter, nullptr);
 
-		};
+		runTask("Command pool", [this] { CreateCommandPool(); }, &commandPoolCounter, nullptr);
+
+		TimeStartupPhase("Swapchain", [this]
+		{
+			CreateSwapChain();
+			if (m_bFrameCaptureSupported)
+			{
+				m_frameCapture.InitFrameCapture(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &m_memoryBudget, &m_frameTimeline,
+					m_swapChainExtent, m_swapChainImageFormat, FRAME_CAPTURE_RING_SIZE);
+			}
+		});
+		TimeStartupPhase("Render targets", [this]
+		{
+			CreateColorBufferImage();
+			CreateDepthBufferImage();
+			CreateResolutionController();
+			if (m_bDynamicRendering)
+			{
+				CreateFrameGraph();
+			}
+			else
+			{
+				CreateRenderPass();
+			}
+		});
 
-		m_firstMesh = Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &meshVertices);
+		// Pipeline only needs the render pass (or formats) and the shaders, so it compiles while the rest is created
+		runTask("Graphics pipeline", [this]
+		{
+			m_uiSceneShaderFeatures = SHADER_FEATURE_VERTEX_COLOR | (DEBUG_VIEW_DEPTH ? SHADER_FEATURE_DEBUG_DEPTH : 0);
+			CreateGraphicsPipeline(m_shaderVariants.GetVariant(m_uiSceneShaderFeatures));
+		}, &startupCounter, &shaderReadCounter);
 
-		CreateSwapChain();
-		CreateRenderPass();
-		CreateGraphicsPipeline();
-		CreateFramebuffers();
-		CreateCommandPool();
-		CreateCommandBuffers();
-		RecordCommands();
-		CreateSynchronization();
+		if (m_bOcclusionCulling)
+		{
+			runTask("Occlusion culling", [this, &depthReduceShaderCode, &occlusionCullShaderCode]
+			{
+				// Pyramid is built from the depth buffer itself, or its single sample resolve with MSAA
+				const VkImageView depthView = m_frameGraph.GetImageView(m_msaaSamples != VK_SAMPLE_COUNT_1_BIT ? m_depthResolveResource : m_depthResource);
+				m_occlusionCuller.InitOcclusionCuller(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &m_memoryBudget,
+					OCCLUSION_CULL_MAX_OBJECTS, depthView, m_swapChainExtent, depthReduceShaderCode, occlusionCullShaderCode);
+			}, &startupCounter, &shaderReadCounter);
+		}
+
+		if (m_bParticles)
+		{
+			runTask("Particles", [this, &particleSimulationShaderCode, &particleVertexShaderCode, &particleFragmentShaderCode]
+			{
+				// Drawn in the same pass as the scene, so the pipeline is made for the same attachments
+				ParticleRenderTarget renderTarget;
+				renderTarget.renderPass = m_bDynamicRendering ? VK_NULL_HANDLE : m_renderPass;
+				renderTarget.colorFormat = m_sceneColorFormat;
+				renderTarget.depthFormat = m_depthFormat;
+				renderTarget.samples = m_msaaSamples;
+				renderTarget.extent = m_swapChainExtent;
+				renderTarget.dynamicViewport = m_bDynamicResolution;
+				// Simulated on the async compute queue, drawn on the graphics queue
+				m_particleSystem.InitParticleSystem(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &m_memoryBudget, PARTICLE_CAPACITY,
+					static_cast<uint32_t>(m_queueFamilyIndices.computeFamily), static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily),
+					renderTarget, particleSimulationShaderCode, particleVertexShaderCode, particleFragmentShaderCode);
+
+				ParticleEmitterSettings emitter;
+				emitter.emitRate = PARTICLE_EMIT_RATE;
+				m_particleSystem.SetEmitter(emitter);
+			}, &startupCounter, &shaderReadCounter);
+		}
+
+		if (m_bPostProcessing)
+		{
+			runTask("Post processing", [this, &postProcessShaderCode]
+			{
+				PostProcessImages images;
+				images.sceneColor = m_frameGraph.GetImageView(m_sceneColorResource);
+				images.bloom = { m_frameGraph.GetImageView(m_arrBloomResources[0]), m_frameGraph.GetImageView(m_arrBloomResources[1]) };
+				images.output = m_frameGraph.GetImageView(m_postOutputResource);
+				m_postProcessChain.InitPostProcessChain(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &m_memoryBudget,
+					m_swapChainExtent, images, postProcessShaderCode);
+			}, &startupCounter, &shaderReadCounter);
+		}
+
+		TimeStartupPhase("Framebuffers", [this]
+		{
+			if (!m_bDynamicRendering)
+			{
+				CreateFramebuffers();
+			}
+		});
+
+		if (PARALLEL_STARTUP)
+		{
+			startupJobs.Wait(commandPoolCounter);
+		}
+		TimeStartupPhase("Command buffers", [this]
+		{
+			CreateCommandBuffers();
+			CreateSynchronization();
+			CreateTimestampQueries();
+		});
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(errorMutex);
+		if (!startupError)
+		{
+			startupError = std::current_exception();
+		}
+	}
+
+	// Jobs reference the locals above, so they all have to finish even when something failed
+	if (PARALLEL_STARTUP)
+	{
+		startupJobs.Wait(shaderReadCounter);
+		startupJobs.Wait(commandPoolCounter);
+		startupJobs.Wait(startupCounter);
+		startupJobs.ShutdownJobSystem();
+	}
+
+	try
+	{
+		if (startupError)
+		{
+			std::rethrow_exception(startupError);
+		}
 	}
 	catch (const std::runtime_error& e)
 	{
 		printf("ERROR: %s\n", e.what());
 		return EXIT_FAILURE;
 	}
-	
+
+	PrintStartupPhases();
+	if (OPTIMIZE_MESHES && m_firstMesh.HasIndices())
+	{
+		const MeshOptimizationStats& stats = m_firstMesh.GetOptimizationStats();
+		printf("Scene mesh optimized: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr);
+	}
 	return 0;
 }
 
-void VulkanRenderer::Draw()
+void VulkanRenderer::Draw(const FrameSnapshot& snapshot)
+{
+	const FrameContext frame = BeginFrame();
+	RecordFrame(frame, snapshot);
+	SubmitFrame(frame);
+}
+
+VulkanRenderer::FrameContext VulkanRenderer::BeginFrame()
 {
 	// -- GET NEXT IMAGE --
+	FrameContext frame;
+	frame.frameSlot = m_uiCurrentFrame;
 
-	// Wait for given fence to signal (open) from last draw before continuing
-	vkWaitForFences(m_mainDevice.logicalDevice, 1, &m_vecDrawFences[m_uiCurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	// Manually rest (close) fences
-	vkResetFences(m_mainDevice.logicalDevice, 1, &m_vecDrawFences[m_uiCurrentFrame]);
+	// Wait for the last draw that used this frame slot (its semaphores) to finish on the GPU
+	// Timeline only ever counts up, so there is nothing to reset afterwards
+	m_frameTimeline.Wait(m_arrFrameTimelineValues[frame.frameSlot]);
+
+	// Everything the slot's last frame allocated is free now
+	m_arrFrameArenas[frame.frameSlot].Reset();
+
+	// Frames are submitted in the order they begin, and each submission advances the timeline by one
+	frame.timelineValue = ++m_ullFramesBegun;
+
+	// Destroy what finished frames released, anything released from here on may be used by this frame
+	m_deletionQueue.Collect();
+	m_deletionQueue.SetCurrentValue(frame.timelineValue);
+
+	// Refresh the budget and evict what finished frames no longer need, between frames so nothing being recorded goes away
+	m_memoryBudget.UpdateBudget();
+
+	// Hand captures of finished frames to the capture worker
+	if (m_bFrameCaptureSupported)
+	{
+		m_frameCapture.Poll();
+	}
 
 	// Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
-	uint32_t imageIndex;
-	vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, std::numeric_limits<uint64_t>::max(), m_vecImageAvailable[m_uiCurrentFrame], VK_NULL_HANDLE, &imageIndex);
+	vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, std::numeric_limits<uint64_t>::max(), m_vecImageAvailable[frame.frameSlot], VK_NULL_HANDLE, &frame.imageIndex);
+
+	// Command buffers are per swapchain image, and the image can come back before the frame that last used it
+	// (from another frame slot) has finished, so wait for that frame too
+	m_frameTimeline.Wait(m_vecImageTimelineValues[frame.imageIndex]);
+
+	// Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
+	m_uiCurrentFrame = (m_uiCurrentFrame + 1) % MAX_FRAME_DRAWS;
+
+	return frame;
+}
+
+void VulkanRenderer::RecordFrame(const FrameContext& frame, const FrameSnapshot& snapshot)
+{
+	// Re-record every frame, meshes join the frame once their upload has completed
+	m_recordSnapshot = snapshot;
+	m_ullRecordFrameValue = frame.timelineValue;
+	m_uiRecordFrameSlot = frame.frameSlot;
+
+	// GPU time of the slot's last frame (BeginFrame waited for it) picks the resolution of this one
+	if (m_bDynamicResolution)
+	{
+		if (m_arrTimestampsWritten[frame.frameSlot])
+		{
+			std::array<uint64_t, 2> timestamps = {};
+			const VkResult result = vkGetQueryPoolResults(m_mainDevice.logicalDevice, m_timestampQueryPool, 2 * frame.frameSlot, 2,
+				sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+			if (result == VK_SUCCESS && timestamps[1] > timestamps[0])
+			{
+				const double gpuFrameMs = static_cast<double>(timestamps[1] - timestamps[0]) * m_fTimestampPeriod / 1000000.0;
+				m_resolutionController.Update(gpuFrameMs);
+			}
+		}
+		m_renderExtent = m_resolutionController.GetRenderExtent(m_swapChainExtent);
+
+		// A replayed frame renders at the resolution it was recorded at
+		if (m_pReplayPacket != nullptr)
+		{
+			m_renderExtent.width = std::min(std::max(m_pReplayPacket->renderWidth, 1u), m_swapChainExtent.width);
+			m_renderExtent.height = std::min(std::max(m_pReplayPacket->renderHeight, 1u), m_swapChainExtent.height);
+		}
+	}
+
+	// Bring back an evicted mesh if there's room again, and keep what this frame draws from being evicted until it completes
+	m_firstMesh.EnsureResident();
+	m_bDrawFirstMesh = m_firstMesh.IsUploaded();
+	if (m_pReplayPacket != nullptr)
+	{
+		// A replayed frame draws what the recorded one did, as far as it's resident here
+		m_bDrawFirstMesh = m_bDrawFirstMesh && m_pReplayPacket->drawMesh != 0;
+	}
+	if (m_bDrawFirstMesh)
+	{
+		m_firstMesh.Touch(frame.timelineValue);
+
+		const std::vector<MeshLod>& lods = m_firstMesh.GetLods();
+		if (m_pReplayPacket != nullptr)
+		{
+			m_uiFirstMeshLod = lods.empty() ? 0 : std::min(m_pReplayPacket->meshLod, static_cast<uint32_t>(lods.size() - 1));
+		}
+		else
+		{
+			// No camera yet, the model matrix takes vertices straight to clip space (2 units across the viewport)
+			const float scale = std::max({ glm::length(glm::vec3(snapshot.model[0])), glm::length(glm::vec3(snapshot.model[1])),
+				glm::length(glm::vec3(snapshot.model[2])) });
+			const float pixelsPerUnit = scale * static_cast<float>(m_renderExtent.height) * 0.5f;
+			m_uiFirstMeshLod = SelectLod(lods, pixelsPerUnit, LOD_MAX_PIXEL_ERROR, m_uiFirstMeshLod, LOD_HYSTERESIS);
+		}
+	}
+
+	// Cull list of this frame, the mesh's chosen level is what gets drawn if it survives
+	if (m_bOcclusionCulling)
+	{
+		OcclusionCullObject cullObject = {};
+		if (m_bDrawFirstMesh && m_firstMesh.HasIndices())
+		{
+			const MeshLod& lod = m_firstMesh.GetLods()[m_uiFirstMeshLod];
+			cullObject.boundsMin = glm::vec4(m_firstMesh.GetBoundsMin(), 1.0f);
+			cullObject.boundsMax = glm::vec4(m_firstMesh.GetBoundsMax(), 1.0f);
+			cullObject.firstIndex = m_firstMesh.GetFirstIndex() + lod.firstIndex;
+			cullObject.indexCount = lod.indexCount;
+			cullObject.vertexOffset = static_cast<int32_t>(m_firstMesh.GetVertexOffset());
+		}
+		m_occlusionCuller.SetObjects(frame.frameSlot, &cullObject, cullObject.indexCount > 0 ? 1 : 0);
+	}
+
+	// Particles and eye adaptation step by simulation time, a snapshot drawn again doesn't move them.
+	// Clamped so a stall isn't one huge step
+	const double elapsed = m_dLastFrameTime < 0.0 ? 0.0 : snapshot.time - m_dLastFrameTime;
+	m_fFrameDeltaTime = static_cast<float>(std::min(std::max(elapsed, 0.0), 0.1));
+	m_dLastFrameTime = snapshot.time;
+
+	// What the frame was given and decided, traced before it's recorded
+	FrameTracePacket tracePacket;
+	tracePacket.model = snapshot.model;
+	tracePacket.time = snapshot.time;
+	tracePacket.renderWidth = m_renderExtent.width;
+	tracePacket.renderHeight = m_renderExtent.height;
+	tracePacket.meshLod = m_uiFirstMeshLod;
+	tracePacket.drawMesh = m_bDrawFirstMesh ? 1 : 0;
+	m_frameTraceRecorder.RecordFrame(tracePacket);
+
+	// Particle simulation overlaps the frame's graphics work up to the particle draw, which waits for it
+	if (m_bParticles)
+	{
+		const VkCommandBuffer computeCommandBuffer = BeginComputeCommands(frame);
+		m_particleSystem.RecordSimulation(computeCommandBuffer, m_fFrameDeltaTime);
+		EndComputeCommands(frame, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+	}
+
+	RecordCommands(frame.imageIndex, m_arrFrameArenas[frame.frameSlot]);
+}
+
+void VulkanRenderer::SubmitFrame(const FrameContext& frame)
+{
+	const uint32_t imageIndex = frame.imageIndex;
+
+	// Hand finished uploads to the GPU first, so this frame's submission is ordered after their acquire barriers
+	m_uploadService.SubmitPending(m_graphicsQueue);
+
+	// Value this frame signals on completion
+	const uint64_t frameValue = m_frameTimeline.AdvanceValue();
+	if (frameValue != frame.timelineValue)
+	{
+		throw std::runtime_error("Frames must be submitted in the order they began");
+	}
+
+	// Compute work of the frame goes first, after the previous frame (whose graphics work may still use what it writes)
+	const VkPipelineStageFlags computeWaitStage = m_arrComputeWaitStages[frame.frameSlot];
+	if (computeWaitStage != 0)
+	{
+		const VkSemaphore frameTimeline = m_frameTimeline.GetSemaphore();
+		const uint64_t previousFrameValue = frameValue - 1;
+		constexpr VkPipelineStageFlags computeStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		const uint64_t computeSignalValue = 0;
+
+		VkTimelineSemaphoreSubmitInfo computeTimelineInfo = {};
+		computeTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		computeTimelineInfo.waitSemaphoreValueCount = 1;
+		computeTimelineInfo.pWaitSemaphoreValues = &previousFrameValue;
+		computeTimelineInfo.signalSemaphoreValueCount = 1;
+		computeTimelineInfo.pSignalSemaphoreValues = &computeSignalValue;
+
+		VkSubmitInfo computeSubmitInfo = {};
+		computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		computeSubmitInfo.pNext = &computeTimelineInfo;
+		computeSubmitInfo.waitSemaphoreCount = 1;
+		computeSubmitInfo.pWaitSemaphores = &frameTimeline;
+		computeSubmitInfo.pWaitDstStageMask = &computeStage;
+		computeSubmitInfo.commandBufferCount = 1;
+		computeSubmitInfo.pCommandBuffers = &m_vecComputeCommandBuffers[frame.frameSlot];
+		computeSubmitInfo.signalSemaphoreCount = 1;
+		computeSubmitInfo.pSignalSemaphores = &m_vecComputeFinished[frame.frameSlot];
+
+		const VkResult computeResult = vkQueueSubmit(m_computeQueue, 1, &computeSubmitInfo, VK_NULL_HANDLE);
+		if (computeResult != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit Command Buffer to Compute Queue");
+		}
+		m_arrComputeWaitStages[frame.frameSlot] = 0;
+	}
 
-	
 
 	// 2. Submit command buffer to queue for execution, make sure it waits for the image to be signaled as available for drawing
 	// and signals whe it has finished rendering
 	// -- SUBMIT COMMAND BUFFER TO RENDER --
 	// Queue submission information
+	// Always wait for the image, and also for this frame's async compute work if any was submitted
+	const VkSemaphore waitSemaphores[] = {
+		m_vecImageAvailable[frame.frameSlot],
+		m_vecComputeFinished[frame.frameSlot]
+	};
+	const VkPipelineStageFlags waitStages[] = {
+		m_swapChainWaitStage,
+		computeWaitStage
+	};
+
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;							// Number of semaphores to wait on
-	submitInfo.pWaitSemaphores = &m_vecImageAvailable[m_uiCurrentFrame];				// List of semaphores to wait on
-	constexpr VkPipelineStageFlags waitStages[] = {
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	};
+	submitInfo.waitSemaphoreCount = computeWaitStage != 0 ? 2 : 1;	// Number of semaphores to wait on
+	submitInfo.pWaitSemaphores = waitSemaphores;				// List of semaphores to wait on
 	submitInfo.pWaitDstStageMask = waitStages;					// Stages to check semaphores at
 	submitInfo.commandBufferCount = 1;							// Number of command buffers to submit
 	submitInfo.pCommandBuffers = &m_vecCommandBuffers[imageIndex];	// Command buffer to submit
-	submitInfo.signalSemaphoreCount = 1;						// Number of semaphores to signal
-	submitInfo.pSignalSemaphores = &m_vecRenderFinished[m_uiCurrentFrame];				// Semaphores to signal when command buffer finishes
-
-	// Submit command buffer to queue
-	VkResult result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_vecDrawFences[m_uiCurrentFrame]);
+	// Binary semaphore for presentation, timeline semaphore for everything CPU side
+	const VkSemaphore signalSemaphores[] = {
+		m_vecRenderFinished[frame.frameSlot],
+		m_frameTimeline.GetSemaphore()
+	};
+	submitInfo.signalSemaphoreCount = 2;						// Number of semaphores to signal
+	submitInfo.pSignalSemaphores = signalSemaphores;			// Semaphores to signal when command buffer finishes
+
+	// Values for the semaphores above (ignored for binary semaphores, but every semaphore needs an entry)
+	const uint64_t waitValues[] = { 0, 0 };
+	const uint64_t signalValues[] = { 0, frameValue };
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+	timelineSubmitInfo.pWaitSemaphoreValues = waitValues;
+	timelineSubmitInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+	timelineSubmitInfo.pSignalSemaphoreValues = signalValues;
+	submitInfo.pNext = &timelineSubmitInfo;
+
+	// Submit command buffer to queue (no fence, timeline semaphore tracks completion)
+	VkResult result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to submit Command Buffer to Queue");
 	}
+
+	m_arrFrameTimelineValues[frame.frameSlot] = frameValue;
+	m_vecImageTimelineValues[imageIndex] = frameValue;
 	
 	// -- PRESENT RENDERED IMAGE TO SCREEN --
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;												// Number of semaphores to wait on
-	presentInfo.pWaitSemaphores = &m_vecRenderFinished[m_uiCurrentFrame];				// Semaphores to wait on
+	presentInfo.pWaitSemaphores = &m_vecRenderFinished[frame.frameSlot];				// Semaphores to wait on
 	presentInfo.swapchainCount = 1;													// Number of swapchains to present to
 	presentInfo.pSwapchains = &m_swapchain;											// Swapchains to present images to
 	presentInfo.pImageIndices = &imageIndex;										// Index of images in swapchains to present
@@ -147,24 +619,62 @@ void VulkanRenderer::Draw()
 		throw std::runtime_error("Failed to present Image");
 	}
 
-	// Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
-	m_uiCurrentFrame = (m_uiCurrentFrame + 1) % MAX_FRAME_DRAWS;
+	if (frameValue == 1)
+	{
+		const std::chrono::duration<double, std::milli> sinceInit = std::chrono::steady_clock::now() - m_startupBegin;
+		printf("First frame presented %.1f ms after Init\n", sinceInit.count());
+	}
 }
 
-void VulkanRenderer::Cleanup() const
+void VulkanRenderer::Cleanup()
 {
+	// A trace still running is written out
+	if (m_frameTraceRecorder.IsTracing() && !m_frameTraceRecorder.StopTrace())
+	{
+		printf("Failed to write the frame trace\n");
+	}
+
 	// Wait until no actions being run on device before destroying
 	vkDeviceWaitIdle(m_mainDevice.logicalDevice);
+	m_uploadService.ShutdownUploadService();
+	if (m_bFrameCaptureSupported)
+	{
+		m_frameCapture.ShutdownFrameCapture();
+	}
+	if (m_bOcclusionCulling)
+	{
+		m_occlusionCuller.ShutdownOcclusionCuller();
+	}
+	if (m_bParticles)
+	{
+		m_particleSystem.ShutdownParticleSystem();
+	}
+	if (m_bPostProcessing)
+	{
+		m_postProcessChain.ShutdownPostProcessChain();
+	}
 
 	m_firstMesh.DestroyVertexBuffer();
+	m_geometryPool.ShutdownGeometryPool();
+	m_depthBuffer.Release();
+	m_colorBuffer.Release();
+	if (m_timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_mainDevice.logicalDevice, m_timestampQueryPool, nullptr);
+	}
+
+	// Device is idle, so everything released so far can go
+	m_deletionQueue.Flush();
 
 	for (size_t i = 0; i < MAX_FRAME_DRAWS; ++i)
 	{
 		vkDestroySemaphore(m_mainDevice.logicalDevice, m_vecRenderFinished[i], nullptr);
 		vkDestroySemaphore(m_mainDevice.logicalDevice, m_vecImageAvailable[i], nullptr);
-		vkDestroyFence(m_mainDevice.logicalDevice, m_vecDrawFences[i], nullptr);
+		vkDestroySemaphore(m_mainDevice.logicalDevice, m_vecComputeFinished[i], nullptr);
 	}
+	m_frameTimeline.DestroyTimeline();
 	
+	vkDestroyCommandPool(m_mainDevice.logicalDevice, m_computeCommandPool, nullptr);
 	vkDestroyCommandPool(m_mainDevice.logicalDevice, m_graphicsCommandPool, nullptr);
 	for (const auto framebuffer : m_vecSwapChainFramebuffers)
 	{
@@ -173,6 +683,7 @@ void VulkanRenderer::Cleanup() const
 	vkDestroyPipeline(m_mainDevice.logicalDevice, m_graphicsPipeline, nullptr);
 	vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_pipelineLayout, nullptr);
 	vkDestroyRenderPass(m_mainDevice.logicalDevice, m_renderPass, nullptr);
+	m_frameGraph.DestroyGraph();
 	for (auto& image: m_vecSwapChainImages)
 	{
 		vkDestroyImageView(m_mainDevice.logicalDevice, image.imageView, nullptr);
@@ -185,6 +696,147 @@ void VulkanRenderer::Cleanup() const
 	}
 	vkDestroyDevice(m_mainDevice.logicalDevice, nullptr);
 	vkDestroyInstance(m_instance, nullptr);
+
+	// Instance is gone, so no more messages can arrive
+	m_debugMessageSink.StopDebugMessageSink();
+}
+
+VkCommandBuffer VulkanRenderer::BeginComputeCommands(const FrameContext& frame)
+{
+	// BeginFrame waited for the slot's last frame, whose graphics submission waited on the slot's last compute work,
+	// so the command buffer is no longer pending
+	const VkCommandBuffer commandBuffer = m_vecComputeCommandBuffers[frame.frameSlot];
+
+	VkCommandBufferBeginInfo bufferBeginInfo = {};
+	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;		// Re-recorded every frame
+
+	// Pool was created with RESET_COMMAND_BUFFER so begin implicitly resets the buffer
+	const VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to start recording a Compute Command Buffer");
+	}
+
+	return commandBuffer;
+}
+
+void VulkanRenderer::EndComputeCommands(const FrameContext& frame, VkPipelineStageFlags graphicsWaitStage)
+{
+	const VkResult result = vkEndCommandBuffer(m_vecComputeCommandBuffers[frame.frameSlot]);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to stop recording a Compute Command Buffer");
+	}
+
+	// Submitted by SubmitFrame, on the thread that submits to the queues
+	m_arrComputeWaitStages[frame.frameSlot] = graphicsWaitStage;
+}
+
+uint64_t VulkanRenderer::GetLastSubmittedFrameValue() const
+{
+	return m_frameTimeline.GetLastSubmittedValue();
+}
+
+FrameTimeline& VulkanRenderer::GetFrameTimeline()
+{
+	return m_frameTimeline;
+}
+
+UploadService& VulkanRenderer::GetUploadService()
+{
+	return m_uploadService;
+}
+
+const MemoryBudget& VulkanRenderer::GetMemoryBudget() const
+{
+	return m_memoryBudget;
+}
+
+DeletionQueue& VulkanRenderer::GetDeletionQueue()
+{
+	return m_deletionQueue;
+}
+
+GeometryPool& VulkanRenderer::GetGeometryPool()
+{
+	return m_geometryPool;
+}
+
+const std::vector<VulkanRenderer::StartupPhase>& VulkanRenderer::GetStartupPhases() const
+{
+	return m_vecStartupPhases;
+}
+
+const DebugMessageSink& VulkanRenderer::GetDebugMessageSink() const
+{
+	return m_debugMessageSink;
+}
+
+FrameCapture* VulkanRenderer::GetFrameCapture()
+{
+	return m_bFrameCaptureSupported ? &m_frameCapture : nullptr;
+}
+
+void VulkanRenderer::StartFrameTrace(const std::string& fileName)
+{
+	// Only the scene mesh so far, as the app handed it over
+	FrameTraceMesh sceneMesh;
+	sceneMesh.meshId = 0;
+	sceneMesh.vecVertices = m_vecSceneVertices;
+	sceneMesh.vecIndices = m_vecSceneIndices;
+	m_frameTraceRecorder.StartTrace(fileName, GetFrameTraceHeader(), { sceneMesh });
+}
+
+bool VulkanRenderer::StopFrameTrace()
+{
+	return m_frameTraceRecorder.StopTrace();
+}
+
+bool VulkanRenderer::IsFrameTracing() const
+{
+	return m_frameTraceRecorder.IsTracing();
+}
+
+FrameTraceHeader VulkanRenderer::GetFrameTraceHeader() const
+{
+	FrameTraceHeader header;
+	header.width = m_swapChainExtent.width;
+	header.height = m_swapChainExtent.height;
+	header.msaaSamples = static_cast<uint32_t>(m_msaaSamples);
+	header.shaderFeatures = m_uiSceneShaderFeatures;
+	header.rendererFeatures = (m_bDynamicRendering ? FRAME_TRACE_FEATURE_DYNAMIC_RENDERING : 0)
+		| (m_bOcclusionCulling ? FRAME_TRACE_FEATURE_OCCLUSION_CULLING : 0)
+		| (m_bParticles ? FRAME_TRACE_FEATURE_PARTICLES : 0)
+		| (m_bDynamicResolution ? FRAME_TRACE_FEATURE_DYNAMIC_RESOLUTION : 0)
+		| (m_bPostProcessing ? FRAME_TRACE_FEATURE_POST_PROCESSING : 0);
+	return header;
+}
+
+void VulkanRenderer::DrawTraceFrame(const FrameTracePacket& packet)
+{
+	FrameSnapshot snapshot;
+	snapshot.model = packet.model;
+	snapshot.time = packet.time;
+
+	m_pReplayPacket = &packet;
+	Draw(snapshot);
+	m_pReplayPacket = nullptr;
+}
+
+bool VulkanRenderer::IsSceneResident() const
+{
+	return m_firstMesh.IsUploaded();
+}
+
+VkDevice VulkanRenderer::GetLogicalDevice() const
+{
+	return m_mainDevice.logicalDevice;
+}
+
+const QueueFamilyIndices& VulkanRenderer::GetQueueFamilyIndices() const
+{
+	return m_queueFamilyIndices;
 }
 
 VulkanRenderer::~VulkanRenderer()
@@ -219,17 +871,26 @@ void VulkanRenderer::CreateInstance()
 	
 	//Create list to hold m_instance extensions
 	std::vector<const char*> instanceExtensions = std::vector<const char*>();
-	// Set up extensions m_instance will use
-	uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
+	if (m_bHeadless)
+	{
+		// No window system, the surface is a headless one
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+	}
+	else
+	{
+		// Set up extensions m_instance will use
+		uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
 
-	// Extensions passed as array of c strings, so need pointer (the array) to pointer ( the c string)
-	//Get GLFW  extensions
-	 const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		// Extensions passed as array of c strings, so need pointer (the array) to pointer ( the c string)
+		//Get GLFW  extensions
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	//Add GLFW extensions to list of extensions
-	for (size_t i = 0; i < glfwExtensionCount; i++)
-	{
-		instanceExtensions.push_back(glfwExtensions[i]);
+		//Add GLFW extensions to list of extensions
+		for (size_t i = 0; i < glfwExtensionCount; i++)
+		{
+			instanceExtensions.push_back(glfwExtensions[i]);
+		}
 	}
 
 	if (enableValidationLayers)
@@ -253,7 +914,7 @@ void VulkanRenderer::CreateInstance()
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 		createInfo.ppEnabledLayerNames = validationLayers.data();
 
-		PopulateDebugMessengerCreateInfo(debugCreateInfo);
+		PopulateDebugMessengerCreateInfo(debugCreateInfo, &m_debugMessageSink);
 		createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
 	}
 	else
@@ -272,39 +933,124 @@ void VulkanRenderer::CreateInstance()
 
 void VulkanRenderer::CreateLogicalDevice()
 {
-	// Get the queue family indices for the chosen Physical device
-	const QueueFamilyIndices indices = GetQueueFamilies(m_mainDevice.physicalDevice);
+	// Queue family indices for the chosen Physical device (found while picking it)
+	const QueueFamilyIndices indices = m_queueFamilyIndices;
 
 	// Vector for queue creation information, and set for family indices
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	const std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily };
+	const std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily, indices.computeFamily, indices.transferFamily };
+
+	// Must outlive the create infos below, vkCreateDevice reads it through the pointer
+	constexpr float priority = 1.0f;
 
-	// Queues the logical device needs to create and info to do so 
+	// Queues the logical device needs to create and info to do so
 	for (const int queueFamilyIndex : queueFamilyIndices)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.queueFamilyIndex = queueFamilyIndex;		//The index of the family to create a queue from
 		queueCreateInfo.queueCount = 1;								//Number of queues to create
-		float priority = 1.0f;
-		queueCreateInfo.pQueuePriorities = &priority;				// Vulkan needs to know hot to handle multiple queues, so decide priority (1 = highest) 
+		queueCreateInfo.pQueuePriorities = &priority;				// Vulkan needs to know hot to handle multiple queues, so decide priority (1 = highest)
 
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 	
 
+	// Optional extensions are enabled on top of the required ones when the device has them
+	std::vector<const char*> enabledExtensions = deviceExtensions;
+	m_bMemoryBudgetExtension = IsDeviceExtensionAvailable(m_mainDevice.physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (m_bMemoryBudgetExtension)
+	{
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
 	// Information to create logical device (sometimes called "device")
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());		// Number of queue infos
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();								// List of queue create infos to device can create required queues
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());	// Number of enabled logical device extensions
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();											// List of enabled logical device extensions
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());	// Number of enabled logical device extensions
+	deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();										// List of enabled logical device extensions
 	
 	// Physical Device features the logical device will be using
-	constexpr VkPhysicalDeviceFeatures deviceFeatures = {};
+	VkPhysicalDeviceFeatures deviceFeatures = {};
+
+	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;		// Physical device features logical device will use
+
+	// Vulkan 1.2 features are chained through pNext
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;				// Frame synchronization is built on a timeline semaphore
+
+	// Vulkan 1.3 features, only chained if the device is 1.3 (dynamic rendering is optional, so it's only enabled if supported)
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	if (USE_DYNAMIC_RENDERING && deviceProperties.apiVersion >= VK_API_VERSION_1_3)
+	{
+		VkPhysicalDeviceFeatures2 supportedFeatures = {};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &vulkan13Features;
+		vkGetPhysicalDeviceFeatures2(m_mainDevice.physicalDevice, &supportedFeatures);
+		supportedFeatures.pNext = nullptr;
+
+		m_bDynamicRendering = vulkan13Features.dynamicRendering == VK_TRUE;
+
+		// Only keep what we use enabled
+		const VkPhysicalDeviceVulkan13Features queried = vulkan13Features;
+		vulkan13Features = {};
+		vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		vulkan13Features.dynamicRendering = queried.dynamicRendering;
+		vulkan12Features.pNext = &vulkan13Features;
+	}
+
+	// Occlusion culling draws a GPU written number of indirect commands, and splits the frame in to two passes,
+	// which needs dynamic rendering (the frame graph places the compute work between them)
+	if (OCCLUSION_CULLING && m_bDynamicRendering)
+	{
+		VkPhysicalDeviceVulkan12Features supported12Features = {};
+		supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supportedFeatures = {};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &supported12Features;
+		vkGetPhysicalDeviceFeatures2(m_mainDevice.physicalDevice, &supportedFeatures);
+
+		m_bOcclusionCulling = supported12Features.drawIndirectCount == VK_TRUE && supportedFeatures.features.multiDrawIndirect == VK_TRUE;
+		if (m_bOcclusionCulling)
+		{
+			vulkan12Features.drawIndirectCount = VK_TRUE;
+			deviceFeatures.multiDrawIndirect = VK_TRUE;
+		}
+
+		// MSAA depth is resolved for the pyramid: farthest sample keeps the test conservative, sample 0 is always there
+		VkPhysicalDeviceDepthStencilResolveProperties resolveProperties = {};
+		resolveProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &resolveProperties;
+		vkGetPhysicalDeviceProperties2(m_mainDevice.physicalDevice, &properties2);
+		m_depthResolveMode = (resolveProperties.supportedDepthResolveModes & VK_RESOLVE_MODE_MAX_BIT)
+			? VK_RESOLVE_MODE_MAX_BIT : VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+	}
 
-	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;		// Physical device features logical device will use
+	// Post processing reduces luminance with subgroup arithmetic in compute (not required by Vulkan 1.1, near universal)
+	if (POST_PROCESSING && m_bDynamicRendering)
+	{
+		VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+		subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &subgroupProperties;
+		vkGetPhysicalDeviceProperties2(m_mainDevice.physicalDevice, &properties2);
+
+		constexpr VkSubgroupFeatureFlags subgroupOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+		m_bPostProcessing = (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0
+			&& (subgroupProperties.supportedOperations & subgroupOperations) == subgroupOperations;
+	}
+
+	deviceCreateInfo.pNext = &vulkan12Features;
 
 	// Create the logical device for the given physical device
 	const VkResult result = vkCreateDevice(m_mainDevice.physicalDevice, &deviceCreateInfo, nullptr, &m_mainDevice.logicalDevice);
@@ -319,6 +1065,11 @@ void VulkanRenderer::CreateLogicalDevice()
 	// From given logical device of given queue family of given queue index (0 since only one queue), place reference in given vkQueue
 	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.graphicsFamily, 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.presentationFamily, 0, &m_presentationQueue);
+	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.computeFamily, 0, &m_computeQueue);
+	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.transferFamily, 0, &m_transferQueue);
+
+	// Keep indices around for ownership transfers between families
+	m_queueFamilyIndices = indices;
 }
 
 bool VulkanRenderer::CheckInstanceExtensionSupport(const std::vector<const char*>* checkExtentions)
@@ -365,15 +1116,34 @@ bool VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device) const
 
 	const bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
+	// Timeline semaphores are core in 1.2 but still an optional feature flag to query
+	// The 1.2 feature struct may only be chained on a 1.2 device
+	bool featuresSupported = false;
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 deviceFeatures2 = {};
+		deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures2.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+
+		featuresSupported = vulkan12Features.timelineSemaphore == VK_TRUE;
+	}
+
+	// Only needs to know there is at least one format and present mode, so the counts are enough
 	bool swapChainValid = false;
 	if (extensionsSupported)
 	{
-		const SwapChainDetails swapChainDetails = GetSwapChainDetails(device);
-		swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
+		uint32_t formatCount = 0;
+		uint32_t presentationCount = 0;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentationCount, nullptr);
+		swapChainValid = formatCount != 0 && presentationCount != 0;
 	}
 	
 
-	return indices.IsValid() && extensionsSupported && swapChainValid;
+	return indices.IsValid() && extensionsSupported && swapChainValid && featuresSupported;
 }
 
 QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device) const
@@ -382,45 +1152,102 @@ QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device) con
 	uint32_t queueFamilyCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
-	std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+	const LinearArena::Scope scratchScope(m_scratchArena);
+	ArenaVector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount, ArenaAllocator<VkQueueFamilyProperties>(&m_scratchArena));
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyList.data());
 
+	int combinedFamily = -1;			// First family that supports both graphics and presentation
+	bool computeIsShared = false;		// Whether chosen compute family is also the graphics family
+	int bestTransferRank = -1;			// How "dedicated" the chosen transfer family is (higher is better)
+
 	// Go through each queue family and check if it has at least 1 of the required types of queue
+	// Whole list is scanned (no early out) so dedicated compute/transfer families further down are also found
 	int i = 0;
 	for (const auto & queueFamily : queueFamilyList)
 	{
 		//First check if queue family has at least 1 queue in that family (could have 0)
-		// Queue can be multiple types defined through bitfield. Need to bitwise AND with V_QUEUE_*_BIT to check if has required type
-		if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+		if (queueFamily.queueCount == 0)
 		{
-			indices.graphicsFamily = i; // If queue family is valid, then get index
+			i++;
+			continue;
 		}
 
+		// Queue can be multiple types defined through bitfield. Need to bitwise AND with V_QUEUE_*_BIT to check if has required type
+		const bool hasGraphics = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		const bool hasCompute = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+		const bool hasTransfer = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+
 		//Check if queue family supports presentation
 		VkBool32 presentationSupport = false;
 		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentationSupport);
+
+		// A family that does both is always preferred (swapchain images can then be EXCLUSIVE)
+		if (hasGraphics && presentationSupport && combinedFamily < 0)
+		{
+			combinedFamily = i;
+		}
+
+		if (hasGraphics && indices.graphicsFamily < 0)
+		{
+			indices.graphicsFamily = i; // If queue family is valid, then get index
+		}
+
 		// Check if queue is presentation type (can be both graphics and presentation)
-		if (queueFamily.queueCount > 0 && presentationSupport)
+		if (presentationSupport && indices.presentationFamily < 0)
 		{
 			indices.presentationFamily = i;
 		}
 
-		// check if queue family indices are in a valid state, stop searching if so
-		if (indices.IsValid())
+		// Prefer a compute family without graphics (async compute), otherwise take any compute family
+		if (hasCompute && (indices.computeFamily < 0 || (!hasGraphics && computeIsShared)))
+		{
+			indices.computeFamily = i;
+			computeIsShared = hasGraphics;
+		}
+
+		// Prefer a transfer-only family (DMA engine), then a compute-only family, then anything that can transfer
+		// (graphics and compute families always support transfer even if the bit isn't reported)
+		const int transferRank = hasGraphics ? 0 : (hasCompute ? 1 : 2);
+		if ((hasTransfer || hasGraphics || hasCompute) && (indices.transferFamily < 0 || transferRank > bestTransferRank))
 		{
-			break;
+			indices.transferFamily = i;
+			bestTransferRank = transferRank;
 		}
-		
+
 		i++;
 	}
 
+	if (combinedFamily >= 0)
+	{
+		indices.graphicsFamily = combinedFamily;
+		indices.presentationFamily = combinedFamily;
+	}
+
 	return indices;
 }
 
 void VulkanRenderer::CreateSurface()
 {
-	// Create surface (creating a surface create info struct, runs the create surface function, returns result
-	const VkResult result = glfwCreateWindowSurface(m_instance, m_pWindow, nullptr, &m_surface);
+	VkResult result;
+	if (m_bHeadless)
+	{
+		// Extension function, has to be looked up
+		const auto createHeadlessSurface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+			vkGetInstanceProcAddr(m_instance, "vkCreateHeadlessSurfaceEXT"));
+		if (createHeadlessSurface == nullptr)
+		{
+			throw std::runtime_error("Failed to create a surface!");
+		}
+
+		VkHeadlessSurfaceCreateInfoEXT surfaceCreateInfo = {};
+		surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+		result = createHeadlessSurface(m_instance, &surfaceCreateInfo, nullptr, &m_surface);
+	}
+	else
+	{
+		// Create surface (creating a surface create info struct, runs the create surface function, returns result
+		result = glfwCreateWindowSurface(m_instance, m_pWindow, nullptr, &m_surface);
+	}
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create a surface!");
@@ -436,7 +1263,7 @@ void VulkanRenderer::CreateSwapChain()
 	// 1. Choose best surface format
 	const VkSurfaceFormatKHR surfaceFormat = ChooseBestSurfaceFormat(swapChainDetails.formats);
 	// 2. Choose vest presentation mode
-	const VkPresentModeKHR presentMode = ChooseBestPresentationMode(swapChainDetails.presentationModes);
+	const VkPresentModeKHR presentMode = ChooseBestPresentationMode(swapChainDetails.presentationModes, m_bHeadless);
 	// 3. Choose Swap Chain Image resolution
 	const VkExtent2D extent = ChooseSwapExtent(swapChainDetails.surfaceCapabilities);
 
@@ -462,12 +1289,48 @@ void VulkanRenderer::CreateSwapChain()
 	swapChainCreateInfo.minImageCount = imageCount;												// Minimum images in swapchain
 	swapChainCreateInfo.imageArrayLayers = 1;													// Number of layers for each image in chain
 	swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;						// What attachment images will be used as
+	// Frame capture copies out of the presented image, so it also needs to be a transfer source where the surface allows it
+	m_bFrameCaptureSupported = (swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+	if (m_bFrameCaptureSupported)
+	{
+		swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+	// Dynamic resolution and post processing blit the frame in to the swapchain image
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_mainDevice.physicalDevice, surfaceFormat.format, &formatProperties);
+	const bool blitToSwapChain = (swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0
+		&& (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0;
+	m_bPostProcessing = m_bPostProcessing && blitToSwapChain;
+
+	// Dynamic resolution also times frames with timestamps on the graphics queue, and without post processing
+	// scales the scene color (in the swapchain format) itself
+	if (DYNAMIC_RESOLUTION && m_bDynamicRendering && blitToSwapChain)
+	{
+		constexpr VkFormatFeatureFlags blitSourceFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_mainDevice.physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_mainDevice.physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+		m_fTimestampPeriod = deviceProperties.limits.timestampPeriod;
+
+		m_bDynamicResolution = (m_bPostProcessing || (formatProperties.optimalTilingFeatures & blitSourceFeatures) == blitSourceFeatures)
+			&& queueFamilies[static_cast<size_t>(m_queueFamilyIndices.graphicsFamily)].timestampValidBits > 0
+			&& m_fTimestampPeriod > 0.0f;
+	}
+	if (m_bDynamicResolution || m_bPostProcessing)
+	{
+		swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
 	swapChainCreateInfo.preTransform = swapChainDetails.surfaceCapabilities.currentTransform;	// Transform to perform on swapchain images
 	swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;						// How to handle the blending images with external graphics (e.g external windows)
 	swapChainCreateInfo.clipped = VK_TRUE;														// Whether to clip parts of image not in view (e.g behind another window, off screen, etc)
 
 	// Get Queue Family Indices
-	const QueueFamilyIndices indices = GetQueueFamilies(m_mainDevice.physicalDevice);
+	const QueueFamilyIndices& indices = m_queueFamilyIndices;
 
 	// If Graphics and Presentation families are different, then swapchain must let images be shared between families
 	if (indices.graphicsFamily != indices.presentationFamily)
@@ -501,6 +1364,7 @@ void VulkanRenderer::CreateSwapChain()
 
 	// Store for later reference
 	m_swapChainImageFormat = surfaceFormat.format;
+	m_sceneColorFormat = m_bPostProcessing ? PostProcessChain::SCENE_COLOR_FORMAT : m_swapChainImageFormat;
 	m_swapChainExtent = extent;
 
 	// Get swap chain images (first count, then values)
@@ -522,46 +1386,144 @@ void VulkanRenderer::CreateSwapChain()
 
 }
 
+void VulkanRenderer::CreateColorBufferImage()
+{
+	// Clamp requested sample count to what the device can render to
+	m_msaaSamples = ChooseMsaaSamples(m_requestedMsaaSamples);
+
+	// Without MSAA the swap chain image is rendered to directly. With dynamic rendering it's a frame graph transient
+	if (m_msaaSamples == VK_SAMPLE_COUNT_1_BIT || m_bDynamicRendering)
+	{
+		return;
+	}
+
+	// Multisampled color image is never stored (resolved in the subpass), so it can be transient
+	// On tiled GPUs lazily allocated memory means it only ever exists in tile memory
+	VkDeviceMemory colorBufferImageMemory;
+	const VkImage colorBufferImage = CreateImage(m_swapChainExtent.width, m_swapChainExtent.height, m_sceneColorFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, m_msaaSamples,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&colorBufferImageMemory);
+
+	const VkImageView colorBufferImageView = CreateImageView(colorBufferImage, m_sceneColorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_colorBuffer = GpuImage(m_mainDevice.logicalDevice, colorBufferImage, colorBufferImageView, colorBufferImageMemory, &m_memoryBudget, &m_deletionQueue);
+}
+
+void VulkanRenderer::CreateDepthBufferImage()
+{
+	// Get supported format for depth buffer (the depth pyramid samples it when occlusion culling)
+	m_depthFormat = ChooseSupportedFormat(
+		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | (m_bOcclusionCulling ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0));
+
+	// With dynamic rendering it's a frame graph transient (as is the occlusion culling's depth resolve)
+	if (m_bDynamicRendering)
+	{
+		return;
+	}
+
+	// Depth is only needed during the subpass (storeOp DONT_CARE), so it is transient too
+	VkDeviceMemory depthBufferImageMemory;
+	const VkImage depthBufferImage = CreateImage(m_swapChainExtent.width, m_swapChainExtent.height, m_depthFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, m_msaaSamples,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depthBufferImageMemory);
+
+	const VkImageView depthBufferImageView = CreateImageView(depthBufferImage, m_depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+	m_depthBuffer = GpuImage(m_mainDevice.logicalDevice, depthBufferImage, depthBufferImageView, depthBufferImageMemory, &m_memoryBudget, &m_deletionQueue);
+}
+
+void VulkanRenderer::CreateResolutionController()
+{
+	m_renderExtent = m_swapChainExtent;
+	if (m_bDynamicResolution)
+	{
+		DynamicResolutionSettings settings;
+		settings.targetFrameMs = DYNAMIC_RESOLUTION_TARGET_MS;
+		settings.minScale = DYNAMIC_RESOLUTION_MIN_SCALE;
+		m_resolutionController.InitDynamicResolution(settings);
+	}
+}
+
 void VulkanRenderer::CreateRenderPass()
 {
+	const bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+	// Attachment order: 0 = color target, 1 = depth, 2 = resolve target (MSAA only)
+	std::array<VkAttachmentDescription, 3> attachments{};
+
 	// Color attachment of render pass
-	VkAttachmentDescription colorAttachment = {};
+	// With MSAA this is the multisampled image: cleared, rendered and resolved all within the subpass, never stored
+	VkAttachmentDescription& colorAttachment = attachments[0];
 	colorAttachment.format = m_swapChainImageFormat;									// Format to use for attachment
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;								// Number of samples to write for multisampling
+	colorAttachment.samples = m_msaaSamples;										// Number of samples to write for multisampling
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;							// Describes what to do with attachment before rendering
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;							// Describes what to do with attachment after rendering
+	colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;	// Describes what to do with attachment after rendering
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;				// Describes what to do with stencil before rendering
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;				// Describes what to do with stencil after rendering
 
 	// Framebuffer data will be stored as an image, but images can be given different data layouts
 	// to give optimal use for certain operations
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;						// Image data layout before render pass starts
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;					// Image data layout after render pass (to change to)
+	colorAttachment.finalLayout = multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;	// Image data layout after render pass (to change to)
+
+	// Depth attachment of render pass, only needed during the subpass so never stored
+	VkAttachmentDescription& depthAttachment = attachments[1];
+	depthAttachment.format = m_depthFormat;
+	depthAttachment.samples = m_msaaSamples;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Resolve attachment (swap chain image), the multisampled color is resolved in to it at the end of the subpass
+	VkAttachmentDescription& resolveAttachment = attachments[2];
+	resolveAttachment.format = m_swapChainImageFormat;
+	resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;						// Every pixel is overwritten by the resolve
+	resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	// Attachment reference uses an attachment index that refers to index in the attachment list passed to renderPassCreateInfo
 	VkAttachmentReference colorAttachmentReference = {};
 	colorAttachmentReference.attachment = 0;
 	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depthAttachmentReference = {};
+	depthAttachmentReference.attachment = 1;
+	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference resolveAttachmentReference = {};
+	resolveAttachmentReference.attachment = 2;
+	resolveAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
 	// Information about a particular subpass the Render Pass is using
 	VkSubpassDescription subpass = {};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;					// Pipeline type subpass is to be bound to
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentReference;
+	subpass.pDepthStencilAttachment = &depthAttachmentReference;
+	subpass.pResolveAttachments = multisampled ? &resolveAttachmentReference : nullptr;	// Resolve happens inside the subpass, no separate pass or blit
 
 	// Need to determine when layout transitions occur using subpass dependencies
 	std::array<VkSubpassDependency, 2> subpassDependencies{};
 
-	// Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	// Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL / DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	// Multisampled color and depth images are shared by all frames in flight, so the previous frame's writes must also be finished
 	// Transition must happen after...
 	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;															// Subpass index (VK_SUBPASS_EXTERNAL = Special value meaning outside of render pass)
-	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;											// Pipeline stage
-	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;													// Stage access mask (memory access)
+	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;	// Pipeline stage (color output chains with the image available semaphore wait)
+	subpassDependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;		// Stage access mask (memory access)
 
 	// But must happen before...
 	subpassDependencies[0].dstSubpass = 0;
-	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	subpassDependencies[0].dependencyFlags = 0;
 
 	// Conversion from VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
@@ -579,8 +1541,8 @@ void VulkanRenderer::CreateRenderPass()
 	// Create info for Render pass
 	VkRenderPassCreateInfo renderPassCreateInfo = {};
 	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
+	renderPassCreateInfo.attachmentCount = multisampled ? 3 : 2;
+	renderPassCreateInfo.pAttachments = attachments.data();
 	renderPassCreateInfo.subpassCount = 1;
 	renderPassCreateInfo.pSubpasses = &subpass;
 	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
@@ -594,15 +1556,11 @@ void VulkanRenderer::CreateRenderPass()
 
 }
 
-void VulkanRenderer::CreateGraphicsPipeline()
+void VulkanRenderer::CreateGraphicsPipeline(const ShaderVariant& shaderVariant)
 {
-	// Read in SPIR-V code of shaders
-	const auto vertexShaderCode = ReadFile("Shaders/vert.spv");
-	const auto fragmentShaderCode = ReadFile("Shaders/frag.spv");
-
 	// Create Shader Modules
-	VkShaderModule vertexShaderModule = CreateShaderModule(vertexShaderCode);
-	VkShaderModule fragmentShaderModule = CreateShaderModule(fragmentShaderCode);
+	VkShaderModule vertexShaderModule = CreateShaderModule(*shaderVariant.pVertexCode);
+	VkShaderModule fragmentShaderModule = CreateShaderModule(*shaderVariant.pFragmentCode);
 
 	// -- SHADER STAGE CREATION INFORMATION --
 	// Vertex Stage creation information
@@ -611,6 +1569,7 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;				// Shader Stage name
 	vertexShaderCreateInfo.module = vertexShaderModule;						// Shader module to be used by stage
 	vertexShaderCreateInfo.pName = "main";									// Entry point in to shader
+	vertexShaderCreateInfo.pSpecializationInfo = &shaderVariant.specializationInfo;	// Feature constants of the variant
 
 	// Fragment Stage creation information
 	VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
@@ -618,6 +1577,7 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;			// Shader Stage name
 	fragmentShaderCreateInfo.module = fragmentShaderModule;					// Shader module to be used by stage
 	fragmentShaderCreateInfo.pName = "main";									// Entry point in to shader
+	fragmentShaderCreateInfo.pSpecializationInfo = &shaderVariant.specializationInfo;
 
 	// Put shader stage creation info in to array
 	// Graphics Pipeline creation info requires array of shader stage creates
@@ -686,17 +1646,17 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	viewportStateCreateInfo.scissorCount = 1;
 	viewportStateCreateInfo.pScissors = &scissor;
 
-	//// -- DYNAMIC STATE --
-	//// Dynamic states to enable
-	//std::vector<VkDynamicState> dynamicStateEnables;
-	//dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);		// Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
-	//dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);		// Dynamic Scissor  : Can resize in command buffer with vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
+	// -- DYNAMIC STATE --
+	// Dynamic states to enable (only with dynamic resolution, the render extent changes every frame)
+	std::vector<VkDynamicState> dynamicStateEnables;
+	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);		// Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
+	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);		// Dynamic Scissor  : Can resize in command buffer with vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
 
-	//// Dynamic state creation info
-	//VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-	//dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	//dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-	//dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+	// Dynamic state creation info
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
 
 
 	// -- RASTERIZER --
@@ -715,7 +1675,7 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
 	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;						// Enable multisample shading or not
-	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;		// Number of samples to use per fragment
+	multisamplingCreateInfo.rasterizationSamples = m_msaaSamples;				// Number of samples to use per fragment
 
 	// -- BLENDING --
 	// Blending decides how to blend a new color being written to a fragment, with the old value
@@ -756,8 +1716,14 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutCreateInfo.setLayoutCount = 0;
 	pipelineLayoutCreateInfo.pSetLayouts = nullptr;
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+	// Model matrix, pushed per draw
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(glm::mat4);
+
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
 
 	// Create Pipeline Layout
@@ -768,7 +1734,13 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	}
 
 	// -- DEPTH STENCIL TESTING
-	// TODO: Set up depth stencil testing
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_TRUE;				// Enable checking depth to determine fragment write
+	depthStencilCreateInfo.depthWriteEnable = VK_TRUE;				// Enable writing to depth buffer (to replace old values)
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;		// Comparison operation that allows an overwrite (is in front)
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;		// Depth Bounds Test: Does the depth value exist between two bounds
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;			// Enable Stencil Test
 
 
 	// -- GRAPHICS PIPELINE CREATION --
@@ -779,127 +1751,585 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;	// All the fixed function pipeline states
 	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
 	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	pipelineCreateInfo.pDynamicState = nullptr;
+	pipelineCreateInfo.pDynamicState = m_bDynamicResolution ? &dynamicStateCreateInfo : nullptr;
 	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
 	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
 	pipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
-	pipelineCreateInfo.pDepthStencilState = nullptr;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
 	pipelineCreateInfo.layout = m_pipelineLayout;						// Pipeline layout the pipeline should use
 	pipelineCreateInfo.renderPass = m_renderPass;						// Render pass description the pipeline is compatible with
 	pipelineCreateInfo.subpass = 0;									// Subpass of render pass to use with pipeline
 
+	// Dynamic rendering: no render pass, the attachment formats are given directly instead
+	VkPipelineRenderingCreateInfo renderingCreateInfo = {};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingCreateInfo.colorAttachmentCount = 1;
+	renderingCreateInfo.pColorAttachmentFormats = &m_sceneColorFormat;
+	renderingCreateInfo.depthAttachmentFormat = m_depthFormat;
+	renderingCreateInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+	if (m_bDynamicRendering)
+	{
+		pipelineCreateInfo.pNext = &renderingCreateInfo;
+		pipelineCreateInfo.renderPass = VK_NULL_HANDLE;
+	}
+
 	// Pipeline Derivatives : Can create multiple pipelines that derive from one another for optimization
 	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;			// Existing pipeline to derive from...
 	pipelineCreateInfo.basePipelineIndex = -1;						// or index of pipeline being created to derive from (in case creating multiple at once)
 
 
-	result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_graphicsPipeline);
-	if (result != VK_SUCCESS)
+	result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_graphicsPipeline);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Graphics Pipeline");
+	}
+
+
+	// Destroy Shader Modules, no longer needed after Pipeline created
+	vkDestroyShaderModule(m_mainDevice.logicalDevice, fragmentShaderModule, nullptr);
+	vkDestroyShaderModule(m_mainDevice.logicalDevice, vertexShaderModule, nullptr);
+}
+
+void VulkanRenderer::CreateFramebuffers()
+{
+	// Resize framebuffer count to equal swap chain image count
+	m_vecSwapChainFramebuffers.resize(m_vecSwapChainImages.size());
+
+	// Create a framebuffer for each swap chain image
+	for (size_t i = 0; i < m_vecSwapChainFramebuffers.size(); ++i)
+	{
+		// Same order as the render pass attachments: color target, depth, resolve target
+		// Without MSAA the swap chain image is the color target and there is no resolve
+		const bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+		std::array <VkImageView, 3> attachments = {
+			multisampled ? m_colorBuffer.GetImageView() : m_vecSwapChainImages[i].imageView,
+			m_depthBuffer.GetImageView(),
+			m_vecSwapChainImages[i].imageView
+		};
+
+
+		VkFramebufferCreateInfo framebufferCreateInfo = {};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.renderPass = m_renderPass;											// Render pass layout the framebuffer will be used with
+		framebufferCreateInfo.attachmentCount = multisampled ? 3 : 2;
+		framebufferCreateInfo.pAttachments = attachments.data();								// List of attachments (1:1 with render pass)
+		framebufferCreateInfo.width = m_swapChainExtent.width;									// Framebuffer width
+		framebufferCreateInfo.height = m_swapChainExtent.height;									// Framebuffer height
+		framebufferCreateInfo.layers = 1;														// Framebuffer layers
+
+		const VkResult result = vkCreateFramebuffer(m_mainDevice.logicalDevice, &framebufferCreateInfo, nullptr, &m_vecSwapChainFramebuffers[i]);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Framebuffer!");
+		}
+	}
+}
+
+void VulkanRenderer::CreateCommandPool()
+{
+	// Get indices of queue families from device
+	const QueueFamilyIndices& queueFamilyIndices = m_queueFamilyIndices;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;	// Frame command buffers are re-recorded every frame
+	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;	// Queue family type that buffers from this command will use
+
+	// Create a Graphics Queue Family COmmand Pool
+	VkResult result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolInfo, nullptr, &m_graphicsCommandPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Command Pool");
+	}
+
+	// Compute buffers are re-recorded every frame as well
+	poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily;
+
+	result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolInfo, nullptr, &m_computeCommandPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Compute Command Pool");
+	}
+}
+
+void VulkanRenderer::CreateCommandBuffers()
+{
+	// Resize command buffer count to have one for each swap chain image
+	m_vecCommandBuffers.resize(m_vecSwapChainImages.size());
+
+	VkCommandBufferAllocateInfo cbAllocInfo = {};
+	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cbAllocInfo.commandPool = m_graphicsCommandPool;
+	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;	// VK_COMMAND_BUFFER_LEVEL_PRIMARY : Buffer you submit directly to queue. Cant be called by other buffers
+															// VK_COMMAND_BUFFER_LEVEL_SECONDARY : Buffer cant be called directly. Can be called by other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer
+	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(m_vecCommandBuffers.size());
+
+	// Allocate command buffers and place handles in array of buffers
+	VkResult result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocInfo, m_vecCommandBuffers.data());
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Command Buffers");
+	}
+
+	// One compute command buffer per frame in flight
+	m_vecComputeCommandBuffers.resize(MAX_FRAME_DRAWS);
+	cbAllocInfo.commandPool = m_computeCommandPool;
+	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(m_vecComputeCommandBuffers.size());
+
+	result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocInfo, m_vecComputeCommandBuffers.data());
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate Compute Command Buffers");
+	}
+}
+
+void VulkanRenderer::CreateSynchronization()
+{
+	m_vecImageAvailable.resize(MAX_FRAME_DRAWS);
+	m_vecRenderFinished.resize(MAX_FRAME_DRAWS);
+	m_vecComputeFinished.resize(MAX_FRAME_DRAWS);
+
+	// Semaphore creation information
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (size_t i = 0; i < MAX_FRAME_DRAWS; ++i)
+	{
+		if (vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &m_vecImageAvailable[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &m_vecRenderFinished[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &m_vecComputeFinished[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Semaphore");
+		}
+	}
+
+	// Replaces per frame fences: frame slots and swapchain images remember the value that frees them
+	// Value 0 is "already complete", so nothing waits before the first submission
+	m_frameTimeline.CreateTimeline(m_mainDevice.logicalDevice);
+	m_arrFrameTimelineValues.fill(0);
+	m_vecImageTimelineValues.assign(m_vecSwapChainImages.size(), 0);
+}
+
+void VulkanRenderer::CreateTimestampQueries()
+{
+	if (!m_bDynamicResolution)
+	{
+		return;
+	}
+
+	// Two per frame slot, a slot's results are read once BeginFrame has waited for its last frame
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = 2 * MAX_FRAME_DRAWS;
+
+	const VkResult result = vkCreateQueryPool(m_mainDevice.logicalDevice, &queryPoolCreateInfo, nullptr, &m_timestampQueryPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Timestamp Query Pool");
+	}
+	m_arrTimestampsWritten.fill(false);
+}
+
+void VulkanRenderer::CreateFrameGraph()
+{
+	m_frameGraph = RenderGraph(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice);
+
+	const bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+	// Swap chain image is swapped per command buffer (see RecordCommands), contents discarded on entry, presented on exit
+	m_swapChainResource = m_frameGraph.ImportImage("SwapChain", m_vecSwapChainImages[0].image, m_vecSwapChainImages[0].imageView,
+		VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, RenderGraphUsage::Present);
+
+	// Offscreen targets are transients: nothing in them outlives the frame, so images whose passes don't overlap
+	// (e.g the MSAA color and the bloom) share memory. Sized for the swap chain, dynamic resolution renders to part of them
+
+	// Offscreen scene color (dynamic resolution, post processing) is what the scene renders or resolves in to, the Output
+	// pass blits it (or what post processing made of it) to the swap chain
+	const bool offscreenScene = m_bDynamicResolution || m_bPostProcessing;
+	RenderGraphImageDesc sceneColorDesc;
+	sceneColorDesc.format = m_sceneColorFormat;
+	sceneColorDesc.extent = m_swapChainExtent;
+	m_sceneColorResource = offscreenScene ? m_frameGraph.CreateImage("SceneColor", sceneColorDesc) : m_swapChainResource;
+
+	RenderGraphImageDesc depthDesc;
+	depthDesc.format = m_depthFormat;
+	depthDesc.extent = m_swapChainExtent;
+	depthDesc.samples = m_msaaSamples;
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	m_depthResource = m_frameGraph.CreateImage("Depth", depthDesc);
+
+	if (multisampled)
+	{
+		RenderGraphImageDesc msaaColorDesc = sceneColorDesc;
+		msaaColorDesc.samples = m_msaaSamples;
+		m_msaaColorResource = m_frameGraph.CreateImage("MsaaColor", msaaColorDesc);
+	}
+	const RenderGraphResource colorResource = multisampled ? m_msaaColorResource : m_sceneColorResource;
+	const RenderGraphResource depthResource = m_depthResource;
+
+	// Simulation runs on the compute queue (see RecordFrame), its buffers are handed to the scene passes and back around them
+	if (m_bParticles)
+	{
+		m_frameGraph.AddPass("ParticlesAcquire", RenderGraphPassType::Graphics,
+			[](RenderGraph::PassBuilder& builder)
+			{
+				builder.SetSideEffect();
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				m_particleSystem.RecordDrawAcquire(commandBuffer);
+			});
+	}
+
+	if (m_bOcclusionCulling)
+	{
+		CreateOcclusionCullingPasses(colorResource, depthResource);
+	}
+	else
+	{
+		m_frameGraph.AddPass("Forward", RenderGraphPassType::Graphics,
+			[this, colorResource, depthResource, multisampled](RenderGraph::PassBuilder& builder)
+			{
+				builder.Write(colorResource, RenderGraphUsage::ColorAttachment);
+				builder.Write(depthResource, RenderGraphUsage::DepthAttachment);
+				if (multisampled)
+				{
+					// Resolve writes the swap chain (or scene color) image in the color attachment output stage
+					builder.Write(m_sceneColorResource, RenderGraphUsage::ColorAttachment);
+				}
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				RecordDynamicRendering(commandBuffer);
+			});
+	}
+
+	if (m_bParticles)
+	{
+		m_frameGraph.AddPass("ParticlesRelease", RenderGraphPassType::Graphics,
+			[](RenderGraph::PassBuilder& builder)
+			{
+				builder.SetSideEffect();
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				m_particleSystem.RecordDrawRelease(commandBuffer);
+			});
+	}
+
+	// The chain syncs its exposure and the stages within the pass, the graph transitions the images it reads and works in
+	RenderGraphResource outputSource = m_sceneColorResource;
+	if (m_bPostProcessing)
+	{
+		RenderGraphImageDesc outputDesc;
+		outputDesc.format = PostProcessChain::OUTPUT_FORMAT;
+		outputDesc.extent = m_swapChainExtent;
+		m_postOutputResource = m_frameGraph.CreateImage("PostOutput", outputDesc);
+		outputSource = m_postOutputResource;
+
+		// Blur samples the bloom it writes, within the pass
+		RenderGraphImageDesc bloomDesc;
+		bloomDesc.format = PostProcessChain::BLOOM_FORMAT;
+		bloomDesc.extent = PostProcessChain::GetBloomExtent(m_swapChainExtent);
+		bloomDesc.extraUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+		m_arrBloomResources[0] = m_frameGraph.CreateImage("BloomA", bloomDesc);
+		m_arrBloomResources[1] = m_frameGraph.CreateImage("BloomB", bloomDesc);
+
+		m_frameGraph.AddPass("PostProcess", RenderGraphPassType::Compute,
+			[this](RenderGraph::PassBuilder& builder)
+			{
+				builder.Read(m_sceneColorResource, RenderGraphUsage::Sampled);
+				builder.Write(m_arrBloomResources[0], RenderGraphUsage::Storage);
+				builder.Write(m_arrBloomResources[1], RenderGraphUsage::Storage);
+				builder.Write(m_postOutputResource, RenderGraphUsage::Storage);
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				m_postProcessChain.RecordPostProcess(commandBuffer, m_renderExtent, m_fFrameDeltaTime);
+			});
+	}
+
+	// GPU frame time ends here, before the blit that has to wait for the swap chain image to be acquired
+	if (m_bDynamicResolution)
+	{
+		m_frameGraph.AddPass("FrameTimerEnd", RenderGraphPassType::Transfer,
+			[](RenderGraph::PassBuilder& builder)
+			{
+				builder.SetSideEffect();
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampQueryPool, 2 * m_uiRecordFrameSlot + 1);
+			});
+	}
+
+	if (offscreenScene)
+	{
+		m_frameGraph.AddPass("Output", RenderGraphPassType::Transfer,
+			[this, outputSource](RenderGraph::PassBuilder& builder)
+			{
+				builder.Read(outputSource, RenderGraphUsage::TransferSrc);
+				builder.Write(m_swapChainResource, RenderGraphUsage::TransferDst);
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				RecordOutputBlit(commandBuffer);
+			});
+	}
+
+	// Last use of the swap chain image, so the graph syncs the copy with whichever pass wrote it and transitions it
+	// back for present afterwards. Records nothing unless a capture is running
+	if (m_bFrameCaptureSupported)
+	{
+		m_frameGraph.AddPass("Capture", RenderGraphPassType::Transfer,
+			[this](RenderGraph::PassBuilder& builder)
+			{
+				builder.Read(m_swapChainResource, RenderGraphUsage::TransferSrc);
+				builder.SetSideEffect();
+			},
+			[this](VkCommandBuffer commandBuffer)
+			{
+				m_frameCapture.RecordCapture(commandBuffer, m_frameGraph.GetImage(m_swapChainResource),
+					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ullRecordFrameValue);
+			});
+	}
+
+	m_frameGraph.Compile();
+
+	// Acquire semaphore is waited on where the swap chain image is first touched: the Output blit's transfer when the
+	// scene renders offscreen, so the scene (and its timing) doesn't wait for the presentation engine
+	const VkPipelineStageFlags swapChainStages = m_frameGraph.GetFirstUseStages(m_swapChainResource);
+	m_swapChainWaitStage = swapChainStages != 0 ? swapChainStages : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+}
+
+void VulkanRenderer::CreateOcclusionCullingPasses(RenderGraphResource colorResource, RenderGraphResource depthResource)
+{
+	const bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+	// Pyramid is built from single sample depth: the depth buffer itself, or its resolve when multisampled
+	if (multisampled)
+	{
+		RenderGraphImageDesc depthResolveDesc;
+		depthResolveDesc.format = m_depthFormat;
+		depthResolveDesc.extent = m_swapChainExtent;
+		depthResolveDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		m_depthResolveResource = m_frameGraph.CreateImage("DepthResolve", depthResolveDesc);
+	}
+	const RenderGraphResource pyramidSource = multisampled ? m_depthResolveResource : depthResource;
+
+	// Passes are declared in execution order. The culler syncs its own buffers and pyramid, the graph only sees the images
+	// the passes share, so the compute passes are kept by their side effects
+	m_frameGraph.AddPass("EarlyCull", RenderGraphPassType::Compute,
+		[](RenderGraph::PassBuilder& builder)
+		{
+			builder.SetSideEffect();
+		},
+		[this](VkCommandBuffer commandBuffer)
+		{
+			m_occlusionCuller.RecordEarlyCull(commandBuffer, m_uiRecordFrameSlot, m_recordSnapshot.model);
+		});
+
+	m_frameGraph.AddPass("EarlyForward", RenderGraphPassType::Graphics,
+		[colorResource, depthResource, pyramidSource, multisampled](RenderGraph::PassBuilder& builder)
+		{
+			builder.Write(colorResource, RenderGraphUsage::ColorAttachment);
+			builder.Write(depthResource, RenderGraphUsage::DepthAttachment);
+			if (multisampled)
+			{
+				builder.Write(pyramidSource, RenderGraphUsage::DepthAttachment);		// Depth resolve
+			}
+		},
+		[this](VkCommandBuffer commandBuffer)
+		{
+			RecordDynamicRendering(commandBuffer, ScenePass::Early);
+		});
+
+	m_frameGraph.AddPass("DepthPyramid", RenderGraphPassType::Compute,
+		[pyramidSource](RenderGraph::PassBuilder& builder)
+		{
+			builder.Read(pyramidSource, RenderGraphUsage::Sampled);
+			builder.SetSideEffect();
+		},
+		[this](VkCommandBuffer commandBuffer)
+		{
+			m_occlusionCuller.RecordDepthPyramid(commandBuffer, m_renderExtent);
+			m_occlusionCuller.RecordLateCull(commandBuffer, m_uiRecordFrameSlot, m_recordSnapshot.model);
+		});
+
+	// Loads what the early pass drew. Depth is only written: the write after write keeps the early contents,
+	// a read would ask for the read only layout in the same pass
+	m_frameGraph.AddPass("LateForward", RenderGraphPassType::Graphics,
+		[this, colorResource, depthResource, multisampled](RenderGraph::PassBuilder& builder)
+		{
+			builder.Read(colorResource, RenderGraphUsage::ColorAttachment);
+			builder.Write(colorResource, RenderGraphUsage::ColorAttachment);
+			builder.Write(depthResource, RenderGraphUsage::DepthAttachment);
+			if (multisampled)
+			{
+				builder.Write(m_sceneColorResource, RenderGraphUsage::ColorAttachment);
+			}
+		},
+		[this](VkCommandBuffer commandBuffer)
+		{
+			RecordDynamicRendering(commandBuffer, ScenePass::Late);
+		});
+}
+
+void VulkanRenderer::RecordDynamicRendering(VkCommandBuffer commandBuffer, ScenePass pass) const
+{
+	const bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+	// Scene color is the swap chain image unless rendering offscreen (dynamic resolution, post processing)
+	const VkImageView outputImageView = m_frameGraph.GetImageView(m_sceneColorResource);
+
+	// Early pass of occlusion culling keeps color and depth for the late pass, which loads them and finishes the frame
+	const bool early = pass == ScenePass::Early;
+	const bool resolveColor = multisampled && !early;
+
+	// Color attachment: same load/store/resolve behaviour as the render pass path
+	VkRenderingAttachmentInfo colorAttachmentInfo = {};
+	colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachmentInfo.imageView = multisampled ? m_frameGraph.GetImageView(m_msaaColorResource) : outputImageView;
+	colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentInfo.resolveMode = resolveColor ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE;
+	colorAttachmentInfo.resolveImageView = resolveColor ? outputImageView : VK_NULL_HANDLE;
+	colorAttachmentInfo.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentInfo.loadOp = pass == ScenePass::Late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachmentInfo.storeOp = resolveColor ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachmentInfo.clearValue.color = { {0.6f, 0.65f, 0.4f, 1.0f} };
+
+	VkRenderingAttachmentInfo depthAttachmentInfo = {};
+	depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachmentInfo.imageView = m_frameGraph.GetImageView(m_depthResource);
+	depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachmentInfo.resolveMode = VK_RESOLVE_MODE_NONE;
+	depthAttachmentInfo.loadOp = pass == ScenePass::Late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachmentInfo.storeOp = early ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachmentInfo.clearValue.depthStencil.depth = 1.0f;
+	if (early && multisampled)
 	{
-		throw std::runtime_error("Failed to create a Graphics Pipeline");
+		// Single sample depth for the pyramid
+		depthAttachmentInfo.resolveMode = m_depthResolveMode;
+		depthAttachmentInfo.resolveImageView = m_frameGraph.GetImageView(m_depthResolveResource);
+		depthAttachmentInfo.resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	}
 
-
-	// Destroy Shader Modules, no longer needed after Pipeline created
-	vkDestroyShaderModule(m_mainDevice.logicalDevice, fragmentShaderModule, nullptr);
-	vkDestroyShaderModule(m_mainDevice.logicalDevice, vertexShaderModule, nullptr);
+	VkRenderingInfo renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = m_renderExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachmentInfo;
+	renderingInfo.pDepthAttachment = &depthAttachmentInfo;
+
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+		if (m_bDynamicResolution)
+		{
+			// Same NDC to the smaller area, the upscale stretches it back over the swap chain
+			VkViewport viewport = {};
+			viewport.width = static_cast<float>(m_renderExtent.width);
+			viewport.height = static_cast<float>(m_renderExtent.height);
+			viewport.maxDepth = 1.0f;
+			const VkRect2D scissor = { { 0, 0 }, m_renderExtent };
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		}
+		RecordSceneDraws(commandBuffer, pass);
+		RecordParticleDraws(commandBuffer, pass);
+	vkCmdEndRendering(commandBuffer);
 }
 
-void VulkanRenderer::CreateFramebuffers()
+void VulkanRenderer::RecordSceneDraws(VkCommandBuffer commandBuffer, ScenePass pass) const
 {
-	// Resize framebuffer count to equal swap chain image count
-	m_vecSwapChainFramebuffers.resize(m_vecSwapChainImages.size());
-
-	// Create a framebuffer for each swap chain image
-	for (size_t i = 0; i < m_vecSwapChainFramebuffers.size(); ++i)
+	// Vertex data still on its way, nothing to draw yet (the pass still clears)
+	if (!m_bDrawFirstMesh)
 	{
-		std::array <VkImageView, 1> attachments = {
-			m_vecSwapChainImages[i].imageView
-		};
+		return;
+	}
 
+	// Bind Pipeline to be used with render pass
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
 
-		VkFramebufferCreateInfo framebufferCreateInfo = {};
-		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferCreateInfo.renderPass = m_renderPass;											// Render pass layout the framebuffer will be used with
-		framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferCreateInfo.pAttachments = attachments.data();								// List of attachments (1:1 with render pass)
-		framebufferCreateInfo.width = m_swapChainExtent.width;									// Framebuffer width
-		framebufferCreateInfo.height = m_swapChainExtent.height;									// Framebuffer height
-		framebufferCreateInfo.layers = 1;														// Framebuffer layers
+	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_recordSnapshot.model);
 
-		const VkResult result = vkCreateFramebuffer(m_mainDevice.logicalDevice, &framebufferCreateInfo, nullptr, &m_vecSwapChainFramebuffers[i]);
-		if (result != VK_SUCCESS)
+	// Pooled meshes share one vertex and index buffer, bound once however many of them are drawn
+	if (m_firstMesh.IsPooled())
+	{
+		m_geometryPool.Bind(commandBuffer);
+	}
+	else
+	{
+		const VkBuffer vertexBuffers[] = { m_firstMesh.GetVertexBuffer() };		// Buffers to bind
+		constexpr VkDeviceSize offsets[] = { 0 };									// Offsets into buffers being bound
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);		// Command to bind the vertex buffer before drawing to it
+		if (m_firstMesh.HasIndices())
 		{
-			throw std::runtime_error("Failed to create a Framebuffer!");
+			vkCmdBindIndexBuffer(commandBuffer, m_firstMesh.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 		}
 	}
-}
-
-void VulkanRenderer::CreateCommandPool()
-{
-	// Get indices of queue families from device
-	QueueFamilyIndices queueFamilyIndices = GetQueueFamilies(m_mainDevice.physicalDevice);
-
-	VkCommandPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;	// Queue family type that buffers from this command will use
 
-	// Create a Graphics Queue Family COmmand Pool
-	VkResult result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolInfo, nullptr, &m_graphicsCommandPool);
-	if (result != VK_SUCCESS)
+	// Execute pipeline
+	if (pass != ScenePass::All && m_firstMesh.HasIndices())
 	{
-		throw std::runtime_error("Failed to create a Command Pool");
+		// Draw arguments were written by the cull shader (see RecordFrame for the objects)
+		if (pass == ScenePass::Early)
+		{
+			m_occlusionCuller.RecordEarlyDraws(commandBuffer);
+		}
+		else
+		{
+			m_occlusionCuller.RecordLateDraws(commandBuffer);
+		}
+	}
+	else if (pass == ScenePass::Late)
+	{
+		// Meshes the culler can't draw indexed are drawn unculled, in the early pass
+		return;
+	}
+	else if (m_firstMesh.HasIndices())
+	{
+		// Level picked for this frame in RecordFrame, only its range of the index buffer is drawn, offset to where the mesh lives
+		const MeshLod& lod = m_firstMesh.GetLods()[m_uiFirstMeshLod];
+		vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, m_firstMesh.GetFirstIndex() + lod.firstIndex,
+			static_cast<int32_t>(m_firstMesh.GetVertexOffset()), 0);
+	}
+	else
+	{
+		vkCmdDraw(commandBuffer, static_cast<uint32_t>(m_firstMesh.GetVertexCount()), 1, 0, 0);
 	}
 }
 
-void VulkanRenderer::CreateCommandBuffers()
+void VulkanRenderer::RecordParticleDraws(VkCommandBuffer commandBuffer, ScenePass pass) const
 {
-	// Resize command buffer count to have one for each framebuffer
-	m_vecCommandBuffers.resize(m_vecSwapChainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo cbAllocInfo = {};
-	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	cbAllocInfo.commandPool = m_graphicsCommandPool;
-	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;	// VK_COMMAND_BUFFER_LEVEL_PRIMARY : Buffer you submit directly to queue. Cant be called by other buffers
-															// VK_COMMAND_BUFFER_LEVEL_SECONDARY : Buffer cant be called directly. Can be called by other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer
-	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(m_vecCommandBuffers.size());
-
-	// Allocate command buffers and place handles in array of buffers
-	const VkResult result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocInfo, m_vecCommandBuffers.data());
-	if (result != VK_SUCCESS)
+	// Particles aren't culled, they go in the pass that finishes the frame after the (opaque) scene
+	if (!m_bParticles || pass == ScenePass::Early)
 	{
-		throw std::runtime_error("Failed to allocate Command Buffers");
+		return;
 	}
+
+	// No camera yet, particles are simulated in clip space
+	m_particleSystem.RecordDraw(commandBuffer, glm::mat4(1.0f));
 }
 
-void VulkanRenderer::CreateSynchronization()
+void VulkanRenderer::RecordOutputBlit(VkCommandBuffer commandBuffer) const
 {
-	m_vecImageAvailable.resize(MAX_FRAME_DRAWS);
-	m_vecRenderFinished.resize(MAX_FRAME_DRAWS);
-	m_vecDrawFences.resize(MAX_FRAME_DRAWS);
-
-	// Semaphore creation information
-	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	// Fence creation information
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (size_t i = 0; i < MAX_FRAME_DRAWS; ++i)
-	{
-		if (vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &m_vecImageAvailable[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &m_vecRenderFinished[i]) != VK_SUCCESS ||
-			vkCreateFence(m_mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &m_vecDrawFences[i]) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create a Semaphore/Fence");
-		}
-	}
-	
+	// Rendered area stretched over the whole swap chain image (graph has done the layouts). Also converts the post
+	// processing output's RGBA to the swap chain's channel order
+	VkImageBlit blit = {};
+	blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.srcOffsets[1] = { static_cast<int32_t>(m_renderExtent.width), static_cast<int32_t>(m_renderExtent.height), 1 };
+	blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.dstOffsets[1] = { static_cast<int32_t>(m_swapChainExtent.width), static_cast<int32_t>(m_swapChainExtent.height), 1 };
+
+	const VkImage sourceImage = m_frameGraph.GetImage(m_bPostProcessing ? m_postOutputResource : m_sceneColorResource);
+	const bool scaled = m_renderExtent.width != m_swapChainExtent.width || m_renderExtent.height != m_swapChainExtent.height;
+	vkCmdBlitImage(commandBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		m_frameGraph.GetImage(m_swapChainResource), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+		scaled ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
 }
 
-void VulkanRenderer::RecordCommands() const
+void VulkanRenderer::RecordCommands(uint32_t imageIndex, LinearArena& frameArena)
 {
 	// Information about how to begin each command buffer
 	VkCommandBufferBeginInfo bufferBeginInfo = {};
@@ -912,48 +2342,79 @@ void VulkanRenderer::RecordCommands() const
 	renderPassBeginInfo.renderPass = m_renderPass;							// Render Pass to begin
 	renderPassBeginInfo.renderArea.offset = { 0,0 };						// Start point of render pass in pixels
 	renderPassBeginInfo.renderArea.extent = m_swapChainExtent;				// Size of region to run render pass on (starting at offset)
-	constexpr VkClearValue clearValues[] = {
-		{{{0.6f, 0.65f, 0.4f, 1.0f}}}
-	};
+	// Clear values per attachment (resolve target isn't cleared, so only color and depth)
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = { {0.6f, 0.65f, 0.4f, 1.0f} };
+	clearValues[1].depthStencil.depth = 1.0f;
 
-	renderPassBeginInfo.pClearValues = clearValues;							// List of clear values (TODO: Depth Attachment clear value)
-	renderPassBeginInfo.clearValueCount = 1;
+	renderPassBeginInfo.pClearValues = clearValues.data();					// List of clear values
+	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	
 
-	for (size_t i = 0; i < m_vecCommandBuffers.size(); i++)
+	// Caller has waited for the last frame that used this image, so its command buffer is no longer pending
+	const VkCommandBuffer commandBuffer = m_vecCommandBuffers[imageIndex];
+
+	// Start recording commands to command buffer
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+	if (result != VK_SUCCESS)
 	{
-		renderPassBeginInfo.framebuffer = m_vecSwapChainFramebuffers[i];
+		throw std::runtime_error("Failed to start recording a Command Buffer");
+	}
 
-		// Start recording commands to command buffer
-		VkResult result = vkBeginCommandBuffer(m_vecCommandBuffers[i], &bufferBeginInfo);
-		if (result != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to start recording a Command Buffer");
-		}
+	// Scene and post processing are timed, dynamic resolution scales from it. The FrameTimerEnd pass writes the end,
+	// before the output blit, the only work that waits for the swap chain image
+	if (m_bDynamicResolution)
+	{
+		vkCmdResetQueryPool(commandBuffer, m_timestampQueryPool, 2 * m_uiRecordFrameSlot, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampQueryPool, 2 * m_uiRecordFrameSlot);
+		m_arrTimestampsWritten[m_uiRecordFrameSlot] = true;
+	}
 
-			//Begin Render Pass
-			vkCmdBeginRenderPass(m_vecCommandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	if (m_bDynamicRendering)
+	{
+		// Frame graph emits the layout transitions and calls RecordDynamicRendering
+		m_frameGraph.SetImportedImage(m_swapChainResource, m_vecSwapChainImages[imageIndex].image, m_vecSwapChainImages[imageIndex].imageView);
+		m_frameGraph.Execute(commandBuffer, &frameArena);
+	}
+	else
+	{
+		renderPassBeginInfo.framebuffer = m_vecSwapChainFramebuffers[imageIndex];
 
-				// Bind Pipeline to be used with render pass
-				vkCmdBindPipeline(m_vecCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+		// Particles simulated on the compute queue are handed over outside the render pass
+		if (m_bParticles)
+		{
+			m_particleSystem.RecordDrawAcquire(commandBuffer);
+		}
 
-				const VkBuffer vertexBuffers[] = { m_firstMesh.GetVertexBuffer() };																			// Buffers to bind
-				constexpr VkDeviceSize offsets[] = { 0 };																										// Offsets into buffers being bound
-				vkCmdBindVertexBuffers(m_vecCommandBuffers[i], 0, 1, vertexBuffers, offsets);		// Command to bind the vertex buffer before drawing to it
+		//Begin Render Pass
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-				// Execute pipeline
-				vkCmdDraw(m_vecCommandBuffers[i], static_cast<uint32_t>(m_firstMesh.GetVertexCount()), 1, 0, 0);
+			RecordSceneDraws(commandBuffer);
+			RecordParticleDraws(commandBuffer);
 
-			// End Render Pass
-			vkCmdEndRenderPass(m_vecCommandBuffers[i]);
+		// End Render Pass
+		vkCmdEndRenderPass(commandBuffer);
 
-		// Stop recording to command buffer
-		result = vkEndCommandBuffer(m_vecCommandBuffers[i]);
-		if (result != VK_SUCCESS)
+		if (m_bParticles)
 		{
-			throw std::runtime_error("Failed to stop recording a Command Buffer");
+			m_particleSystem.RecordDrawRelease(commandBuffer);
 		}
 	}
+
+	// Render pass path: image is in present layout now, copy it out if a capture is running (never waits, drops the
+	// frame if the ring is full). The frame graph has a pass of its own for it
+	if (m_bFrameCaptureSupported && !m_bDynamicRendering)
+	{
+		m_frameCapture.RecordCapture(commandBuffer, m_vecSwapChainImages[imageIndex].image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			m_ullRecordFrameValue);
+	}
+
+	// Stop recording to command buffer
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to stop recording a Command Buffer");
+	}
 }
 
 void VulkanRenderer::GetPhysicalDevice()
@@ -971,24 +2432,205 @@ void VulkanRenderer::GetPhysicalDevice()
 	std::vector<VkPhysicalDevice> deviceList(deviceCount);
 	vkEnumeratePhysicalDevices(m_instance, &deviceCount, deviceList.data());
 
+	// Explicit override (e.g force lavapipe with "llvmpipe") wins over scoring, as long as the device is usable
+	std::string deviceOverride = m_strDeviceOverride;
+	if (deviceOverride.empty())
+	{
+		const char* environmentOverride = std::getenv("VULKAN_DEVICE");
+		deviceOverride = environmentOverride != nullptr ? environmentOverride : "";
+	}
+
+	VkPhysicalDevice bestDevice = VK_NULL_HANDLE;
+	uint64_t bestScore = 0;
+	bool overridden = false;
+
 	for (const auto& device : deviceList)
 	{
-		if (CheckDeviceSuitable(device))
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+		if (!CheckDeviceSuitable(device))
+		{
+			printf("Device: %s (%s) - not suitable\n", deviceProperties.deviceName, GetDeviceUuidString(device).c_str());
+			continue;
+		}
+
+		const uint64_t score = RateDevice(device);
+		printf("Device: %s (%s) - score %llu\n", deviceProperties.deviceName, GetDeviceUuidString(device).c_str(),
+			static_cast<unsigned long long>(score));
+
+		if (overridden)
+		{
+			continue;
+		}
+
+		if (!deviceOverride.empty() && CheckDeviceMatchesOverride(device, deviceOverride))
+		{
+			bestDevice = device;
+			overridden = true;
+			continue;
+		}
+
+		// + 1 so a device scoring 0 is still picked over none
+		if (score + 1 > bestScore)
+		{
+			bestDevice = device;
+			bestScore = score + 1;
+		}
+	}
+
+	if (bestDevice == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Can't find a GPU that supports the required features");
+	}
+
+	if (!deviceOverride.empty() && !overridden)
+	{
+		printf("Device override \"%s\" matched no suitable device, using best score instead\n", deviceOverride.c_str());
+	}
+
+	m_mainDevice.physicalDevice = bestDevice;
+	m_queueFamilyIndices = GetQueueFamilies(bestDevice);
+
+	VkPhysicalDeviceProperties chosenProperties;
+	vkGetPhysicalDeviceProperties(bestDevice, &chosenProperties);
+	printf("Selected device: %s (%s) - graphics family %d, present family %d, compute family %d, transfer family %d\n",
+		chosenProperties.deviceName, overridden ? "override" : "highest score",
+		m_queueFamilyIndices.graphicsFamily, m_queueFamilyIndices.presentationFamily,
+		m_queueFamilyIndices.computeFamily, m_queueFamilyIndices.transferFamily);
+}
+
+uint64_t VulkanRenderer::RateDevice(VkPhysicalDevice device) const
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+	VkPhysicalDeviceFeatures deviceFeatures;
+	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+
+	uint64_t score = 0;
+
+	// Device type dominates: any discrete GPU beats any integrated GPU, which beats software rasterizers
+	switch (deviceProperties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:		score += 1000000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:	score += 100000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:		score += 50000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:				score += 0; break;
+	default:										score += 1000; break;
+	}
+
+	// Largest device local heap, in MiB (capped so it can't outweigh the device type)
+	VkDeviceSize largestLocalHeap = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
 		{
-			m_mainDevice.physicalDevice = device;
-			break;
+			largestLocalHeap = std::max(largestLocalHeap, memoryProperties.memoryHeaps[i].size);
 		}
 	}
+	score += std::min<uint64_t>(largestLocalHeap / (1024 * 1024), 49999);
+
+	// Limits and features as tie breakers between similar devices
+	score += deviceProperties.limits.maxImageDimension2D / 64;
+	score += deviceFeatures.samplerAnisotropy ? 100 : 0;
+	score += deviceFeatures.multiDrawIndirect ? 100 : 0;
+	score += (deviceProperties.limits.framebufferColorSampleCounts & VK_SAMPLE_COUNT_4_BIT) ? 50 : 0;
+
+	// One family that does graphics and present avoids CONCURRENT swapchain images
+	const QueueFamilyIndices indices = GetQueueFamilies(device);
+	score += indices.graphicsFamily == indices.presentationFamily ? 500 : 0;
+	score += indices.HasDedicatedCompute() ? 200 : 0;
+	score += indices.HasDedicatedTransfer() ? 100 : 0;
+
+	return score;
+}
+
+std::string VulkanRenderer::GetDeviceUuidString(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceIDProperties idProperties = {};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 deviceProperties2 = {};
+	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties2.pNext = &idProperties;
+	vkGetPhysicalDeviceProperties2(device, &deviceProperties2);
+
+	// Plain lowercase hex, no dashes
+	static const char hexDigits[] = "0123456789abcdef";
+	std::string uuid;
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+	{
+		uuid += hexDigits[idProperties.deviceUUID[i] >> 4];
+		uuid += hexDigits[idProperties.deviceUUID[i] & 0xF];
+	}
+	return uuid;
+}
+
+bool VulkanRenderer::CheckDeviceMatchesOverride(VkPhysicalDevice device, const std::string& nameOrUuid)
+{
+	auto toLower = [](std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	};
+
+	// UUIDs are often written with dashes, compare without them
+	std::string wanted = toLower(nameOrUuid);
+	std::string wantedUuid = wanted;
+	wantedUuid.erase(std::remove(wantedUuid.begin(), wantedUuid.end(), '-'), wantedUuid.end());
+
+	if (wantedUuid == GetDeviceUuidString(device))
+	{
+		return true;
+	}
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+	return toLower(deviceProperties.deviceName).find(wanted) != std::string::npos;
+}
+
+void VulkanRenderer::TimeStartupPhase(const char* name, const std::function<void()>& phase)
+{
+	const auto begin = std::chrono::steady_clock::now();
+	phase();
+	const auto end = std::chrono::steady_clock::now();
+
+	StartupPhase startupPhase;
+	startupPhase.name = name;
+	startupPhase.startMs = std::chrono::duration<double, std::milli>(begin - m_startupBegin).count();
+	startupPhase.durationMs = std::chrono::duration<double, std::milli>(end - begin).count();
+
+	std::lock_guard<std::mutex> lock(m_startupMutex);
+	m_vecStartupPhases.push_back(std::move(startupPhase));
+}
+
+void VulkanRenderer::PrintStartupPhases() const
+{
+	std::vector<StartupPhase> phases = m_vecStartupPhases;
+	std::sort(phases.begin(), phases.end(), [](const StartupPhase& a, const StartupPhase& b) { return a.startMs < b.startMs; });
+
+	double totalMs = 0.0;
+	printf("Startup (%s):\n", PARALLEL_STARTUP ? "parallel" : "serial");
+	for (const StartupPhase& phase : phases)
+	{
+		printf("  %-18s %8.2f ms at %8.2f ms\n", phase.name.c_str(), phase.durationMs, phase.startMs);
+		totalMs = std::max(totalMs, phase.startMs + phase.durationMs);
+	}
+	printf("  %-18s %8.2f ms\n", "Total", totalMs);
 }
 
-void VulkanRenderer::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo)
+void VulkanRenderer::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo, DebugMessageSink* debugMessageSink)
 {
 	createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
 	createInfo.messageSeverity = /*VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |*/ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
 	createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
 	createInfo.pfnUserCallback = reinterpret_cast<PFN_vkDebugUtilsMessengerCallbackEXT>(debugCallback);
-	createInfo.pUserData = nullptr;
+	createInfo.pUserData = debugMessageSink;						// Messages are queued to the sink, printed on its thread
 }
 
 SwapChainDetails VulkanRenderer::GetSwapChainDetails(VkPhysicalDevice device) const
@@ -1049,8 +2691,20 @@ VkSurfaceFormatKHR VulkanRenderer::ChooseBestSurfaceFormat(const std::vector<VkS
 	return formats[0];
 }
 
-VkPresentModeKHR VulkanRenderer::ChooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes)
+VkPresentModeKHR VulkanRenderer::ChooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes, bool uncapped)
 {
+	// Immediate never waits for a vertical blank, frames go as fast as the GPU takes them
+	if (uncapped)
+	{
+		for (const auto& presentationMode : presentationModes)
+		{
+			if (presentationMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+			{
+				return presentationMode;
+			}
+		}
+	}
+
 	// Look for Mailbox presentation mode
 	for (const auto& presentationMode : presentationModes)
 	{
@@ -1073,9 +2727,13 @@ VkExtent2D VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& surf
 	}
 	else
 	{
-		// If value can vary, need to set manually
-		int width, height;
-		glfwGetFramebufferSize(m_pWindow, &width, &height);
+		// If value can vary, need to set manually (headless surfaces have no window to take it from)
+		int width = static_cast<int>(m_headlessExtent.width);
+		int height = static_cast<int>(m_headlessExtent.height);
+		if (!m_bHeadless)
+		{
+			glfwGetFramebufferSize(m_pWindow, &width, &height);
+		}
 
 		// Create new extent using window size
 		VkExtent2D newExtent = {};
@@ -1090,6 +2748,50 @@ VkExtent2D VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& surf
 	}
 }
 
+VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags) const
+{
+	// Loop through options and find compatible one
+	for (const VkFormat format : formats)
+	{
+		// Get properties for given format on this device
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_mainDevice.physicalDevice, format, &properties);
+
+		// Depending on tiling choice, need to check for different bit flag
+		if (tiling == VK_IMAGE_TILING_LINEAR && (properties.linearTilingFeatures & featureFlags) == featureFlags)
+		{
+			return format;
+		}
+		if (tiling == VK_IMAGE_TILING_OPTIMAL && (properties.optimalTilingFeatures & featureFlags) == featureFlags)
+		{
+			return format;
+		}
+	}
+
+	throw std::runtime_error("Failed to find a matching format!");
+}
+
+VkSampleCountFlagBits VulkanRenderer::ChooseMsaaSamples(VkSampleCountFlagBits requested) const
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+
+	// Color and depth attachments share a subpass, so both must support the sample count
+	const VkSampleCountFlags supported = deviceProperties.limits.framebufferColorSampleCounts
+		& deviceProperties.limits.framebufferDepthSampleCounts;
+
+	// Sample count bits are powers of two, step down from the requested count until one is supported
+	for (uint32_t samples = requested; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1)
+	{
+		if (supported & samples)
+		{
+			return static_cast<VkSampleCountFlagBits>(samples);
+		}
+	}
+
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
 VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlagBits aspectFlags) const
 {
 	VkImageViewCreateInfo viewCreateInfo = {};
@@ -1120,6 +2822,68 @@ VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkIm
 	return imageView;
 }
 
+VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+	VkSampleCountFlagBits samples, VkMemoryPropertyFlags preferredProperties, VkMemoryPropertyFlags fallbackProperties,
+	VkDeviceMemory* outImageMemory)
+{
+	// CREATE IMAGE
+	// Image creation info
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;						// Type of image (1D, 2D, or 3D)
+	imageCreateInfo.extent.width = width;								// Width of image extent
+	imageCreateInfo.extent.height = height;								// Height of image extent
+	imageCreateInfo.extent.depth = 1;									// Depth of image (just 1, no 3D aspect)
+	imageCreateInfo.mipLevels = 1;										// Number of mipmap levels
+	imageCreateInfo.arrayLayers = 1;									// Number of levels in image array
+	imageCreateInfo.format = format;									// Format type of image
+	imageCreateInfo.tiling = tiling;									// How image data should be "tiled" (arranged for optimal reading)
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Layout of image data on creation
+	imageCreateInfo.usage = usage;										// Bit flags defining what image will be used for
+	imageCreateInfo.samples = samples;									// Number of samples for multi-sampling
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;			// Whether image can be shared between queues
+
+	VkImage image;
+	VkResult result = vkCreateImage(m_mainDevice.logicalDevice, &imageCreateInfo, nullptr, &image);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create an Image!");
+	}
+
+	// CREATE MEMORY FOR IMAGE
+	// Get memory requirements for a type of image
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(m_mainDevice.logicalDevice, image, &memoryRequirements);
+
+	// Try the preferred properties first (e.g lazily allocated), then the fallback
+	uint32_t memoryTypeIndex = FindMemoryTypeIndex(m_mainDevice.physicalDevice, memoryRequirements.memoryTypeBits, preferredProperties);
+	if (memoryTypeIndex == UINT32_MAX)
+	{
+		memoryTypeIndex = FindMemoryTypeIndex(m_mainDevice.physicalDevice, memoryRequirements.memoryTypeBits, fallbackProperties);
+	}
+	if (memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("Failed to find memory type for an Image!");
+	}
+
+	// Allocate memory using image requirements and chosen memory type
+	VkMemoryAllocateInfo memoryAllocInfo = {};
+	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocInfo.allocationSize = memoryRequirements.size;
+	memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	result = m_memoryBudget.Allocate(memoryAllocInfo, MemoryCategory::RenderTarget, outImageMemory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate memory for image!");
+	}
+
+	// Connect memory to image
+	vkBindImageMemory(m_mainDevice.logicalDevice, image, *outImageMemory, 0);
+
+	return image;
+}
+
 VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char>& code) const
 {
 	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
@@ -1144,7 +2908,7 @@ void VulkanRenderer::SetupDebugMessenger()
 	}
 
 	VkDebugUtilsMessengerCreateInfoEXT createInfo;
-	PopulateDebugMessengerCreateInfo(createInfo);
+	PopulateDebugMessengerCreateInfo(createInfo, &m_debugMessageSink);
 
 	if (g_CreateDebugUtilsMessengerExt(m_instance, &createInfo, nullptr, &m_debugMessenger) != VK_SUCCESS)
 	{
@@ -1152,7 +2916,7 @@ void VulkanRenderer::SetupDebugMessenger()
 	}
 }
 
-bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
+bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device) const
 {
 	// Get device extension count
 	uint32_t extensionCount = 0;
@@ -1165,7 +2929,8 @@ bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 	}
 
 	// Populate list of extension
-	std::vector<VkExtensionProperties> extensions(extensionCount);
+	const LinearArena::Scope scratchScope(m_scratchArena);
+	ArenaVector<VkExtensionProperties> extensions(extensionCount, ArenaAllocator<VkExtensionProperties>(&m_scratchArena));
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
 
 	// Check for extension
@@ -1190,6 +2955,25 @@ bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 	return true;
 }
 
+bool VulkanRenderer::IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) const
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	const LinearArena::Scope scratchScope(m_scratchArena);
+	ArenaVector<VkExtensionProperties> extensions(extensionCount, ArenaAllocator<VkExtensionProperties>(&m_scratchArena));
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+	for (const auto& extension : extensions)
+	{
+		if (strcmp(extensionName, extension.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 
 
 
@@ -2,11 +2,36 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <VulkanRenderer.h>
+#include <JobSystem.h>
+#include <TripleBuffer.hpp>
+
+// Headless benchmark suite (mainBenchmark.cpp)
+int mainBenchmark();
+// Frame trace replay (mainReplay.cpp)
+int mainReplay(const std::string& traceFileName, uint32_t loops);
+// Steady state Draw() heap allocation check (mainTestAllocations.cpp, counts only in a build with ALLOCATION_CHECK defined)
+int mainTestAllocations(uint32_t frames);
+// Geometry pool range allocator check (mainTestRangeAllocator.cpp)
+int mainTestRangeAllocator();
+// Mesh level of detail check (mainTestMeshLod.cpp)
+int mainTestMeshLod();
+// Mesh optimizer passes check (mainTestMeshOptimizer.cpp)
+int mainTestMeshOptimizer();
+// Job system stress check (mainTestJobSystem.cpp)
+int mainTestJobSystem();
+// Frame trace round trip check (mainTestFrameTrace.cpp)
+int mainTestFrameTrace();
 
 GLFWwindow* g_window;
 VulkanRenderer g_vulkanRenderer;
+JobSystem g_jobSystem;
 
 
 
@@ -26,8 +51,212 @@ void initWindow(const std::string& wName = "Test Window", const int width = 800,
 	g_window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
 }
 
-int main()
+// F11 starts and stops a frame trace, replayed later with --replay
+void toggleFrameTrace()
 {
+	if (g_vulkanRenderer.IsFrameTracing())
+	{
+		printf(g_vulkanRenderer.StopFrameTrace() ? "Frame trace written\n" : "Failed to write the frame trace\n");
+		return;
+	}
+
+	const std::string fileName = "trace_" + std::to_string(g_vulkanRenderer.GetLastSubmittedFrameValue()) + ".vft";
+	g_vulkanRenderer.StartFrameTrace(fileName);
+	printf("Tracing frames to %s, F11 again to stop\n", fileName.c_str());
+}
+
+// F12 saves the next frame as a PPM, written on the capture worker so the frame loop never waits for the disk
+void onKey(GLFWwindow* window, const int key, const int scancode, const int action, const int mods)
+{
+	if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+	{
+		toggleFrameTrace();
+		return;
+	}
+	if (key != GLFW_KEY_F12 || action != GLFW_PRESS)
+	{
+		return;
+	}
+
+	FrameCapture* frameCapture = g_vulkanRenderer.GetFrameCapture();
+	if (frameCapture == nullptr)
+	{
+		printf("Frame capture isn't supported by this surface\n");
+		return;
+	}
+
+	frameCapture->StartCapture([](const CapturedFrame& frame)
+	{
+		const std::string fileName = "capture_" + std::to_string(frame.frameValue) + ".ppm";
+		if (FrameCapture::WritePpm(frame, fileName))
+		{
+			printf("Captured frame %llu to %s\n", static_cast<unsigned long long>(frame.frameValue), fileName.c_str());
+		}
+	});
+}
+
+// Simulation stage: scene state for the frame shown at the given time
+FrameSnapshot simulate(const double time)
+{
+	FrameSnapshot snapshot;
+	snapshot.time = time;
+	snapshot.model = glm::rotate(glm::mat4(1.0f), static_cast<float>(time) * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	return snapshot;
+}
+
+// Frames pipelined on the job system over three stages: while frame N is recorded, frame N+1 is simulated and
+// frame N-1 is submitted/presented. Snapshot N % 2 is read by the record stage, (N + 1) % 2 written by the simulation
+void runJobPipeline()
+{
+	g_jobSystem.InitJobSystem();
+
+	std::array<FrameSnapshot, 2> snapshots;
+	snapshots[0] = simulate(glfwGetTime());
+	VulkanRenderer::FrameContext recordFrame = g_vulkanRenderer.BeginFrame();
+	VulkanRenderer::FrameContext submitFrame;
+	bool hasSubmitFrame = false;
+	uint64_t frameIndex = 0;
+
+	//Loop until closed
+	while (!glfwWindowShouldClose(g_window))
+	{
+		JobCounter inputCounter;
+		JobCounter frameCounter;
+
+		// Window events can only be pumped on the main thread, the simulation reads the input they produce
+		g_jobSystem.RunOnMainThread([] { glfwPollEvents(); }, &inputCounter);
+
+		FrameSnapshot& nextSnapshot = snapshots[(frameIndex + 1) % 2];
+		g_jobSystem.Run([&nextSnapshot] { nextSnapshot = simulate(glfwGetTime()); }, &frameCounter, &inputCounter);
+
+		const FrameSnapshot& recordSnapshot = snapshots[frameIndex % 2];
+		g_jobSystem.Run([&recordFrame, &recordSnapshot] { g_vulkanRenderer.RecordFrame(recordFrame, recordSnapshot); }, &frameCounter);
+
+		if (hasSubmitFrame)
+		{
+			g_jobSystem.Run([&submitFrame] { g_vulkanRenderer.SubmitFrame(submitFrame); }, &frameCounter);
+		}
+
+		// Main thread runs jobs too (the event pump has to run here)
+		g_jobSystem.Wait(inputCounter);
+		g_jobSystem.Wait(frameCounter);
+
+		// Recorded frame moves on to the submit stage. Acquire can't overlap present, so it happens between frames
+		submitFrame = recordFrame;
+		hasSubmitFrame = true;
+		recordFrame = g_vulkanRenderer.BeginFrame();
+		++frameIndex;
+	}
+
+	// Drain the pipeline so every acquired image is presented
+	if (hasSubmitFrame)
+	{
+		g_vulkanRenderer.SubmitFrame(submitFrame);
+	}
+	g_vulkanRenderer.RecordFrame(recordFrame, snapshots[frameIndex % 2]);
+	g_vulkanRenderer.SubmitFrame(recordFrame);
+
+	g_jobSystem.ShutdownJobSystem();
+}
+
+// Render thread owns submission and presentation, so blocking on vsync never delays input.
+// Main thread only pumps events and steps the simulation at a fixed rate, publishing a snapshot after each update
+void runRenderThread()
+{
+	TripleBuffer<FrameSnapshot> snapshots;
+	snapshots.Publish(simulate(0.0));
+	std::atomic<bool> stopRendering{ false };
+
+	std::thread renderThread([&snapshots, &stopRendering]
+	{
+		while (!stopRendering.load(std::memory_order_relaxed))
+		{
+			// Same snapshot is drawn again if the simulation hasn't stepped since the last frame
+			g_vulkanRenderer.Draw(snapshots.Read());
+		}
+	});
+
+	double simulationTime = 0.0;
+	double previousTime = glfwGetTime();
+	double accumulator = 0.0;
+
+	//Loop until closed
+	while (!glfwWindowShouldClose(g_window))
+	{
+		// Sleep until the next step is due, but wake up straight away for input
+		glfwWaitEventsTimeout(std::max(SIMULATION_TIMESTEP - accumulator, 0.0));
+
+		const double currentTime = glfwGetTime();
+		// Clamp so a long stall (e.g window dragged) doesn't turn in to hundreds of catch up steps
+		accumulator += std::min(currentTime - previousTime, 0.25);
+		previousTime = currentTime;
+
+		bool stepped = false;
+		while (accumulator >= SIMULATION_TIMESTEP)
+		{
+			simulationTime += SIMULATION_TIMESTEP;
+			accumulator -= SIMULATION_TIMESTEP;
+			stepped = true;
+		}
+
+		if (stepped)
+		{
+			snapshots.Publish(simulate(simulationTime));
+		}
+	}
+
+	stopRendering = true;
+	renderThread.join();
+}
+
+int main(int argc, char** argv)
+{
+	// No window, writes benchmark_results.json and exits
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		return mainBenchmark();
+	}
+	// No window where the loader has headless surfaces, replays the trace as fast as it goes and exits
+	// --replay trace.vft [loops]
+	if (argc > 2 && std::string(argv[1]) == "--replay")
+	{
+		const uint32_t loops = argc > 3 ? static_cast<uint32_t>(std::max(std::atoi(argv[3]), 1)) : 1;
+		return mainReplay(argv[2], loops);
+	}
+	// Self checks, exit non-zero when they fail
+	// --test allocations [frames] | ranges | lod | optimizer | jobs | trace
+	if (argc > 2 && std::string(argv[1]) == "--test")
+	{
+		const std::string testName = argv[2];
+		if (testName == "allocations")
+		{
+			const uint32_t frames = argc > 3 ? static_cast<uint32_t>(std::max(std::atoi(argv[3]), 1)) : 1000;
+			return mainTestAllocations(frames);
+		}
+		if (testName == "ranges")
+		{
+			return mainTestRangeAllocator();
+		}
+		if (testName == "lod")
+		{
+			return mainTestMeshLod();
+		}
+		if (testName == "optimizer")
+		{
+			return mainTestMeshOptimizer();
+		}
+		if (testName == "jobs")
+		{
+			return mainTestJobSystem();
+		}
+		if (testName == "trace")
+		{
+			return mainTestFrameTrace();
+		}
+		fprintf(stderr, "Unknown test: %s\n", testName.c_str());
+		return EXIT_FAILURE;
+	}
+
 	// Create window
 	initWindow("Test Window", 800, 600);
 
@@ -36,12 +265,15 @@ int main()
 	{
 		return EXIT_FAILURE;
 	}
+	glfwSetKeyCallback(g_window, onKey);
 
-	//Loop until closed
-	while (!glfwWindowShouldClose(g_window))
+	if (USE_RENDER_THREAD)
+	{
+		runRenderThread();
+	}
+	else
 	{
-		glfwPollEvents();
-		g_vulkanRenderer.Draw();
+		runJobPipeline();
 	}
 
 	g_vulkanRenderer.Cleanup();
@@ -52,4 +284,3 @@ int main()
 	//getchar();
 	return 0;
 }
-
@@ -0,0 +1,782 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Utilities.h"
+#include "Mesh.h"
+#include "UploadService.h"
+#include "FrameTimeline.h"
+#include "ResultsJson.h"
+
+// Headless microbenchmarks of the renderer building blocks
+// No window or surface, so it runs on a CPU implementation (lavapipe, SwiftShader) in CI as well as on a GPU.
+// Results are written as JSON to BENCHMARK_OUTPUT (default benchmark_results.json), one entry per benchmark with
+// per iteration timings, so runs can be compared commit to commit.
+// VULKAN_DEVICE picks a device by name substring, otherwise a CPU device is preferred for stable numbers
+//
+// Drivers may keep their own on-disk shader cache (Mesa: MESA_SHADER_CACHE_DISABLE=true), disable it for
+// meaningful cold pipeline numbers
+namespace
+{
+	constexpr uint32_t TARGET_SIZE = 64;				// Offscreen color target the draws are recorded against
+	constexpr uint32_t DRAWS_PER_RECORDING = 1000;
+	constexpr VkFormat TARGET_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+	struct BenchmarkResult
+	{
+		std::string name;
+		uint32_t itemsPerIteration = 1;			// Timings are per iteration, divide by this for per item cost
+		std::vector<double> vecNanoseconds;		// One per iteration, sorted
+	};
+
+	// Device, queue and the objects every benchmark shares
+	struct BenchmarkContext
+	{
+		VkInstance instance{};
+		VkPhysicalDevice physicalDevice{};
+		VkDevice device{};
+		VkQueue queue{};
+		uint32_t queueFamily = 0;
+		VkPhysicalDeviceProperties properties{};
+
+		VkCommandPool commandPool{};
+		VkCommandBuffer commandBuffer{};
+		VkRenderPass renderPass{};
+		VkImage targetImage{};
+		VkDeviceMemory targetMemory{};
+		VkImageView targetView{};
+		VkFramebuffer framebuffer{};
+		VkPipelineLayout pipelineLayout{};
+
+		std::vector<char> vecVertexShaderCode;
+		std::vector<char> vecFragmentShaderCode;
+	};
+
+	// Runs body iterations times after one untimed warm up run
+	BenchmarkResult RunBenchmark(const std::string& name, uint32_t iterations, uint32_t itemsPerIteration, const std::function<void()>& body)
+	{
+		fprintf(stderr, "Running %s (%u iterations)\n", name.c_str(), iterations);
+
+		BenchmarkResult result;
+		result.name = name;
+		result.itemsPerIteration = itemsPerIteration;
+		result.vecNanoseconds.reserve(iterations);
+
+		body();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			body();
+			const auto end = std::chrono::steady_clock::now();
+			result.vecNanoseconds.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+		}
+
+		std::sort(result.vecNanoseconds.begin(), result.vecNanoseconds.end());
+		return result;
+	}
+
+	bool WriteJson(const std::string& fileName, const BenchmarkContext& context, const std::vector<BenchmarkResult>& results)
+	{
+		FILE* file = fopen(fileName.c_str(), "w");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"device\": \"%s\",\n", EscapeJson(context.properties.deviceName).c_str());
+		fprintf(file, "  \"device_type\": %u,\n", static_cast<uint32_t>(context.properties.deviceType));
+		fprintf(file, "  \"api_version\": \"%u.%u.%u\",\n", VK_API_VERSION_MAJOR(context.properties.apiVersion),
+			VK_API_VERSION_MINOR(context.properties.apiVersion), VK_API_VERSION_PATCH(context.properties.apiVersion));
+		fprintf(file, "  \"driver_version\": %u,\n", context.properties.driverVersion);
+		fprintf(file, "  \"benchmarks\": [\n");
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& result = results[i];
+			double total = 0.0;
+			for (const double nanoseconds : result.vecNanoseconds)
+			{
+				total += nanoseconds;
+			}
+			const double mean = total / static_cast<double>(result.vecNanoseconds.size());
+
+			fprintf(file, "    {\"name\": \"%s\", \"iterations\": %zu, \"items_per_iteration\": %u, "
+				"\"mean_ns\": %.1f, \"median_ns\": %.1f, \"min_ns\": %.1f, \"p95_ns\": %.1f, \"max_ns\": %.1f}%s\n",
+				EscapeJson(result.name).c_str(), result.vecNanoseconds.size(), result.itemsPerIteration,
+				mean, GetPercentile(result.vecNanoseconds, 0.5), result.vecNanoseconds.front(),
+				GetPercentile(result.vecNanoseconds, 0.95), result.vecNanoseconds.back(), i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n");
+		fprintf(file, "}\n");
+
+		return fclose(file) == 0;
+	}
+
+	// - Setup
+	void CreateContext(BenchmarkContext& context)
+	{
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "VulkanBenchmark";
+		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.pEngineName = "No Engine";
+		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.apiVersion = VK_API_VERSION_1_3;
+
+		// No surface extensions and no validation layers, they would only measure the layer
+		VkInstanceCreateInfo instanceCreateInfo = {};
+		instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceCreateInfo.pApplicationInfo = &appInfo;
+
+		VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &context.instance);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Vulkan Instance");
+		}
+
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(context.instance, &deviceCount, nullptr);
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(context.instance, &deviceCount, devices.data());
+		if (devices.empty())
+		{
+			throw std::runtime_error("Can't find a GPU that supports Vulkan");
+		}
+
+		// Override by name, then the first CPU device, then whatever comes first
+		const char* overrideName = std::getenv("VULKAN_DEVICE");
+		context.physicalDevice = devices[0];
+		for (const auto device : devices)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device, &properties);
+			if (overrideName != nullptr ? std::string(properties.deviceName).find(overrideName) != std::string::npos
+				: properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+			{
+				context.physicalDevice = device;
+				break;
+			}
+		}
+		vkGetPhysicalDeviceProperties(context.physicalDevice, &context.properties);
+		if (context.properties.apiVersion < VK_API_VERSION_1_2)
+		{
+			throw std::runtime_error("Benchmarks need a Vulkan 1.2 device (timeline semaphores)");
+		}
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &queueFamilyCount, queueFamilies.data());
+		bool foundGraphics = false;
+		for (uint32_t i = 0; i < queueFamilyCount && !foundGraphics; ++i)
+		{
+			if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			{
+				context.queueFamily = i;
+				foundGraphics = true;
+			}
+		}
+		if (!foundGraphics)
+		{
+			throw std::runtime_error("Benchmark device has no graphics queue");
+		}
+
+		constexpr float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueCreateInfo = {};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = context.queueFamily;
+		queueCreateInfo.queueCount = 1;
+		queueCreateInfo.pQueuePriorities = &priority;
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+
+		VkDeviceCreateInfo deviceCreateInfo = {};
+		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceCreateInfo.pNext = &vulkan12Features;
+		deviceCreateInfo.queueCreateInfoCount = 1;
+		deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+
+		result = vkCreateDevice(context.physicalDevice, &deviceCreateInfo, nullptr, &context.device);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a logical device!");
+		}
+		vkGetDeviceQueue(context.device, context.queueFamily, 0, &context.queue);
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = context.queueFamily;
+		result = vkCreateCommandPool(context.device, &poolInfo, nullptr, &context.commandPool);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Command Pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = context.commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+		result = vkAllocateCommandBuffers(context.device, &allocateInfo, &context.commandBuffer);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Command Buffers!");
+		}
+	}
+
+	// Single color attachment render pass and framebuffer, a render pass works on every device (dynamic rendering doesn't)
+	void CreateRenderTarget(BenchmarkContext& context)
+	{
+		VkAttachmentDescription colorAttachment = {};
+		colorAttachment.format = TARGET_FORMAT;
+		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorAttachmentReference = {};
+		colorAttachmentReference.attachment = 0;
+		colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorAttachmentReference;
+
+		VkRenderPassCreateInfo renderPassCreateInfo = {};
+		renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassCreateInfo.attachmentCount = 1;
+		renderPassCreateInfo.pAttachments = &colorAttachment;
+		renderPassCreateInfo.subpassCount = 1;
+		renderPassCreateInfo.pSubpasses = &subpass;
+
+		VkResult result = vkCreateRenderPass(context.device, &renderPassCreateInfo, nullptr, &context.renderPass);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Render Pass!");
+		}
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.extent = { TARGET_SIZE, TARGET_SIZE, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.format = TARGET_FORMAT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		result = vkCreateImage(context.device, &imageCreateInfo, nullptr, &context.targetImage);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create an Image!");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(context.device, context.targetImage, &memoryRequirements);
+
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = memoryRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(context.physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX)
+		{
+			memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(context.physicalDevice, memoryRequirements.memoryTypeBits, 0);
+		}
+
+		result = vkAllocateMemory(context.device, &memoryAllocateInfo, nullptr, &context.targetMemory);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate memory for image!");
+		}
+		vkBindImageMemory(context.device, context.targetImage, context.targetMemory, 0);
+
+		VkImageViewCreateInfo viewCreateInfo = {};
+		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewCreateInfo.image = context.targetImage;
+		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCreateInfo.format = TARGET_FORMAT;
+		viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewCreateInfo.subresourceRange.levelCount = 1;
+		viewCreateInfo.subresourceRange.layerCount = 1;
+
+		result = vkCreateImageView(context.device, &viewCreateInfo, nullptr, &context.targetView);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create an Image View!");
+		}
+
+		VkFramebufferCreateInfo framebufferCreateInfo = {};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.renderPass = context.renderPass;
+		framebufferCreateInfo.attachmentCount = 1;
+		framebufferCreateInfo.pAttachments = &context.targetView;
+		framebufferCreateInfo.width = TARGET_SIZE;
+		framebufferCreateInfo.height = TARGET_SIZE;
+		framebufferCreateInfo.layers = 1;
+
+		result = vkCreateFramebuffer(context.device, &framebufferCreateInfo, nullptr, &context.framebuffer);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Framebuffer!");
+		}
+
+		// Same layout as the renderer: model matrix push constant
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(glm::mat4);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+		result = vkCreatePipelineLayout(context.device, &pipelineLayoutCreateInfo, nullptr, &context.pipelineLayout);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Pipeline Layout!");
+		}
+	}
+
+	void DestroyContext(BenchmarkContext& context)
+	{
+		vkDeviceWaitIdle(context.device);
+		vkDestroyPipelineLayout(context.device, context.pipelineLayout, nullptr);
+		vkDestroyFramebuffer(context.device, context.framebuffer, nullptr);
+		vkDestroyImageView(context.device, context.targetView, nullptr);
+		vkDestroyImage(context.device, context.targetImage, nullptr);
+		vkFreeMemory(context.device, context.targetMemory, nullptr);
+		vkDestroyRenderPass(context.device, context.renderPass, nullptr);
+		vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+		vkDestroyDevice(context.device, nullptr);
+		vkDestroyInstance(context.instance, nullptr);
+	}
+
+	// - Helpers
+	VkShaderModule CreateShaderModule(const BenchmarkContext& context, const std::vector<char>& code)
+	{
+		VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+		shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shaderModuleCreateInfo.codeSize = code.size();
+		shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+		VkShaderModule shaderModule;
+		const VkResult result = vkCreateShaderModule(context.device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a shader module!");
+		}
+		return shaderModule;
+	}
+
+	// Renderer's pipeline state (without depth), modules are created and destroyed as part of it like at startup
+	VkPipeline CreatePipeline(const BenchmarkContext& context, VkPipelineCache pipelineCache)
+	{
+		const VkShaderModule vertexShaderModule = CreateShaderModule(context, context.vecVertexShaderCode);
+		const VkShaderModule fragmentShaderModule = CreateShaderModule(context, context.vecFragmentShaderCode);
+
+		VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStages[0].module = vertexShaderModule;
+		shaderStages[0].pName = "main";
+		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStages[1].module = fragmentShaderModule;
+		shaderStages[1].pName = "main";
+
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = sizeof(Vertex);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[0].offset = offsetof(Vertex, pos);
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[1].offset = offsetof(Vertex, col);
+
+		VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+		vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+		vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+		vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(TARGET_SIZE), static_cast<float>(TARGET_SIZE), 0.0f, 1.0f };
+		VkRect2D scissor = { { 0, 0 }, { TARGET_SIZE, TARGET_SIZE } };
+
+		VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+		viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportStateCreateInfo.viewportCount = 1;
+		viewportStateCreateInfo.pViewports = &viewport;
+		viewportStateCreateInfo.scissorCount = 1;
+		viewportStateCreateInfo.pScissors = &scissor;
+
+		VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+		rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizerCreateInfo.lineWidth = 1.0f;
+		rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterizerCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+		VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+		multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineColorBlendAttachmentState colorState = {};
+		colorState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorState.blendEnable = VK_TRUE;
+		colorState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorState.colorBlendOp = VK_BLEND_OP_ADD;
+		colorState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colorState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
+		colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlendingCreateInfo.attachmentCount = 1;
+		colorBlendingCreateInfo.pAttachments = &colorState;
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.stageCount = 2;
+		pipelineCreateInfo.pStages = shaderStages;
+		pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+		pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+		pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+		pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+		pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+		pipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
+		pipelineCreateInfo.layout = context.pipelineLayout;
+		pipelineCreateInfo.renderPass = context.renderPass;
+		pipelineCreateInfo.subpass = 0;
+		pipelineCreateInfo.basePipelineIndex = -1;
+
+		VkPipeline pipeline;
+		const VkResult result = vkCreateGraphicsPipelines(context.device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+
+		vkDestroyShaderModule(context.device, fragmentShaderModule, nullptr);
+		vkDestroyShaderModule(context.device, vertexShaderModule, nullptr);
+
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Graphics Pipeline!");
+		}
+		return pipeline;
+	}
+
+	// Flat grid of (cells + 1)^2 vertices, for the indexed (optimized, simplified) mesh path
+	void BuildGrid(uint32_t cells, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices)
+	{
+		outVertices.clear();
+		outIndices.clear();
+		for (uint32_t y = 0; y <= cells; ++y)
+		{
+			for (uint32_t x = 0; x <= cells; ++x)
+			{
+				const float u = static_cast<float>(x) / static_cast<float>(cells);
+				const float v = static_cast<float>(y) / static_cast<float>(cells);
+				outVertices.push_back({ { u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.0f }, { u, v, 1.0f } });
+			}
+		}
+		for (uint32_t y = 0; y < cells; ++y)
+		{
+			for (uint32_t x = 0; x < cells; ++x)
+			{
+				const uint32_t corner = y * (cells + 1) + x;
+				outIndices.insert(outIndices.end(), { corner, corner + 1, corner + cells + 2, corner + cells + 2, corner + cells + 1, corner });
+			}
+		}
+	}
+
+	// Submit the recorded command buffer and wait for it with a fence
+	void SubmitAndWait(const BenchmarkContext& context, VkFence fence)
+	{
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &context.commandBuffer;
+
+		VkResult result = vkQueueSubmit(context.queue, 1, &submitInfo, fence);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit Command Buffer to Queue");
+		}
+		vkWaitForFences(context.device, 1, &fence, VK_TRUE, UINT64_MAX);
+		vkResetFences(context.device, 1, &fence);
+	}
+
+	void RecordEmpty(const BenchmarkContext& context)
+	{
+		vkResetCommandPool(context.device, context.commandPool, 0);
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		vkBeginCommandBuffer(context.commandBuffer, &beginInfo);
+		vkEndCommandBuffer(context.commandBuffer);
+	}
+
+	// - Benchmarks
+	void BenchmarkFindMemoryTypeIndex(const BenchmarkContext& context, std::vector<BenchmarkResult>& results)
+	{
+		constexpr uint32_t callsPerIteration = 1000;
+		volatile uint32_t sink = 0;		// Keeps the calls from being optimized away
+		results.push_back(RunBenchmark("find_memory_type_index", 200, callsPerIteration, [&context, &sink]
+		{
+			for (uint32_t i = 0; i < callsPerIteration; ++i)
+			{
+				sink = FindMemoryTypeIndex(context.physicalDevice, 0xFFFFFFFFu >> (i % 8),
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			}
+		}));
+	}
+
+	void BenchmarkMeshes(const BenchmarkContext& context, std::vector<BenchmarkResult>& results)
+	{
+		QueueFamilyIndices queueFamilyIndices;
+		queueFamilyIndices.graphicsFamily = static_cast<int>(context.queueFamily);
+		queueFamilyIndices.presentationFamily = static_cast<int>(context.queueFamily);
+		queueFamilyIndices.computeFamily = static_cast<int>(context.queueFamily);
+		queueFamilyIndices.transferFamily = static_cast<int>(context.queueFamily);
+
+		UploadService uploadService;
+		uploadService.InitUploadService(context.physicalDevice, context.device, queueFamilyIndices, context.queue);
+
+		// Shared queue, so the benchmark thread submits the uploads like the render thread would
+		auto waitForUpload = [&context, &uploadService](const Mesh& mesh)
+		{
+			while (!mesh.IsUploaded())
+			{
+				uploadService.SubmitPending(context.queue);
+				std::this_thread::yield();
+			}
+		};
+
+		for (const uint32_t cells : { 8u, 64u, 256u })
+		{
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			BuildGrid(cells, vertices, indices);
+			const std::string suffix = "/" + std::to_string(vertices.size()) + "_vertices";
+			const uint32_t iterations = cells >= 256 ? 10 : 50;
+
+			results.push_back(RunBenchmark("mesh_create_host_visible" + suffix, iterations, 1, [&context, &vertices]
+			{
+				Mesh mesh(context.physicalDevice, context.device, &vertices);
+			}));
+
+			results.push_back(RunBenchmark("mesh_upload_device_local" + suffix, iterations, 1, [&context, &vertices, &uploadService, &waitForUpload]
+			{
+				Mesh mesh(context.physicalDevice, context.device, &vertices, uploadService);
+				waitForUpload(mesh);
+			}));
+
+			// Includes the load time optimization and level of detail simplification
+			results.push_back(RunBenchmark("mesh_upload_indexed_lods" + suffix, iterations, 1, [&context, &vertices, &indices, &uploadService, &waitForUpload]
+			{
+				Mesh mesh(context.physicalDevice, context.device, &vertices, &indices, uploadService, nullptr, nullptr, MESH_LOD_COUNT);
+				waitForUpload(mesh);
+			}));
+		}
+
+		vkQueueWaitIdle(context.queue);
+		uploadService.ShutdownUploadService();
+	}
+
+	void BenchmarkPipelines(const BenchmarkContext& context, std::vector<BenchmarkResult>& results)
+	{
+		results.push_back(RunBenchmark("shader_module_create", 100, 2, [&context]
+		{
+			const VkShaderModule vertexShaderModule = CreateShaderModule(context, context.vecVertexShaderCode);
+			const VkShaderModule fragmentShaderModule = CreateShaderModule(context, context.vecFragmentShaderCode);
+			vkDestroyShaderModule(context.device, fragmentShaderModule, nullptr);
+			vkDestroyShaderModule(context.device, vertexShaderModule, nullptr);
+		}));
+
+		results.push_back(RunBenchmark("pipeline_create_cold", 20, 1, [&context]
+		{
+			vkDestroyPipeline(context.device, CreatePipeline(context, VK_NULL_HANDLE), nullptr);
+		}));
+
+		// Cache warmed by the first (untimed) run, like a cache loaded from disk at startup
+		VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		VkPipelineCache pipelineCache;
+		const VkResult result = vkCreatePipelineCache(context.device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Pipeline Cache!");
+		}
+
+		results.push_back(RunBenchmark("pipeline_create_cached", 20, 1, [&context, pipelineCache]
+		{
+			vkDestroyPipeline(context.device, CreatePipeline(context, pipelineCache), nullptr);
+		}));
+
+		vkDestroyPipelineCache(context.device, pipelineCache, nullptr);
+	}
+
+	void BenchmarkRecording(const BenchmarkContext& context, std::vector<BenchmarkResult>& results)
+	{
+		const VkPipeline pipeline = CreatePipeline(context, VK_NULL_HANDLE);
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		BuildGrid(1, vertices, indices);
+		Mesh mesh(context.physicalDevice, context.device, &vertices);
+		const VkBuffer vertexBuffer = mesh.GetVertexBuffer();
+
+		VkRenderPassBeginInfo renderPassBeginInfo = {};
+		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassBeginInfo.renderPass = context.renderPass;
+		renderPassBeginInfo.framebuffer = context.framebuffer;
+		renderPassBeginInfo.renderArea = { { 0, 0 }, { TARGET_SIZE, TARGET_SIZE } };
+		VkClearValue clearValue = {};
+		renderPassBeginInfo.clearValueCount = 1;
+		renderPassBeginInfo.pClearValues = &clearValue;
+
+		// Same per draw work as RecordSceneDraws: bind, push the model matrix, draw
+		results.push_back(RunBenchmark("record_draws", 100, DRAWS_PER_RECORDING, [&context, &renderPassBeginInfo, pipeline, vertexBuffer]
+		{
+			vkResetCommandPool(context.device, context.commandPool, 0);
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(context.commandBuffer, &beginInfo);
+			vkCmdBeginRenderPass(context.commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdBindPipeline(context.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+			const VkDeviceSize offset = 0;
+			glm::mat4 model(1.0f);
+			for (uint32_t i = 0; i < DRAWS_PER_RECORDING; ++i)
+			{
+				vkCmdBindVertexBuffers(context.commandBuffer, 0, 1, &vertexBuffer, &offset);
+				model[3][0] = static_cast<float>(i) * 0.001f;
+				vkCmdPushConstants(context.commandBuffer, context.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &model);
+				vkCmdDraw(context.commandBuffer, 6, 1, 0, 0);
+			}
+
+			vkCmdEndRenderPass(context.commandBuffer);
+			vkEndCommandBuffer(context.commandBuffer);
+		}));
+
+		vkDestroyPipeline(context.device, pipeline, nullptr);
+	}
+
+	void BenchmarkSubmission(const BenchmarkContext& context, std::vector<BenchmarkResult>& results)
+	{
+		RecordEmpty(context);
+
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		VkResult result = vkCreateFence(context.device, &fenceCreateInfo, nullptr, &fence);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Fence!");
+		}
+
+		results.push_back(RunBenchmark("submit_fence_round_trip", 200, 1, [&context, fence]
+		{
+			SubmitAndWait(context, fence);
+		}));
+		vkDestroyFence(context.device, fence, nullptr);
+
+		// What the frame loop does instead of fences
+		FrameTimeline timeline;
+		timeline.CreateTimeline(context.device);
+		results.push_back(RunBenchmark("submit_timeline_round_trip", 200, 1, [&context, &timeline]
+		{
+			const uint64_t value = timeline.AdvanceValue();
+			const VkSemaphore semaphore = timeline.GetSemaphore();
+
+			VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+			timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineSubmitInfo.signalSemaphoreValueCount = 1;
+			timelineSubmitInfo.pSignalSemaphoreValues = &value;
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.pNext = &timelineSubmitInfo;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &context.commandBuffer;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &semaphore;
+
+			const VkResult submitResult = vkQueueSubmit(context.queue, 1, &submitInfo, VK_NULL_HANDLE);
+			if (submitResult != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit Command Buffer to Queue");
+			}
+			timeline.Wait(value);
+		}));
+		timeline.DestroyTimeline();
+	}
+}
+
+int mainBenchmark()
+{
+	BenchmarkContext context;
+	try
+	{
+		CreateContext(context);
+		CreateRenderTarget(context);
+		context.vecVertexShaderCode = ReadFile("Shaders/vert.spv");
+		context.vecFragmentShaderCode = ReadFile("Shaders/frag.spv");
+		fprintf(stderr, "Benchmarking on %s\n", context.properties.deviceName);
+
+		std::vector<BenchmarkResult> results;
+		BenchmarkFindMemoryTypeIndex(context, results);
+		BenchmarkMeshes(context, results);
+		BenchmarkPipelines(context, results);
+		BenchmarkRecording(context, results);
+		BenchmarkSubmission(context, results);
+
+		DestroyContext(context);
+
+		const char* outputName = std::getenv("BENCHMARK_OUTPUT");
+		const std::string fileName = outputName != nullptr ? outputName : "benchmark_results.json";
+		if (!WriteJson(fileName, context, results))
+		{
+			throw std::runtime_error("Failed to write benchmark results: " + fileName);
+		}
+		printf("Benchmark results written to %s\n", fileName.c_str());
+	}
+	catch (const std::runtime_error& e)
+	{
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "VulkanRenderer.h"
+#include "FrameTrace.h"
+#include "ResultsJson.h"
+
+// Frame trace replay (see FrameTrace.h)
+// Feeds a recorded trace's frames back through the renderer as fast as they go: headless (VK_EXT_headless_surface,
+// immediate presents) where the loader has it, otherwise in a hidden window. Frame times are written as JSON to
+// REPLAY_OUTPUT (default replay_results.json) so runs can be compared commit to commit, like the benchmark suite.
+// Frames are replayed loops times in a row, after untimed frames that wait for the scene to be uploaded
+namespace
+{
+	constexpr uint32_t MAX_WARM_UP_FRAMES = 10000;		// Scene upload taking longer than this is an error
+
+	// Differences that make the replay's timings incomparable with the recording's, the replay still runs
+	void WarnOnMismatch(const FrameTraceHeader& recorded, const FrameTraceHeader& replayed)
+	{
+		if (recorded.width != replayed.width || recorded.height != replayed.height)
+		{
+			fprintf(stderr, "WARNING: recorded at %ux%u, replaying at %ux%u\n", recorded.width, recorded.height, replayed.width, replayed.height);
+		}
+		if (recorded.msaaSamples != replayed.msaaSamples)
+		{
+			fprintf(stderr, "WARNING: recorded with %ux MSAA, replaying with %ux\n", recorded.msaaSamples, replayed.msaaSamples);
+		}
+		if (recorded.shaderFeatures != replayed.shaderFeatures)
+		{
+			fprintf(stderr, "WARNING: recorded with shader features 0x%x, replaying with 0x%x\n", recorded.shaderFeatures, replayed.shaderFeatures);
+		}
+		if (recorded.rendererFeatures != replayed.rendererFeatures)
+		{
+			fprintf(stderr, "WARNING: recorded with renderer features 0x%x, replaying with 0x%x\n",
+				recorded.rendererFeatures, replayed.rendererFeatures);
+		}
+	}
+
+	bool WriteJson(const std::string& fileName, const std::string& traceFileName, const FrameTraceHeader& header, bool headless,
+		uint32_t loops, double totalMs, const std::vector<double>& sortedFrameMs)
+	{
+		FILE* file = fopen(fileName.c_str(), "w");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		double total = 0.0;
+		for (const double frameMs : sortedFrameMs)
+		{
+			total += frameMs;
+		}
+		const double mean = total / static_cast<double>(sortedFrameMs.size());
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"trace\": \"%s\",\n", EscapeJson(traceFileName).c_str());
+		fprintf(file, "  \"width\": %u,\n", header.width);
+		fprintf(file, "  \"height\": %u,\n", header.height);
+		fprintf(file, "  \"msaa_samples\": %u,\n", header.msaaSamples);
+		fprintf(file, "  \"shader_features\": %u,\n", header.shaderFeatures);
+		fprintf(file, "  \"renderer_features\": %u,\n", header.rendererFeatures);
+		fprintf(file, "  \"headless\": %s,\n", headless ? "true" : "false");
+		fprintf(file, "  \"loops\": %u,\n", loops);
+		fprintf(file, "  \"frames\": %zu,\n", sortedFrameMs.size());
+		fprintf(file, "  \"total_ms\": %.3f,\n", totalMs);
+		fprintf(file, "  \"fps\": %.1f,\n", static_cast<double>(sortedFrameMs.size()) * 1000.0 / totalMs);
+		fprintf(file, "  \"mean_frame_ms\": %.4f,\n", mean);
+		fprintf(file, "  \"median_frame_ms\": %.4f,\n", GetPercentile(sortedFrameMs, 0.5));
+		fprintf(file, "  \"min_frame_ms\": %.4f,\n", sortedFrameMs.front());
+		fprintf(file, "  \"p95_frame_ms\": %.4f,\n", GetPercentile(sortedFrameMs, 0.95));
+		fprintf(file, "  \"p99_frame_ms\": %.4f,\n", GetPercentile(sortedFrameMs, 0.99));
+		fprintf(file, "  \"max_frame_ms\": %.4f\n", sortedFrameMs.back());
+		fprintf(file, "}\n");
+
+		return fclose(file) == 0;
+	}
+}
+
+int mainReplay(const std::string& traceFileName, uint32_t loops)
+{
+	GLFWwindow* window = nullptr;
+	std::unique_ptr<VulkanRenderer> renderer = std::make_unique<VulkanRenderer>();
+	bool headless = false;
+	try
+	{
+		const FrameTrace trace = LoadFrameTrace(traceFileName);
+		if (trace.vecFrames.empty())
+		{
+			throw std::runtime_error("Frame trace has no frames: " + traceFileName);
+		}
+		fprintf(stderr, "Replaying %zu frames of %s\n", trace.vecFrames.size(), traceFileName.c_str());
+
+		// Same scene and settings as the recording
+		for (const FrameTraceMesh& mesh : trace.vecMeshes)
+		{
+			if (mesh.meshId == 0)
+			{
+				renderer->SetSceneGeometry(mesh.vecVertices, mesh.vecIndices);
+			}
+		}
+		renderer->SetRequestedMsaaSamples(static_cast<VkSampleCountFlagBits>(trace.header.msaaSamples));
+
+		headless = VulkanRenderer::IsHeadlessSupported();
+		if (headless)
+		{
+			renderer->SetHeadless({ trace.header.width, trace.header.height });
+		}
+		else
+		{
+			fprintf(stderr, "VK_EXT_headless_surface isn't available, replaying in a hidden window\n");
+			if (!glfwInit())
+			{
+				throw std::runtime_error("GLFW could not initialize");
+			}
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+			glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			window = glfwCreateWindow(static_cast<int>(trace.header.width), static_cast<int>(trace.header.height), "Replay", nullptr, nullptr);
+			if (window == nullptr)
+			{
+				throw std::runtime_error("Failed to create the replay window");
+			}
+		}
+
+		if (renderer->Init(window) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		WarnOnMismatch(trace.header, renderer->GetFrameTraceHeader());
+
+		// Recorded frames that drew the scene only draw it here once it's uploaded
+		uint32_t warmUpFrames = 0;
+		FrameSnapshot warmUpSnapshot;
+		warmUpSnapshot.model = trace.vecFrames.front().model;
+		warmUpSnapshot.time = trace.vecFrames.front().time;
+		while (!renderer->IsSceneResident())
+		{
+			if (++warmUpFrames > MAX_WARM_UP_FRAMES)
+			{
+				throw std::runtime_error("Scene of the frame trace never finished uploading");
+			}
+			renderer->Draw(warmUpSnapshot);
+		}
+		renderer->GetFrameTimeline().Wait(renderer->GetLastSubmittedFrameValue());
+
+		// Time between frames starting. Once the frames in flight fill up, each one waits for the GPU, so this is
+		// the GPU's throughput rather than only the CPU's recording time
+		std::vector<double> frameMs;
+		frameMs.reserve(trace.vecFrames.size() * loops);
+		const auto replayStart = std::chrono::steady_clock::now();
+		for (uint32_t loop = 0; loop < loops; ++loop)
+		{
+			for (const FrameTracePacket& packet : trace.vecFrames)
+			{
+				const auto frameStart = std::chrono::steady_clock::now();
+				renderer->DrawTraceFrame(packet);
+				const auto frameEnd = std::chrono::steady_clock::now();
+				frameMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+			}
+		}
+		renderer->GetFrameTimeline().Wait(renderer->GetLastSubmittedFrameValue());
+		const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replayStart).count();
+
+		std::sort(frameMs.begin(), frameMs.end());
+		printf("Replayed %zu frames in %.1f ms (%.1f fps, median %.3f ms, p99 %.3f ms)\n", frameMs.size(), totalMs,
+			static_cast<double>(frameMs.size()) * 1000.0 / totalMs, GetPercentile(frameMs, 0.5), GetPercentile(frameMs, 0.99));
+
+		const char* outputName = std::getenv("REPLAY_OUTPUT");
+		const std::string fileName = outputName != nullptr ? outputName : "replay_results.json";
+		if (!WriteJson(fileName, traceFileName, renderer->GetFrameTraceHeader(), headless, loops, totalMs, frameMs))
+		{
+			throw std::runtime_error("Failed to write replay results: " + fileName);
+		}
+		printf("Replay results written to %s\n", fileName.c_str());
+
+		renderer->Cleanup();
+	}
+	catch (const std::runtime_error& e)
+	{
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (window != nullptr)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+	return 0;
+}
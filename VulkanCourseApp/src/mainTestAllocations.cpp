@@ -0,0 +1,271 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "VulkanRenderer.h"
+
+// Allocation check: steady state Draw() must not touch the heap (transient CPU data comes from the frame arenas)
+// Every form of global operator new/delete is replaced, new counts while counting is switched on. Renderer threads
+// (upload, capture) are counted too, nothing should allocate while frames are only being drawn. Driver allocations
+// don't go through operator new. The replacements change allocation for the whole program, so they are only compiled
+// in to a test build with ALLOCATION_CHECK defined, other builds fail the check without running it
+// Warms up like the replay (headless where the loader has it, otherwise a hidden window), then draws frames
+// with counting on and fails if any of them allocated
+namespace
+{
+	constexpr uint32_t TEST_WIDTH = 800;
+	constexpr uint32_t TEST_HEIGHT = 600;
+	constexpr uint32_t MAX_WARM_UP_FRAMES = 10000;		// Scene upload taking longer than this is an error
+	// Frames drawn after the upload before counting: every slot's arena has to have grown to its peak
+	constexpr uint32_t STEADY_STATE_FRAMES = 8 * MAX_FRAME_DRAWS;
+
+	std::atomic<bool> g_bCountAllocations{ false };
+	std::atomic<uint64_t> g_ullAllocationCount{ 0 };
+	std::atomic<uint64_t> g_ullAllocatedBytes{ 0 };
+
+#ifdef ALLOCATION_CHECK
+	constexpr bool ALLOCATIONS_COUNTED = true;
+
+	void CountAllocation(size_t size)
+	{
+		if (g_bCountAllocations.load(std::memory_order_relaxed))
+		{
+			g_ullAllocationCount.fetch_add(1, std::memory_order_relaxed);
+			g_ullAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		}
+	}
+
+	void* AllocateAligned(size_t size, size_t alignment)
+	{
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		// aligned_alloc wants a multiple of the alignment
+		return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void FreeAligned(void* pointer)
+	{
+#ifdef _WIN32
+		_aligned_free(pointer);
+#else
+		free(pointer);
+#endif
+	}
+#else
+	constexpr bool ALLOCATIONS_COUNTED = false;
+#endif
+
+	// Same motion as the app's simulation, so the frames do the same work
+	FrameSnapshot GetSnapshot(uint32_t frame)
+	{
+		FrameSnapshot snapshot;
+		snapshot.time = static_cast<double>(frame) * SIMULATION_TIMESTEP;
+		snapshot.model = glm::rotate(glm::mat4(1.0f), static_cast<float>(snapshot.time) * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		return snapshot;
+	}
+}
+
+#ifdef ALLOCATION_CHECK
+void* operator new(size_t size)
+{
+	CountAllocation(size);
+	void* pointer = malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	CountAllocation(size);
+	void* pointer = AllocateAligned(size == 0 ? 1 : size, static_cast<size_t>(alignment));
+	if (pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	CountAllocation(size);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	CountAllocation(size);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	CountAllocation(size);
+	return AllocateAligned(size == 0 ? 1 : size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	CountAllocation(size);
+	return AllocateAligned(size == 0 ? 1 : size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+#endif
+
+int mainTestAllocations(uint32_t frames)
+{
+	if (!ALLOCATIONS_COUNTED)
+	{
+		fprintf(stderr, "ERROR: allocations are only counted in a build with ALLOCATION_CHECK defined\n");
+		return EXIT_FAILURE;
+	}
+
+	GLFWwindow* window = nullptr;
+	std::unique_ptr<VulkanRenderer> renderer = std::make_unique<VulkanRenderer>();
+	uint64_t allocationCount = 0;
+	uint64_t allocatedBytes = 0;
+	uint32_t allocatingFrames = 0;
+	try
+	{
+		if (VulkanRenderer::IsHeadlessSupported())
+		{
+			renderer->SetHeadless({ TEST_WIDTH, TEST_HEIGHT });
+		}
+		else
+		{
+			fprintf(stderr, "VK_EXT_headless_surface isn't available, drawing in a hidden window\n");
+			if (!glfwInit())
+			{
+				throw std::runtime_error("GLFW could not initialize");
+			}
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+			glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			window = glfwCreateWindow(static_cast<int>(TEST_WIDTH), static_cast<int>(TEST_HEIGHT), "Allocation test", nullptr, nullptr);
+			if (window == nullptr)
+			{
+				throw std::runtime_error("Failed to create the test window");
+			}
+		}
+
+		if (renderer->Init(window) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+
+		// Upload and first use allocate, steady state starts once the scene is drawn and the arenas have grown
+		uint32_t frame = 0;
+		while (!renderer->IsSceneResident())
+		{
+			if (frame > MAX_WARM_UP_FRAMES)
+			{
+				throw std::runtime_error("Scene never finished uploading");
+			}
+			renderer->Draw(GetSnapshot(frame++));
+		}
+		for (uint32_t i = 0; i < STEADY_STATE_FRAMES; ++i)
+		{
+			renderer->Draw(GetSnapshot(frame++));
+		}
+		renderer->GetFrameTimeline().Wait(renderer->GetLastSubmittedFrameValue());
+
+		// Nothing between the switches allocates but the frames (no printing)
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			const uint64_t countBefore = g_ullAllocationCount.load(std::memory_order_relaxed);
+			g_bCountAllocations = true;
+			renderer->Draw(GetSnapshot(frame++));
+			g_bCountAllocations = false;
+			if (g_ullAllocationCount.load(std::memory_order_relaxed) != countBefore)
+			{
+				++allocatingFrames;
+			}
+		}
+		renderer->GetFrameTimeline().Wait(renderer->GetLastSubmittedFrameValue());
+		allocationCount = g_ullAllocationCount.load();
+		allocatedBytes = g_ullAllocatedBytes.load();
+
+		renderer->Cleanup();
+	}
+	catch (const std::runtime_error& e)
+	{
+		g_bCountAllocations = false;
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (window != nullptr)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	if (allocationCount != 0)
+	{
+		fprintf(stderr, "FAILED: %llu allocations (%llu bytes) in %u of %u steady state frames\n",
+			static_cast<unsigned long long>(allocationCount), static_cast<unsigned long long>(allocatedBytes), allocatingFrames, frames);
+		return EXIT_FAILURE;
+	}
+	printf("Passed: no allocations in %u steady state frames\n", frames);
+	return 0;
+}
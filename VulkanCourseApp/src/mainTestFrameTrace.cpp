@@ -0,0 +1,227 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "FrameTrace.h"
+#include "TestCheck.h"
+
+// Frame trace check, CPU only, through a file in the working directory
+// A recorded trace loads back exactly as recorded. Files cut short anywhere but between records, with another
+// version or without the magic are refused, and record types the reader doesn't know are skipped
+namespace
+{
+	const char* TEST_TRACE_FILE = "test_frame_trace.vft";
+	constexpr uint32_t TEST_FRAMES = 16;
+	constexpr uint32_t UNKNOWN_RECORD_TYPE = 99;
+
+	void WriteBytes(const std::vector<char>& bytes)
+	{
+		std::ofstream file(TEST_TRACE_FILE, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	bool LoadFails()
+	{
+		try
+		{
+			LoadFrameTrace(TEST_TRACE_FILE);
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	bool SameVertex(const Vertex& lhs, const Vertex& rhs)
+	{
+		return lhs.pos == rhs.pos && lhs.col == rhs.col;
+	}
+
+	bool SameMesh(const FrameTraceMesh& lhs, const FrameTraceMesh& rhs)
+	{
+		if (lhs.meshId != rhs.meshId || lhs.vecVertices.size() != rhs.vecVertices.size() || lhs.vecIndices != rhs.vecIndices)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < lhs.vecVertices.size(); ++i)
+		{
+			if (!SameVertex(lhs.vecVertices[i], rhs.vecVertices[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool SameFrame(const FrameTracePacket& lhs, const FrameTracePacket& rhs)
+	{
+		return lhs.model == rhs.model && lhs.time == rhs.time && lhs.renderWidth == rhs.renderWidth
+			&& lhs.renderHeight == rhs.renderHeight && lhs.meshLod == rhs.meshLod && lhs.drawMesh == rhs.drawMesh;
+	}
+
+	bool SameTrace(const FrameTrace& trace, const FrameTraceHeader& header, const std::vector<FrameTraceMesh>& meshes,
+		const std::vector<FrameTracePacket>& frames)
+	{
+		if (std::memcmp(&trace.header, &header, sizeof(header)) != 0 || trace.vecMeshes.size() != meshes.size()
+			|| trace.vecFrames.size() != frames.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			if (!SameMesh(trace.vecMeshes[i], meshes[i]))
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			if (!SameFrame(trace.vecFrames[i], frames[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Offsets where a record starts (or the file could end), the header's end first
+	std::set<size_t> GetRecordBoundaries(const std::vector<char>& bytes)
+	{
+		std::set<size_t> setBoundaries;
+		size_t offset = sizeof(FrameTraceHeader);
+		while (offset + sizeof(FrameTraceRecordHeader) <= bytes.size())
+		{
+			setBoundaries.insert(offset);
+			FrameTraceRecordHeader recordHeader;
+			std::memcpy(&recordHeader, bytes.data() + offset, sizeof(recordHeader));
+			offset += sizeof(recordHeader) + recordHeader.size;
+		}
+		setBoundaries.insert(offset);
+		return setBoundaries;
+	}
+
+	std::vector<char> MakeUnknownRecord()
+	{
+		const uint32_t payload[3] = { 7, 8, 9 };
+		FrameTraceRecordHeader recordHeader;
+		recordHeader.type = static_cast<FrameTraceRecordType>(UNKNOWN_RECORD_TYPE);
+		recordHeader.size = sizeof(payload);
+
+		std::vector<char> record(sizeof(recordHeader) + sizeof(payload));
+		std::memcpy(record.data(), &recordHeader, sizeof(recordHeader));
+		std::memcpy(record.data() + sizeof(recordHeader), payload, sizeof(payload));
+		return record;
+	}
+}
+
+int mainTestFrameTrace()
+{
+	FrameTraceHeader header;
+	header.width = 800;
+	header.height = 600;
+	header.msaaSamples = 4;
+	header.shaderFeatures = 3;
+	header.rendererFeatures = FRAME_TRACE_FEATURE_DYNAMIC_RENDERING | FRAME_TRACE_FEATURE_PARTICLES;
+
+	std::vector<FrameTraceMesh> meshes(2);
+	meshes[0].meshId = 1;
+	meshes[0].vecVertices = { { glm::vec3(0.0f, 1.0f, 2.0f), glm::vec3(1.0f, 0.0f, 0.0f) },
+		{ glm::vec3(3.0f, 4.0f, 5.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(6.0f, 7.0f, 8.0f), glm::vec3(0.0f, 0.0f, 1.0f) } };
+	meshes[0].vecIndices = { 0, 1, 2 };
+	meshes[1].meshId = 7;
+	meshes[1].vecVertices = { { glm::vec3(-1.0f), glm::vec3(0.5f) } };		// No indices
+
+	std::vector<FrameTracePacket> frames(TEST_FRAMES);
+	for (uint32_t i = 0; i < TEST_FRAMES; ++i)
+	{
+		frames[i].model = glm::mat4(static_cast<float>(i + 1));
+		frames[i].time = i / 60.0;
+		frames[i].renderWidth = 400 + i;
+		frames[i].renderHeight = 300 + i;
+		frames[i].meshLod = i % 4;
+		frames[i].drawMesh = i % 3 != 0 ? 1 : 0;
+	}
+
+	try
+	{
+		// Round trip, frames recorded while nothing is traced are dropped
+		FrameTraceRecorder recorder;
+		recorder.RecordFrame(frames[0]);
+		Check(!recorder.StopTrace(), "stopping without a trace fails");
+		recorder.StartTrace(TEST_TRACE_FILE, header, meshes);
+		for (const FrameTracePacket& frame : frames)
+		{
+			recorder.RecordFrame(frame);
+		}
+		Check(recorder.GetFrameCount() == TEST_FRAMES, "recorder counts the recorded frames");
+		Check(recorder.StopTrace(), "trace is written");
+		recorder.RecordFrame(frames[0]);
+		Check(recorder.GetFrameCount() == TEST_FRAMES, "frames after the trace stopped are dropped");
+		Check(SameTrace(LoadFrameTrace(TEST_TRACE_FILE), header, meshes, frames), "trace loads back as recorded");
+
+		const std::vector<char> bytes = ReadFile(TEST_TRACE_FILE);
+		const std::set<size_t> setBoundaries = GetRecordBoundaries(bytes);
+		Check(setBoundaries.size() == meshes.size() + TEST_FRAMES + 1 && *setBoundaries.rbegin() == bytes.size(),
+			"trace is the header and one record per mesh and frame");
+
+		// Cut short at every length: only the ends of records are whole (shorter) traces
+		bool bTruncatedRefused = true;
+		bool bRecordEndsLoad = true;
+		for (size_t length = 0; length < bytes.size(); ++length)
+		{
+			WriteBytes(std::vector<char>(bytes.begin(), bytes.begin() + length));
+			if (setBoundaries.count(length) == 0)
+			{
+				bTruncatedRefused = bTruncatedRefused && LoadFails();
+			}
+			else
+			{
+				bRecordEndsLoad = bRecordEndsLoad && !LoadFails();
+			}
+		}
+		Check(bTruncatedRefused, "trace cut short inside the header or a record is refused");
+		Check(bRecordEndsLoad, "trace cut short between records loads");
+
+		// Other versions and other files
+		std::vector<char> modified = bytes;
+		const uint32_t otherVersion = FRAME_TRACE_VERSION + 1;
+		std::memcpy(modified.data() + offsetof(FrameTraceHeader, version), &otherVersion, sizeof(otherVersion));
+		WriteBytes(modified);
+		Check(LoadFails(), "trace of another version is refused");
+
+		modified = bytes;
+		const uint32_t otherMagic = FRAME_TRACE_MAGIC + 1;
+		std::memcpy(modified.data() + offsetof(FrameTraceHeader, magic), &otherMagic, sizeof(otherMagic));
+		WriteBytes(modified);
+		Check(LoadFails(), "file without the magic is refused");
+
+		// Unknown records between the meshes and the frames and at the end are skipped
+		const std::vector<char> unknownRecord = MakeUnknownRecord();
+		const size_t firstFrame = *std::next(setBoundaries.begin(), static_cast<std::ptrdiff_t>(meshes.size()));
+		modified.assign(bytes.begin(), bytes.begin() + firstFrame);
+		modified.insert(modified.end(), unknownRecord.begin(), unknownRecord.end());
+		modified.insert(modified.end(), bytes.begin() + firstFrame, bytes.end());
+		modified.insert(modified.end(), unknownRecord.begin(), unknownRecord.end());
+		WriteBytes(modified);
+		Check(SameTrace(LoadFrameTrace(TEST_TRACE_FILE), header, meshes, frames), "unknown record types are skipped");
+
+		// Unknown record cut short is still a cut short trace
+		modified.resize(modified.size() - 1);
+		WriteBytes(modified);
+		Check(LoadFails(), "unknown record cut short is refused");
+	}
+	catch (const std::runtime_error& e)
+	{
+		Check(false, e.what());
+	}
+	std::remove(TEST_TRACE_FILE);
+
+	return FinishChecks("frame trace");
+}
@@ -0,0 +1,157 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TestCheck.h"
+
+// Job system stress check, CPU only, repeated for many rounds on its own JobSystem
+// Chains of dependent stages never start a stage before the one it depends on finished, a job tree spawned from
+// a single worker finishes its counter exactly once everything ran (most of it stolen by other workers), and
+// main thread jobs run on the main thread only, wherever they were scheduled from
+namespace
+{
+	constexpr uint32_t TEST_WORKERS = 4;			// Fixed so stealing happens whatever the machine
+	constexpr uint32_t TEST_ROUNDS = 200;
+	constexpr uint32_t STAGE_COUNT = 8;
+	constexpr uint32_t STAGE_JOBS = 64;
+	constexpr uint32_t TREE_CHILDREN = 256;
+	constexpr uint32_t MAIN_THREAD_JOBS = 32;
+	constexpr auto JOB_WORK = std::chrono::microseconds(20);	// Long enough for thieves to find work in a queue
+
+	void DoWork()
+	{
+		const auto end = std::chrono::steady_clock::now() + JOB_WORK;
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+	}
+
+	// Every stage depends on the previous stage's counter, each of its jobs checks that stage completed in full
+	void TestDependencies(JobSystem& jobSystem)
+	{
+		std::vector<std::atomic<uint32_t>> vecCompleted(STAGE_COUNT);
+		std::vector<JobCounter> vecCounters(STAGE_COUNT);
+		std::atomic<uint32_t> earlyStarts{ 0 };
+
+		for (uint32_t stage = 0; stage < STAGE_COUNT; ++stage)
+		{
+			JobCounter* dependency = stage > 0 ? &vecCounters[stage - 1] : nullptr;
+			for (uint32_t job = 0; job < STAGE_JOBS; ++job)
+			{
+				jobSystem.Run([&vecCompleted, &earlyStarts, stage]
+				{
+					if (stage > 0 && vecCompleted[stage - 1].load() != STAGE_JOBS)
+					{
+						++earlyStarts;
+					}
+					DoWork();
+					++vecCompleted[stage];
+				}, &vecCounters[stage], dependency);
+			}
+		}
+
+		// Last stage done means every stage is, still waits on each so a broken ordering can't outlive the stack
+		jobSystem.Wait(vecCounters[STAGE_COUNT - 1]);
+		bool bAllRan = true;
+		for (uint32_t stage = 0; stage < STAGE_COUNT; ++stage)
+		{
+			bAllRan = bAllRan && vecCounters[stage].IsDone() && vecCompleted[stage].load() == STAGE_JOBS;
+			jobSystem.Wait(vecCounters[stage]);
+		}
+		Check(earlyStarts.load() == 0, "no job starts before the stage it depends on finished");
+		Check(bAllRan, "every stage ran in full once the last one is done");
+	}
+
+	// A worker schedules every child on its own queue, the others can only get them by stealing
+	void TestStealing(JobSystem& jobSystem, std::set<std::thread::id>& childThreads)
+	{
+		JobCounter counter;
+		std::atomic<uint32_t> childrenRun{ 0 };
+		std::mutex threadsMutex;
+
+		jobSystem.Run([&jobSystem, &counter, &childrenRun, &threadsMutex, &childThreads]
+		{
+			for (uint32_t child = 0; child < TREE_CHILDREN; ++child)
+			{
+				jobSystem.Run([&childrenRun, &threadsMutex, &childThreads]
+				{
+					DoWork();
+					{
+						std::lock_guard<std::mutex> lock(threadsMutex);
+						childThreads.insert(std::this_thread::get_id());
+					}
+					++childrenRun;
+				}, &counter);
+			}
+		}, &counter);
+
+		jobSystem.Wait(counter);
+		Check(childrenRun.load() == TREE_CHILDREN, "counter reaches zero only after every stolen job ran");
+		Check(counter.IsDone(), "counter stays done after the wait");
+	}
+
+	// Main thread jobs scheduled from the main thread, from workers, and behind a dependency
+	void TestMainThreadJobs(JobSystem& jobSystem, std::thread::id mainThreadId)
+	{
+		JobCounter workerCounter;
+		JobCounter mainCounter;
+		std::atomic<uint32_t> mainJobsRun{ 0 };
+		std::atomic<uint32_t> wrongThread{ 0 };
+
+		const auto mainThreadJob = [&jobSystem, &mainJobsRun, &wrongThread, mainThreadId]
+		{
+			if (std::this_thread::get_id() != mainThreadId || !jobSystem.IsMainThread())
+			{
+				++wrongThread;
+			}
+			++mainJobsRun;
+		};
+
+		for (uint32_t job = 0; job < MAIN_THREAD_JOBS; ++job)
+		{
+			jobSystem.RunOnMainThread(mainThreadJob, &mainCounter);
+			jobSystem.Run([&jobSystem, &mainCounter, mainThreadJob]
+			{
+				DoWork();
+				jobSystem.RunOnMainThread(mainThreadJob, &mainCounter);
+			}, &workerCounter);
+		}
+		// Waits for the workers' jobs before they are all released
+		jobSystem.RunOnMainThread(mainThreadJob, &mainCounter, &workerCounter);
+
+		jobSystem.Wait(workerCounter);
+		jobSystem.Wait(mainCounter);
+		Check(mainJobsRun.load() == 2 * MAIN_THREAD_JOBS + 1, "every main thread job ran");
+		Check(wrongThread.load() == 0, "main thread jobs only run on the main thread");
+	}
+}
+
+int mainTestJobSystem()
+{
+	JobSystem jobSystem;
+	jobSystem.InitJobSystem(TEST_WORKERS);
+	const std::thread::id mainThreadId = std::this_thread::get_id();
+
+	std::set<std::thread::id> childThreads;
+	for (uint32_t round = 0; round < TEST_ROUNDS && GetCheckFailures().load() == 0; ++round)
+	{
+		TestDependencies(jobSystem);
+		TestStealing(jobSystem, childThreads);
+		TestMainThreadJobs(jobSystem, mainThreadId);
+	}
+
+	// Workers are real threads, on a single core machine the spawning worker may run its whole tree itself
+	if (std::thread::hardware_concurrency() > 1)
+	{
+		Check(childThreads.size() > 1, "job tree of one worker is stolen by others");
+	}
+	jobSystem.ShutdownJobSystem();
+
+	printf("Job system: %u rounds, job trees ran on %zu threads\n", TEST_ROUNDS, childThreads.size());
+	return FinishChecks("job system");
+}
@@ -0,0 +1,250 @@
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "MeshLod.h"
+#include "TestCheck.h"
+
+// Level of detail check, CPU only
+// A closed sphere with an attribute seam: every level has fewer indices than the one before, errors never decrease
+// along the chain, and the seam's vertices and edges are in every level. An open bumpy grid: every level keeps
+// the grid's outline. SelectLod with hysteresis doesn't switch back and forth on a threshold
+namespace
+{
+	constexpr float TEST_PI = 3.14159265358979f;
+	constexpr uint32_t SPHERE_RINGS = 32;			// Latitude bands, pole to pole
+	constexpr uint32_t SPHERE_SEGMENTS = 64;		// Around, the last column repeats the first one's positions
+	constexpr uint32_t GRID_CELLS = 32;				// Per side
+	constexpr uint32_t TEST_LOD_COUNT = 5;
+
+	using Edge = std::pair<uint32_t, uint32_t>;
+
+	Edge MakeEdge(uint32_t a, uint32_t b)
+	{
+		return a < b ? Edge(a, b) : Edge(b, a);
+	}
+
+	// Uses of every edge of indices[first, first + count), vertices with the same position count as one
+	std::map<Edge, uint32_t> CountEdges(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		uint32_t first, uint32_t count)
+	{
+		std::map<std::vector<float>, uint32_t> mapPositions;
+		std::vector<uint32_t> vecPositionIndex(vertices.size());
+		for (uint32_t i = 0; i < vertices.size(); ++i)
+		{
+			const std::vector<float> key = { vertices[i].pos.x, vertices[i].pos.y, vertices[i].pos.z };
+			vecPositionIndex[i] = mapPositions.emplace(key, i).first->second;
+		}
+
+		std::map<Edge, uint32_t> mapEdges;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint32_t a = indices[first + i];
+			const uint32_t b = indices[first + i - i % 3 + (i + 1) % 3];
+			++mapEdges[MakeEdge(vecPositionIndex[a], vecPositionIndex[b])];
+		}
+		return mapEdges;
+	}
+
+	bool HasEdge(const std::vector<uint32_t>& indices, const MeshLod& lod, uint32_t a, uint32_t b)
+	{
+		for (uint32_t i = 0; i < lod.indexCount; i += 3)
+		{
+			const uint32_t* triangle = &indices[lod.firstIndex + i];
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				if (MakeEdge(triangle[corner], triangle[(corner + 1) % 3]) == MakeEdge(a, b))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void CheckChain(const std::vector<Vertex>& vertices, const MeshLodChain& chain)
+	{
+		Check(chain.lods.size() >= 3, "chain has at least two simplified levels");
+		Check(chain.lods[0].firstIndex == 0 && chain.lods[0].error == 0.0f, "level 0 is the full detail mesh");
+
+		for (size_t level = 0; level < chain.lods.size(); ++level)
+		{
+			const MeshLod& lod = chain.lods[level];
+			Check(lod.indexCount % 3 == 0 && lod.firstIndex + lod.indexCount <= chain.indices.size(), "level is whole triangles in the index buffer");
+			bool bIndicesValid = true;
+			for (uint32_t i = 0; i < lod.indexCount; ++i)
+			{
+				bIndicesValid = bIndicesValid && chain.indices[lod.firstIndex + i] < vertices.size();
+			}
+			Check(bIndicesValid, "level only indexes existing vertices");
+
+			if (level > 0)
+			{
+				Check(lod.indexCount < chain.lods[level - 1].indexCount, "index count falls at every level");
+				Check(lod.error >= chain.lods[level - 1].error, "error never decreases along the chain");
+			}
+		}
+		Check(chain.lods.back().error > 0.0f, "curved mesh can't be simplified without error");
+	}
+
+	uint32_t SphereIndex(uint32_t ring, uint32_t segment)
+	{
+		return 1 + (ring - 1) * (SPHERE_SEGMENTS + 1) + segment;
+	}
+
+	void TestClosedSphere()
+	{
+		// Poles, then rings 1 to SPHERE_RINGS - 1. Color follows the segment, so the seam column differs in color only
+		std::vector<Vertex> vertices;
+		vertices.push_back({ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f) });
+		for (uint32_t ring = 1; ring < SPHERE_RINGS; ++ring)
+		{
+			const float theta = TEST_PI * static_cast<float>(ring) / SPHERE_RINGS;
+			for (uint32_t segment = 0; segment <= SPHERE_SEGMENTS; ++segment)
+			{
+				const float phi = 2.0f * TEST_PI * static_cast<float>(segment % SPHERE_SEGMENTS) / SPHERE_SEGMENTS;
+				const glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				vertices.push_back({ position, glm::vec3(static_cast<float>(segment) / SPHERE_SEGMENTS, 0.0f, 0.0f) });
+			}
+		}
+		const uint32_t southPole = static_cast<uint32_t>(vertices.size());
+		vertices.push_back({ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f) });
+
+		std::vector<uint32_t> indices;
+		for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; ++segment)
+		{
+			indices.insert(indices.end(), { 0, SphereIndex(1, segment), SphereIndex(1, segment + 1) });
+			for (uint32_t ring = 1; ring + 1 < SPHERE_RINGS; ++ring)
+			{
+				const uint32_t a = SphereIndex(ring, segment);
+				const uint32_t b = SphereIndex(ring, segment + 1);
+				const uint32_t c = SphereIndex(ring + 1, segment);
+				const uint32_t d = SphereIndex(ring + 1, segment + 1);
+				indices.insert(indices.end(), { a, c, b, b, c, d });
+			}
+			indices.insert(indices.end(), { southPole, SphereIndex(SPHERE_RINGS - 1, segment + 1), SphereIndex(SPHERE_RINGS - 1, segment) });
+		}
+
+		bool bClosed = true;
+		for (const auto& edge : CountEdges(vertices, indices, 0, static_cast<uint32_t>(indices.size())))
+		{
+			bClosed = bClosed && edge.second == 2;
+		}
+		Check(bClosed, "test sphere is closed");
+
+		const MeshLodChain chain = BuildLodChain(vertices, indices, TEST_LOD_COUNT);
+		CheckChain(vertices, chain);
+
+		// Seam vertices are locked: never collapsed, so both sides of the seam keep every edge along it
+		bool bSeamKept = true;
+		for (size_t level = 1; level < chain.lods.size(); ++level)
+		{
+			for (uint32_t ring = 1; ring + 1 < SPHERE_RINGS; ++ring)
+			{
+				bSeamKept = bSeamKept && HasEdge(chain.indices, chain.lods[level], SphereIndex(ring, 0), SphereIndex(ring + 1, 0))
+					&& HasEdge(chain.indices, chain.lods[level], SphereIndex(ring, SPHERE_SEGMENTS), SphereIndex(ring + 1, SPHERE_SEGMENTS));
+			}
+		}
+		Check(bSeamKept, "attribute seam edges are in every level");
+	}
+
+	void TestOpenGrid()
+	{
+		std::vector<Vertex> vertices;
+		for (uint32_t y = 0; y <= GRID_CELLS; ++y)
+		{
+			for (uint32_t x = 0; x <= GRID_CELLS; ++x)
+			{
+				const float u = static_cast<float>(x) / GRID_CELLS;
+				const float v = static_cast<float>(y) / GRID_CELLS;
+				const float height = 0.1f * std::sin(u * 2.0f * TEST_PI) * std::cos(v * 2.0f * TEST_PI);
+				vertices.push_back({ glm::vec3(u, v, height), glm::vec3(1.0f) });
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y < GRID_CELLS; ++y)
+		{
+			for (uint32_t x = 0; x < GRID_CELLS; ++x)
+			{
+				const uint32_t a = y * (GRID_CELLS + 1) + x;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + GRID_CELLS + 1;
+				const uint32_t d = c + 1;
+				indices.insert(indices.end(), { a, b, c, b, d, c });
+			}
+		}
+
+		const MeshLodChain chain = BuildLodChain(vertices, indices, TEST_LOD_COUNT);
+		CheckChain(vertices, chain);
+
+		// Border vertices are locked, so the outline (edges of one triangle) is the same at every level
+		std::vector<Edge> vecBorder;
+		for (const auto& edge : CountEdges(vertices, chain.indices, 0, chain.lods[0].indexCount))
+		{
+			if (edge.second == 1)
+			{
+				vecBorder.push_back(edge.first);
+			}
+		}
+		Check(vecBorder.size() == 4 * GRID_CELLS, "test grid's outline is its four sides");
+
+		for (size_t level = 1; level < chain.lods.size(); ++level)
+		{
+			const std::map<Edge, uint32_t> mapEdges = CountEdges(vertices, chain.indices, chain.lods[level].firstIndex, chain.lods[level].indexCount);
+			bool bBorderKept = true;
+			for (const Edge& edge : vecBorder)
+			{
+				const auto found = mapEdges.find(edge);
+				bBorderKept = bBorderKept && found != mapEdges.end() && found->second == 1;
+			}
+			Check(bBorderKept, "border edges are in every level");
+		}
+	}
+
+	// Frames in a row spent on the threshold between two levels, counts how often the selection changes
+	uint32_t CountSwitches(const std::vector<MeshLod>& lods, float lowPixelsPerUnit, float highPixelsPerUnit,
+		uint32_t startLod, float hysteresis, uint32_t& outLod)
+	{
+		uint32_t switches = 0;
+		uint32_t current = startLod;
+		for (uint32_t frame = 0; frame < 16; ++frame)
+		{
+			const uint32_t selected = SelectLod(lods, frame % 2 == 0 ? lowPixelsPerUnit : highPixelsPerUnit, 1.0f, current, hysteresis);
+			switches += selected != current ? 1 : 0;
+			current = selected;
+		}
+		outLod = current;
+		return switches;
+	}
+
+	void TestHysteresis()
+	{
+		std::vector<MeshLod> lods(4);
+		lods[1].error = 1.0f;
+		lods[2].error = 2.0f;
+		lods[3].error = 4.0f;
+		constexpr float hysteresis = 0.25f;
+
+		// Level 1's error is 1 pixel at 1 pixel per unit, moving back and forth across it
+		uint32_t lod = 0;
+		Check(CountSwitches(lods, 0.95f, 1.05f, 0, 0.0f, lod) == 16, "without hysteresis the selection flips every frame on a threshold");
+		Check(CountSwitches(lods, 0.95f, 1.05f, 0, hysteresis, lod) == 0 && lod == 0, "finer level stays on its coarsening threshold");
+		Check(CountSwitches(lods, 0.95f, 1.05f, 1, hysteresis, lod) == 1 && lod == 0, "coarser level goes finer once on its threshold");
+		Check(CountSwitches(lods, 0.7f, 0.8f, 0, hysteresis, lod) == 1 && lod == 1, "level goes coarser once inside the hysteresis band");
+
+		// Far enough either side the selection doesn't depend on the current level
+		Check(SelectLod(lods, 0.1f, 1.0f, 0, hysteresis) == 3 && SelectLod(lods, 0.1f, 1.0f, 3, hysteresis) == 3, "far away selects the coarsest level");
+		Check(SelectLod(lods, 10.0f, 1.0f, 0, hysteresis) == 0 && SelectLod(lods, 10.0f, 1.0f, 3, hysteresis) == 0, "close up selects full detail");
+	}
+}
+
+int mainTestMeshLod()
+{
+	TestClosedSphere();
+	TestOpenGrid();
+	TestHysteresis();
+
+	return FinishChecks("level of detail");
+}
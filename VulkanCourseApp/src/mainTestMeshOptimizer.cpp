@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "MeshOptimizer.h"
+#include "TestCheck.h"
+
+// Mesh optimizer check, CPU only, on meshes with their triangles shuffled (the worst case for the vertex cache)
+// Every pass must keep the same triangles with the same winding, only reordered. After the vertex fetch pass every
+// index points at the vertex it pointed at before, vertices are in order of first use, and ACMR is never worse
+// than the input's
+namespace
+{
+	constexpr float TEST_PI = 3.14159265358979f;
+	constexpr uint32_t SPHERE_RINGS = 48;
+	constexpr uint32_t SPHERE_SEGMENTS = 96;
+	constexpr uint32_t GRID_CELLS = 64;
+	constexpr uint32_t SHUFFLE_SEED = 1;
+
+	using Triangle = std::array<uint32_t, 3>;
+
+	// Every vertex remembers its original index in its color, so triangles can be compared across vertex reordering
+	Vertex MakeVertex(const glm::vec3& position, size_t originalIndex)
+	{
+		return { position, glm::vec3(static_cast<float>(originalIndex), 0.0f, 0.0f) };
+	}
+
+	// Original vertices of every triangle, rotated to start at the smallest (winding is kept), sorted
+	std::vector<Triangle> GetTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::vector<Triangle> vecTriangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Triangle triangle;
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				triangle[corner] = static_cast<uint32_t>(vertices[indices[i + corner]].col.x);
+			}
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			vecTriangles.push_back(triangle);
+		}
+		std::sort(vecTriangles.begin(), vecTriangles.end());
+		return vecTriangles;
+	}
+
+	void ShuffleTriangles(std::vector<uint32_t>& indices)
+	{
+		std::vector<Triangle> vecTriangles(indices.size() / 3);
+		for (size_t i = 0; i < vecTriangles.size(); ++i)
+		{
+			vecTriangles[i] = { indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] };
+		}
+		std::mt19937 random(SHUFFLE_SEED);
+		std::shuffle(vecTriangles.begin(), vecTriangles.end(), random);
+		for (size_t i = 0; i < vecTriangles.size(); ++i)
+		{
+			std::copy(vecTriangles[i].begin(), vecTriangles[i].end(), indices.begin() + i * 3);
+		}
+	}
+
+	void CheckOptimization(const char* meshName, std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+	{
+		printf("%s: %zu triangles\n", meshName, indices.size() / 3);
+		const std::vector<Triangle> vecInputTriangles = GetTriangles(vertices, indices);
+		const float inputAcmr = AnalyzeVertexCache(indices, vertices.size()).acmr;
+
+		// Each pass on its own, triangles are only reordered and ACMR doesn't go up
+		OptimizeVertexCache(indices, vertices.size());
+		Check(GetTriangles(vertices, indices) == vecInputTriangles, "vertex cache pass only reorders triangles");
+		const float cacheAcmr = AnalyzeVertexCache(indices, vertices.size()).acmr;
+		Check(cacheAcmr <= inputAcmr, "vertex cache pass doesn't make ACMR worse");
+
+		OptimizeOverdraw(indices, vertices);
+		Check(GetTriangles(vertices, indices) == vecInputTriangles, "overdraw pass only reorders triangles");
+		const float overdrawAcmr = AnalyzeVertexCache(indices, vertices.size()).acmr;
+		Check(overdrawAcmr <= inputAcmr, "overdraw pass doesn't make ACMR worse than the input");
+
+		const size_t inputVertexCount = vertices.size();
+		OptimizeVertexFetch(vertices, indices);
+		Check(GetTriangles(vertices, indices) == vecInputTriangles, "vertex fetch pass keeps the triangles");
+		Check(vertices.size() < inputVertexCount, "vertex fetch pass drops the unused vertex");
+
+		// Every index valid, vertices numbered in order of first use
+		bool bIndicesValid = true;
+		bool bFirstUseOrder = true;
+		uint32_t nextVertex = 0;
+		for (const uint32_t index : indices)
+		{
+			bIndicesValid = bIndicesValid && index < vertices.size();
+			if (index == nextVertex)
+			{
+				++nextVertex;
+			}
+			bFirstUseOrder = bFirstUseOrder && index < nextVertex;
+		}
+		Check(bIndicesValid, "indices are valid after the vertex fetch pass");
+		Check(bFirstUseOrder && nextVertex == vertices.size(), "vertices are in order of first use");
+		Check(AnalyzeVertexCache(indices, vertices.size()).acmr == overdrawAcmr, "vertex fetch pass doesn't change ACMR");
+
+		printf("  ACMR %.3f in, %.3f vertex cache, %.3f overdraw\n", inputAcmr, cacheAcmr, overdrawAcmr);
+	}
+
+	void TestSphere()
+	{
+		std::vector<Vertex> vertices;
+		for (uint32_t ring = 0; ring <= SPHERE_RINGS; ++ring)
+		{
+			const float theta = TEST_PI * static_cast<float>(ring) / SPHERE_RINGS;
+			for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; ++segment)
+			{
+				const float phi = 2.0f * TEST_PI * static_cast<float>(segment) / SPHERE_SEGMENTS;
+				vertices.push_back(MakeVertex(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)), vertices.size()));
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		for (uint32_t ring = 0; ring < SPHERE_RINGS; ++ring)
+		{
+			for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; ++segment)
+			{
+				const uint32_t a = ring * SPHERE_SEGMENTS + segment;
+				const uint32_t b = ring * SPHERE_SEGMENTS + (segment + 1) % SPHERE_SEGMENTS;
+				const uint32_t c = a + SPHERE_SEGMENTS;
+				const uint32_t d = b + SPHERE_SEGMENTS;
+				indices.insert(indices.end(), { a, c, b, b, c, d });
+			}
+		}
+
+		// Never indexed, the vertex fetch pass drops it
+		vertices.push_back(MakeVertex(glm::vec3(2.0f), vertices.size()));
+
+		ShuffleTriangles(indices);
+		CheckOptimization("Sphere", vertices, indices);
+	}
+
+	void TestGrid()
+	{
+		std::vector<Vertex> vertices;
+		vertices.push_back(MakeVertex(glm::vec3(-1.0f), 0));		// Unused, first so every other index moves
+		for (uint32_t y = 0; y <= GRID_CELLS; ++y)
+		{
+			for (uint32_t x = 0; x <= GRID_CELLS; ++x)
+			{
+				vertices.push_back(MakeVertex(glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f), vertices.size()));
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y < GRID_CELLS; ++y)
+		{
+			for (uint32_t x = 0; x < GRID_CELLS; ++x)
+			{
+				const uint32_t a = 1 + y * (GRID_CELLS + 1) + x;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + GRID_CELLS + 1;
+				const uint32_t d = c + 1;
+				indices.insert(indices.end(), { a, b, c, b, d, c });
+			}
+		}
+
+		ShuffleTriangles(indices);
+		CheckOptimization("Grid", vertices, indices);
+	}
+
+	void TestOptimizeMesh()
+	{
+		// All passes together report the same numbers as analysing the result
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		for (uint32_t i = 0; i < 64; ++i)
+		{
+			vertices.push_back(MakeVertex(glm::vec3(std::cos(i * 0.1f), std::sin(i * 0.1f), 0.0f), i));
+		}
+		for (uint32_t i = 0; i + 2 < 64; ++i)
+		{
+			indices.insert(indices.end(), { 0, i + 1, i + 2 });
+		}
+		ShuffleTriangles(indices);
+
+		const std::vector<Triangle> vecInputTriangles = GetTriangles(vertices, indices);
+		const MeshOptimizationStats stats = OptimizeMesh(vertices, indices);
+		Check(GetTriangles(vertices, indices) == vecInputTriangles, "optimised mesh has the same triangles");
+		Check(stats.after.acmr <= stats.before.acmr, "optimised mesh's ACMR isn't worse");
+		Check(stats.after.acmr == AnalyzeVertexCache(indices, vertices.size()).acmr, "optimised mesh's stats match its indices");
+
+		// Nothing to do
+		std::vector<Vertex> vecNoVertices;
+		std::vector<uint32_t> vecNoIndices;
+		OptimizeMesh(vecNoVertices, vecNoIndices);
+		Check(vecNoVertices.empty() && vecNoIndices.empty(), "empty mesh stays empty");
+	}
+}
+
+int mainTestMeshOptimizer()
+{
+	TestSphere();
+	TestGrid();
+	TestOptimizeMesh();
+
+	return FinishChecks("mesh optimizer");
+}
@@ -0,0 +1,110 @@
+#include "GeometryPool.h"
+#include "TestCheck.h"
+
+// Range allocator check, CPU only: filling to capacity, freed ranges merging with free neighbours on either side,
+// and a pool allocation whose indices don't fit leaving the vertex allocator as it was
+namespace
+{
+	constexpr uint32_t TEST_CAPACITY = 100;
+	constexpr uint32_t TEST_BLOCK = 10;			// Capacity is filled with blocks of this size
+
+	void FillToCapacity(RangeAllocator& allocator)
+	{
+		allocator.InitRangeAllocator(TEST_CAPACITY);
+		for (uint32_t expected = 0; expected < TEST_CAPACITY; expected += TEST_BLOCK)
+		{
+			uint32_t offset = UINT32_MAX;
+			Check(allocator.Allocate(TEST_BLOCK, offset), "block allocation below capacity succeeds");
+			Check(offset == expected, "blocks are handed out front to back");
+		}
+	}
+
+	void TestCapacity()
+	{
+		RangeAllocator allocator;
+		FillToCapacity(allocator);
+		Check(allocator.GetFreeCount() == 0, "nothing is free at capacity");
+		Check(allocator.GetLargestFreeRange() == 0, "no free range at capacity");
+
+		uint32_t offset = UINT32_MAX;
+		Check(!allocator.Allocate(1, offset), "allocation past capacity fails");
+		Check(allocator.Allocate(0, offset), "empty allocation succeeds at capacity");
+
+		// Exactly the whole capacity in one piece
+		allocator.InitRangeAllocator(TEST_CAPACITY);
+		Check(!allocator.Allocate(TEST_CAPACITY + 1, offset), "allocation larger than capacity fails");
+		Check(allocator.GetFreeCount() == TEST_CAPACITY, "failed allocation takes nothing");
+		Check(allocator.Allocate(TEST_CAPACITY, offset) && offset == 0, "allocation of the whole capacity succeeds");
+		Check(allocator.GetFreeCount() == 0, "whole capacity allocated");
+	}
+
+	void TestMerging()
+	{
+		RangeAllocator allocator;
+		FillToCapacity(allocator);
+
+		// [40, 50) alone, then [50, 60) right after it merges with its left neighbour
+		allocator.Free(40, TEST_BLOCK);
+		Check(allocator.GetLargestFreeRange() == TEST_BLOCK, "freed block is free");
+		allocator.Free(50, TEST_BLOCK);
+		Check(allocator.GetLargestFreeRange() == 2 * TEST_BLOCK, "freed block merges with the free range on its left");
+
+		// [30, 40) merges with the free range on its right
+		allocator.Free(30, TEST_BLOCK);
+		Check(allocator.GetLargestFreeRange() == 3 * TEST_BLOCK, "freed block merges with the free range on its right");
+
+		// [10, 20) isn't next to anything free, then [20, 30) joins it to [30, 60)
+		allocator.Free(10, TEST_BLOCK);
+		Check(allocator.GetLargestFreeRange() == 3 * TEST_BLOCK, "freed block apart from free ranges doesn't merge");
+		allocator.Free(20, TEST_BLOCK);
+		Check(allocator.GetLargestFreeRange() == 5 * TEST_BLOCK, "freed block merges with free ranges on both sides");
+		Check(allocator.GetFreeCount() == 5 * TEST_BLOCK, "free count covers every freed block");
+
+		// First fit: a block goes in to the merged range's front, a bigger range than any free one doesn't fit
+		uint32_t offset = UINT32_MAX;
+		Check(allocator.Allocate(TEST_BLOCK, offset) && offset == 10, "allocation takes the front of the first fitting range");
+		Check(!allocator.Allocate(5 * TEST_BLOCK, offset), "allocation larger than the largest free range fails");
+		allocator.Free(10, TEST_BLOCK);
+
+		// Everything back is the whole capacity again, in one range
+		allocator.Free(0, TEST_BLOCK);
+		for (uint32_t blockOffset = 6 * TEST_BLOCK; blockOffset < TEST_CAPACITY; blockOffset += TEST_BLOCK)
+		{
+			allocator.Free(blockOffset, TEST_BLOCK);
+		}
+		Check(allocator.GetFreeCount() == TEST_CAPACITY, "every block freed");
+		Check(allocator.GetLargestFreeRange() == TEST_CAPACITY, "every freed block merged in to one range");
+		Check(allocator.Allocate(TEST_CAPACITY, offset) && offset == 0, "whole capacity allocates after merging");
+	}
+
+	void TestRollback()
+	{
+		RangeAllocator vertexRanges;
+		RangeAllocator indexRanges;
+		vertexRanges.InitRangeAllocator(TEST_CAPACITY);
+		indexRanges.InitRangeAllocator(TEST_BLOCK);
+
+		GeometryRange range;
+		range.vertexCount = TEST_BLOCK;
+		range.indexCount = TEST_BLOCK + 1;
+		Check(!AllocateGeometryRange(vertexRanges, indexRanges, range), "range whose indices don't fit fails");
+		Check(vertexRanges.GetFreeCount() == TEST_CAPACITY, "failed range gives its vertices back");
+		Check(vertexRanges.GetLargestFreeRange() == TEST_CAPACITY, "given back vertices merge in to one range");
+		Check(indexRanges.GetFreeCount() == TEST_BLOCK, "failed range takes no indices");
+
+		range.indexCount = TEST_BLOCK;
+		Check(AllocateGeometryRange(vertexRanges, indexRanges, range), "range that fits succeeds");
+		Check(range.vertexOffset == 0 && range.firstIndex == 0, "range after a failed one starts at the front");
+		Check(vertexRanges.GetFreeCount() == TEST_CAPACITY - TEST_BLOCK, "range takes its vertices");
+		Check(indexRanges.GetFreeCount() == 0, "range takes its indices");
+	}
+}
+
+int mainTestRangeAllocator()
+{
+	TestCapacity();
+	TestMerging();
+	TestRollback();
+
+	return FinishChecks("range allocator");
+}